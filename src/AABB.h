@@ -0,0 +1,102 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_AABB_H
+#define TRACER_AABB_H
+
+#include <limits>
+
+#include <SYCL/sycl.hpp>
+#include "Common.h"
+#include "Vector.h"
+
+namespace Tracer {
+
+///
+/// \brief An axis aligned bounding box.  Used to bound primatives when building acceleration structures.
+/// \note An AABB is "empty" by default (min is +INF and max is -INF) so that growing it by anything gives the correct result
+///
+class AABB {
+public:
+    AABB()
+        : min_(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity()),
+          max_(-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()) {}
+    AABB(const Vector3f &min, const Vector3f &max) : min_(min), max_(max) {}
+    ///
+    /// \brief Grows the box to contain the point
+    ///
+    void Grow(const Vector3f &p) {
+        for (uint i=0; i<3; i++) {
+            min_[i] = p[i] < min_[i] ? p[i] : min_[i];
+            max_[i] = p[i] > max_[i] ? p[i] : max_[i];
+        }
+    }
+    ///
+    /// \brief Grows the box to contain another box
+    ///
+    void Grow(const AABB &b) {
+        if (b.IsEmpty()) return;
+        Grow(b.min_);
+        Grow(b.max_);
+    }
+    ///
+    /// \brief Returns true if the box contains nothing
+    ///
+    bool IsEmpty() const { return min_[0] > max_[0] || min_[1] > max_[1] || min_[2] > max_[2]; }
+    ///
+    /// \brief Returns the center of the box
+    ///
+    Vector3f Centroid() const { return Vector3f(min_ + max_) * .5F; }
+    ///
+    /// \brief Returns the size of the box along each axis
+    ///
+    Vector3f Extent() const { return Vector3f(max_ - min_); }
+    ///
+    /// \brief Returns the surface area of the box (0 if the box is empty)
+    ///
+    float SurfaceArea() const {
+        if (IsEmpty()) return 0;
+        const Vector3f e = Extent();
+        return 2 * (e.X()*e.Y() + e.Y()*e.Z() + e.Z()*e.X());
+    }
+    ///
+    /// \brief Returns the index of the longest axis of the box
+    ///
+    uint LongestAxis() const {
+        const Vector3f e = Extent();
+        return e.X() > e.Y() ? (e.X() > e.Z() ? 0 : 2) : (e.Y() > e.Z() ? 1 : 2);
+    }
+    const Vector3f &Min() const { return min_; }
+    const Vector3f &Max() const { return max_; }
+private:
+    ///
+    /// \brief the corner of the box with the smallest values
+    ///
+    Vector3f min_;
+    ///
+    /// \brief the corner of the box with the largest values
+    ///
+    Vector3f max_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_AABB_H
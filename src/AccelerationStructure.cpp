@@ -0,0 +1,319 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "AccelerationStructure.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Scene.h"
+
+namespace Tracer {
+
+void AccelerationStructure::Build(const Scene &scene, cl::sycl::queue *queue) {
+    buildMethod_ = scene.GetBVHBuildMethod();
+    nodes_.clear();
+    indices_.clear();
+    primatives_.clear();
+    instances_.clear();
+    objectRoots_.clear();
+    objectBounds_.assign(scene.GetObjects().size(), AABB());
+
+    // the scene's own primatives (root is node 0)
+    // room is left for the biggest tree the primatives can produce so it can be rebuilt in place later
+    primatives_ = scene.GetPrimatives();
+    const uint primativeCount = static_cast<uint>(primatives_.size());
+    nodes_.resize(primativeCount == 0 ? 1 : 2*primativeCount - 1);
+    indices_.resize(primativeCount);
+    sceneBVH_.Build(primatives_, buildMethod_, queue);
+    sceneBuildCost_ = sceneBVH_.GetCost();
+    CopySceneBVH();
+
+    // every object is built only once no matter how many instances of it there are
+    for (uint i=0; i<scene.GetObjects().size(); i++)
+        objectRoots_.push_back(AppendPrimatives(scene.GetObjects()[i], &objectBounds_[i], queue));
+    primativeArrays_.Build(primatives_);
+
+    for (const Instance &instance : scene.GetInstances()) {
+        BVHInstance bvhInstance;
+        bvhInstance.worldToObject = instance.transform.Inverse();
+        bvhInstance.rootNode = objectRoots_[instance.objectId];
+        bvhInstance.wideRootNode = 0;
+        bvhInstance.materialOverride = instance.materialOverride;
+        instances_.push_back(bvhInstance);
+    }
+    topLevelRoot_ = static_cast<uint>(nodes_.size());
+    topLevelFirstIndex_ = static_cast<uint>(indices_.size());
+    BuildTopLevel(scene, queue);
+    CollapseWideNodes();
+    nodeChanges_.AddAll(nodes_.size());
+    indexChanges_.AddAll(indices_.size());
+    instanceChanges_.AddAll(instances_.size());
+    primativeChanges_.AddAll(primatives_.size());
+}
+
+bool AccelerationStructure::Update(const Scene &scene, const std::vector<uint> &changedPrimatives, const std::vector<uint> &changedInstances,
+                                   float rebuildThreshold, cl::sycl::queue *queue) {
+    // refitting can't handle a different number of things
+    if (scene.GetPrimatives().size() != sceneBVH_.GetIndices().size()
+            || scene.GetObjects().size() != objectRoots_.size()
+            || scene.GetInstances().size() != instances_.size()
+            || scene.GetBVHBuildMethod() != buildMethod_) {
+        Build(scene, queue);
+        return true;
+    }
+
+    bool rebuilt = false;
+    // ids in nodes_ of every node that was only refit
+    std::vector<uint> refitNodes;
+    std::vector<uint> changedNodes;
+
+    if (!changedPrimatives.empty()) {
+        for (uint primativeId : changedPrimatives) {
+            primatives_[primativeId] = scene.GetPrimatives()[primativeId];
+            primativeChanges_.Add(primativeId);
+        }
+        primativeArrays_.Update(primatives_, changedPrimatives);
+        sceneBVH_.Refit([this](uint primativeId) { return primatives_[primativeId].GetBoundingBox(); },
+                        changedPrimatives, &changedNodes);
+        if (sceneBVH_.GetCost() > rebuildThreshold * sceneBuildCost_) {
+            sceneBVH_.Build(primatives_, buildMethod_, queue);
+            sceneBuildCost_ = sceneBVH_.GetCost();
+            CopySceneBVH();
+            rebuilt = true;
+        } else {
+            CopyNodes(sceneBVH_, changedNodes, 0, 0);
+            refitNodes.insert(refitNodes.end(), changedNodes.begin(), changedNodes.end());
+        }
+    }
+
+    if (!changedInstances.empty()) {
+        for (uint instanceId : changedInstances) {
+            const Instance &instance = scene.GetInstances()[instanceId];
+            instances_[instanceId].worldToObject = instance.transform.Inverse();
+            instances_[instanceId].materialOverride = instance.materialOverride;
+            instanceChanges_.Add(instanceId);
+        }
+        changedNodes.clear();
+        topLevelBVH_.Refit([this, &scene](uint instanceId) { return GetInstanceBounds(scene.GetInstances()[instanceId]); },
+                           changedInstances, &changedNodes);
+        if (topLevelBVH_.GetCost() > rebuildThreshold * topLevelBuildCost_) {
+            // the top level BVH is last so it can simply be replaced
+            BuildTopLevel(scene, queue);
+            rebuilt = true;
+        } else {
+            CopyNodes(topLevelBVH_, changedNodes, topLevelRoot_, topLevelFirstIndex_);
+            for (uint nodeId : changedNodes)
+                refitNodes.push_back(topLevelRoot_ + nodeId);
+        }
+    }
+
+    // rebuilding moves binary nodes around so everything is collapsed again, refitting only changes some of their bounds
+    if (rebuilt)
+        CollapseWideNodes();
+    else
+        RefitWideNodes(refitNodes);
+    return rebuilt;
+}
+
+void AccelerationStructure::SetNodeWidth(uint nodeWidth) {
+    if (nodeWidth != 2 && nodeWidth != 4 && nodeWidth != 8)
+        throw std::invalid_argument("BVH nodes must be 2, 4, or 8 wide");
+    nodeWidth_ = nodeWidth;
+    CollapseWideNodes();
+}
+
+void AccelerationStructure::SetCompressedNodes(bool compressedNodes) {
+    compressedNodes_ = compressedNodes;
+    CollapseWideNodes();
+}
+
+void AccelerationStructure::CollapseWideNodes() {
+    nodes4_.clear();
+    nodes8_.clear();
+    quantizedNodes2_.clear();
+    quantizedNodes4_.clear();
+    quantizedNodes8_.clear();
+    wideChildSources_.clear();
+    wideChildSlots_.clear();
+    if (compressedNodes_ && nodeWidth_ == 2)
+        wideTopLevelRoot_ = CompressAll(&quantizedNodes2_);
+    else if (compressedNodes_ && nodeWidth_ == 4)
+        wideTopLevelRoot_ = CompressAll(&quantizedNodes4_);
+    else if (compressedNodes_ && nodeWidth_ == 8)
+        wideTopLevelRoot_ = CompressAll(&quantizedNodes8_);
+    else if (nodeWidth_ == 4)
+        wideTopLevelRoot_ = CollapseAll(&nodes4_);
+    else if (nodeWidth_ == 8)
+        wideTopLevelRoot_ = CollapseAll(&nodes8_);
+    // whichever layout is kept was made from scratch, and the instances got new wide roots
+    wideNodeChanges_.AddAll(nodes4_.size() + nodes8_.size() + quantizedNodes2_.size() + quantizedNodes4_.size() + quantizedNodes8_.size());
+    instanceChanges_.AddAll(instances_.size());
+}
+
+void AccelerationStructure::RefitWideNodes(const std::vector<uint> &changedNodes) {
+    if (compressedNodes_ && nodeWidth_ == 2)
+        RefitCompressed(changedNodes, &quantizedNodes2_);
+    else if (compressedNodes_ && nodeWidth_ == 4)
+        RefitCompressed(changedNodes, &quantizedNodes4_);
+    else if (compressedNodes_ && nodeWidth_ == 8)
+        RefitCompressed(changedNodes, &quantizedNodes8_);
+    else if (nodeWidth_ == 4)
+        RefitCollapsed(changedNodes, &nodes4_);
+    else if (nodeWidth_ == 8)
+        RefitCollapsed(changedNodes, &nodes8_);
+}
+
+template<uint Width>
+uint AccelerationStructure::CollapseAll(std::vector<WideBVHNode<Width>> *wideNodes) {
+    if (nodes_.empty()) return 0;
+
+    // same order as the binary nodes: the scene's BVH (so its root is also 0), every object, then the top level
+    WideBVH<Width>::Collapse(nodes_, 0, wideNodes, &wideChildSources_);
+    std::vector<uint> wideObjectRoots;
+    for (uint objectRoot : objectRoots_)
+        wideObjectRoots.push_back(WideBVH<Width>::Collapse(nodes_, objectRoot, wideNodes, &wideChildSources_));
+    for (BVHInstance &instance : instances_) {
+        // objects are appended in order so their roots are sorted
+        const uint objectId = static_cast<uint>(std::lower_bound(objectRoots_.begin(), objectRoots_.end(), instance.rootNode) - objectRoots_.begin());
+        instance.wideRootNode = wideObjectRoots[objectId];
+    }
+    const uint wideTopLevelRoot = WideBVH<Width>::Collapse(nodes_, topLevelRoot_, wideNodes, &wideChildSources_);
+
+    // remember where every binary node went so refit nodes can be found without collapsing again
+    const uint emptyChild = WideBVHNode<Width>::EMPTY_CHILD; // a copy, assign() takes a reference
+    wideChildSlots_.assign(nodes_.size(), emptyChild);
+    for (uint slot=0; slot<wideChildSources_.size(); slot++)
+        if (wideChildSources_[slot] != emptyChild)
+            wideChildSlots_[wideChildSources_[slot]] = slot;
+    return wideTopLevelRoot;
+}
+
+template<uint Width>
+uint AccelerationStructure::CompressAll(std::vector<QuantizedBVHNode<Width>> *quantizedNodes) {
+    // binary nodes are collapsed too (into 2 wide nodes) so every child's bounds are stored in its parent
+    std::vector<WideBVHNode<Width>> wideNodes;
+    const uint topLevelRoot = CollapseAll(&wideNodes);
+    QuantizedBVH<Width>::Compress(wideNodes, quantizedNodes);
+    return topLevelRoot;
+}
+
+template<uint Width>
+void AccelerationStructure::RefitCollapsed(const std::vector<uint> &changedNodes, std::vector<WideBVHNode<Width>> *wideNodes) {
+    for (uint nodeId : changedNodes) {
+        const uint slot = wideChildSlots_[nodeId];
+        if (slot != WideBVHNode<Width>::EMPTY_CHILD) {
+            WideBVH<Width>::SetChildBounds(nodes_[nodeId], slot % Width, &(*wideNodes)[slot / Width]);
+            wideNodeChanges_.Add(slot / Width);
+        }
+    }
+}
+
+template<uint Width>
+void AccelerationStructure::RefitCompressed(const std::vector<uint> &changedNodes, std::vector<QuantizedBVHNode<Width>> *quantizedNodes) {
+    // a compressed node's children share one quantization grid so the whole node is compressed again, but only once
+    std::vector<uint> wideNodeIds;
+    for (uint nodeId : changedNodes) {
+        const uint slot = wideChildSlots_[nodeId];
+        if (slot != WideBVHNode<Width>::EMPTY_CHILD)
+            wideNodeIds.push_back(slot / Width);
+    }
+    std::sort(wideNodeIds.begin(), wideNodeIds.end());
+    wideNodeIds.erase(std::unique(wideNodeIds.begin(), wideNodeIds.end()), wideNodeIds.end());
+
+    for (uint wideNodeId : wideNodeIds) {
+        // the uncompressed node is put back together from the binary nodes it was collapsed from
+        const QuantizedBVHNode<Width> &quantizedNode = (*quantizedNodes)[wideNodeId];
+        WideBVHNode<Width> wideNode = {};
+        for (uint i=0; i<Width; i++) {
+            wideNode.child[i] = quantizedNode.child[i];
+            wideNode.count[i] = quantizedNode.count[i];
+            const uint source = wideChildSources_[wideNodeId * Width + i];
+            if (source != WideBVHNode<Width>::EMPTY_CHILD)
+                WideBVH<Width>::SetChildBounds(nodes_[source], i, &wideNode);
+        }
+        (*quantizedNodes)[wideNodeId] = QuantizedBVH<Width>::Compress(wideNode);
+        wideNodeChanges_.Add(wideNodeId);
+    }
+}
+
+void AccelerationStructure::CopySceneBVH() {
+    const std::vector<BVHNode> &nodes = sceneBVH_.GetNodes();
+    std::copy(nodes.begin(), nodes.end(), nodes_.begin());
+    const std::vector<uint> &indices = sceneBVH_.GetIndices();
+    std::copy(indices.begin(), indices.end(), indices_.begin());
+    nodeChanges_.Add(0, nodes.size());
+    indexChanges_.Add(0, indices.size());
+}
+
+void AccelerationStructure::BuildTopLevel(const Scene &scene, cl::sycl::queue *queue) {
+    // the top level BVH is built over the bounds of the objects moved into place
+    std::vector<AABB> instanceBounds;
+    instanceBounds.reserve(scene.GetInstances().size());
+    for (const Instance &instance : scene.GetInstances())
+        instanceBounds.push_back(GetInstanceBounds(instance));
+    topLevelBVH_.Build(instanceBounds, buildMethod_, queue);
+    topLevelBuildCost_ = topLevelBVH_.GetCost();
+
+    nodes_.resize(topLevelRoot_);
+    indices_.resize(topLevelFirstIndex_);
+    AppendBVH(topLevelBVH_, 0);
+    nodeChanges_.Add(topLevelRoot_, nodes_.size());
+    indexChanges_.Add(topLevelFirstIndex_, indices_.size());
+}
+
+void AccelerationStructure::CopyNodes(const BVH &bvh, const std::vector<uint> &nodeIds, uint nodeOffset, uint firstIndex) {
+    for (uint nodeId : nodeIds) {
+        BVHNode node = bvh.GetNodes()[nodeId];
+        node.leftFirst += node.IsLeaf() ? firstIndex : nodeOffset;
+        nodes_[nodeOffset + nodeId] = node;
+        nodeChanges_.Add(nodeOffset + nodeId);
+    }
+}
+
+AABB AccelerationStructure::GetInstanceBounds(const Instance &instance) const {
+    return instance.transform.TransformBoundingBox(objectBounds_[instance.objectId]);
+}
+
+uint AccelerationStructure::AppendBVH(const BVH &bvh, uint indexOffset) {
+    const uint nodeOffset = static_cast<uint>(nodes_.size());
+    const uint firstIndex = static_cast<uint>(indices_.size());
+    for (BVHNode node : bvh.GetNodes()) {
+        node.leftFirst += node.IsLeaf() ? firstIndex : nodeOffset;
+        nodes_.push_back(node);
+    }
+    for (uint index : bvh.GetIndices())
+        indices_.push_back(index + indexOffset);
+    return nodeOffset;
+}
+
+uint AccelerationStructure::AppendPrimatives(const std::vector<ScenePrimative> &primatives, AABB *bounds, cl::sycl::queue *queue) {
+    const uint primativeOffset = static_cast<uint>(primatives_.size());
+    primatives_.insert(primatives_.end(), primatives.begin(), primatives.end());
+    for (const ScenePrimative &primative : primatives)
+        bounds->Grow(primative.GetBoundingBox());
+
+    BVH bvh;
+    bvh.Build(primatives, buildMethod_, queue);
+    return AppendBVH(bvh, primativeOffset);
+}
+
+} // namespace Tracer
@@ -0,0 +1,361 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_ACCELERATIONSTRUCTURE_H
+#define TRACER_ACCELERATIONSTRUCTURE_H
+
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "AABB.h"
+#include "BVH.h"
+#include "Common.h"
+#include "DirtyRanges.h"
+#include "PrimativeArrays.h"
+#include "ScenePrimative.h"
+#include "Transform.h"
+#include "QuantizedBVH.h"
+#include "Vector.h"
+#include "WideBVH.h"
+
+namespace Tracer {
+
+class Scene;
+
+///
+/// \brief Places an object (see Scene::AddObject) in the scene
+///
+struct Instance {
+    ///
+    /// \brief Used as the material override when the instance uses the materials of the object's primatives
+    ///
+    static const uint NO_MATERIAL_OVERRIDE = 0xFFFFFFFF;
+    ///
+    /// \brief the id of the object this is an instance of
+    ///
+    uint objectId;
+    ///
+    /// \brief moves the object from its own coordinate space into the scene
+    ///
+    Transform transform;
+    ///
+    /// \brief if not NO_MATERIAL_OVERRIDE, the material used by every primative of the instance
+    ///
+    uint materialOverride;
+};
+
+///
+/// \brief An instance as it is copied to the SYCL device
+///
+struct BVHInstance {
+    ///
+    /// \brief moves rays into the object's coordinate space
+    ///
+    Transform worldToObject;
+    ///
+    /// \brief the node the object's BVH starts at
+    ///
+    uint rootNode;
+    ///
+    /// \brief the node the object's BVH starts at in the wide or compressed nodes (see AccelerationStructure::SetNodeWidth)
+    ///
+    uint wideRootNode;
+    ///
+    /// \brief See Instance::materialOverride
+    ///
+    uint materialOverride;
+};
+
+///
+/// \brief A two level acceleration structure for a scene.
+/// The scene's primatives get a BVH, every object (see Scene::AddObject) gets its own BVH (built once no matter how many
+/// times it is used), and a top level BVH is built over the instances.
+///
+/// Everything is packed into a handful of flat arrays so it can be copied to the SYCL device as-is:
+///  - nodes: the BVH of the scene's primatives (the root is always node 0), the BVH of every object, then the top level BVH
+///  - indices: primative ids for the leaves of primative BVHs, instance ids for the leaves of the top level BVH
+///  - primatives: the scene's primatives followed by the primatives of every object
+///
+/// The nodes can also be collapsed into wide nodes (see SetNodeWidth) and/or compressed (see SetCompressedNodes) which share the same indices and primatives.
+/// When primatives or instances move, Update() refits the affected BVHs in place instead of rebuilding everything.
+/// The scene's BVH gets room for the largest tree its primatives can produce so it can be rebuilt without moving the
+/// other BVHs when refitting has made it too slow to traverse.
+///
+class AccelerationStructure {
+public:
+    AccelerationStructure() = default;
+    ///
+    /// \brief Builds everything from scratch for the scene (using the scene's BVH build method)
+    /// \param queue if not nullptr, linear BVHs are built on the queue's SYCL device
+    ///
+    void Build(const Scene &scene, cl::sycl::queue *queue = nullptr);
+    ///
+    /// \brief Updates the acceleration structure after some of the scene's primatives or instance transforms changed.
+    /// The changed parts are refit and only rebuilt if their SAH cost grew by more than rebuildThreshold times the cost
+    /// when last built. If primatives, objects, or instances were added everything is built from scratch.
+    /// The wide and compressed nodes are only collapsed again if a BVH was rebuilt, otherwise just the children that were refit are updated.
+    /// \param changedPrimatives ids of the scene's primatives that changed
+    /// \param changedInstances ids of the instances that changed
+    /// \param rebuildThreshold how much the SAH cost may grow (as a multiple of the cost when built) before rebuilding
+    /// \param queue see Build()
+    /// \return true if any BVH was rebuilt instead of only refit
+    ///
+    bool Update(const Scene &scene, const std::vector<uint> &changedPrimatives, const std::vector<uint> &changedInstances,
+                float rebuildThreshold, cl::sycl::queue *queue = nullptr);
+    ///
+    /// \brief Gets the nodes of every BVH
+    ///
+    const std::vector<BVHNode> &GetNodes() const { return nodes_; }
+    ///
+    /// \brief Sets the width of the nodes (2 for binary nodes only, or 4 or 8 to also collapse every BVH into wide nodes)
+    /// The wide nodes are kept up to date by Build() and Update().
+    ///
+    void SetNodeWidth(uint nodeWidth);
+    uint GetNodeWidth() const { return nodeWidth_; }
+    ///
+    /// \brief Gets the nodes of every BVH collapsed into 4 wide nodes (empty unless the node width is 4)
+    ///
+    const std::vector<BVH4Node> &GetNodes4() const { return nodes4_; }
+    ///
+    /// \brief Gets the nodes of every BVH collapsed into 8 wide nodes (empty unless the node width is 8)
+    ///
+    const std::vector<BVH8Node> &GetNodes8() const { return nodes8_; }
+    ///
+    /// \brief Sets if the nodes are also compressed (see QuantizedBVHNode) which takes much less memory on the SYCL device.
+    /// The compressed nodes are as wide as GetNodeWidth() and are kept up to date by Build() and Update().
+    ///
+    void SetCompressedNodes(bool compressedNodes);
+    bool GetCompressedNodes() const { return compressedNodes_; }
+    ///
+    /// \brief Gets the nodes of every BVH compressed into quantized nodes of the node width (empty unless the nodes are compressed)
+    ///
+    const std::vector<QuantizedBVHNode<2>> &GetQuantizedNodes2() const { return quantizedNodes2_; }
+    const std::vector<QuantizedBVHNode<4>> &GetQuantizedNodes4() const { return quantizedNodes4_; }
+    const std::vector<QuantizedBVHNode<8>> &GetQuantizedNodes8() const { return quantizedNodes8_; }
+    ///
+    /// \brief Gets the root node of the top level BVH in the wide (or compressed) nodes
+    ///
+    uint GetWideTopLevelRoot() const { return wideTopLevelRoot_; }
+    ///
+    /// \brief Gets the indices referenced by the leaves of every BVH
+    ///
+    const std::vector<uint> &GetIndices() const { return indices_; }
+    ///
+    /// \brief Gets all primatives (the scene's and every object's)
+    ///
+    const std::vector<ScenePrimative> &GetPrimatives() const { return primatives_; }
+    ///
+    /// \brief Gets the primatives stored as a structure of arrays (what is copied to the SYCL device)
+    ///
+    const PrimativeArrays &GetPrimativeArrays() const { return primativeArrays_; }
+    ///
+    /// \brief Gets the instances
+    ///
+    const std::vector<BVHInstance> &GetInstances() const { return instances_; }
+    ///
+    /// \brief Gets the root node of the top level BVH (the BVH over the instances)
+    ///
+    uint GetTopLevelRoot() const { return topLevelRoot_; }
+    ///
+    /// \brief Gets the ranges of the arrays changed by Build(), Update(), SetNodeWidth(), and SetCompressedNodes() (see DirtyRanges)
+    /// The wide nodes are the ones of whichever layout is kept (the 4 or 8 wide, or compressed nodes).
+    /// The primative changes are ids of the scene's primatives (GetPrimativeArrays() keeps its own).
+    ///
+    const DirtyRanges &GetNodeChanges() const { return nodeChanges_; }
+    const DirtyRanges &GetWideNodeChanges() const { return wideNodeChanges_; }
+    const DirtyRanges &GetIndexChanges() const { return indexChanges_; }
+    const DirtyRanges &GetInstanceChanges() const { return instanceChanges_; }
+    const DirtyRanges &GetPrimativeChanges() const { return primativeChanges_; }
+    ///
+    /// \brief Finds the closest intersection of the ray with the scene's primatives and instances (intended to be run on the SYCL device)
+    /// \tparam Node the node layout (BVHNode, or WideBVHNode/QuantizedBVHNode with the wide top level root)
+    /// \tparam Primatives GetPrimatives().data(), or GetPrimativeArrays()' pointers (what the SYCL device is given)
+    /// \param materialId holds the id of the material at the intersection (if there was an intersection)
+    ///
+    template<typename Node, typename Primatives>
+    static Intersection Intersect(const Ray &ray, const Node *nodes, const uint *indices, const Primatives &primatives,
+                                  const BVHInstance *instances, uint instanceCount, uint topLevelRoot, uint *materialId);
+    ///
+    /// \brief Returns true if the ray hits any of the scene's primatives or instances closer than maxDistance (intended to be run on the SYCL device)
+    /// Stops at the first hit found so it is much cheaper than Intersect() for shadow rays.
+    ///
+    template<typename Node, typename Primatives>
+    static bool Occluded(const Ray &ray, const Node *nodes, const uint *indices, const Primatives &primatives,
+                         const BVHInstance *instances, uint instanceCount, uint topLevelRoot, float maxDistance);
+private:
+    ///
+    /// \brief Appends a BVH to nodes_ and indices_
+    /// \param indexOffset added to every index of the BVH
+    /// \return the root node of the appended BVH
+    ///
+    uint AppendBVH(const BVH &bvh, uint indexOffset);
+    ///
+    /// \brief Builds a BVH for the primatives and appends both the BVH and the primatives
+    /// \param bounds holds the bounds of all of the primatives
+    /// \return the root node of the appended BVH
+    ///
+    uint AppendPrimatives(const std::vector<ScenePrimative> &primatives, AABB *bounds, cl::sycl::queue *queue);
+    ///
+    /// \brief Copies the scene's BVH into the start of nodes_ and indices_ (the space reserved for it)
+    ///
+    void CopySceneBVH();
+    ///
+    /// \brief Builds the top level BVH and appends it to the end of nodes_ and indices_ (replacing the old one)
+    ///
+    void BuildTopLevel(const Scene &scene, cl::sycl::queue *queue);
+    ///
+    /// \brief Copies some of the nodes of a BVH that was appended to nodes_
+    /// \param nodeOffset where the BVH's root was placed in nodes_
+    /// \param firstIndex where the BVH's indices were placed in indices_
+    ///
+    void CopyNodes(const BVH &bvh, const std::vector<uint> &nodeIds, uint nodeOffset, uint firstIndex);
+    ///
+    /// \brief Gets the bounds of the instance in the scene
+    ///
+    AABB GetInstanceBounds(const Instance &instance) const;
+    ///
+    /// \brief Collapses every BVH into wide nodes (if the node width isn't 2) and compresses them (if compressed nodes are used)
+    ///
+    void CollapseWideNodes();
+    ///
+    /// \brief Updates the children of the wide (or compressed) nodes that hold binary nodes that were refit
+    /// \param changedNodes ids of the binary nodes (in nodes_) that were refit
+    ///
+    void RefitWideNodes(const std::vector<uint> &changedNodes);
+    ///
+    /// \brief Collapses every BVH into wide nodes of the given width
+    ///
+    template<uint Width>
+    uint CollapseAll(std::vector<WideBVHNode<Width>> *wideNodes);
+    ///
+    /// \brief Collapses every BVH into wide nodes of the given width then compresses them
+    ///
+    template<uint Width>
+    uint CompressAll(std::vector<QuantizedBVHNode<Width>> *quantizedNodes);
+    ///
+    /// \brief Copies the bounds of refit binary nodes into the wide nodes they were collapsed into
+    ///
+    template<uint Width>
+    void RefitCollapsed(const std::vector<uint> &changedNodes, std::vector<WideBVHNode<Width>> *wideNodes);
+    ///
+    /// \brief Compresses again only the compressed nodes that hold refit binary nodes
+    ///
+    template<uint Width>
+    void RefitCompressed(const std::vector<uint> &changedNodes, std::vector<QuantizedBVHNode<Width>> *quantizedNodes);
+    ///
+    /// \brief See GetNodes()
+    ///
+    std::vector<BVHNode> nodes_;
+    ///
+    /// \brief See GetIndices()
+    ///
+    std::vector<uint> indices_;
+    ///
+    /// \brief See GetPrimatives()
+    ///
+    std::vector<ScenePrimative> primatives_;
+    ///
+    /// \brief See GetPrimativeArrays()
+    ///
+    PrimativeArrays primativeArrays_;
+    ///
+    /// \brief See GetInstances()
+    ///
+    std::vector<BVHInstance> instances_;
+    ///
+    /// \brief See GetTopLevelRoot()
+    ///
+    uint topLevelRoot_ = 0;
+    ///
+    /// \brief See SetNodeWidth()
+    ///
+    uint nodeWidth_ = 2;
+    ///
+    /// \brief See GetNodes4() and GetNodes8()
+    ///
+    std::vector<BVH4Node> nodes4_;
+    std::vector<BVH8Node> nodes8_;
+    ///
+    /// \brief See SetCompressedNodes()
+    ///
+    bool compressedNodes_ = false;
+    ///
+    /// \brief See GetQuantizedNodes2(), GetQuantizedNodes4(), and GetQuantizedNodes8()
+    ///
+    std::vector<QuantizedBVHNode<2>> quantizedNodes2_;
+    std::vector<QuantizedBVHNode<4>> quantizedNodes4_;
+    std::vector<QuantizedBVHNode<8>> quantizedNodes8_;
+    ///
+    /// \brief See GetWideTopLevelRoot()
+    ///
+    uint wideTopLevelRoot_ = 0;
+    ///
+    /// \brief The binary node stored in every child of the wide (or compressed) nodes, node width entries per wide node
+    /// (see WideBVH::Collapse)
+    ///
+    std::vector<uint> wideChildSources_;
+    ///
+    /// \brief Where every binary node is stored in the wide (or compressed) nodes as wide node * node width + child,
+    /// or EMPTY_CHILD for nodes that were pulled up into their parent (only their descendants are stored)
+    ///
+    std::vector<uint> wideChildSlots_;
+    ///
+    /// \brief Where the indices of the top level BVH start in indices_
+    ///
+    uint topLevelFirstIndex_ = 0;
+    ///
+    /// \brief The BVH over the scene's primatives (kept so it can be refit)
+    ///
+    BVH sceneBVH_;
+    ///
+    /// \brief The BVH over the instances (kept so it can be refit)
+    ///
+    BVH topLevelBVH_;
+    ///
+    /// \brief How every BVH is built
+    ///
+    BVH::BuildMethod buildMethod_ = BVH::SAH;
+    ///
+    /// \brief The SAH cost of sceneBVH_ and topLevelBVH_ when they were last built
+    ///
+    float sceneBuildCost_ = 0;
+    float topLevelBuildCost_ = 0;
+    ///
+    /// \brief The root node of every object's BVH
+    ///
+    std::vector<uint> objectRoots_;
+    ///
+    /// \brief The bounds of every object (in the object's own coordinate space)
+    ///
+    std::vector<AABB> objectBounds_;
+    ///
+    /// \brief See GetNodeChanges(), GetWideNodeChanges(), GetIndexChanges(), GetInstanceChanges(), and GetPrimativeChanges()
+    ///
+    DirtyRanges nodeChanges_;
+    DirtyRanges wideNodeChanges_;
+    DirtyRanges indexChanges_;
+    DirtyRanges instanceChanges_;
+    DirtyRanges primativeChanges_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_ACCELERATIONSTRUCTURE_H
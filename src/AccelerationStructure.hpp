@@ -0,0 +1,160 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_ACCELERATIONSTRUCTURE_HPP
+#define TRACER_ACCELERATIONSTRUCTURE_HPP
+
+#include "AccelerationStructure.h"
+#include "BVH.hpp"
+#include "PrimativeArrays.hpp"
+#include "QuantizedBVH.hpp"
+#include "ScenePrimative.hpp"
+#include "WideBVH.hpp"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+///
+/// \brief Finds the closest instance a ray hits while traversing the top level BVH
+/// \tparam Node the node layout (BVHNode, WideBVHNode, or QuantizedBVHNode)
+/// \tparam Primatives an array of ScenePrimatives (const ScenePrimative *) or PrimativePointers
+///
+template<typename Node, typename Primatives>
+struct ClosestInstanceIntersector {
+    ClosestInstanceIntersector(const Ray &ray, const Node *nodes, const uint *indices, const Primatives &primatives,
+                               const BVHInstance *instances, const Intersection &bestIntersection, uint materialId)
+        : ray(ray), nodes(nodes), indices(indices), primatives(primatives), instances(instances),
+          bestIntersection(bestIntersection), materialId(materialId) {}
+    float Distance() const { return bestIntersection.Distance(); }
+    void Intersect(uint index) {
+        const BVHInstance &instance = instances[index];
+
+        // move the ray into the object's space
+        // the direction is normalized again (primatives expect unit directions) so distances are scaled by the length of the direction
+        const Vector3f objectDirection = instance.worldToObject.TransformVector(ray.direction);
+        const float scale = objectDirection.Length();
+        const Ray objectRay(instance.worldToObject.TransformPoint(ray.origin), objectDirection * (1/scale));
+
+        ClosestPrimativeIntersector<Primatives> objectIntersector(objectRay, primatives, bestIntersection.Distance() * scale);
+        TraverseBVH(objectRay, nodes, indices, RootNode(instance, nodes), &objectIntersector);
+        if (objectIntersector.bestIntersection == Intersection::NO_INTERSECTION())
+            return;
+
+        // move the hit back into the scene
+        const float distance = objectIntersector.bestIntersection.Distance() / scale;
+        const Vector3f normal = Vector3f(instance.worldToObject.TransformVectorTransposed(objectIntersector.bestIntersection.Normal())).Normalize();
+        bestIntersection = Intersection(distance, normal, ray.origin + ray.direction*distance);
+        materialId = instance.materialOverride != Instance::NO_MATERIAL_OVERRIDE ?
+                    instance.materialOverride
+                  : PrimativeMaterialId(primatives, objectIntersector.primativeId);
+    }
+    ///
+    /// \brief Returns the root of the instance's object in the node layout being traversed
+    ///
+    static uint RootNode(const BVHInstance &instance, const BVHNode *) { return instance.rootNode; }
+    template<uint Width>
+    static uint RootNode(const BVHInstance &instance, const WideBVHNode<Width> *) { return instance.wideRootNode; }
+    template<uint Width>
+    static uint RootNode(const BVHInstance &instance, const QuantizedBVHNode<Width> *) { return instance.wideRootNode; }
+    const Ray &ray;
+    const Node *nodes;
+    const uint *indices;
+    Primatives primatives;
+    const BVHInstance *instances;
+    Intersection bestIntersection;
+    uint materialId;
+};
+
+///
+/// \brief Finds if a ray hits any instance closer than a distance while traversing the top level BVH (stops at the first hit)
+/// \tparam Node the node layout (BVHNode, WideBVHNode, or QuantizedBVHNode)
+/// \tparam Primatives an array of ScenePrimatives (const ScenePrimative *) or PrimativePointers
+///
+template<typename Node, typename Primatives>
+struct AnyInstanceIntersector {
+    AnyInstanceIntersector(const Ray &ray, const Node *nodes, const uint *indices, const Primatives &primatives,
+                           const BVHInstance *instances, float maxDistance)
+        : ray(ray), nodes(nodes), indices(indices), primatives(primatives), instances(instances), maxDistance(maxDistance), occluded(false) {}
+    float Distance() const { return occluded ? -std::numeric_limits<float>::infinity() : maxDistance; }
+    void Intersect(uint index) {
+        if (occluded) return;
+        const BVHInstance &instance = instances[index];
+
+        // move the ray into the object's space (see ClosestInstanceIntersector)
+        const Vector3f objectDirection = instance.worldToObject.TransformVector(ray.direction);
+        const float scale = objectDirection.Length();
+        const Ray objectRay(instance.worldToObject.TransformPoint(ray.origin), objectDirection * (1/scale));
+
+        AnyPrimativeIntersector<Primatives> objectIntersector(objectRay, primatives, maxDistance * scale);
+        TraverseBVH(objectRay, nodes, indices, ClosestInstanceIntersector<Node,Primatives>::RootNode(instance, nodes), &objectIntersector);
+        occluded = objectIntersector.occluded;
+    }
+    const Ray &ray;
+    const Node *nodes;
+    const uint *indices;
+    Primatives primatives;
+    const BVHInstance *instances;
+    float maxDistance;
+    bool occluded;
+};
+
+template<typename Node, typename Primatives>
+inline Intersection AccelerationStructure::Intersect(const Ray &ray, const Node *nodes, const uint *indices, const Primatives &primatives,
+                                                     const BVHInstance *instances, uint instanceCount, uint topLevelRoot, uint *materialId) {
+    // the scene's own primatives first
+    ClosestPrimativeIntersector<Primatives> sceneIntersector(ray, primatives);
+    TraverseBVH(ray, nodes, indices, 0, &sceneIntersector);
+    *materialId = sceneIntersector.bestIntersection == Intersection::NO_INTERSECTION() ? 0 : PrimativeMaterialId(primatives, sceneIntersector.primativeId);
+    if (instanceCount == 0)
+        return sceneIntersector.bestIntersection;
+
+    // then anything closer in the instances
+    ClosestInstanceIntersector<Node,Primatives> instanceIntersector(ray, nodes, indices, primatives, instances, sceneIntersector.bestIntersection, *materialId);
+    TraverseBVH(ray, nodes, indices, topLevelRoot, &instanceIntersector);
+    *materialId = instanceIntersector.materialId;
+    return instanceIntersector.bestIntersection;
+}
+
+template<typename Node, typename Primatives>
+inline bool AccelerationStructure::Occluded(const Ray &ray, const Node *nodes, const uint *indices, const Primatives &primatives,
+                                            const BVHInstance *instances, uint instanceCount, uint topLevelRoot, float maxDistance) {
+    AnyPrimativeIntersector<Primatives> sceneIntersector(ray, primatives, maxDistance);
+    TraverseBVH(ray, nodes, indices, 0, &sceneIntersector);
+    if (sceneIntersector.occluded || instanceCount == 0)
+        return sceneIntersector.occluded;
+
+    AnyInstanceIntersector<Node,Primatives> instanceIntersector(ray, nodes, indices, primatives, instances, maxDistance);
+    TraverseBVH(ray, nodes, indices, topLevelRoot, &instanceIntersector);
+    return instanceIntersector.occluded;
+}
+
+} // namespace Tracer
+
+#endif // TRACER_ACCELERATIONSTRUCTURE_HPP
@@ -0,0 +1,55 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "AccumulationBuffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Tracer {
+
+void AccumulationBuffer::Clear() {
+    std::fill(pixels_.begin(), pixels_.end(), AccumulatedPixel());
+    changes_.AddAll(pixels_.size());
+}
+
+uint64 AccumulationBuffer::GetTotalSampleCount() const {
+    uint64 total = 0;
+    for (const AccumulatedPixel &pixel : pixels_)
+        total += pixel.sampleCount;
+    return total;
+}
+
+void AccumulationBuffer::Resolve(Image *image) const {
+    if (image->GetWidth() != width_ || image->GetHeight() != height_)
+        throw std::invalid_argument("The image must be the same size as the accumulation buffer");
+    for (uint y=0; y<height_; y++)
+        for (uint x=0; x<width_; x++)
+            image->SetPixel(x, y, Pixel(GetColor(x, y)).GammaCorrect());
+}
+
+Image AccumulationBuffer::Resolve() const {
+    Image image(width_, height_);
+    Resolve(&image);
+    return image;
+}
+
+} // namespace Tracer
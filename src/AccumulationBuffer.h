@@ -0,0 +1,167 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_ACCUMULATIONBUFFER_H
+#define TRACER_ACCUMULATIONBUFFER_H
+
+#include <limits>
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "Common.h"
+#include "DirtyRanges.h"
+#include "Image.h"
+
+namespace Tracer {
+
+///
+/// \brief The samples of a pixel kept as their mean and how much their brightness varies (Welford's online algorithm).
+/// This is what is copied to the SYCL device.
+///
+struct AccumulatedPixel {
+    ///
+    /// \brief the mean (unclamped) color of the samples
+    ///
+    Color mean;
+    ///
+    /// \brief the sum of the squared differences of the samples' brightness from the mean brightness
+    ///
+    float m2 = 0;
+    ///
+    /// \brief the number of samples
+    ///
+    uint sampleCount = 0;
+
+    ///
+    /// \brief Adds a sample
+    ///
+    void Add(const Color &sample) {
+        sampleCount++;
+        const float delta = Brightness(sample) - Brightness(mean);
+        mean = Color(mean + (sample - mean) * (1.F/sampleCount));
+        m2 += delta * (Brightness(sample) - Brightness(mean));
+    }
+    ///
+    /// \brief Adds the samples of another pixel (the parallel form of Welford's algorithm by Chan et al.)
+    ///
+    void Add(const AccumulatedPixel &b) {
+        if (b.sampleCount == 0) return;
+        const uint count = sampleCount + b.sampleCount;
+        const float delta = Brightness(b.mean) - Brightness(mean);
+        mean = Color(mean + (b.mean - mean) * (static_cast<float>(b.sampleCount) / count));
+        m2 += b.m2 + delta * delta * (static_cast<float>(sampleCount) * b.sampleCount / count);
+        sampleCount = count;
+    }
+    ///
+    /// \brief Returns the variance of the brightness of the samples
+    ///
+    float Variance() const { return sampleCount < 2 ? 0 : m2 / (sampleCount - 1); }
+    ///
+    /// \brief Returns the standard error of the mean brightness relative to the mean brightness (how far the pixel is
+    /// from its converged color).  Dark pixels are measured against a brightness of at least 0.01 so they can converge.
+    ///
+    float RelativeError() const {
+        if (sampleCount < 2) return std::numeric_limits<float>::infinity();
+        return cl::sycl::sqrt(Variance() / sampleCount) / cl::sycl::fmax(Brightness(mean), .01F);
+    }
+    ///
+    /// \brief Returns the brightness of a color as seen by people (its luminance)
+    ///
+    static float Brightness(const Color &color) { return .2126F*color.R() + .7152F*color.G() + .0722F*color.B(); }
+};
+
+///
+/// \brief Collects the samples of every pixel of an image across many renders (see Renderer::RenderPass).
+/// Colors are kept unclamped (HDR) so more samples can be added at any time, along with how much every pixel's samples
+/// vary so pixels that have converged can be left alone (see Renderer::SetAdaptiveThreshold).
+/// Resolve() turns the mean of the samples into an Image.
+///
+class AccumulationBuffer {
+public:
+    AccumulationBuffer(uint width, uint height) : width_(width), height_(height), pixels_(width * height) {}
+    ///
+    /// \brief Throws away every sample
+    ///
+    void Clear();
+    ///
+    /// \brief Adds a sample to the pixel at x,y
+    ///
+    void AddSample(uint x, uint y, const Color &sample) {
+        pixels_[y*width_+x].Add(sample);
+        changes_.Add(y*width_+x);
+    }
+    ///
+    /// \brief Gets the samples of the pixel at x,y
+    ///
+    const AccumulatedPixel &GetPixel(uint x, uint y) const { return pixels_[y*width_+x]; }
+    ///
+    /// \brief Gets the number of samples of the pixel at x,y
+    ///
+    uint GetSampleCount(uint x, uint y) const { return GetPixel(x, y).sampleCount; }
+    ///
+    /// \brief Gets the number of samples of every pixel added together
+    ///
+    uint64 GetTotalSampleCount() const;
+    ///
+    /// \brief Gets the mean (unclamped) color of the samples of the pixel at x,y
+    ///
+    Color GetColor(uint x, uint y) const { return GetPixel(x, y).mean; }
+    ///
+    /// \brief Gets the samples of every pixel (row by row).  Intended for copying to the SYCL device.
+    /// Every pixel is marked as changed when they are gotten to be written to.
+    ///
+    std::vector<AccumulatedPixel> &GetPixels() {
+        changes_.AddAll(pixels_.size());
+        return pixels_;
+    }
+    const std::vector<AccumulatedPixel> &GetPixels() const { return pixels_; }
+    ///
+    /// \brief Gets the ranges of the pixels that changed (see DirtyRanges)
+    ///
+    const DirtyRanges &GetChanges() const { return changes_; }
+    ///
+    /// \brief Writes the (gamma corrected) mean color of every pixel to an image of the same size
+    ///
+    void Resolve(Image *image) const;
+    ///
+    /// \brief Returns an image of the (gamma corrected) mean color of every pixel
+    ///
+    Image Resolve() const;
+    uint GetWidth() const { return width_; }
+    uint GetHeight() const { return height_; }
+private:
+    ///
+    /// \brief The size of the image
+    ///
+    uint width_, height_;
+    ///
+    /// \brief See GetPixels()
+    ///
+    std::vector<AccumulatedPixel> pixels_;
+    ///
+    /// \brief See GetChanges()
+    ///
+    DirtyRanges changes_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_ACCUMULATIONBUFFER_H
@@ -0,0 +1,317 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "BVH.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+
+#include "LinearBVHBuilder.h"
+
+namespace Tracer {
+
+void BVH::Build(const std::vector<ScenePrimative> &primatives) {
+    std::vector<AABB> primativeBounds;
+    primativeBounds.reserve(primatives.size());
+    for (const ScenePrimative &primative : primatives)
+        primativeBounds.push_back(primative.GetBoundingBox());
+    Build(primativeBounds);
+}
+
+void BVH::Build(const std::vector<AABB> &primativeBounds) {
+    const uint primativeCount = static_cast<uint>(primativeBounds.size());
+
+    indices_.resize(primativeCount);
+    for (uint i=0; i<primativeCount; i++)
+        indices_[i] = i;
+
+    // a binary tree with N leaves has at most 2N-1 nodes
+    nodes_.clear();
+    nodes_.reserve(primativeCount > 0 ? 2*primativeCount - 1 : 1);
+
+    // the root starts off as a leaf containing everything
+    BVHNode root;
+    root.leftFirst = 0;
+    root.count = primativeCount;
+    nodes_.push_back(root);
+    UpdateNodeBounds(0, primativeBounds);
+    if (primativeCount == 0) {
+        FinishBuild();
+        return;
+    }
+
+    // the centroids are what gets split, calculate them once
+    std::vector<Vector3f> centroids;
+    centroids.reserve(primativeCount);
+    for (const AABB &bounds : primativeBounds)
+        centroids.push_back(bounds.Centroid());
+
+    // split nodes top down (an explicit stack is used so huge scenes cannot overflow the call stack)
+    std::vector<std::pair<uint,uint>> toSplit; // (node id, depth)
+    toSplit.push_back(std::make_pair(0U, 0U));
+    while (!toSplit.empty()) {
+        const uint nodeId = toSplit.back().first;
+        const uint depth = toSplit.back().second;
+        toSplit.pop_back();
+
+        const uint first = nodes_[nodeId].leftFirst;
+        const uint count = nodes_[nodeId].count;
+        // the traversal stack cannot go any deeper than MAX_DEPTH
+        if (count <= MIN_LEAF_SIZE || depth+1 >= MAX_DEPTH)
+            continue;
+
+        // bin the primatives by their centroids
+        AABB centroidBounds;
+        for (uint i=first; i<first+count; i++)
+            centroidBounds.Grow(centroids[indices_[i]]);
+
+        float bestCost = std::numeric_limits<float>::infinity();
+        uint bestAxis = 0;
+        uint bestSplit = 0;
+        for (uint axis=0; axis<3; axis++) {
+            const float axisMin = centroidBounds.Min()[axis];
+            const float axisMax = centroidBounds.Max()[axis];
+            if (axisMin == axisMax) continue; // all centroids are in the same spot, can't split on this axis
+            const float scale = SAH_BINS / (axisMax - axisMin);
+
+            AABB binBounds[SAH_BINS];
+            uint binCount[SAH_BINS] = {0};
+            for (uint i=first; i<first+count; i++) {
+                const uint primativeId = indices_[i];
+                const uint bin = std::min(SAH_BINS-1, static_cast<uint>((centroids[primativeId][axis] - axisMin) * scale));
+                binCount[bin]++;
+                binBounds[bin].Grow(primativeBounds[primativeId]);
+            }
+
+            // sweep from both sides to get the area and count on each side of every split plane
+            float leftArea[SAH_BINS-1], rightArea[SAH_BINS-1];
+            uint leftCount[SAH_BINS-1], rightCount[SAH_BINS-1];
+            AABB leftBox, rightBox;
+            uint leftSum = 0, rightSum = 0;
+            for (uint i=0; i<SAH_BINS-1; i++) {
+                leftSum += binCount[i];
+                leftCount[i] = leftSum;
+                leftBox.Grow(binBounds[i]);
+                leftArea[i] = leftBox.SurfaceArea();
+                rightSum += binCount[SAH_BINS-1-i];
+                rightCount[SAH_BINS-2-i] = rightSum;
+                rightBox.Grow(binBounds[SAH_BINS-1-i]);
+                rightArea[SAH_BINS-2-i] = rightBox.SurfaceArea();
+            }
+
+            for (uint i=0; i<SAH_BINS-1; i++) {
+                if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+                const float cost = leftCount[i]*leftArea[i] + rightCount[i]*rightArea[i];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        // only split if it is cheaper than intersecting every primative of the leaf
+        AABB nodeBounds(Vector3f(nodes_[nodeId].boundsMin[0], nodes_[nodeId].boundsMin[1], nodes_[nodeId].boundsMin[2]),
+                        Vector3f(nodes_[nodeId].boundsMax[0], nodes_[nodeId].boundsMax[1], nodes_[nodeId].boundsMax[2]));
+        const float nodeArea = nodeBounds.SurfaceArea();
+        const float splitCost = TRAVERSAL_COST + INTERSECTION_COST * bestCost / (nodeArea > 0 ? nodeArea : 1);
+        const float leafCost = INTERSECTION_COST * count;
+        if (bestCost == std::numeric_limits<float>::infinity() || splitCost >= leafCost)
+            continue;
+
+        // partition the indices so the left child's primatives come first
+        const float axisMin = centroidBounds.Min()[bestAxis];
+        const float scale = SAH_BINS / (centroidBounds.Max()[bestAxis] - axisMin);
+        uint *middle = std::partition(indices_.data() + first, indices_.data() + first + count, [&](uint primativeId) {
+            return std::min(SAH_BINS-1, static_cast<uint>((centroids[primativeId][bestAxis] - axisMin) * scale)) <= bestSplit;
+        });
+        const uint leftCount = static_cast<uint>(middle - (indices_.data() + first));
+
+        // create the children next to each other
+        const uint leftChild = static_cast<uint>(nodes_.size());
+        BVHNode child;
+        child.leftFirst = first;
+        child.count = leftCount;
+        nodes_.push_back(child);
+        child.leftFirst = first + leftCount;
+        child.count = count - leftCount;
+        nodes_.push_back(child);
+        UpdateNodeBounds(leftChild, primativeBounds);
+        UpdateNodeBounds(leftChild+1, primativeBounds);
+
+        // the node is now an interior node
+        nodes_[nodeId].leftFirst = leftChild;
+        nodes_[nodeId].count = 0;
+
+        toSplit.push_back(std::make_pair(leftChild, depth+1));
+        toSplit.push_back(std::make_pair(leftChild+1, depth+1));
+    }
+
+
+    FinishBuild();
+}
+
+void BVH::BuildLinear(const std::vector<ScenePrimative> &primatives, cl::sycl::queue *queue) {
+    std::vector<AABB> primativeBounds;
+    primativeBounds.reserve(primatives.size());
+    for (const ScenePrimative &primative : primatives)
+        primativeBounds.push_back(primative.GetBoundingBox());
+    BuildLinear(primativeBounds, queue);
+}
+
+void BVH::BuildLinear(const std::vector<AABB> &primativeBounds, cl::sycl::queue *queue) {
+    LinearBVHBuilder::Build(primativeBounds, queue, &nodes_, &indices_);
+    FinishBuild();
+}
+
+void BVH::Build(const std::vector<AABB> &primativeBounds, BuildMethod method, cl::sycl::queue *queue) {
+    if (method == LINEAR)
+        BuildLinear(primativeBounds, queue);
+    else
+        Build(primativeBounds);
+}
+
+void BVH::Build(const std::vector<ScenePrimative> &primatives, BuildMethod method, cl::sycl::queue *queue) {
+    if (method == LINEAR)
+        BuildLinear(primatives, queue);
+    else
+        Build(primatives);
+}
+
+void BVH::FinishBuild() {
+    // remember how nodes are connected for refitting
+    parents_.assign(nodes_.size(), 0);
+    leaves_.assign(indices_.size(), 0);
+    refitMarks_.assign(nodes_.size(), false);
+    refitPending_.assign(nodes_.size(), 0);
+    cost_ = 0;
+    for (const BVHNode &node : nodes_)
+        cost_ += GetNodeCost(node);
+    // the root of an empty BVH has no children
+    if (indices_.empty())
+        return;
+    for (uint nodeId=0; nodeId<nodes_.size(); nodeId++) {
+        const BVHNode &node = nodes_[nodeId];
+        if (node.IsLeaf()) {
+            for (uint i=node.leftFirst; i<node.leftFirst+node.count; i++)
+                leaves_[indices_[i]] = nodeId;
+        } else {
+            parents_[node.leftFirst] = nodeId;
+            parents_[node.leftFirst+1] = nodeId;
+        }
+    }
+}
+
+void BVH::Refit(const std::function<AABB(uint)> &primativeBounds, const std::vector<uint> &changedPrimatives, std::vector<uint> *changedNodes) {
+    // queue the leaves of the changed primatives and all of their ancestors (once each)
+    std::vector<uint> toRefit;
+    for (uint primativeId : changedPrimatives) {
+        if (primativeId >= leaves_.size()) continue;
+        uint nodeId = leaves_[primativeId];
+        while (!refitMarks_[nodeId]) {
+            refitMarks_[nodeId] = true;
+            toRefit.push_back(nodeId);
+            if (nodeId == 0) break;
+            nodeId = parents_[nodeId];
+        }
+    }
+
+    // a node can only be refit once all of its queued children are, so count how many each one is waiting on
+    for (uint nodeId : toRefit)
+        if (nodeId != 0)
+            refitPending_[parents_[nodeId]]++;
+    std::vector<uint> ready;
+    for (uint nodeId : toRefit)
+        if (refitPending_[nodeId] == 0)
+            ready.push_back(nodeId);
+
+    while (!ready.empty()) {
+        const uint nodeId = ready.back();
+        ready.pop_back();
+        const BVHNode &node = nodes_[nodeId];
+        AABB bounds;
+        if (node.IsLeaf()) {
+            for (uint i=node.leftFirst; i<node.leftFirst+node.count; i++)
+                bounds.Grow(primativeBounds(indices_[i]));
+        } else {
+            for (uint child=node.leftFirst; child<node.leftFirst+2; child++) {
+                const BVHNode &childNode = nodes_[child];
+                if (childNode.boundsMin[0] == std::numeric_limits<float>::infinity()) continue; // empty
+                bounds.Grow(AABB(Vector3f(childNode.boundsMin[0], childNode.boundsMin[1], childNode.boundsMin[2]),
+                                 Vector3f(childNode.boundsMax[0], childNode.boundsMax[1], childNode.boundsMax[2])));
+            }
+        }
+        // only the refit nodes change the cost
+        cost_ -= GetNodeCost(node);
+        SetNodeBounds(nodeId, bounds);
+        cost_ += GetNodeCost(node);
+        refitMarks_[nodeId] = false;
+        if (nodeId != 0 && --refitPending_[parents_[nodeId]] == 0)
+            ready.push_back(parents_[nodeId]);
+    }
+
+    if (changedNodes)
+        changedNodes->insert(changedNodes->end(), toRefit.begin(), toRefit.end());
+}
+
+void BVH::UpdateNodeBounds(uint nodeId, const std::vector<AABB> &primativeBounds) {
+    const BVHNode &node = nodes_[nodeId];
+    AABB bounds;
+    for (uint i=node.leftFirst; i<node.leftFirst+node.count; i++)
+        bounds.Grow(primativeBounds[indices_[i]]);
+    SetNodeBounds(nodeId, bounds);
+}
+
+void BVH::SetNodeBounds(uint nodeId, AABB bounds) {
+    BVHNode &node = nodes_[nodeId];
+    if (bounds.IsEmpty()) {
+        // a box at +INF is never hit by any ray (unlike an inverted box which the slab test sees as infinitely large)
+        const float inf = std::numeric_limits<float>::infinity();
+        bounds = AABB(Vector3f(inf,inf,inf), Vector3f(inf,inf,inf));
+    }
+    for (uint i=0; i<3; i++) {
+        node.boundsMin[i] = bounds.Min()[i];
+        node.boundsMax[i] = bounds.Max()[i];
+    }
+}
+
+float BVH::GetSurfaceArea(const BVHNode &node) {
+    // empty nodes are a box at +INF (see SetNodeBounds)
+    if (node.boundsMin[0] == std::numeric_limits<float>::infinity()) return 0;
+    return AABB(Vector3f(node.boundsMin[0], node.boundsMin[1], node.boundsMin[2]),
+                Vector3f(node.boundsMax[0], node.boundsMax[1], node.boundsMax[2])).SurfaceArea();
+}
+
+float BVH::GetNodeCost(const BVHNode &node) {
+    if (node.IsLeaf())
+        return INTERSECTION_COST * node.count * GetSurfaceArea(node);
+    return TRAVERSAL_COST * GetSurfaceArea(node);
+}
+
+float BVH::GetCost() const {
+    const float rootArea = nodes_.empty() ? 0 : GetSurfaceArea(nodes_[0]);
+    if (!(rootArea > 0) || rootArea == std::numeric_limits<float>::infinity()) return 0;
+    return static_cast<float>(cost_ / rootArea);
+}
+
+} // namespace Tracer
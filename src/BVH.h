@@ -0,0 +1,206 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_BVH_H
+#define TRACER_BVH_H
+
+#include <functional>
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "AABB.h"
+#include "Common.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+
+namespace Tracer {
+
+///
+/// \brief A single node of a flattened BVH tree.  This is what is copied to the SYCL device.
+///
+/// A node is a leaf if count > 0.  Leaves reference the primative indices [leftFirst, leftFirst+count).
+/// Interior nodes (count == 0) have their two children stored next to each other at nodes [leftFirst] and [leftFirst+1].
+/// The root is always node 0, but otherwise nothing should be assumed about the order nodes are stored in.
+///
+/// \note plain floats are used for the bounds (instead of AABB) to keep the node at exactly 32 bytes
+///
+struct BVHNode {
+    float boundsMin[3];
+    uint leftFirst;
+    float boundsMax[3];
+    uint count;
+
+    bool IsLeaf() const { return count > 0; }
+    ///
+    /// \brief Tests the ray against the node bounds using the slab method
+    /// \param invDirection 1/ray.direction (precomputed once per ray)
+    /// \return the distance the ray enters the box or INF if the ray misses (or the box is further than maxDistance)
+    ///
+    float Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance) const;
+};
+
+///
+/// \brief A bounding volume hierarchy built using the surface area heuristic (SAH) or as a linear BVH (LBVH)
+/// The tree is built then flattened into a node array and an index array for traversal on the SYCL device.
+/// The SAH build gives the fastest traversal, the linear build is much faster to build (and can be built on the SYCL device).
+///
+class BVH {
+public:
+    ///
+    /// \brief The max depth of the tree. Traversal on the SYCL device uses a fixed size stack this deep.
+    ///
+    static const uint MAX_DEPTH = 64;
+    ///
+    /// \brief Leaves that hold this many primatives (or fewer) are not considered for splitting
+    ///
+    static const uint MIN_LEAF_SIZE = 2;
+    ///
+    /// \brief The number of bins used when evaluating the SAH along an axis
+    ///
+    static const uint SAH_BINS = 16;
+    ///
+    /// \brief How the tree is built
+    ///
+    enum BuildMethod {
+        // Slower to build but faster to traverse (see Build)
+        SAH = 0,
+        // Much faster to build but slower to traverse (see BuildLinear)
+        LINEAR = 1
+    };
+
+    BVH() = default;
+    ///
+    /// \brief Builds the tree for a set of primative bounds (the id of a primative is its index in the list)
+    ///
+    void Build(const std::vector<AABB> &primativeBounds);
+    ///
+    /// \brief Builds the tree for the primatives of a scene
+    ///
+    void Build(const std::vector<ScenePrimative> &primatives);
+    ///
+    /// \brief Builds the tree by sorting the primatives along a morton curve (see LinearBVHBuilder)
+    /// \param queue if not nullptr the tree is built by SYCL kernels on the queue's device, otherwise it is built using every host core
+    ///
+    void BuildLinear(const std::vector<AABB> &primativeBounds, cl::sycl::queue *queue = nullptr);
+    ///
+    /// \brief Builds the tree for the primatives of a scene by sorting them along a morton curve
+    ///
+    void BuildLinear(const std::vector<ScenePrimative> &primatives, cl::sycl::queue *queue = nullptr);
+    ///
+    /// \brief Builds the tree using the given method
+    /// \param queue used by linear builds (see BuildLinear)
+    ///
+    void Build(const std::vector<AABB> &primativeBounds, BuildMethod method, cl::sycl::queue *queue);
+    void Build(const std::vector<ScenePrimative> &primatives, BuildMethod method, cl::sycl::queue *queue);
+    ///
+    /// \brief Gets the flattened nodes of the tree. The root is always node 0.
+    ///
+    const std::vector<BVHNode> &GetNodes() const { return nodes_; }
+    ///
+    /// \brief Gets the primative indices referenced by the leaves of the tree
+    ///
+    const std::vector<uint> &GetIndices() const { return indices_; }
+    ///
+    /// \brief Refits the bounds of the tree after some primatives moved, without changing the tree's structure.
+    /// Only the leaves of the changed primatives and their ancestors are touched (bottom up).
+    /// \param primativeBounds returns the current bounds of a primative
+    /// \param changedPrimatives ids of the primatives that moved
+    /// \param changedNodes if not nullptr, the ids of every node that was refit are added to this
+    ///
+    void Refit(const std::function<AABB(uint)> &primativeBounds, const std::vector<uint> &changedPrimatives, std::vector<uint> *changedNodes = nullptr);
+    ///
+    /// \brief Returns the SAH cost of the tree (lower is better)
+    /// The cost is kept up to date by Refit() so this is cheap to call after every refit.
+    ///
+    float GetCost() const;
+    ///
+    /// \brief Finds the closest intersection of the ray using the BVH (intended to be run on the SYCL device)
+    /// \param primativeId holds the id of the primative that was intersected with (if there was an intersection)
+    ///
+    static Intersection Intersect(const Ray &ray, const BVHNode *nodes, const uint *indices, const ScenePrimative *primatives, uint *primativeId);
+    ///
+    /// \brief Walks the tree starting at root front to back, calling intersector->Intersect(index) for the indices of every leaf the ray reaches.
+    /// Nodes further away than intersector->Distance() (the closest hit found so far) are skipped. (intended to be run on the SYCL device)
+    ///
+    template<typename Intersector>
+    static void Traverse(const Ray &ray, const BVHNode *nodes, const uint *indices, uint root, Intersector *intersector);
+private:
+    ///
+    /// \brief Relative cost of traversing a node compared to intersecting a primative (used by the SAH)
+    ///
+    static constexpr float TRAVERSAL_COST = 1.F;
+    ///
+    /// \brief Relative cost of intersecting a primative (used by the SAH)
+    ///
+    static constexpr float INTERSECTION_COST = 1.F;
+    ///
+    /// \brief Sets the bounds of the node to fit all of the primatives it references
+    ///
+    void UpdateNodeBounds(uint nodeId, const std::vector<AABB> &primativeBounds);
+    ///
+    /// \brief Sets the bounds of the node
+    ///
+    void SetNodeBounds(uint nodeId, AABB bounds);
+    ///
+    /// \brief Returns the surface area of the node's bounds (0 for empty nodes)
+    ///
+    static float GetSurfaceArea(const BVHNode &node);
+    ///
+    /// \brief Returns what the node adds to the SAH cost before it is divided by the root's surface area
+    ///
+    static float GetNodeCost(const BVHNode &node);
+    ///
+    /// \brief Sets up what is needed for refitting once nodes_ and indices_ are built
+    ///
+    void FinishBuild();
+    ///
+    /// \brief Flattened tree nodes
+    ///
+    std::vector<BVHNode> nodes_;
+    ///
+    /// \brief Primative ids referenced by the leaves
+    ///
+    std::vector<uint> indices_;
+    ///
+    /// \brief The parent of every node (used for refitting, the root is its own parent)
+    ///
+    std::vector<uint> parents_;
+    ///
+    /// \brief The leaf node every primative is in (used for refitting)
+    ///
+    std::vector<uint> leaves_;
+    ///
+    /// \brief Marks the nodes already queued while refitting (kept around so it isn't reallocated every refit)
+    ///
+    std::vector<bool> refitMarks_;
+    ///
+    /// \brief The number of children each node is still waiting on while refitting
+    ///
+    std::vector<uint8> refitPending_;
+    ///
+    /// \brief The sum of GetNodeCost() over every node (a double so refitting over and over doesn't drift)
+    ///
+    double cost_ = 0;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_BVH_H
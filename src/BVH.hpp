@@ -0,0 +1,180 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TRACER_BVH_HPP
+#define TRACER_BVH_HPP
+
+
+#include "BVH.h"
+#include "ScenePrimative.hpp"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+inline float BVHNode::Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance) const {
+    float tNear = 0;
+    float tFar = maxDistance;
+    for (uint i=0; i<3; i++) {
+        const float t1 = (boundsMin[i] - ray.origin[i]) * invDirection[i];
+        const float t2 = (boundsMax[i] - ray.origin[i]) * invDirection[i];
+        tNear = cl::sycl::fmax(tNear, cl::sycl::fmin(t1, t2));
+        tFar = cl::sycl::fmin(tFar, cl::sycl::fmax(t1, t2));
+    }
+    return tNear <= tFar ? tNear : std::numeric_limits<float>::infinity();
+}
+
+template<typename Intersector>
+inline void BVH::Traverse(const Ray &ray, const BVHNode *nodes, const uint *indices, uint root, Intersector *intersector) {
+    const float inf = std::numeric_limits<float>::infinity();
+    const Vector3f invDirection(1/ray.direction.X(), 1/ray.direction.Y(), 1/ray.direction.Z());
+
+    // short stack of nodes still to visit (and how far away they were when they were pushed)
+    uint stack[MAX_DEPTH];
+    float stackDistance[MAX_DEPTH];
+    uint stackSize = 0;
+
+    uint nodeId = root;
+    if (nodes[root].Intersect(ray, invDirection, intersector->Distance()) == inf)
+        return;
+
+    while (true) {
+        const BVHNode &node = nodes[nodeId];
+        if (node.IsLeaf()) {
+            for (uint i=node.leftFirst; i<node.leftFirst+node.count; i++)
+                intersector->Intersect(indices[i]);
+        } else {
+            // visit the closest child first, the other one is saved for later
+            uint nearChild = node.leftFirst;
+            uint farChild = node.leftFirst + 1;
+            float nearDistance = nodes[nearChild].Intersect(ray, invDirection, intersector->Distance());
+            float farDistance = nodes[farChild].Intersect(ray, invDirection, intersector->Distance());
+            if (farDistance < nearDistance) {
+                uint tmpChild = nearChild; nearChild = farChild; farChild = tmpChild;
+                float tmpDistance = nearDistance; nearDistance = farDistance; farDistance = tmpDistance;
+            }
+            if (nearDistance != inf) {
+                if (farDistance != inf) {
+                    stack[stackSize] = farChild;
+                    stackDistance[stackSize] = farDistance;
+                    stackSize++;
+                }
+                nodeId = nearChild;
+                continue;
+            }
+        }
+
+        // pop the next node that could still hold something closer than what was already found
+        bool found = false;
+        while (stackSize > 0) {
+            stackSize--;
+            if (stackDistance[stackSize] < intersector->Distance()) {
+                nodeId = stack[stackSize];
+                found = true;
+                break;
+            }
+        }
+        if (!found) break;
+    }
+}
+
+///
+/// \brief Determines if the ray intersects a primative of an array of ScenePrimatives (see ClosestPrimativeIntersector)
+///
+inline Intersection IntersectPrimative(const ScenePrimative *primatives, uint primativeId, const Ray &ray) {
+    return primatives[primativeId].Intersect(ray);
+}
+
+///
+/// \brief Gets the id of the material of a primative of an array of ScenePrimatives
+///
+inline uint PrimativeMaterialId(const ScenePrimative *primatives, uint primativeId) {
+    return primatives[primativeId].GetMaterialId();
+}
+
+///
+/// \brief Finds the closest primative a ray hits while traversing a BVH
+/// \tparam Primatives an array of ScenePrimatives (const ScenePrimative *) or PrimativePointers
+///
+template<typename Primatives>
+struct ClosestPrimativeIntersector {
+    ClosestPrimativeIntersector(const Ray &ray, const Primatives &primatives, float maxDistance = std::numeric_limits<float>::infinity())
+        : ray(ray), primatives(primatives), bestIntersection(Intersection::NO_INTERSECTION()), maxDistance(maxDistance), primativeId(0) {}
+    float Distance() const { return bestIntersection.Distance() < maxDistance ? bestIntersection.Distance() : maxDistance; }
+    void Intersect(uint index) {
+        Intersection newIntersection = IntersectPrimative(primatives, index, ray);
+        if (newIntersection.Distance() < Distance()) {
+            bestIntersection = newIntersection;
+            primativeId = index;
+        }
+    }
+    const Ray &ray;
+    Primatives primatives;
+    Intersection bestIntersection;
+    ///
+    /// \brief nothing further than this is considered a hit
+    ///
+    float maxDistance;
+    uint primativeId;
+};
+
+///
+/// \brief Finds if a ray hits any primative closer than a distance while traversing a BVH (stops at the first hit)
+/// \tparam Primatives an array of ScenePrimatives (const ScenePrimative *) or PrimativePointers
+///
+template<typename Primatives>
+struct AnyPrimativeIntersector {
+    AnyPrimativeIntersector(const Ray &ray, const Primatives &primatives, float maxDistance)
+        : ray(ray), primatives(primatives), maxDistance(maxDistance), occluded(false) {}
+    ///
+    /// \brief -INF once something is hit so that traversal skips every node left
+    ///
+    float Distance() const { return occluded ? -std::numeric_limits<float>::infinity() : maxDistance; }
+    void Intersect(uint index) {
+        if (!occluded && IntersectPrimative(primatives, index, ray).Distance() < maxDistance)
+            occluded = true;
+    }
+    const Ray &ray;
+    Primatives primatives;
+    ///
+    /// \brief nothing further than this is considered a hit
+    ///
+    float maxDistance;
+    bool occluded;
+};
+
+inline Intersection BVH::Intersect(const Ray &ray, const BVHNode *nodes, const uint *indices, const ScenePrimative *primatives, uint *primativeId) {
+    ClosestPrimativeIntersector<const ScenePrimative*> intersector(ray, primatives);
+    Traverse(ray, nodes, indices, 0, &intersector);
+    *primativeId = intersector.primativeId;
+    return intersector.bestIntersection;
+}
+
+} // namespace Tracer
+
+#endif // TRACER_BVH_HPP
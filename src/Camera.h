@@ -36,6 +36,15 @@ public:
     /// \brief Generates the ray that needs to be rendered for a specific pixel on an image
     ///
     Ray GenerateLookForPixel(uint pixelX, uint pixelY, uint imageWidth, uint imageHeight) const;
+    ///
+    /// \brief Generates the ray through any point of an image (pixel centers are at whole numbers, ex: x=2.5 is halfway
+    /// between the centers of the pixels 2 and 3)
+    ///
+    Ray GenerateLookForPoint(float x, float y, uint imageWidth, uint imageHeight) const;
+    ///
+    /// \brief Gets where the camera's eye is in the scene
+    ///
+    const Vector3f &GetEye() const { return eye_; }
 private:
     Camera() = default;
     ///
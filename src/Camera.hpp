@@ -37,7 +37,11 @@
 
 namespace Tracer {
 
-Ray Camera::GenerateLookForPixel(uint pixelX, uint pixelY, uint imageWidth, uint imageHeight) const {
+inline Ray Camera::GenerateLookForPixel(uint pixelX, uint pixelY, uint imageWidth, uint imageHeight) const {
+    return GenerateLookForPoint(static_cast<float>(pixelX), static_cast<float>(pixelY), imageWidth, imageHeight);
+}
+
+inline Ray Camera::GenerateLookForPoint(float x, float y, uint imageWidth, uint imageHeight) const {
     // calculate camera vectors w,v,u (the localized unit vectors of the camera)
 
     // w always points away from the lookat point... for some historical reason
@@ -51,9 +55,9 @@ Ray Camera::GenerateLookForPixel(uint pixelX, uint pixelY, uint imageWidth, uint
     const float right = imagePlaneBounds_[2];
     const float top = imagePlaneBounds_[3];
 
-    // where this pixel is on the image plane
-    const float px = (static_cast<float>(pixelX))/(imageWidth-1) * (right-left) + left;
-    const float py = (static_cast<float>(pixelY))/(imageHeight-1) * (top-bottom) + bottom;
+    // where this point is on the image plane
+    const float px = x/(imageWidth-1) * (right-left) + left;
+    const float py = y/(imageHeight-1) * (top-bottom) + bottom;
     // put into real world coords where the pixel is at using the camera's localized unit vectors
     const Vector3f position = eye_ - (w * focalLength_) + (u * px) + (v * py);
     // direction is easy now
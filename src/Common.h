@@ -27,6 +27,7 @@
 
 namespace Tracer {
 
+typedef int8_t int8;
 typedef uint8_t uint8;
 typedef unsigned int uint;
 typedef unsigned long int uint64;
@@ -0,0 +1,65 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "DeviceScene.h"
+
+namespace Tracer {
+
+void DeviceScene::Invalidate() {
+    primativeReferences_.Invalidate();
+    primativeData_.Invalidate();
+    primativeMaterialIds_.Invalidate();
+    nodes_.Invalidate();
+    nodes4_.Invalidate();
+    nodes8_.Invalidate();
+    quantizedNodes2_.Invalidate();
+    quantizedNodes4_.Invalidate();
+    quantizedNodes8_.Invalidate();
+    indices_.Invalidate();
+    instances_.Invalidate();
+    materials_.Invalidate();
+    chunks_.Invalidate();
+    sectionRoots_.Invalidate();
+    voxelNodes_.Invalidate();
+    voxelLeaves_.Invalidate();
+    blockMaterials_.Invalidate();
+}
+
+uint64 DeviceScene::UploadScene(cl::sycl::queue &queue, const Scene &scene, const AccelerationStructure &accelerationStructure) {
+    const VoxelDAG &voxelDAG = scene.GetVoxelDAG();
+    const VoxelWorld &voxelWorld = scene.GetVoxelWorld();
+    const PrimativeArrays &primatives = accelerationStructure.GetPrimativeArrays();
+    const MaterialManager &materialManager = scene.GetMaterialManager();
+    uint64 bytes = primativeReferences_.Upload(queue, primatives.GetReferences(), primatives.GetReferenceChanges());
+    bytes += primativeData_.Upload(queue, primatives.GetData(), primatives.GetDataChanges());
+    bytes += primativeMaterialIds_.Upload(queue, primatives.GetMaterialIds(), primatives.GetMaterialIdChanges());
+    bytes += indices_.Upload(queue, accelerationStructure.GetIndices(), accelerationStructure.GetIndexChanges());
+    bytes += instances_.Upload(queue, accelerationStructure.GetInstances(), accelerationStructure.GetInstanceChanges());
+    bytes += materials_.Upload(queue, materialManager.GetMaterials(), materialManager.GetChanges());
+    bytes += chunks_.Upload(queue, voxelDAG.GetChunks(), voxelDAG.GetChunkChanges());
+    bytes += sectionRoots_.Upload(queue, voxelDAG.GetSectionRoots(), voxelDAG.GetSectionRootChanges());
+    bytes += voxelNodes_.Upload(queue, voxelDAG.GetNodes(), voxelDAG.GetNodeChanges());
+    bytes += voxelLeaves_.Upload(queue, voxelDAG.GetLeaves(), voxelDAG.GetLeafChanges());
+    bytes += blockMaterials_.Upload(queue, voxelWorld.GetBlockMaterials(), voxelWorld.GetBlockMaterialChanges());
+    return bytes;
+}
+
+} // namespace Tracer
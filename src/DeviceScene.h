@@ -0,0 +1,226 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef TRACER_DEVICESCENE_H
+#define TRACER_DEVICESCENE_H
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "AccelerationStructure.h"
+#include "Common.h"
+#include "DirtyRanges.h"
+#include "Material.h"
+#include "PrimativeArrays.h"
+#include "Scene.h"
+#include "VoxelDAG.h"
+
+namespace Tracer {
+
+///
+/// \brief An array kept on the SYCL device between renders.
+///
+/// Whatever owns the array keeps track of the ranges of it that change (see DirtyRanges), so Upload() only copies the
+/// ranges that changed since the device's copy was last brought up to date.  The buffer has room to grow, so an array that
+/// grows a little at a time isn't reallocated (and copied whole) every time it does.
+///
+template<typename T>
+class DeviceArray {
+public:
+    ///
+    /// \brief Changed ranges fewer than this many elements apart are copied together (along with the elements between them),
+    /// so scattered changes take a few bigger copies instead of many tiny ones
+    ///
+    static const uint64 MERGE_GAP = 64;
+    ///
+    /// \brief Makes the device's copy the same as the vector.  Only the ranges changed since the last Upload() or Download()
+    /// and the elements past the device's old size are copied, unless the buffer had to grow or what changed isn't known
+    /// (ex: after Invalidate()) in which case the whole array is.  The copies are made straight from the vector and can still
+    /// be running when it returns, so the vector must not change until the queue is waited on.
+    /// \param changes the changes of the vector (kept by whatever owns it)
+    /// \return the number of bytes copied to the device
+    ///
+    uint64 Upload(cl::sycl::queue &queue, const std::vector<T> &vector, const DirtyRanges &changes);
+    ///
+    /// \brief Copies the device's copy (after SYCL kernels wrote to it) back to the vector
+    /// \param changes the changes of the vector, the device's copy is then up to date with them
+    ///
+    void Download(std::vector<T> *vector, const DirtyRanges &changes);
+    ///
+    /// \brief Forgets what the device has so the next Upload() copies the whole array (ex: after a kernel writing to it failed)
+    ///
+    void Invalidate() { stamp_ = DirtyRanges::Stamp(); }
+    ///
+    /// \brief Gets the buffer of the device's copy.  It can have more elements than the array (and has one when the array is empty)
+    ///
+    cl::sycl::buffer<T,1> &GetBuffer() { return buffer_; }
+    ///
+    /// \brief Gets the number of elements of the device's copy
+    ///
+    uint64 GetSize() const { return size_; }
+private:
+    ///
+    /// \brief See GetSize()
+    ///
+    uint64 size_ = 0;
+    ///
+    /// \brief The changes of the array the device's copy is up to date with
+    ///
+    DirtyRanges::Stamp stamp_;
+    ///
+    /// \brief The number of elements the buffer has room for
+    ///
+    uint64 capacity_ = 0;
+    cl::sycl::buffer<T,1> buffer_{cl::sycl::range<1>(1)};
+};
+
+template<typename T>
+uint64 DeviceArray<T>::Upload(cl::sycl::queue &queue, const std::vector<T> &vector, const DirtyRanges &changes) {
+    const uint64 size = vector.size();
+    std::vector<DirtyRanges::Range> ranges;
+    if (size > capacity_) {
+        // a new buffer has none of the array
+        capacity_ = size + size / 2;
+        buffer_ = cl::sycl::buffer<T,1>(cl::sycl::range<1>(capacity_));
+        ranges.push_back({ 0, size });
+    } else if (!changes.GetSince(stamp_, &ranges)) {
+        ranges.assign(1, { 0, size });
+    } else if (size > size_) {
+        ranges.push_back({ size_, size });
+    }
+    size_ = size;
+    stamp_ = changes.GetStamp();
+
+    std::sort(ranges.begin(), ranges.end(), [](const DirtyRanges::Range &a, const DirtyRanges::Range &b) { return a.begin < b.begin; });
+    uint64 bytes = 0;
+    for (uint64 i=0; i<ranges.size();) {
+        const uint64 begin = ranges[i].begin;
+        uint64 end = ranges[i].end;
+        for (i++; i<ranges.size() && ranges[i].begin < end + MERGE_GAP; i++)
+            end = std::max(end, ranges[i].end);
+        // ranges past the end were removed from the array
+        end = std::min(end, size);
+        if (begin >= end)
+            break;
+        queue.submit([&](cl::sycl::handler& cgh) {
+            auto accessor = buffer_.template get_access<cl::sycl::access::mode::write>(cgh, cl::sycl::range<1>(end - begin), cl::sycl::id<1>(begin));
+            cgh.copy(vector.data() + begin, accessor);
+        });
+        bytes += (end - begin) * sizeof(T);
+    }
+    return bytes;
+}
+
+template<typename T>
+void DeviceArray<T>::Download(std::vector<T> *vector, const DirtyRanges &changes) {
+    vector->resize(size_);
+    if (size_ > 0) {
+        auto accessor = buffer_.template get_access<cl::sycl::access::mode::read>(cl::sycl::range<1>(size_), cl::sycl::id<1>(0));
+        for (uint64 i=0; i<size_; i++)
+            (*vector)[i] = accessor[i];
+    }
+    stamp_ = changes.GetStamp();
+}
+
+///
+/// \brief The arrays of a scene kept on the SYCL device between renders (see DeviceArray).
+/// A Renderer owns one, so rendering a scene again (ex: every frame of an interactive render) only copies what the scene,
+/// its acceleration structure, and its material manager marked as changed since the last render to the device.
+///
+class DeviceScene {
+public:
+    ///
+    /// \brief Brings the device's copy of the scene up to date (the scene's acceleration structure must be up to date)
+    /// \param nodes the nodes of the acceleration structure in the layout being rendered
+    /// \return the number of bytes copied to the device
+    ///
+    template<typename Node>
+    uint64 Upload(cl::sycl::queue &queue, const Scene &scene, const AccelerationStructure &accelerationStructure, const std::vector<Node> &nodes) {
+        // every wide or compressed layout shares the same changes (only one of them is kept at a time)
+        const DirtyRanges &nodeChanges = std::is_same<Node,BVHNode>::value ? accelerationStructure.GetNodeChanges() : accelerationStructure.GetWideNodeChanges();
+        return UploadScene(queue, scene, accelerationStructure) + NodeArray(static_cast<const Node*>(nullptr)).Upload(queue, nodes, nodeChanges);
+    }
+    ///
+    /// \brief Forgets what the device has so the next Upload() copies everything
+    ///
+    void Invalidate();
+    cl::sycl::buffer<uint,1> &GetPrimativeReferences() { return primativeReferences_.GetBuffer(); }
+    cl::sycl::buffer<float,1> &GetPrimativeData() { return primativeData_.GetBuffer(); }
+    cl::sycl::buffer<uint,1> &GetPrimativeMaterialIds() { return primativeMaterialIds_.GetBuffer(); }
+    template<typename Node>
+    cl::sycl::buffer<Node,1> &GetNodes() { return NodeArray(static_cast<const Node*>(nullptr)).GetBuffer(); }
+    cl::sycl::buffer<uint,1> &GetIndices() { return indices_.GetBuffer(); }
+    cl::sycl::buffer<BVHInstance,1> &GetInstances() { return instances_.GetBuffer(); }
+    cl::sycl::buffer<Material,1> &GetMaterials() { return materials_.GetBuffer(); }
+    cl::sycl::buffer<uint,1> &GetChunks() { return chunks_.GetBuffer(); }
+    cl::sycl::buffer<uint,1> &GetSectionRoots() { return sectionRoots_.GetBuffer(); }
+    cl::sycl::buffer<VoxelDAGNode,1> &GetVoxelNodes() { return voxelNodes_.GetBuffer(); }
+    cl::sycl::buffer<VoxelDAGLeaf,1> &GetVoxelLeaves() { return voxelLeaves_.GetBuffer(); }
+    cl::sycl::buffer<uint,1> &GetBlockMaterials() { return blockMaterials_.GetBuffer(); }
+private:
+    ///
+    /// \brief Uploads everything but the nodes
+    ///
+    uint64 UploadScene(cl::sycl::queue &queue, const Scene &scene, const AccelerationStructure &accelerationStructure);
+    ///
+    /// \brief Returns the array of the nodes of a layout (the pointer only picks the layout)
+    ///
+    DeviceArray<BVHNode> &NodeArray(const BVHNode*) { return nodes_; }
+    DeviceArray<BVH4Node> &NodeArray(const BVH4Node*) { return nodes4_; }
+    DeviceArray<BVH8Node> &NodeArray(const BVH8Node*) { return nodes8_; }
+    DeviceArray<QuantizedBVHNode<2>> &NodeArray(const QuantizedBVHNode<2>*) { return quantizedNodes2_; }
+    DeviceArray<QuantizedBVHNode<4>> &NodeArray(const QuantizedBVHNode<4>*) { return quantizedNodes4_; }
+    DeviceArray<QuantizedBVHNode<8>> &NodeArray(const QuantizedBVHNode<8>*) { return quantizedNodes8_; }
+    ///
+    /// \brief The acceleration structure's arrays (only the nodes of the layouts that were rendered are kept)
+    /// The primatives are its PrimativeArrays.
+    ///
+    DeviceArray<uint> primativeReferences_;
+    DeviceArray<float> primativeData_;
+    DeviceArray<uint> primativeMaterialIds_;
+    DeviceArray<BVHNode> nodes_;
+    DeviceArray<BVH4Node> nodes4_;
+    DeviceArray<BVH8Node> nodes8_;
+    DeviceArray<QuantizedBVHNode<2>> quantizedNodes2_;
+    DeviceArray<QuantizedBVHNode<4>> quantizedNodes4_;
+    DeviceArray<QuantizedBVHNode<8>> quantizedNodes8_;
+    DeviceArray<uint> indices_;
+    DeviceArray<BVHInstance> instances_;
+    ///
+    /// \brief The scene's materials
+    ///
+    DeviceArray<Material> materials_;
+    ///
+    /// \brief The voxel world's arrays (see VoxelDAG)
+    ///
+    DeviceArray<uint> chunks_;
+    DeviceArray<uint> sectionRoots_;
+    DeviceArray<VoxelDAGNode> voxelNodes_;
+    DeviceArray<VoxelDAGLeaf> voxelLeaves_;
+    DeviceArray<uint> blockMaterials_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_DEVICESCENE_H
@@ -0,0 +1,85 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "DirtyRanges.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace Tracer {
+
+const uint64 DirtyRanges::MIN_LIMIT;
+
+DirtyRanges &DirtyRanges::operator=(const DirtyRanges &b) {
+    version_ = b.version_;
+    allVersion_ = b.allVersion_;
+    stampedVersion_ = b.stampedVersion_;
+    limit_ = b.limit_;
+    changes_ = b.changes_;
+    id_ = NextId();
+    return *this;
+}
+
+void DirtyRanges::Add(uint64 begin, uint64 end) {
+    if (begin >= end) return;
+    version_++;
+    // a range touching the last one (ex: filling an array in order) grows it instead, unless a copy could be past it
+    if (!changes_.empty() && changes_.back().version > stampedVersion_ &&
+            begin <= changes_.back().range.end && end >= changes_.back().range.begin) {
+        Change &last = changes_.back();
+        last.version = version_;
+        last.range.begin = std::min(last.range.begin, begin);
+        last.range.end = std::max(last.range.end, end);
+        return;
+    }
+    // past the limit copying everything costs about as much as going through the ranges
+    if (changes_.size() >= limit_) {
+        allVersion_ = version_;
+        changes_.clear();
+        return;
+    }
+    changes_.push_back({ version_, { begin, end } });
+}
+
+void DirtyRanges::AddAll(uint64 size) {
+    version_++;
+    allVersion_ = version_;
+    changes_.clear();
+    limit_ = std::max(size, MIN_LIMIT);
+}
+
+bool DirtyRanges::GetSince(const Stamp &stamp, std::vector<Range> *ranges) const {
+    if (stamp.id != id_ || stamp.version < allVersion_)
+        return false;
+    // the changes are in the order of their versions so the ones after the stamp are at the end
+    auto change = std::upper_bound(changes_.begin(), changes_.end(), stamp.version,
+                                   [](uint64 version, const Change &c) { return version < c.version; });
+    for (; change != changes_.end(); ++change)
+        ranges->push_back(change->range);
+    return true;
+}
+
+uint64 DirtyRanges::NextId() {
+    static std::atomic<uint64> nextId(1);
+    return nextId++;
+}
+
+} // namespace Tracer
@@ -0,0 +1,146 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_DIRTYRANGES_H
+#define TRACER_DIRTYRANGES_H
+
+#include <vector>
+
+#include "Common.h"
+
+namespace Tracer {
+
+///
+/// \brief Keeps track of which elements of an array changed, so copies of it (ex: on the SYCL device, see DeviceArray) can
+/// be brought up to date by copying only those.
+///
+/// Whatever owns the array adds the ranges it changes.  A copy remembers the stamp of the changes it was last brought up to
+/// date with and asks for the ranges added since.  Any number of copies can follow the same array.  If more ranges are
+/// added than the array has elements (or AddAll() is called) the ranges are forgotten, and copies from before then must
+/// copy everything.
+///
+class DirtyRanges {
+public:
+    ///
+    /// \brief The elements [begin,end) of the array
+    ///
+    struct Range {
+        uint64 begin;
+        uint64 end;
+    };
+    ///
+    /// \brief How far a copy of the array is through its changes (see GetSince())
+    ///
+    struct Stamp {
+        ///
+        /// \brief which DirtyRanges the stamp is of (0 for none)
+        ///
+        uint64 id = 0;
+        ///
+        /// \brief the number of changes made by then
+        ///
+        uint64 version = 0;
+        bool operator==(const Stamp &b) const { return id == b.id && version == b.version; }
+        bool operator!=(const Stamp &b) const { return !((*this) == b); }
+    };
+    ///
+    /// \brief The fewest ranges kept before they are forgotten (so small arrays don't forget them all the time)
+    ///
+    static const uint64 MIN_LIMIT = 1024;
+
+    DirtyRanges() : id_(NextId()) {}
+    ///
+    /// \brief Copies are of a different array (that just happens to start out the same) so copies of this one don't follow them
+    ///
+    DirtyRanges(const DirtyRanges &b) : version_(b.version_), allVersion_(b.allVersion_), stampedVersion_(b.stampedVersion_), limit_(b.limit_),
+                                        changes_(b.changes_), id_(NextId()) {}
+    DirtyRanges &operator=(const DirtyRanges &b);
+    ///
+    /// \brief Marks an element as changed
+    ///
+    void Add(uint64 index) { Add(index, index + 1); }
+    ///
+    /// \brief Marks the elements [begin,end) as changed
+    ///
+    void Add(uint64 begin, uint64 end);
+    ///
+    /// \brief Marks every element as changed (ex: the array was rebuilt)
+    /// \param size the number of elements the array has now
+    ///
+    void AddAll(uint64 size);
+    ///
+    /// \brief Gets the stamp of the changes so far
+    ///
+    Stamp GetStamp() const {
+        stampedVersion_ = version_;
+        Stamp stamp;
+        stamp.id = id_;
+        stamp.version = version_;
+        return stamp;
+    }
+    ///
+    /// \brief Adds the ranges changed since the stamp to ranges (in no particular order, and they can overlap)
+    /// \return false if what changed isn't known (the stamp is of another array, or from before the ranges were last forgotten)
+    /// in which case every element must be treated as changed
+    ///
+    bool GetSince(const Stamp &stamp, std::vector<Range> *ranges) const;
+private:
+    ///
+    /// \brief A range and the version it was (last) added at
+    ///
+    struct Change {
+        uint64 version;
+        Range range;
+    };
+    ///
+    /// \brief Returns an id no other DirtyRanges has
+    ///
+    static uint64 NextId();
+    ///
+    /// \brief The number of changes made so far
+    ///
+    uint64 version_ = 0;
+    ///
+    /// \brief The version the ranges were last forgotten at (every element changed)
+    ///
+    uint64 allVersion_ = 0;
+    ///
+    /// \brief The version the last stamp was gotten at.  Ranges added before then can't grow, since copies with that stamp
+    /// would see all of them as changed again.
+    ///
+    mutable uint64 stampedVersion_ = 0;
+    ///
+    /// \brief The most ranges kept before they are forgotten
+    ///
+    uint64 limit_ = MIN_LIMIT;
+    ///
+    /// \brief The ranges added since allVersion_, in the order of their versions
+    ///
+    std::vector<Change> changes_;
+    ///
+    /// \brief See Stamp::id
+    ///
+    uint64 id_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_DIRTYRANGES_H
@@ -0,0 +1,393 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "LinearBVHBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "RadixSort.hpp"
+
+namespace Tracer {
+
+// names of the SYCL kernels
+class LinearBVHMortonCodes;
+class LinearBVHHierarchy;
+class LinearBVHBounds;
+
+namespace {
+
+const uint MORTON_BITS = 3*LinearBVHBuilder::MORTON_BITS_PER_AXIS;
+///
+/// \brief The work group size used for the bounds kernel
+///
+const uint BOUNDS_WORK_GROUP_SIZE = 64;
+///
+/// \brief Host threads are only started for at least this many items each
+///
+const uint MIN_ITEMS_PER_THREAD = 4096;
+
+///
+/// \brief Maps centroids to the [0,1] cube morton codes are made in
+///
+struct MortonMapping {
+    float min[3];
+    float scale[3];
+};
+
+///
+/// \brief Copies the bounds of a box into a node (an empty box is placed at +INF so no ray hits it)
+///
+void SetBounds(BVHNode *node, const AABB &bounds) {
+    const float inf = std::numeric_limits<float>::infinity();
+    const bool empty = bounds.IsEmpty();
+    for (uint i=0; i<3; i++) {
+        node->boundsMin[i] = empty ? inf : bounds.Min()[i];
+        node->boundsMax[i] = empty ? inf : bounds.Max()[i];
+    }
+}
+
+///
+/// \brief Spreads the lowest 10 bits out so there are two 0 bits between each of them
+///
+inline uint ExpandBits(uint v) {
+    v = (v * 0x00010001U) & 0xFF0000FFU;
+    v = (v * 0x00000101U) & 0x0F00F00FU;
+    v = (v * 0x00000011U) & 0xC30C30C3U;
+    v = (v * 0x00000005U) & 0x49249249U;
+    return v;
+}
+
+///
+/// \brief Returns the 30 bit morton code of the centroid of a box
+///
+inline uint MortonCode(const BVHNode &box, const MortonMapping &mapping) {
+    const float gridSize = 1 << LinearBVHBuilder::MORTON_BITS_PER_AXIS;
+    uint code = 0;
+    for (uint axis=0; axis<3; axis++) {
+        const float centroid = (box.boundsMin[axis] + box.boundsMax[axis]) * .5F;
+        const float cell = cl::sycl::fmin(cl::sycl::fmax((centroid - mapping.min[axis]) * mapping.scale[axis] * gridSize, 0.F), gridSize - 1);
+        code |= ExpandBits(static_cast<uint>(cell)) << (2 - axis);
+    }
+    return code;
+}
+
+///
+/// \brief Returns the length of the common prefix of the sorted codes i and j, or -1 if j is out of range
+/// (duplicate codes are made unique by their position)
+///
+inline int CommonPrefix(const uint *codes, int codeCount, int i, int j) {
+    if (j < 0 || j >= codeCount) return -1;
+    if (codes[i] == codes[j])
+        return 32 + static_cast<int>(cl::sycl::clz(static_cast<uint>(i ^ j)));
+    return static_cast<int>(cl::sycl::clz(codes[i] ^ codes[j]));
+}
+
+///
+/// \brief Creates the two children of interior node i.
+/// There are N-1 interior nodes for N sorted codes.  Interior node i covers a range of codes that starts or ends at i and is split
+/// where the highest differing bit of the range changes.  Its children are placed at nodes 2i+1 and 2i+2 (interior node 0 is the root, node 0).
+/// \param interiorNodes holds which node every interior node was placed at
+/// \param leafNodes holds which node every sorted code's leaf was placed at
+/// \param parents holds the interior node that is the parent of every node
+///
+inline void BuildInterior(int i, const uint *codes, int codeCount, BVHNode *nodes, uint *interiorNodes, uint *leafNodes, uint *parents) {
+    // the direction the range goes from i
+    const int direction = CommonPrefix(codes, codeCount, i, i+1) - CommonPrefix(codes, codeCount, i, i-1) >= 0 ? 1 : -1;
+
+    // find the other end of the range (everything in the range shares more than the code just outside of it)
+    const int minPrefix = CommonPrefix(codes, codeCount, i, i-direction);
+    int maxLength = 2;
+    while (CommonPrefix(codes, codeCount, i, i + maxLength*direction) > minPrefix)
+        maxLength *= 2;
+    int length = 0;
+    for (int step=maxLength/2; step>=1; step/=2)
+        if (CommonPrefix(codes, codeCount, i, i + (length+step)*direction) > minPrefix)
+            length += step;
+    const int j = i + length*direction;
+
+    // binary search for the last code that shares more than the whole range does
+    const int nodePrefix = CommonPrefix(codes, codeCount, i, j);
+    int split = 0;
+    int step = length;
+    do {
+        step = (step + 1) / 2;
+        if (CommonPrefix(codes, codeCount, i, i + (split+step)*direction) > nodePrefix)
+            split += step;
+    } while (step > 1);
+    const int splitIndex = i + split*direction + (direction < 0 ? -1 : 0);
+
+    if (i == 0) {
+        nodes[0].leftFirst = 1;
+        nodes[0].count = 0;
+        interiorNodes[0] = 0;
+    }
+
+    // the left child covers [min(i,j), splitIndex] and the right child [splitIndex+1, max(i,j)]
+    const uint child[2] = { static_cast<uint>(splitIndex), static_cast<uint>(splitIndex+1) };
+    const bool childIsLeaf[2] = { cl::sycl::min(i, j) == splitIndex, cl::sycl::max(i, j) == splitIndex+1 };
+    for (uint c=0; c<2; c++) {
+        const uint nodeId = 2*i + 1 + c;
+        parents[nodeId] = i;
+        if (childIsLeaf[c]) {
+            nodes[nodeId].leftFirst = child[c];
+            nodes[nodeId].count = 1;
+            leafNodes[child[c]] = nodeId;
+        } else {
+            nodes[nodeId].leftFirst = 2*child[c] + 1;
+            nodes[nodeId].count = 0;
+            interiorNodes[child[c]] = nodeId;
+        }
+    }
+}
+
+///
+/// \brief Sets the bounds of a leaf, then goes up the tree setting the bounds of every interior node until reaching one whose
+/// other child isn't done yet (whichever child finishes second does the parent)
+/// \param visit adds 1 to the number of children of an interior node that are done and returns the number before it was added to
+///
+template<typename Visit>
+inline void BuildBounds(uint leaf, const uint *sortedIds, const BVHNode *boxes, BVHNode *nodes, const uint *interiorNodes,
+                        const uint *leafNodes, const uint *parents, Visit visit) {
+    uint nodeId = leafNodes[leaf];
+    const BVHNode &box = boxes[sortedIds[leaf]];
+    for (uint axis=0; axis<3; axis++) {
+        nodes[nodeId].boundsMin[axis] = box.boundsMin[axis];
+        nodes[nodeId].boundsMax[axis] = box.boundsMax[axis];
+    }
+
+    while (nodeId != 0) {
+        const uint parent = parents[nodeId];
+        if (visit(parent) == 0)
+            return;
+        nodeId = interiorNodes[parent];
+        BVHNode &node = nodes[nodeId];
+        const BVHNode &left = nodes[node.leftFirst];
+        const BVHNode &right = nodes[node.leftFirst+1];
+        for (uint axis=0; axis<3; axis++) {
+            node.boundsMin[axis] = cl::sycl::fmin(left.boundsMin[axis], right.boundsMin[axis]);
+            node.boundsMax[axis] = cl::sycl::fmax(left.boundsMax[axis], right.boundsMax[axis]);
+        }
+    }
+}
+
+///
+/// \brief Returns the number of host threads to split count items between
+///
+uint HostThreadCount(uint count, uint minItemsPerThread = MIN_ITEMS_PER_THREAD) {
+    const uint threadCount = std::max(1U, std::thread::hardware_concurrency());
+    return std::max(1U, std::min(threadCount, count / minItemsPerThread));
+}
+
+///
+/// \brief Splits [0,count) into one range per host thread and calls work(thread, begin, end) for every range in parallel
+///
+template<typename Work>
+void ParallelFor(uint count, Work work, uint minItemsPerThread = MIN_ITEMS_PER_THREAD) {
+    const uint threadCount = HostThreadCount(count, minItemsPerThread);
+    const uint perThread = (count + threadCount - 1) / threadCount;
+    std::vector<std::thread> threads;
+    for (uint i=1; i<threadCount; i++)
+        threads.push_back(std::thread(work, i, std::min(count, i*perThread), std::min(count, (i+1)*perThread)));
+    work(0, 0, std::min(count, perThread));
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+///
+/// \brief Builds the tree with SYCL kernels
+///
+void BuildOnDevice(cl::sycl::queue &queue, const std::vector<BVHNode> &boxes, const MortonMapping &mapping,
+                   std::vector<BVHNode> *nodes, std::vector<uint> *indices) {
+    const uint count = static_cast<uint>(boxes.size());
+
+    // only the nodes and indices are copied back, everything else lives on the device
+    const cl::sycl::range<1> primativeRange(count);
+    const cl::sycl::range<1> nodeRange(2*count - 1);
+    const cl::sycl::range<1> interiorRange(count - 1);
+    cl::sycl::buffer<BVHNode,1> boxBuffer(boxes.data(), primativeRange);
+    cl::sycl::buffer<uint,1> codeBuffer(primativeRange);
+    cl::sycl::buffer<uint,1> idBuffer(indices->data(), primativeRange);
+    cl::sycl::buffer<BVHNode,1> nodeBuffer(nodes->data(), nodeRange);
+    cl::sycl::buffer<uint,1> interiorBuffer(interiorRange);
+    cl::sycl::buffer<uint,1> leafBuffer(primativeRange);
+    cl::sycl::buffer<uint,1> parentBuffer(nodeRange);
+    cl::sycl::buffer<uint,1> visitBuffer(interiorRange);
+
+    queue.submit([&](cl::sycl::handler &cgh) {
+        auto boxAccessor = boxBuffer.get_access<cl::sycl::access::mode::read>(cgh);
+        auto codeAccessor = codeBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+        auto idAccessor = idBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+        cgh.parallel_for<LinearBVHMortonCodes>(primativeRange, [=](cl::sycl::item<1> item) {
+            const uint i = static_cast<uint>(item.get_id(0));
+            codeAccessor[i] = MortonCode(boxAccessor[i], mapping);
+            idAccessor[i] = i;
+        });
+    });
+
+    RadixSort().Sort(queue, codeBuffer, idBuffer, count, MORTON_BITS);
+
+    queue.submit([&](cl::sycl::handler &cgh) {
+        auto codeAccessor = codeBuffer.get_access<cl::sycl::access::mode::read>(cgh);
+        auto nodeAccessor = nodeBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+        auto interiorAccessor = interiorBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+        auto leafAccessor = leafBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+        auto parentAccessor = parentBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+        cgh.parallel_for<LinearBVHHierarchy>(interiorRange, [=](cl::sycl::item<1> item) {
+            BuildInterior(static_cast<int>(item.get_id(0)), codeAccessor.get_pointer(), static_cast<int>(count), nodeAccessor.get_pointer(),
+                          interiorAccessor.get_pointer(), leafAccessor.get_pointer(), parentAccessor.get_pointer());
+        });
+    });
+
+    queue.submit([&](cl::sycl::handler &cgh) {
+        auto visitAccessor = visitBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+        cgh.fill(visitAccessor, 0U);
+    });
+    queue.submit([&](cl::sycl::handler &cgh) {
+        auto idAccessor = idBuffer.get_access<cl::sycl::access::mode::read>(cgh);
+        auto boxAccessor = boxBuffer.get_access<cl::sycl::access::mode::read>(cgh);
+        auto nodeAccessor = nodeBuffer.get_access<cl::sycl::access::mode::read_write>(cgh);
+        auto interiorAccessor = interiorBuffer.get_access<cl::sycl::access::mode::read>(cgh);
+        auto leafAccessor = leafBuffer.get_access<cl::sycl::access::mode::read>(cgh);
+        auto parentAccessor = parentBuffer.get_access<cl::sycl::access::mode::read>(cgh);
+        auto visitAccessor = visitBuffer.get_access<cl::sycl::access::mode::atomic>(cgh);
+        const uint globalSize = (count + BOUNDS_WORK_GROUP_SIZE - 1) / BOUNDS_WORK_GROUP_SIZE * BOUNDS_WORK_GROUP_SIZE;
+        cgh.parallel_for<LinearBVHBounds>(cl::sycl::nd_range<1>(globalSize, BOUNDS_WORK_GROUP_SIZE), [=](cl::sycl::nd_item<1> item) {
+            const uint leaf = static_cast<uint>(item.get_global_id(0));
+            if (leaf >= count) return;
+            BuildBounds(leaf, idAccessor.get_pointer(), boxAccessor.get_pointer(), nodeAccessor.get_pointer(), interiorAccessor.get_pointer(),
+                        leafAccessor.get_pointer(), parentAccessor.get_pointer(), [&](uint parent) {
+                // make sure the bounds written so far are seen by whoever does the parent
+                item.mem_fence(cl::sycl::access::fence_space::global_space);
+                return visitAccessor[parent].fetch_add(1U);
+            });
+        });
+    });
+
+    queue.wait_and_throw();
+}
+
+///
+/// \brief Builds the tree using every host core (the same steps as the SYCL kernels)
+///
+void BuildOnHost(const std::vector<BVHNode> &boxes, const MortonMapping &mapping, std::vector<BVHNode> *nodes, std::vector<uint> *indices) {
+    const uint count = static_cast<uint>(boxes.size());
+    const uint blockCount = RadixSort::BlockCount(count);
+
+    std::vector<uint> codes(count), sortedCodes(count), sortedIds(count);
+    uint *ids = indices->data();
+    ParallelFor(count, [&](uint, uint begin, uint end) {
+        for (uint i=begin; i<end; i++) {
+            codes[i] = MortonCode(boxes[i], mapping);
+            ids[i] = i;
+        }
+    });
+
+    // the same radix sort as RadixSort::Sort() with host threads instead of kernels
+    const uint blocksPerThread = std::max(1U, MIN_ITEMS_PER_THREAD / RadixSort::BLOCK_SIZE);
+    std::vector<uint> histogram(RadixSort::RADIX * blockCount);
+    std::vector<uint> digitOffsets(RadixSort::RADIX);
+    uint *keys[2] = { codes.data(), sortedCodes.data() };
+    uint *values[2] = { ids, sortedIds.data() };
+    const uint passCount = RadixSort::PassCount(MORTON_BITS);
+    for (uint pass=0; pass<passCount; pass++) {
+        const uint shift = pass * RadixSort::RADIX_BITS;
+        const uint *inKeys = keys[pass % 2];
+        const uint *inValues = values[pass % 2];
+        uint *outKeys = keys[(pass+1) % 2];
+        uint *outValues = values[(pass+1) % 2];
+        ParallelFor(blockCount, [&](uint, uint begin, uint end) {
+            for (uint block=begin; block<end; block++)
+                RadixSort::Histogram(block, inKeys, count, shift, histogram.data(), blockCount);
+        }, blocksPerThread);
+        for (uint digit=0; digit<RadixSort::RADIX; digit++)
+            RadixSort::ScanBlocks(digit, histogram.data(), blockCount, digitOffsets.data());
+        RadixSort::ScanDigits(digitOffsets.data());
+        ParallelFor(blockCount, [&](uint, uint begin, uint end) {
+            for (uint block=begin; block<end; block++)
+                RadixSort::Scatter(block, inKeys, inValues, count, shift, histogram.data(), blockCount, digitOffsets.data(), outKeys, outValues);
+        }, blocksPerThread);
+    }
+
+    std::vector<uint> interiorNodes(count - 1), leafNodes(count), parents(2*count - 1);
+    ParallelFor(count - 1, [&](uint, uint begin, uint end) {
+        for (uint i=begin; i<end; i++)
+            BuildInterior(static_cast<int>(i), codes.data(), static_cast<int>(count), nodes->data(), interiorNodes.data(), leafNodes.data(), parents.data());
+    });
+
+    std::unique_ptr<std::atomic<uint>[]> visits(new std::atomic<uint>[count - 1]);
+    for (uint i=0; i<count-1; i++)
+        visits[i] = 0;
+    ParallelFor(count, [&](uint, uint begin, uint end) {
+        for (uint leaf=begin; leaf<end; leaf++)
+            BuildBounds(leaf, ids, boxes.data(), nodes->data(), interiorNodes.data(), leafNodes.data(), parents.data(),
+                        [&](uint parent) { return visits[parent].fetch_add(1); });
+    });
+}
+
+} // namespace
+
+void LinearBVHBuilder::Build(const std::vector<AABB> &primativeBounds, cl::sycl::queue *queue, std::vector<BVHNode> *nodes, std::vector<uint> *indices) {
+    const uint count = static_cast<uint>(primativeBounds.size());
+    nodes->clear();
+    indices->clear();
+
+    // with one primative (or none) there is nothing to sort, the root is a leaf
+    if (count <= 1) {
+        BVHNode root;
+        root.leftFirst = 0;
+        root.count = count;
+        SetBounds(&root, count == 1 ? primativeBounds[0] : AABB());
+        nodes->push_back(root);
+        indices->assign(count, 0);
+        return;
+    }
+
+    // copy the bounds into nodes (plain floats are what the SYCL device can use) and find the bounds of the centroids
+    std::vector<BVHNode> boxes(count);
+    std::vector<AABB> centroidBounds(HostThreadCount(count));
+    ParallelFor(count, [&](uint thread, uint begin, uint end) {
+        for (uint i=begin; i<end; i++) {
+            SetBounds(&boxes[i], primativeBounds[i]);
+            centroidBounds[thread].Grow(primativeBounds[i].Centroid());
+        }
+    });
+    AABB sceneCentroidBounds;
+    for (const AABB &bounds : centroidBounds)
+        sceneCentroidBounds.Grow(bounds);
+    MortonMapping mapping;
+    for (uint axis=0; axis<3; axis++) {
+        const float extent = sceneCentroidBounds.Max()[axis] - sceneCentroidBounds.Min()[axis];
+        mapping.min[axis] = sceneCentroidBounds.Min()[axis];
+        mapping.scale[axis] = extent > 0 ? 1 / extent : 0;
+    }
+
+    nodes->resize(2*count - 1);
+    indices->resize(count);
+    if (queue)
+        BuildOnDevice(*queue, boxes, mapping, nodes, indices);
+    else
+        BuildOnHost(boxes, mapping, nodes, indices);
+}
+
+} // namespace Tracer
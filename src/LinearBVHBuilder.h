@@ -0,0 +1,60 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_LINEARBVHBUILDER_H
+#define TRACER_LINEARBVHBUILDER_H
+
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "AABB.h"
+#include "BVH.h"
+#include "Common.h"
+
+namespace Tracer {
+
+///
+/// \brief Builds linear BVHs (LBVH) in parallel, either with SYCL kernels or on every host core.
+///
+/// The centroid of every primative is given a 30 bit morton code (its position along a Z-order curve through the
+/// scene's bounds), the codes are radix sorted (see RadixSort), and the tree is made from the sorted codes (Karras, "Maximizing
+/// Parallelism in the Construction of BVHs, Octrees, and k-d Trees").  Every interior node is built independently
+/// and the bounds are then filled in bottom up, so every step is parallel.
+///
+/// The tree has one primative per leaf and exactly 2N-1 nodes.  Its quality is worse than a SAH build
+/// (see BVH::Build) but it is built many times faster.
+///
+class LinearBVHBuilder {
+public:
+    ///
+    /// \brief The number of bits of a morton code used for each axis
+    ///
+    static const uint MORTON_BITS_PER_AXIS = 10;
+    ///
+    /// \brief Builds the nodes and indices of a BVH (in the layout described by BVHNode)
+    /// \param queue if not nullptr the tree is built by SYCL kernels on the queue's device, otherwise it is built using every host core
+    ///
+    static void Build(const std::vector<AABB> &primativeBounds, cl::sycl::queue *queue, std::vector<BVHNode> *nodes, std::vector<uint> *indices);
+};
+
+} // namespace Tracer
+
+#endif // TRACER_LINEARBVHBUILDER_H
@@ -205,6 +205,7 @@ uint MaterialManager::AddMaterial(const Material &material) {
     uint newMaterialId = static_cast<uint>(materialList_.size());
     // add material to list
     materialList_.push_back(material);
+    changes_.Add(newMaterialId);
     return newMaterialId;
 }
 
@@ -26,6 +26,7 @@
 #include <string>
 #include <stdexcept>
 
+#include "DirtyRanges.h"
 #include "Vector.h"
 #include <Image.h>
 
@@ -83,12 +84,20 @@ public:
     uint GetMaterial(const std::string &file, const std::string &materialName = "");
     ///
     /// \brief Get Material from its material index
+    /// \note the material is marked as changed (see GetChanges()) since it can be changed through the reference
     ///
-    Material& GetMaterial(uint materialIndex) { return materialList_[materialIndex]; }
+    Material& GetMaterial(uint materialIndex) {
+        changes_.Add(materialIndex);
+        return materialList_[materialIndex];
+    }
+    const Material& GetMaterial(uint materialIndex) const { return materialList_[materialIndex]; }
     ///
     /// \brief Overwrites the material at the material index
     ///
-    void SetMaterial(const Material &material, uint materialIndex) { materialList_[materialIndex] = material; }
+    void SetMaterial(const Material &material, uint materialIndex) {
+        materialList_[materialIndex] = material;
+        changes_.Add(materialIndex);
+    }
     ///
     /// \brief Adds Material to the list of materials and returns the material index.
     /// \param file should be unique
@@ -103,6 +112,10 @@ public:
     /// \brief Gets readonly view of all materials. Intended for index lookup on the GPU
     ///
     const std::vector<Material> &GetMaterials() const { return materialList_; }
+    ///
+    /// \brief Gets the ranges of the materials that were added or changed (see DirtyRanges)
+    ///
+    const DirtyRanges &GetChanges() const { return changes_; }
 
     ///
     /// \brief Represents an error that material requested could not be found
@@ -130,6 +143,10 @@ private:
     /// \brief unordered list of all materials
     ///
     std::vector<Material> materialList_;
+    ///
+    /// \brief See GetChanges()
+    ///
+    DirtyRanges changes_;
 };
 
 } // namespace Tracer
@@ -0,0 +1,415 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Common.h"
+
+namespace Tracer {
+
+namespace {
+
+///
+/// \brief Keeps a read only memory mapping of a file alive
+///
+class MappedFile {
+public:
+    MappedFile(const std::string &filename) {
+        const int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw FileReadException(filename);
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw FileReadException(filename);
+        }
+        size_ = static_cast<uint64>(info.st_size);
+        if (size_ > 0) {
+            void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throw FileReadException(filename);
+            }
+            madvise(mapped, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(mapped);
+        }
+        // the mapping stays valid after the file is closed
+        close(fd);
+    }
+    MappedFile(const MappedFile&) = delete;
+    ~MappedFile() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+    }
+    const char *Begin() const { return data_; }
+    const char *End() const { return data_ + size_; }
+    uint64 Size() const { return size_; }
+private:
+    const char *data_ = nullptr;
+    uint64 size_ = 0;
+};
+
+///
+/// \brief Everything parsed from one chunk of an .obj file
+/// Chunks are parsed independently so some things (vertex offsets, relative indices, the current material)
+/// can only be fixed up after every chunk is done.
+///
+struct ObjChunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    std::vector<Vector3f> vertices;
+    // three vertex indices per triangle (0 based).  Relative (negative) indices are local to this chunk until fixed up
+    std::vector<int64_t> corners;
+    // where in corners the relative indices are
+    std::vector<uint64> relativeCorners;
+    // (first triangle using the material, material name)
+    std::vector<std::pair<uint,std::string>> materialChanges;
+    std::vector<std::string> materialLibraries;
+    uint lineCount = 0;
+    // the first error of the chunk (line number is local to the chunk)
+    std::string error;
+    uint errorLine = 0;
+};
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline void SkipSpaces(const char *&p, const char *end) {
+    while (p < end && IsSpace(*p)) p++;
+}
+
+inline std::string ReadToken(const char *&p, const char *end) {
+    SkipSpaces(p, end);
+    const char *start = p;
+    while (p < end && !IsSpace(*p)) p++;
+    return std::string(start, p);
+}
+
+///
+/// \brief Parses an integer. (std::strtol can't be used since the mapped file isn't null terminated)
+///
+bool ParseInt(const char *&p, const char *end, int64_t *value) {
+    SkipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if (p == end || *p < '0' || *p > '9') return false;
+    int64_t result = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        result = result*10 + (*p++ - '0');
+    *value = negative ? -result : result;
+    return true;
+}
+
+///
+/// \brief Parses a floating point number. (std::strtof can't be used since the mapped file isn't null terminated)
+///
+bool ParseFloat(const char *&p, const char *end, float *value) {
+    SkipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    double mantissa = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        mantissa = mantissa*10 + (*p++ - '0');
+        hasDigits = true;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mantissa = mantissa*10 + (*p++ - '0');
+            exponent--;
+            hasDigits = true;
+        }
+    }
+    if (!hasDigits) return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int64_t e;
+        if (!ParseInt(p, end, &e)) return false;
+        exponent += static_cast<int>(e);
+    }
+    const double result = exponent == 0 ? mantissa : mantissa * std::pow(10.0, exponent);
+    *value = static_cast<float>(negative ? -result : result);
+    return true;
+}
+
+///
+/// \brief Parses the lines of one chunk
+/// http://www.paulbourke.net/dataformats/obj/
+///
+void ParseObjChunk(ObjChunk *chunk) {
+    std::vector<int64_t> face;
+    const char *p = chunk->begin;
+    while (p < chunk->end) {
+        chunk->lineCount++;
+        const char *lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(chunk->end - p)));
+        if (!lineEnd) lineEnd = chunk->end;
+
+        auto fail = [&](const std::string &msg) {
+            chunk->error = msg;
+            chunk->errorLine = chunk->lineCount;
+        };
+
+        SkipSpaces(p, lineEnd);
+        const std::string type = ReadToken(p, lineEnd);
+        if (type.empty() || type[0] == '#') {
+            // blank line or comment
+        } else if (type == "v") { // vertex
+            float x,y,z;
+            if (!(ParseFloat(p, lineEnd, &x) && ParseFloat(p, lineEnd, &y) && ParseFloat(p, lineEnd, &z)))
+                return fail("Could not parse vertex");
+            chunk->vertices.push_back(Vector3f(x,y,z));
+        } else if (type == "f") { // face
+            face.clear();
+            while (true) {
+                SkipSpaces(p, lineEnd);
+                if (p == lineEnd) break;
+                int64_t index;
+                if (!ParseInt(p, lineEnd, &index) || index == 0)
+                    return fail("Could not parse face");
+                // only the position is used, skip "/texture/normal"
+                while (p < lineEnd && !IsSpace(*p)) p++;
+                face.push_back(index);
+            }
+            if (face.size() < 3)
+                return fail("Face has less than three vertices");
+            // polygons are split into a fan of triangles
+            const int64_t localVertexCount = static_cast<int64_t>(chunk->vertices.size());
+            for (uint64 i=1; i+1<face.size(); i++) {
+                for (int64_t index : {face[0], face[i], face[i+1]}) {
+                    if (index < 0) {
+                        chunk->relativeCorners.push_back(chunk->corners.size());
+                        chunk->corners.push_back(localVertexCount + index);
+                    } else {
+                        chunk->corners.push_back(index - 1);
+                    }
+                }
+            }
+        } else if (type == "usemtl") { // material of the faces that follow
+            const std::string name = ReadToken(p, lineEnd);
+            if (name.empty())
+                return fail("Could not parse material name");
+            chunk->materialChanges.push_back(std::make_pair(static_cast<uint>(chunk->corners.size()/3), name));
+        } else if (type == "mtllib") { // material file(s)
+            for (std::string library = ReadToken(p, lineEnd); !library.empty(); library = ReadToken(p, lineEnd))
+                chunk->materialLibraries.push_back(library);
+        } else {
+            // texture coordinates, normals, groups, smoothing groups, etc. are not used
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+///
+/// \brief Hashable version of a vertex position (for merging identical vertices)
+///
+struct VertexKey {
+    uint32_t x, y, z;
+    bool operator==(const VertexKey &b) const { return x == b.x && y == b.y && z == b.z; }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &k) const {
+        return (static_cast<size_t>(k.x) * 73856093U) ^ (static_cast<size_t>(k.y) * 19349663U) ^ (static_cast<size_t>(k.z) * 83492791U);
+    }
+};
+
+VertexKey MakeVertexKey(const Vector3f &v) {
+    VertexKey key;
+    // adding 0 turns -0 into +0 so they are merged
+    const float x = v.X() + 0.F, y = v.Y() + 0.F, z = v.Z() + 0.F;
+    std::memcpy(&key.x, &x, sizeof(float));
+    std::memcpy(&key.y, &y, sizeof(float));
+    std::memcpy(&key.z, &z, sizeof(float));
+    return key;
+}
+
+///
+/// \brief Runs work(i) for every chunk, one thread per chunk (the first chunk runs on the calling thread)
+///
+template<typename Work>
+void ForEachChunk(uint chunkCount, Work work) {
+    std::vector<std::thread> threads;
+    for (uint i=1; i<chunkCount; i++)
+        threads.push_back(std::thread(work, i));
+    work(0);
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+///
+/// \brief Returns the directory part of a path (including the trailing slash) or "" if there is none
+///
+std::string DirectoryOf(const std::string &path) {
+    const uint64 lastSlash = path.find_last_of("\\/");
+    return lastSlash == std::string::npos ? "" : path.substr(0, lastSlash + 1);
+}
+
+} // namespace
+
+Mesh Mesh::LoadObj(const std::string &file, MaterialManager &materialManager, uint threadCount) {
+    MappedFile mapped(file);
+
+    // split the file into one chunk per thread (small files aren't worth the threads)
+    if (threadCount == 0) {
+        const uint64 minChunkSize = 1 << 20;
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+        threadCount = static_cast<uint>(std::max<uint64>(1, std::min<uint64>(threadCount, mapped.Size() / minChunkSize)));
+    }
+    std::vector<ObjChunk> chunks(threadCount);
+    const char *chunkBegin = mapped.Begin();
+    for (uint i=0; i<threadCount; i++) {
+        const char *chunkEnd = mapped.End();
+        if (i+1 < threadCount) {
+            // chunks always end just after a newline
+            chunkEnd = std::max(chunkBegin, mapped.Begin() + mapped.Size()*(i+1)/threadCount);
+            const char *newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', static_cast<size_t>(mapped.End() - chunkEnd)));
+            chunkEnd = newline ? newline + 1 : mapped.End();
+        }
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    // parse every chunk at the same time
+    ForEachChunk(threadCount, [&](uint i) { ParseObjChunk(&chunks[i]); });
+
+    uint lineOffset = 0;
+    for (const ObjChunk &chunk : chunks) {
+        if (!chunk.error.empty())
+            throw ParseException(chunk.error + " in obj file \"" + file + "\" on line: " + std::to_string(lineOffset + chunk.errorLine));
+        lineOffset += chunk.lineCount;
+    }
+
+    // where each chunk's vertices and triangles start in the whole file
+    std::vector<uint64> vertexOffsets(threadCount), triangleOffsets(threadCount);
+    uint64 vertexCount = 0, triangleCount = 0;
+    for (uint i=0; i<threadCount; i++) {
+        vertexOffsets[i] = vertexCount;
+        triangleOffsets[i] = triangleCount;
+        vertexCount += chunks[i].vertices.size();
+        triangleCount += chunks[i].corners.size() / 3;
+    }
+
+    // merge identical vertices
+    Mesh mesh;
+    std::vector<uint> vertexRemap;
+    vertexRemap.reserve(vertexCount);
+    {
+        std::unordered_map<VertexKey,uint,VertexKeyHash> uniqueVertices;
+        uniqueVertices.reserve(vertexCount);
+        for (const ObjChunk &chunk : chunks) {
+            for (const Vector3f &vertex : chunk.vertices) {
+                auto inserted = uniqueVertices.insert(std::make_pair(MakeVertexKey(vertex), static_cast<uint>(mesh.vertices_.size())));
+                if (inserted.second)
+                    mesh.vertices_.push_back(vertex);
+                vertexRemap.push_back(inserted.first->second);
+            }
+        }
+    }
+
+    // resolve the triangle indices now that the vertex offsets are known
+    mesh.indices_.resize(triangleCount*3);
+    std::vector<std::string> errors(threadCount);
+    ForEachChunk(threadCount, [&](uint i) {
+        ObjChunk &chunk = chunks[i];
+        for (uint64 relativeCorner : chunk.relativeCorners)
+            chunk.corners[relativeCorner] += static_cast<int64_t>(vertexOffsets[i]);
+        uint *indices = mesh.indices_.data() + triangleOffsets[i]*3;
+        for (uint64 j=0; j<chunk.corners.size(); j++) {
+            const int64_t corner = chunk.corners[j];
+            if (corner < 0 || corner >= static_cast<int64_t>(vertexCount)) {
+                errors[i] = "Face references vertex " + std::to_string(corner + 1) + " which does not exist in obj file \"" + file + "\"";
+                return;
+            }
+            indices[j] = vertexRemap[static_cast<uint64>(corner)];
+        }
+    });
+    for (const std::string &error : errors)
+        if (!error.empty())
+            throw ParseException(error);
+
+    // look up the materials (the material of a chunk's first faces is whatever the previous chunk left off with)
+    std::vector<std::string> materialLibraries;
+    for (const ObjChunk &chunk : chunks)
+        for (const std::string &library : chunk.materialLibraries)
+            materialLibraries.push_back(DirectoryOf(file) + library);
+
+    std::unordered_map<std::string,uint> materialIds;
+    auto lookupMaterial = [&](const std::string &name) {
+        auto search = materialIds.find(name);
+        if (search != materialIds.end())
+            return search->second;
+        for (const std::string &library : materialLibraries) {
+            try {
+                uint id = materialManager.GetMaterial(library, name);
+                materialIds[name] = id;
+                return id;
+            } catch (MaterialManager::MaterialNotFoundException &) {
+                // try the next library
+            }
+        }
+        throw MaterialManager::MaterialNotFoundException("Could not find material by name \"" + name + "\" used in obj file \"" + file + "\"");
+    };
+
+    bool hasMaterial = false;
+    uint currentMaterial = 0;
+    mesh.materialIds_.resize(triangleCount);
+    for (uint i=0; i<threadCount; i++) {
+        const ObjChunk &chunk = chunks[i];
+        const uint chunkTriangles = static_cast<uint>(chunk.corners.size() / 3);
+        uint triangle = 0;
+        for (uint j=0; j<=chunk.materialChanges.size(); j++) {
+            const uint nextChange = j < chunk.materialChanges.size() ? chunk.materialChanges[j].first : chunkTriangles;
+            if (triangle < nextChange) {
+                if (!hasMaterial) {
+                    // faces before any "usemtl" get a plain diffuse material
+                    currentMaterial = materialManager.AddMaterial(Material(Color(0,0,0), Color(.75F,.75F,.75F), Material::DIFFUSE));
+                    hasMaterial = true;
+                }
+                std::fill(mesh.materialIds_.begin() + static_cast<int64_t>(triangleOffsets[i] + triangle),
+                          mesh.materialIds_.begin() + static_cast<int64_t>(triangleOffsets[i] + nextChange),
+                          currentMaterial);
+            }
+            triangle = nextChange;
+            if (j < chunk.materialChanges.size()) {
+                currentMaterial = lookupMaterial(chunk.materialChanges[j].second);
+                hasMaterial = true;
+            }
+        }
+    }
+
+    return mesh;
+}
+
+} // namespace Tracer
@@ -0,0 +1,89 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_MESH_H
+#define TRACER_MESH_H
+
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "Material.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+
+namespace Tracer {
+
+///
+/// \brief An indexed triangle mesh (every triangle is three indices into a shared list of vertices)
+///
+class Mesh {
+public:
+    Mesh() = default;
+    ///
+    /// \brief Loads a mesh from a wavefront .obj file
+    /// The file is memory mapped, split into chunks at line boundaries, and the chunks are parsed in parallel.
+    /// Vertices with identical positions are merged.  Materials ("usemtl") are looked up in the files
+    /// given by "mtllib" using the material manager.  Faces without a material use a default diffuse material.
+    /// \param threadCount how many threads to parse with (0 to use every core)
+    /// \exception throws exceptions: FileReadException, ParseException, and MaterialManager::MaterialNotFoundException
+    ///
+    static Mesh LoadObj(const std::string &file, MaterialManager &materialManager, uint threadCount = 0);
+    ///
+    /// \brief Gets the (unique) vertices of the mesh
+    ///
+    const std::vector<Vector3f> &GetVertices() const { return vertices_; }
+    ///
+    /// \brief Gets the vertex indices of the triangles (three per triangle)
+    ///
+    const std::vector<uint> &GetIndices() const { return indices_; }
+    ///
+    /// \brief Gets the material id of every triangle
+    ///
+    const std::vector<uint> &GetMaterialIds() const { return materialIds_; }
+    ///
+    /// \brief Returns the number of triangles in the mesh
+    ///
+    uint GetTriangleCount() const { return static_cast<uint>(materialIds_.size()); }
+    ///
+    /// \brief Creates the triangle primative for a triangle of the mesh
+    ///
+    Triangle GetTriangle(uint i) const {
+        return Triangle(vertices_[indices_[3*i]], vertices_[indices_[3*i+1]], vertices_[indices_[3*i+2]]);
+    }
+private:
+    ///
+    /// \brief unique vertex positions
+    ///
+    std::vector<Vector3f> vertices_;
+    ///
+    /// \brief three vertex indices per triangle
+    ///
+    std::vector<uint> indices_;
+    ///
+    /// \brief one material id per triangle
+    ///
+    std::vector<uint> materialIds_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_MESH_H
@@ -0,0 +1,71 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_PIXELFILTER_H
+#define TRACER_PIXELFILTER_H
+
+#include "Common.h"
+
+namespace Tracer {
+
+///
+/// \brief Spreads the samples of a pixel around the pixel's center (the reconstruction filter of the image), which
+/// anti-aliases edges.
+///
+/// Instead of adding every sample to every pixel the filter reaches with the filter's weight (which needs atomics on the
+/// SYCL device since neighboring pixels share samples), every pixel takes its own samples at positions picked with the
+/// filter's shape as the probability (filter importance sampling of Ernst et al.).  Every sample then has the same
+/// weight and every pixel only ever writes to itself.
+///
+struct PixelFilter {
+    ///
+    /// \brief The shapes of the filter
+    ///
+    enum Type {
+        ///
+        /// \brief every position within the radius (along x and y) is as likely
+        ///
+        BOX,
+        ///
+        /// \brief positions are less likely the further they are from the center (linearly, along x and y)
+        ///
+        TENT,
+        ///
+        /// \brief a gaussian whose standard deviation is a third of the radius (cut off at the radius)
+        ///
+        GAUSSIAN
+    };
+    Type type;
+    ///
+    /// \brief how far from the pixel's center samples are taken, in pixels (0 takes every sample at the center)
+    ///
+    float radius;
+
+    ///
+    /// \brief Picks where a sample of a pixel is taken relative to the pixel's center, in pixels (intended to be run on the SYCL device)
+    /// \param u,v numbers in [0,1) (spread evenly over the square for the best anti-aliasing)
+    ///
+    void SampleOffset(float u, float v, float *offsetX, float *offsetY) const;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_PIXELFILTER_H
@@ -0,0 +1,67 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_PIXELFILTER_HPP
+#define TRACER_PIXELFILTER_HPP
+
+#include <SYCL/sycl.hpp>
+#include "PixelFilter.h"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+///
+/// \brief Maps a number in [0,1) to [-1,1] with the probability of the tent (the inverse of its cumulative distribution)
+///
+inline float SampleTent(float u) {
+    return u < .5F ? cl::sycl::sqrt(2*u) - 1 : 1 - cl::sycl::sqrt(2 - 2*u);
+}
+
+inline void PixelFilter::SampleOffset(float u, float v, float *offsetX, float *offsetY) const {
+    if (type == BOX) {
+        *offsetX = (2*u - 1) * radius;
+        *offsetY = (2*v - 1) * radius;
+    } else if (type == TENT) {
+        *offsetX = SampleTent(u) * radius;
+        *offsetY = SampleTent(v) * radius;
+    } else {
+        // the distance from the center of a 2D gaussian is a rayleigh distribution, cut off at the radius
+        const float sigma = radius / 3;
+        const float cutoff = 1 - cl::sycl::exp(-4.5F);
+        const float distance = sigma * cl::sycl::sqrt(-2 * cl::sycl::log(1 - u * cutoff));
+        const float angle = 2 * static_cast<float>(M_PI) * v;
+        *offsetX = distance * cl::sycl::cos(angle);
+        *offsetY = distance * cl::sycl::sin(angle);
+    }
+}
+
+} // namespace Tracer
+
+#endif // TRACER_PIXELFILTER_HPP
@@ -0,0 +1,119 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "PrimativeArrays.h"
+
+#include <stdexcept>
+
+namespace Tracer {
+
+PrimativeLayout::Type PrimativeArrays::GetType(const ScenePrimative &primative) {
+    if (primative.GetSphere() != nullptr)
+        return PrimativeLayout::SPHERE;
+    else if (primative.GetTriangle() != nullptr)
+        return PrimativeLayout::TRIANGLE;
+    else if (primative.GetPlane() != nullptr)
+        return PrimativeLayout::PLANE;
+    else if (primative.GetQuad() != nullptr)
+        return PrimativeLayout::QUAD;
+    return PrimativeLayout::BOX;
+}
+
+void PrimativeArrays::Build(const std::vector<ScenePrimative> &primatives) {
+    if (primatives.size() > INDEX_MASK)
+        throw std::length_error("Too many primatives to store");
+
+    // number the primatives of every type, then lay out the arrays of each type one after the other
+    layout_ = PrimativeLayout();
+    references_.resize(primatives.size());
+    for (uint i=0; i<primatives.size(); i++) {
+        const uint type = GetType(primatives[i]);
+        references_[i] = type << TYPE_SHIFT | layout_.counts[type]++;
+    }
+    uint dataSize = 0, materialCount = 0;
+    for (uint type=0; type<PrimativeLayout::TYPE_COUNT; type++) {
+        layout_.offsets[type] = dataSize;
+        layout_.materialOffsets[type] = materialCount;
+        dataSize += PrimativeLayout::FieldCount(type) * layout_.counts[type];
+        materialCount += layout_.counts[type];
+    }
+    data_.assign(dataSize, 0);
+    materialIds_.assign(materialCount, 0);
+    for (uint i=0; i<primatives.size(); i++)
+        Store(primatives[i], references_[i] & INDEX_MASK);
+    referenceChanges_.AddAll(references_.size());
+    dataChanges_.AddAll(data_.size());
+    materialIdChanges_.AddAll(materialIds_.size());
+}
+
+void PrimativeArrays::Update(const std::vector<ScenePrimative> &primatives, const std::vector<uint> &changedPrimatives) {
+    for (uint primativeId : changedPrimatives) {
+        if (GetType(primatives[primativeId]) != references_[primativeId] >> TYPE_SHIFT) {
+            Build(primatives);
+            return;
+        }
+    }
+    for (uint primativeId : changedPrimatives) {
+        const uint type = references_[primativeId] >> TYPE_SHIFT;
+        const uint index = references_[primativeId] & INDEX_MASK;
+        Store(primatives[primativeId], index);
+        for (uint field=0; field<PrimativeLayout::FieldCount(type); field++)
+            dataChanges_.Add(layout_.offsets[type] + field*layout_.counts[type] + index);
+        materialIdChanges_.Add(layout_.materialOffsets[type] + index);
+    }
+}
+
+void PrimativeArrays::Store(const ScenePrimative &primative, uint index) {
+    const uint type = GetType(primative);
+    float values[9];
+    uint count = 0;
+    auto add = [&](const Vector3f &v) {
+        values[count++] = v.X();
+        values[count++] = v.Y();
+        values[count++] = v.Z();
+    };
+    if (const Sphere *sphere = primative.GetSphere()) {
+        add(sphere->GetPosition());
+        values[count++] = sphere->GetRadius() * sphere->GetRadius();
+    } else if (const Triangle *triangle = primative.GetTriangle()) {
+        add(triangle->GetVertex(0));
+        add(triangle->GetVertex(1));
+        add(triangle->GetVertex(2));
+    } else if (const Plane *plane = primative.GetPlane()) {
+        add(plane->GetNormal());
+        values[count++] = plane->GetOffset();
+    } else if (const Quad *quad = primative.GetQuad()) {
+        add(quad->GetCorner());
+        add(quad->GetEdgeU());
+        add(quad->GetEdgeV());
+    } else if (const Box *box = primative.GetBox()) {
+        add(box->GetMin());
+        add(box->GetMax());
+    }
+
+    // every field of the type is its own array
+    const uint stride = layout_.counts[type];
+    for (uint field=0; field<count; field++)
+        data_[layout_.offsets[type] + field*stride + index] = values[field];
+    materialIds_[layout_.materialOffsets[type] + index] = primative.GetMaterialId();
+}
+
+} // namespace Tracer
@@ -0,0 +1,173 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef TRACER_PRIMATIVEARRAYS_H
+#define TRACER_PRIMATIVEARRAYS_H
+
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "Common.h"
+#include "DirtyRanges.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+
+namespace Tracer {
+
+///
+/// \brief Where the arrays of every type of primative are in a PrimativeArrays.  This is what is copied to the SYCL device.
+///
+struct PrimativeLayout {
+    ///
+    /// \brief The types of primatives (in the order their arrays are stored)
+    ///
+    enum Type {
+        SPHERE = 0,
+        TRIANGLE,
+        PLANE,
+        QUAD,
+        BOX,
+        TYPE_COUNT
+    };
+    ///
+    /// \brief Returns the number of floats stored for a primative of the type
+    ///
+    static uint FieldCount(uint type) { return type == SPHERE ? 4 : type == TRIANGLE ? 9 : type == PLANE ? 4 : type == QUAD ? 9 : 6; }
+    ///
+    /// \brief the number of primatives of each type
+    ///
+    uint counts[TYPE_COUNT];
+    ///
+    /// \brief where the fields of each type start in the data (field f of the i'th primative of a type is at offsets[type] + f*counts[type] + i)
+    ///
+    uint offsets[TYPE_COUNT];
+    ///
+    /// \brief where the material ids of each type start
+    ///
+    uint materialOffsets[TYPE_COUNT];
+};
+
+///
+/// \brief Pointers to the arrays of a PrimativeArrays, for intersecting rays with the primatives (intended to be used on the SYCL device)
+///
+struct PrimativePointers {
+    ///
+    /// \brief Determines if the ray intersects the primative (the same as ScenePrimative::Intersect)
+    ///
+    Intersection Intersect(uint primativeId, const Ray &ray) const;
+    ///
+    /// \brief Gets the id of the material of the primative
+    ///
+    uint GetMaterialId(uint primativeId) const;
+    ///
+    /// \brief Returns the vector stored in three fields starting at firstField
+    ///
+    static Vector3f GetVector(const float *fields, uint stride, uint firstField);
+    const uint *references;
+    const float *data;
+    const uint *materialIds;
+    PrimativeLayout layout;
+};
+
+///
+/// \brief The primatives of an acceleration structure stored as a structure of arrays (what is copied to the SYCL device).
+///
+/// A ScenePrimative is a padded union of every type of primative, so loading one loads more than any type needs.  Here every
+/// type has its own array of every float it needs (ex: a sphere's center x, y and z, and its squared radius) and of its
+/// material ids, so testing a ray only loads what the primative's type needs, and work-items testing neighboring primatives
+/// of a type load neighboring floats.  Primatives keep their ids: GetReferences() holds the type of every primative (in the
+/// top bits) and its index among the primatives of that type.
+///
+class PrimativeArrays {
+public:
+    ///
+    /// \brief Where the type is in a reference (the rest of it is the index)
+    ///
+    static const uint TYPE_SHIFT = 29;
+    static const uint INDEX_MASK = (1U << TYPE_SHIFT) - 1;
+    ///
+    /// \brief Stores the primatives (replacing any that were stored)
+    ///
+    void Build(const std::vector<ScenePrimative> &primatives);
+    ///
+    /// \brief Stores the changed primatives again.  Everything is stored again if one of them changed type.
+    ///
+    void Update(const std::vector<ScenePrimative> &primatives, const std::vector<uint> &changedPrimatives);
+    ///
+    /// \brief Gets the type (shifted by TYPE_SHIFT) and index among primatives of the type of every primative
+    ///
+    const std::vector<uint> &GetReferences() const { return references_; }
+    ///
+    /// \brief Gets the fields of the primatives (see PrimativeLayout::offsets)
+    ///
+    const std::vector<float> &GetData() const { return data_; }
+    ///
+    /// \brief Gets the ids of the materials of the primatives (see PrimativeLayout::materialOffsets)
+    ///
+    const std::vector<uint> &GetMaterialIds() const { return materialIds_; }
+    const PrimativeLayout &GetLayout() const { return layout_; }
+    ///
+    /// \brief Gets the ranges of the references, data, and material ids changed by Build() and Update() (see DirtyRanges)
+    ///
+    const DirtyRanges &GetReferenceChanges() const { return referenceChanges_; }
+    const DirtyRanges &GetDataChanges() const { return dataChanges_; }
+    const DirtyRanges &GetMaterialIdChanges() const { return materialIdChanges_; }
+    ///
+    /// \brief Returns pointers to the arrays (for intersecting on the host)
+    ///
+    PrimativePointers GetPointers() const { return { references_.data(), data_.data(), materialIds_.data(), layout_ }; }
+    ///
+    /// \brief Returns the type of the primative
+    ///
+    static PrimativeLayout::Type GetType(const ScenePrimative &primative);
+private:
+    ///
+    /// \brief Writes the fields and material id of the primative as the index'th primative of its type
+    ///
+    void Store(const ScenePrimative &primative, uint index);
+    ///
+    /// \brief See GetReferences()
+    ///
+    std::vector<uint> references_;
+    ///
+    /// \brief See GetData()
+    ///
+    std::vector<float> data_;
+    ///
+    /// \brief See GetMaterialIds()
+    ///
+    std::vector<uint> materialIds_;
+    ///
+    /// \brief See GetLayout()
+    ///
+    PrimativeLayout layout_ = PrimativeLayout();
+    ///
+    /// \brief See GetReferenceChanges(), GetDataChanges(), and GetMaterialIdChanges()
+    ///
+    DirtyRanges referenceChanges_;
+    DirtyRanges dataChanges_;
+    DirtyRanges materialIdChanges_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_PRIMATIVEARRAYS_H
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef TRACER_PRIMATIVEARRAYS_HPP
+#define TRACER_PRIMATIVEARRAYS_HPP
+
+#include "PrimativeArrays.h"
+#include "ScenePrimative.hpp"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+/// The alternative would be to have all SYCL kernel code in headers
+/// which is much worse.
+///
+
+namespace Tracer {
+
+inline Vector3f PrimativePointers::GetVector(const float *fields, uint stride, uint firstField) {
+    return Vector3f(fields[firstField*stride], fields[(firstField+1)*stride], fields[(firstField+2)*stride]);
+}
+
+inline Intersection PrimativePointers::Intersect(uint primativeId, const Ray &ray) const {
+    static_assert (PrimativeLayout::TYPE_COUNT - 1 == PrimativeLayout::BOX, "You must add the new primative type to PrimativePointers::Intersect.");
+    const uint reference = references[primativeId];
+    const uint type = reference >> PrimativeArrays::TYPE_SHIFT;
+    // field f of the primative is at fields[f*stride]
+    const float *fields = data + layout.offsets[type] + (reference & PrimativeArrays::INDEX_MASK);
+    const uint stride = layout.counts[type];
+
+    if (type == PrimativeLayout::SPHERE)
+        return Sphere::Intersect(ray, GetVector(fields, stride, 0), fields[3*stride]);
+    else if (type == PrimativeLayout::TRIANGLE)
+        return Triangle(GetVector(fields, stride, 0), GetVector(fields, stride, 3), GetVector(fields, stride, 6)).Intersect(ray);
+    else if (type == PrimativeLayout::PLANE)
+        return Plane::Intersect(ray, GetVector(fields, stride, 0), fields[3*stride]);
+    else if (type == PrimativeLayout::QUAD)
+        return Quad(GetVector(fields, stride, 0), GetVector(fields, stride, 3), GetVector(fields, stride, 6)).Intersect(ray);
+    else if (type == PrimativeLayout::BOX)
+        return Box(GetVector(fields, stride, 0), GetVector(fields, stride, 3)).Intersect(ray);
+    return Intersection::NO_INTERSECTION();
+}
+
+inline uint PrimativePointers::GetMaterialId(uint primativeId) const {
+    const uint reference = references[primativeId];
+    return materialIds[layout.materialOffsets[reference >> PrimativeArrays::TYPE_SHIFT] + (reference & PrimativeArrays::INDEX_MASK)];
+}
+
+///
+/// \brief Determines if the ray intersects a primative of the arrays (see ClosestPrimativeIntersector)
+///
+inline Intersection IntersectPrimative(const PrimativePointers &primatives, uint primativeId, const Ray &ray) {
+    return primatives.Intersect(primativeId, ray);
+}
+
+///
+/// \brief Gets the id of the material of a primative of the arrays
+///
+inline uint PrimativeMaterialId(const PrimativePointers &primatives, uint primativeId) {
+    return primatives.GetMaterialId(primativeId);
+}
+
+} // namespace Tracer
+
+#endif // TRACER_PRIMATIVEARRAYS_HPP
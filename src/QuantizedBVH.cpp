@@ -0,0 +1,111 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "QuantizedBVH.h"
+
+#include <cmath>
+#include <limits>
+
+namespace Tracer {
+
+namespace {
+
+///
+/// \brief Decompresses a quantized bound exactly the way it is decompressed while traversing
+///
+float Decompress(float origin, float quantized, float scale) {
+    return origin + quantized * scale;
+}
+
+} // namespace
+
+template<uint Width>
+QuantizedBVHNode<Width> QuantizedBVH<Width>::Compress(const WideBVHNode<Width> &node) {
+    QuantizedBVHNode<Width> quantizedNode;
+    for (uint i=0; i<Width; i++) {
+        quantizedNode.child[i] = node.child[i];
+        quantizedNode.count[i] = node.count[i];
+    }
+
+    const float *boundsMin[3] = { node.boundsMinX, node.boundsMinY, node.boundsMinZ };
+    const float *boundsMax[3] = { node.boundsMaxX, node.boundsMaxY, node.boundsMaxZ };
+    uint8 *quantizedMin[3] = { quantizedNode.quantizedMinX, quantizedNode.quantizedMinY, quantizedNode.quantizedMinZ };
+    uint8 *quantizedMax[3] = { quantizedNode.quantizedMaxX, quantizedNode.quantizedMaxY, quantizedNode.quantizedMaxZ };
+    for (uint axis=0; axis<3; axis++) {
+        // the node's own box along this axis
+        float min = std::numeric_limits<float>::infinity();
+        float max = -std::numeric_limits<float>::infinity();
+        for (uint i=0; i<Width; i++) {
+            quantizedMin[axis][i] = 0;
+            quantizedMax[axis][i] = 0;
+            if (node.child[i] == WideBVHNode<Width>::EMPTY_CHILD) continue;
+            min = std::fmin(min, boundsMin[axis][i]);
+            max = std::fmax(max, boundsMax[axis][i]);
+        }
+        if (min > max) {
+            // no children
+            quantizedNode.origin[axis] = 0;
+            quantizedNode.exponent[axis] = 0;
+            continue;
+        }
+        quantizedNode.origin[axis] = min;
+
+        // the smallest power of two that splits the box into at most 255 steps,
+        // made bigger if rounding outwards pushed a child past the last step
+        int exponent = MIN_EXPONENT;
+        if (max > min)
+            std::frexp((max - min) / 255, &exponent);
+        if (exponent < MIN_EXPONENT)
+            exponent = MIN_EXPONENT;
+        for (; exponent <= MAX_EXPONENT; exponent++) {
+            const float scale = std::ldexp(1.F, exponent);
+            bool fits = true;
+            for (uint i=0; i<Width && fits; i++) {
+                if (node.child[i] == WideBVHNode<Width>::EMPTY_CHILD) continue;
+                float low = std::floor((boundsMin[axis][i] - min) / scale);
+                while (low > 0 && Decompress(min, low, scale) > boundsMin[axis][i])
+                    low--;
+                float high = std::ceil((boundsMax[axis][i] - min) / scale);
+                while (high <= 255 && Decompress(min, high, scale) < boundsMax[axis][i])
+                    high++;
+                fits = high <= 255 || exponent == MAX_EXPONENT;
+                quantizedMin[axis][i] = static_cast<uint8>(std::fmax(low, 0.F));
+                quantizedMax[axis][i] = static_cast<uint8>(std::fmin(high, 255.F));
+            }
+            if (fits) break;
+        }
+        quantizedNode.exponent[axis] = static_cast<int8>(exponent);
+    }
+    return quantizedNode;
+}
+
+template<uint Width>
+void QuantizedBVH<Width>::Compress(const std::vector<WideBVHNode<Width>> &nodes, std::vector<QuantizedBVHNode<Width>> *quantizedNodes) {
+    quantizedNodes->resize(nodes.size());
+    for (uint i=0; i<nodes.size(); i++)
+        (*quantizedNodes)[i] = Compress(nodes[i]);
+}
+
+template class QuantizedBVH<2>;
+template class QuantizedBVH<4>;
+template class QuantizedBVH<8>;
+
+} // namespace Tracer
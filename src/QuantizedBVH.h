@@ -0,0 +1,104 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_QUANTIZEDBVH_H
+#define TRACER_QUANTIZEDBVH_H
+
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "AABB.h"
+#include "Common.h"
+#include "Vector.h"
+#include "WideBVH.h"
+
+namespace Tracer {
+
+///
+/// \brief A compressed BVH node (Width children per node).  This is what is copied to the SYCL device.
+///
+/// The bounds of the children are stored as 8 bit offsets from the node's own box: along each axis a child's bounds are
+/// origin + quantized * 2^exponent, rounded outwards so a child's quantized box always contains the child.
+/// Children and counts are exactly as in WideBVHNode (32 bit primative/node indices).
+///
+/// A binary node is 44 bytes instead of the 64 bytes of the two BVHNodes it replaces, a 4 wide node is 72 bytes
+/// instead of 128, and an 8 wide node is 128 bytes instead of 256.
+///
+template<uint Width>
+struct QuantizedBVHNode {
+    ///
+    /// \brief Marks an unused child
+    ///
+    static const uint EMPTY_CHILD = WideBVHNode<Width>::EMPTY_CHILD;
+
+    float origin[3];
+    uint child[Width];
+    uint count[Width];
+    uint8 quantizedMinX[Width];
+    uint8 quantizedMinY[Width];
+    uint8 quantizedMinZ[Width];
+    uint8 quantizedMaxX[Width];
+    uint8 quantizedMaxY[Width];
+    uint8 quantizedMaxZ[Width];
+    int8 exponent[3];
+
+    ///
+    /// \brief Tests the ray against the (decompressed) bounds of every child, see WideBVHNode::Intersect
+    ///
+    void Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) const;
+    ///
+    /// \brief Returns the decompressed bounds of a child (they contain the child's real bounds)
+    ///
+    AABB GetChildBounds(uint i) const;
+};
+
+///
+/// \brief Compresses wide BVHs into quantized nodes (see QuantizedBVHNode).
+/// Compressed nodes use much less memory (so bigger scenes fit on the SYCL device) and more of the tree fits in the
+/// caches while traversing, at the cost of decompressing the bounds of every child tested and slightly looser bounds.
+///
+template<uint Width>
+class QuantizedBVH {
+public:
+    ///
+    /// \brief The smallest and biggest exponents used to scale the quantized bounds (they keep 2^exponent a normal float)
+    ///
+    static const int MIN_EXPONENT = -126;
+    static const int MAX_EXPONENT = 127;
+    ///
+    /// \brief Compresses a single wide node
+    ///
+    static QuantizedBVHNode<Width> Compress(const WideBVHNode<Width> &node);
+    ///
+    /// \brief Replaces quantizedNodes with every wide node compressed.
+    /// Node ids are kept (the i'th wide node becomes the i'th compressed node) so roots and children stay valid.
+    ///
+    static void Compress(const std::vector<WideBVHNode<Width>> &nodes, std::vector<QuantizedBVHNode<Width>> *quantizedNodes);
+    ///
+    /// \brief Walks the tree starting at root front to back, see BVH::Traverse (intended to be run on the SYCL device)
+    ///
+    template<typename Intersector>
+    static void Traverse(const Ray &ray, const QuantizedBVHNode<Width> *nodes, const uint *indices, uint root, Intersector *intersector);
+};
+
+} // namespace Tracer
+
+#endif // TRACER_QUANTIZEDBVH_H
@@ -0,0 +1,88 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_QUANTIZEDBVH_HPP
+#define TRACER_QUANTIZEDBVH_HPP
+
+#include "QuantizedBVH.h"
+#include "WideBVH.hpp"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+template<uint Width>
+inline void QuantizedBVHNode<Width>::Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) const {
+    // decompress into an uncompressed node so the (possibly SIMD) slab test of the wide node is used
+    const float inf = std::numeric_limits<float>::infinity();
+    const float scaleX = cl::sycl::ldexp(1.F, exponent[0]);
+    const float scaleY = cl::sycl::ldexp(1.F, exponent[1]);
+    const float scaleZ = cl::sycl::ldexp(1.F, exponent[2]);
+    WideBVHNode<Width> decompressed;
+    for (uint i=0; i<Width; i++) {
+        const bool used = child[i] != EMPTY_CHILD;
+        decompressed.boundsMinX[i] = used ? origin[0] + quantizedMinX[i] * scaleX : inf;
+        decompressed.boundsMinY[i] = used ? origin[1] + quantizedMinY[i] * scaleY : inf;
+        decompressed.boundsMinZ[i] = used ? origin[2] + quantizedMinZ[i] * scaleZ : inf;
+        decompressed.boundsMaxX[i] = used ? origin[0] + quantizedMaxX[i] * scaleX : inf;
+        decompressed.boundsMaxY[i] = used ? origin[1] + quantizedMaxY[i] * scaleY : inf;
+        decompressed.boundsMaxZ[i] = used ? origin[2] + quantizedMaxZ[i] * scaleZ : inf;
+    }
+    decompressed.Intersect(ray, invDirection, maxDistance, distances);
+}
+
+template<uint Width>
+inline AABB QuantizedBVHNode<Width>::GetChildBounds(uint i) const {
+    if (child[i] == EMPTY_CHILD) return AABB();
+    const uint8 *quantizedMin[3] = { quantizedMinX, quantizedMinY, quantizedMinZ };
+    const uint8 *quantizedMax[3] = { quantizedMaxX, quantizedMaxY, quantizedMaxZ };
+    Vector3f min, max;
+    for (uint axis=0; axis<3; axis++) {
+        const float scale = cl::sycl::ldexp(1.F, exponent[axis]);
+        min[axis] = origin[axis] + quantizedMin[axis][i] * scale;
+        max[axis] = origin[axis] + quantizedMax[axis][i] * scale;
+    }
+    return AABB(min, max);
+}
+
+template<uint Width>
+template<typename Intersector>
+inline void QuantizedBVH<Width>::Traverse(const Ray &ray, const QuantizedBVHNode<Width> *nodes, const uint *indices, uint root, Intersector *intersector) {
+    // the tree has the same shape as the wide BVH it was compressed from
+    WideBVH<Width>::Traverse(ray, nodes, indices, root, intersector);
+}
+
+template<uint Width, typename Intersector>
+inline void TraverseBVH(const Ray &ray, const QuantizedBVHNode<Width> *nodes, const uint *indices, uint root, Intersector *intersector) {
+    QuantizedBVH<Width>::Traverse(ray, nodes, indices, root, intersector);
+}
+
+} // namespace Tracer
+
+#endif // TRACER_QUANTIZEDBVH_HPP
@@ -0,0 +1,93 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "RadixSort.h"
+
+#include "RadixSort.hpp"
+
+namespace Tracer {
+
+// names of the SYCL kernels
+class RadixSortHistogram;
+class RadixSortScanBlocks;
+class RadixSortScanDigits;
+class RadixSortScatter;
+
+void RadixSort::Sort(cl::sycl::queue &queue, cl::sycl::buffer<uint,1> &keys, cl::sycl::buffer<uint,1> &values, uint keyCount, uint bits) {
+    if (keyCount <= 1)
+        return;
+    const uint blockCount = BlockCount(keyCount);
+    if (keyCount > capacity_) {
+        scratchKeys_ = cl::sycl::buffer<uint,1>(cl::sycl::range<1>(keyCount));
+        scratchValues_ = cl::sycl::buffer<uint,1>(cl::sycl::range<1>(keyCount));
+        histogram_ = cl::sycl::buffer<uint,1>(cl::sycl::range<1>(RADIX * blockCount));
+        capacity_ = keyCount;
+    }
+
+    // least significant digit first, ping-ponging between the buffers
+    cl::sycl::buffer<uint,1> *keyBuffers[2] = { &keys, &scratchKeys_ };
+    cl::sycl::buffer<uint,1> *valueBuffers[2] = { &values, &scratchValues_ };
+    const uint passCount = PassCount(bits);
+    for (uint pass=0; pass<passCount; pass++) {
+        const uint shift = pass * RADIX_BITS;
+        cl::sycl::buffer<uint,1> &inKeys = *keyBuffers[pass % 2];
+        cl::sycl::buffer<uint,1> &inValues = *valueBuffers[pass % 2];
+        cl::sycl::buffer<uint,1> &outKeys = *keyBuffers[(pass+1) % 2];
+        cl::sycl::buffer<uint,1> &outValues = *valueBuffers[(pass+1) % 2];
+
+        queue.submit([&](cl::sycl::handler &cgh) {
+            auto keyAccessor = inKeys.get_access<cl::sycl::access::mode::read>(cgh);
+            auto histogramAccessor = histogram_.get_access<cl::sycl::access::mode::discard_write>(cgh);
+            cgh.parallel_for<RadixSortHistogram>(cl::sycl::range<1>(blockCount), [=](cl::sycl::item<1> item) {
+                Histogram(static_cast<uint>(item.get_id(0)), keyAccessor.get_pointer(), keyCount, shift, histogramAccessor.get_pointer(), blockCount);
+            });
+        });
+        queue.submit([&](cl::sycl::handler &cgh) {
+            auto histogramAccessor = histogram_.get_access<cl::sycl::access::mode::read_write>(cgh);
+            auto digitAccessor = digitOffsets_.get_access<cl::sycl::access::mode::discard_write>(cgh);
+            cgh.parallel_for<RadixSortScanBlocks>(cl::sycl::range<1>(RADIX), [=](cl::sycl::item<1> item) {
+                ScanBlocks(static_cast<uint>(item.get_id(0)), histogramAccessor.get_pointer(), blockCount, digitAccessor.get_pointer());
+            });
+        });
+        queue.submit([&](cl::sycl::handler &cgh) {
+            auto digitAccessor = digitOffsets_.get_access<cl::sycl::access::mode::read_write>(cgh);
+            cgh.single_task<RadixSortScanDigits>([=]() {
+                ScanDigits(digitAccessor.get_pointer());
+            });
+        });
+        queue.submit([&](cl::sycl::handler &cgh) {
+            auto keyAccessor = inKeys.get_access<cl::sycl::access::mode::read>(cgh);
+            auto valueAccessor = inValues.get_access<cl::sycl::access::mode::read>(cgh);
+            auto histogramAccessor = histogram_.get_access<cl::sycl::access::mode::read_write>(cgh);
+            auto digitAccessor = digitOffsets_.get_access<cl::sycl::access::mode::read>(cgh);
+            // only the first keyCount keys are written, the rest of the buffers are kept
+            auto outKeyAccessor = outKeys.get_access<cl::sycl::access::mode::write>(cgh);
+            auto outValueAccessor = outValues.get_access<cl::sycl::access::mode::write>(cgh);
+            cgh.parallel_for<RadixSortScatter>(cl::sycl::range<1>(blockCount), [=](cl::sycl::item<1> item) {
+                Scatter(static_cast<uint>(item.get_id(0)), keyAccessor.get_pointer(), valueAccessor.get_pointer(), keyCount, shift,
+                        histogramAccessor.get_pointer(), blockCount, digitAccessor.get_pointer(),
+                        outKeyAccessor.get_pointer(), outValueAccessor.get_pointer());
+            });
+        });
+    }
+}
+
+} // namespace Tracer
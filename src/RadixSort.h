@@ -0,0 +1,111 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef TRACER_RADIXSORT_H
+#define TRACER_RADIXSORT_H
+
+#include <SYCL/sycl.hpp>
+#include "Common.h"
+
+namespace Tracer {
+
+///
+/// \brief Sorts 32 bit keys (and a 32 bit value that goes with every key) with a stable, least significant digit first radix sort.
+///
+/// The keys are split into blocks.  For every digit the keys of every block are counted, the counts are scanned into
+/// where every block's keys with each digit go, and every block then moves its keys there in order.  The steps are used
+/// by the SYCL kernels of Sort() and can also be run on host threads (see LinearBVHBuilder).
+///
+/// The buffers Sort() needs besides the keys and values are kept (and grown when needed) so sorting again and again
+/// (ex: every bounce of a wavefront) doesn't allocate any device memory.
+///
+class RadixSort {
+public:
+    ///
+    /// \brief The number of bits sorted by each pass
+    ///
+    static const uint RADIX_BITS = 8;
+    static const uint RADIX = 1 << RADIX_BITS;
+    ///
+    /// \brief The number of keys every work item (or host task) is responsible for
+    ///
+    static const uint BLOCK_SIZE = 256;
+    ///
+    /// \brief Returns the number of blocks keyCount keys are split into
+    ///
+    static uint BlockCount(uint keyCount) { return (keyCount + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+    ///
+    /// \brief Returns the number of passes that sort the lowest bits of the keys.
+    /// Passes ping-pong between two buffers, so there is always an even number of them to end in the buffers that were sorted.
+    ///
+    static uint PassCount(uint bits) { return ((bits + RADIX_BITS - 1) / RADIX_BITS + 1) / 2 * 2; }
+    ///
+    /// \brief Sorts the first keyCount keys (and values) of the buffers by the lowest bits of the keys with SYCL kernels
+    /// \param bits how many of the lowest bits of the keys are sorted (higher bits are sorted too if they are in the same digit
+    /// as the highest of them, so keys should fit in bits)
+    ///
+    void Sort(cl::sycl::queue &queue, cl::sycl::buffer<uint,1> &keys, cl::sycl::buffer<uint,1> &values, uint keyCount, uint bits);
+    ///
+    /// \brief Returns the digit of a key sorted by the pass starting at the bit shift
+    ///
+    static uint Digit(uint key, uint shift) { return (key >> shift) & (RADIX - 1); }
+    ///
+    /// \brief Counts the digits in a block of keys (intended to be run on the SYCL device).
+    /// The histogram is stored digit major (histogram[digit*blockCount + block]) so scanning it gives where every block's keys go.
+    ///
+    static void Histogram(uint block, const uint *keys, uint keyCount, uint shift, uint *histogram, uint blockCount);
+    ///
+    /// \brief Replaces the counts of a digit with where each block's keys with that digit start (relative to the digit)
+    /// (intended to be run on the SYCL device)
+    /// \param digitTotals holds how many keys have the digit
+    ///
+    static void ScanBlocks(uint digit, uint *histogram, uint blockCount, uint *digitTotals);
+    ///
+    /// \brief Replaces the number of keys with each digit with where the keys with the digit start (intended to be run on the SYCL device)
+    ///
+    static void ScanDigits(uint *digitTotals);
+    ///
+    /// \brief Moves a block of keys (and their values) to where they are sorted by the digit, keeping their order otherwise
+    /// (intended to be run on the SYCL device)
+    ///
+    static void Scatter(uint block, const uint *keys, const uint *values, uint keyCount, uint shift, uint *histogram, uint blockCount,
+                        const uint *digitOffsets, uint *sortedKeys, uint *sortedValues);
+private:
+    ///
+    /// \brief The number of keys the buffers below have room for
+    ///
+    uint capacity_ = 0;
+    ///
+    /// \brief Where every other pass puts the keys and values
+    ///
+    cl::sycl::buffer<uint,1> scratchKeys_{cl::sycl::range<1>(1)};
+    cl::sycl::buffer<uint,1> scratchValues_{cl::sycl::range<1>(1)};
+    ///
+    /// \brief See Histogram() and ScanDigits()
+    ///
+    cl::sycl::buffer<uint,1> histogram_{cl::sycl::range<1>(1)};
+    cl::sycl::buffer<uint,1> digitOffsets_{cl::sycl::range<1>(RADIX)};
+};
+
+} // namespace Tracer
+
+#endif // TRACER_RADIXSORT_H
@@ -0,0 +1,81 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+
+#ifndef TRACER_RADIXSORT_HPP
+#define TRACER_RADIXSORT_HPP
+
+#include <SYCL/sycl.hpp>
+#include "RadixSort.h"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See RadixSort.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+inline void RadixSort::Histogram(uint block, const uint *keys, uint keyCount, uint shift, uint *histogram, uint blockCount) {
+    for (uint digit=0; digit<RADIX; digit++)
+        histogram[digit*blockCount + block] = 0;
+    const uint end = cl::sycl::min(keyCount, (block+1) * BLOCK_SIZE);
+    for (uint i=block*BLOCK_SIZE; i<end; i++)
+        histogram[Digit(keys[i], shift)*blockCount + block]++;
+}
+
+inline void RadixSort::ScanBlocks(uint digit, uint *histogram, uint blockCount, uint *digitTotals) {
+    uint sum = 0;
+    for (uint block=0; block<blockCount; block++) {
+        const uint count = histogram[digit*blockCount + block];
+        histogram[digit*blockCount + block] = sum;
+        sum += count;
+    }
+    digitTotals[digit] = sum;
+}
+
+inline void RadixSort::ScanDigits(uint *digitTotals) {
+    uint sum = 0;
+    for (uint digit=0; digit<RADIX; digit++) {
+        const uint count = digitTotals[digit];
+        digitTotals[digit] = sum;
+        sum += count;
+    }
+}
+
+inline void RadixSort::Scatter(uint block, const uint *keys, const uint *values, uint keyCount, uint shift, uint *histogram, uint blockCount,
+                               const uint *digitOffsets, uint *sortedKeys, uint *sortedValues) {
+    const uint end = cl::sycl::min(keyCount, (block+1) * BLOCK_SIZE);
+    for (uint i=block*BLOCK_SIZE; i<end; i++) {
+        const uint digit = Digit(keys[i], shift);
+        const uint position = digitOffsets[digit] + histogram[digit*blockCount + block]++;
+        sortedKeys[position] = keys[i];
+        sortedValues[position] = values[i];
+    }
+}
+
+} // namespace Tracer
+
+#endif // TRACER_RADIXSORT_HPP
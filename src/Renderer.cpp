@@ -20,12 +20,24 @@
 
 #include "Renderer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
 #include <SYCL/sycl.hpp>
+#include "AccelerationStructure.hpp"
 #include "ScenePrimative.hpp"
 #include "Camera.hpp"
+#include "PixelFilter.hpp"
+#include "PrimativeArrays.hpp"
+#include "QuantizedBVH.hpp"
+#include "RadixSort.h"
+#include "Sampler.hpp"
+#include "VoxelDAG.hpp"
+#include "WideBVH.hpp"
 #include "Material.h"
 
 using cl::sycl::pow;
@@ -36,6 +48,44 @@ using cl::sycl::sin;
 
 namespace Tracer {
 
+///
+/// \brief Names the render kernel for each node layout (and memory the scene is read from)
+///
+template<typename Node, cl::sycl::access::target Memory>
+class RenderKernel;
+///
+/// \brief Names the kernel adding a finished wave of samples to the accumulation buffer
+///
+class AddWaveKernel;
+///
+/// \brief Names the kernel finding the pixels that need more samples
+///
+class FindActivePixelsKernel;
+///
+/// \brief Name the kernels of the wavefront for each node layout and scene memory (see Renderer::SetWavefront())
+///
+template<typename Node, cl::sycl::access::target Memory>
+class GeneratePathsKernel;
+template<typename Node, cl::sycl::access::target Memory>
+class ExtendPathsKernel;
+template<typename Node, cl::sycl::access::target Memory>
+class ShadePathsKernel;
+template<typename Node, cl::sycl::access::target Memory>
+class ShadowRaysKernel;
+template<typename Node, cl::sycl::access::target Memory>
+class AccumulatePathsKernel;
+template<typename Node, cl::sycl::access::target Memory>
+class RaySortKeysKernel;
+template<typename Node, cl::sycl::access::target Memory>
+class HitSortKeysKernel;
+///
+/// \brief Name the kernels of persistent threads for each node layout and scene memory (see Renderer::SetPersistentThreads())
+///
+template<typename Node, cl::sycl::access::target Memory>
+class PersistentRenderKernel;
+template<typename Node, cl::sycl::access::target Memory>
+class PersistentMergeKernel;
+
 ///
 /// \brief Local Rendering helpers
 ///
@@ -50,40 +100,349 @@ void DefaultErrorHandler(cl::sycl::exception const& e) {
 }
 
 ///
-/// \brief Returns the closest intersection of the ray for the primatives given.  Or NO_INTERSECTION if no intersection is found.
-/// \param primativeId holds the id of the primative that was intersected with (if there was an intersection)
+/// \brief Returns an accessor for reading the first count elements of the buffer in a kernel from the given memory.
+/// It only covers what is read, since the device's buffers can have room to grow (see DeviceArray) that shouldn't take
+/// up constant memory.
 ///
-Intersection ClosestIntersection(const Ray &r, const ScenePrimative *primatives, uint64 primativesCount, uint64 *primativeId) {
-    Intersection bestIntersection = Intersection::NO_INTERSECTION();
-    *primativeId = 0;
-    for (uint64 i=0; i<primativesCount; i++) {
-        Intersection newIntersection = primatives[i].Intersect(r);
-        if (newIntersection < bestIntersection) {
-            bestIntersection = newIntersection;
-            *primativeId = i;
-        }
+template<cl::sycl::access::target Memory, typename T>
+cl::sycl::accessor<T,1,cl::sycl::access::mode::read,Memory> ReadAccessor(cl::sycl::buffer<T,1> &buffer, uint64 count, cl::sycl::handler &cgh) {
+    return buffer.template get_access<cl::sycl::access::mode::read,Memory>(cgh, cl::sycl::range<1>(std::max<uint64>(count, 1)), cl::sycl::id<1>(0));
+}
+
+///
+/// \brief Returns the closest intersection of the ray for the primatives and voxel world given.  Or NO_INTERSECTION if no intersection is found.
+/// \param materialId holds the id of the material of the primative or block that was intersected with (if there was an intersection)
+///
+template<typename Node>
+Intersection ClosestIntersection(const Ray &r, const Node *nodes, const uint *indices, const PrimativePointers &primatives,
+                                 const BVHInstance *instances, uint instanceCount, uint topLevelRoot,
+                                 const VoxelGrid &voxelGrid, const uint *chunks, const uint *sectionRoots, const VoxelDAGNode *voxelNodes,
+                                 const VoxelDAGLeaf *voxelLeaves, const uint *blockMaterials, uint *materialId) {
+    const Intersection intersection = AccelerationStructure::Intersect(r, nodes, indices, primatives, instances, instanceCount, topLevelRoot, materialId);
+    // blocks behind the closest primative are never visited
+    uint blockMaterialId = 0;
+    const Intersection blockIntersection = VoxelDAG::Intersect(r, voxelGrid, chunks, sectionRoots, voxelNodes, voxelLeaves, blockMaterials,
+                                                               intersection.Distance(), &blockMaterialId);
+    if (!(blockIntersection < intersection))
+        return intersection;
+    *materialId = blockMaterialId;
+    return blockIntersection;
+}
+
+///
+/// \brief Returns true if any primative or block is closer than maxDistance along the ray (for shadow rays)
+///
+template<typename Node>
+bool Occluded(const Ray &r, const Node *nodes, const uint *indices, const PrimativePointers &primatives,
+              const BVHInstance *instances, uint instanceCount, uint topLevelRoot,
+              const VoxelGrid &voxelGrid, const uint *chunks, const uint *sectionRoots, const VoxelDAGNode *voxelNodes,
+              const VoxelDAGLeaf *voxelLeaves, const uint *blockMaterials, float maxDistance) {
+    if (AccelerationStructure::Occluded(r, nodes, indices, primatives, instances, instanceCount, topLevelRoot, maxDistance))
+        return true;
+    uint blockMaterialId = 0;
+    return VoxelDAG::Intersect(r, voxelGrid, chunks, sectionRoots, voxelNodes, voxelLeaves, blockMaterials, maxDistance, &blockMaterialId)
+            != Intersection::NO_INTERSECTION();
+}
+
+///
+/// \brief Returns 1 - cos of the half angle of the cone the sphere covers as seen from the point (0 if the point is inside the sphere)
+/// \note written so that it doesn't cancel down to 0 for small, far away spheres
+///
+float SphereConeSize(const Sphere &sphere, const Vector3f &point) {
+    const Vector3f toCenter = Vector3f(sphere.GetPosition() - point);
+    const float sinSquared = sphere.GetRadius() * sphere.GetRadius() / toCenter.Dot(toCenter);
+    if (!(sinSquared < 1))
+        return 0;
+    return sinSquared / (1 + sqrt(1 - sinSquared));
+}
+
+///
+/// \brief Picks a direction from the point toward the sphere uniformly over the cone the sphere covers as seen from the point
+/// \param pdf holds the probability density (per solid angle) of the direction
+/// \return false if the point is inside the sphere
+///
+bool SampleSphereLight(const Sphere &sphere, const Vector3f &point, float r1, float r2, Vector3f *direction, float *pdf) {
+    const float coneSize = SphereConeSize(sphere, point);
+    if (coneSize == 0)
+        return false;
+    const float oneMinusCos = r1 * coneSize;
+    const float cosTheta = 1 - oneMinusCos;
+    const float sinTheta = sqrt(cl::sycl::fmax(0.F, oneMinusCos * (2 - oneMinusCos)));
+    const float phi = 2*static_cast<float>(M_PI)*r2;
+    Vector3f w = Vector3f(sphere.GetPosition() - point).Normalize(); // toward the center
+    Vector3f u = ( ((fabs(w.X())>.1F) ? Vector3f(0,1) : Vector3f(1) ).Cross(w)).Normalize(); // u is perpendicular to w
+    Vector3f v = w.Cross(u); // v is perpendicular to u and w
+    *direction = Vector3f(u*cos(phi)*sinTheta + v*sin(phi)*sinTheta + w*cosTheta).Normalize();
+    *pdf = 1 / (2*static_cast<float>(M_PI)*coneSize);
+    return true;
+}
+
+///
+/// \brief Returns the probability density of sampling the lights picking the ray's direction, given that the ray hit a light at the distance
+/// (0 if what was hit isn't one of the lights)
+///
+float SphereLightsPdf(const Ray &r, float distance, const Renderer::SphereLight *lights, uint lightCount) {
+    for (uint i=0; i<lightCount; i++) {
+        const Intersection lightIntersection = lights[i].sphere.Intersect(r);
+        if (fabs(lightIntersection.Distance() - distance) <= 1e-4F * distance)
+            return 1 / (2*static_cast<float>(M_PI)*SphereConeSize(lights[i].sphere, r.origin) * lightCount);
+    }
+    return 0;
+}
+
+///
+/// \brief Finds the spheres of the scene whose material emits light
+///
+std::vector<Renderer::SphereLight> FindSphereLights(const Scene &scene) {
+    const std::vector<Material> &materials = scene.GetMaterialManager().GetMaterials();
+    std::vector<Renderer::SphereLight> lights;
+    for (const ScenePrimative &primative : scene.GetPrimatives()) {
+        const Sphere *sphere = primative.GetSphere();
+        if (sphere != nullptr && materials[primative.GetMaterialId()].emission != Color(0,0,0))
+            lights.push_back(Renderer::SphereLight { *sphere, primative.GetMaterialId() });
     }
-    return bestIntersection;
+    return lights;
 }
 
 ///
-/// \brief A simple pseudorandom floating point number generator based on a two byte seed.  The more "random" this is, the better
+/// \brief A path of light being traced from the camera (everything carried from one bounce to the next)
 ///
-float GetRandom(Renderer::RenderRandomSeed *seed) {
-    seed->s1 = 36969 * ((seed->s1) & 65535) + ((seed->s1) >> 16);  // hash the seeds using bitwise AND and bitshifts
-    seed->s2 = 18000 * ((seed->s2) & 65535) + ((seed->s2) >> 16);
+struct PathState {
+    Ray ray = Ray(Vector3f(), Vector3f());
+    ///
+    /// \brief the light gathered so far
+    ///
+    Color color = Color(0,0,0);
+    ///
+    /// \brief how much of the light found further along the path makes it to the camera
+    ///
+    Color reflectance = Color(1,1,1);
+    ///
+    /// \brief the probability density of the last diffuse bounce picking the ray's direction (0 if the last bounce wasn't diffuse)
+    ///
+    float bouncePdf = 0;
+    ///
+    /// \brief the number of surfaces hit so far
+    ///
+    uint depth = 0;
+    Sampler sampler;
+};
 
-    unsigned int ires = ((seed->s1) << 16) + (seed->s2);
+///
+/// \brief A ray from a surface toward a light, and the light it adds to its path if nothing is in the way
+///
+struct ShadowRay {
+    Ray ray = Ray(Vector3f(), Vector3f());
+    float maxDistance = 0;
+    Color contribution;
+    ///
+    /// \brief the path (in the wavefront's path buffer) the light is added to
+    ///
+    uint path = 0;
+};
 
-    // Convert to float
-    union {
-        float f;
-        unsigned int ui;
-    } res;
+///
+/// \brief What the ray of a path hit (see ClosestIntersection())
+///
+struct PathHit {
+    Intersection intersection = Intersection::NO_INTERSECTION();
+    uint materialId = 0;
+};
 
-    res.ui = (ires & 0x007fffff) | 0x40000000;  // bitwise AND, bitwise OR
+///
+/// \brief The most samples of a pixel a persistent thread takes at once
+///
+const uint PERSISTENT_CHUNK_SAMPLES = 4;
+///
+/// \brief The number of work-groups of persistent threads started for every compute unit of the device (more than one so
+/// the device can switch to another while one waits on memory)
+///
+const uint PERSISTENT_GROUPS_PER_COMPUTE_UNIT = 4;
 
-    return (res.f - 2.f) / 2.f;
+///
+/// \brief The number of bits per axis of the cell of the grid over the scene rays are sorted by
+///
+const uint SORT_GRID_BITS = 4;
+///
+/// \brief The number of bits of the keys rays (the cell and the octant of their direction) and hits are sorted by
+///
+const uint RAY_SORT_BITS = 3*SORT_GRID_BITS + 3;
+const uint HIT_SORT_BITS = 16;
+
+///
+/// \brief Maps positions in the scene to the grid rays are sorted by
+///
+struct SortGrid {
+    float min[3];
+    float scale[3];
+};
+
+///
+/// \brief Returns the grid over everything in the scene (the primatives, instances, and voxel world)
+///
+SortGrid CreateSortGrid(const AccelerationStructure &accelerationStructure, const VoxelDAG &voxelDAG) {
+    AABB bounds;
+    if (!accelerationStructure.GetNodes().empty()) {
+        const BVHNode &root = accelerationStructure.GetNodes()[accelerationStructure.GetTopLevelRoot()];
+        bounds.Grow(AABB(Vector3f(root.boundsMin[0], root.boundsMin[1], root.boundsMin[2]), Vector3f(root.boundsMax[0], root.boundsMax[1], root.boundsMax[2])));
+    }
+    if (!voxelDAG.GetNodes().empty()) {
+        const VoxelGrid &grid = voxelDAG.GetGrid();
+        bounds.Grow(AABB(grid.origin, grid.origin + Vector3f(static_cast<float>(grid.chunkCountX * VoxelWorld::CHUNK_WIDTH), static_cast<float>(VoxelWorld::CHUNK_HEIGHT),
+                                                             static_cast<float>(grid.chunkCountZ * VoxelWorld::CHUNK_WIDTH)) * grid.blockSize));
+    }
+    SortGrid sortGrid;
+    for (uint axis=0; axis<3; axis++) {
+        const float extent = bounds.Max()[axis] - bounds.Min()[axis];
+        const bool usable = extent > 0 && std::isfinite(extent);
+        sortGrid.min[axis] = usable ? bounds.Min()[axis] : 0;
+        sortGrid.scale[axis] = usable ? 1 / extent : 0;
+    }
+    return sortGrid;
+}
+
+///
+/// \brief Returns the key rays are sorted by before finding what they hit: the octant of their direction, then the cell
+/// of the grid they start in (in morton order) so rays next to each other start close together and go the same way
+///
+inline uint RaySortKey(const Ray &ray, const SortGrid &grid) {
+    const float gridSize = 1 << SORT_GRID_BITS;
+    uint key = 0;
+    for (uint axis=0; axis<3; axis++) {
+        const uint cell = static_cast<uint>(cl::sycl::fmin(cl::sycl::fmax((ray.origin[axis] - grid.min[axis]) * grid.scale[axis] * gridSize, 0.F), gridSize - 1));
+        for (uint bit=0; bit<SORT_GRID_BITS; bit++)
+            key |= ((cell >> bit) & 1) << (3*bit + axis);
+        if (ray.direction[axis] < 0)
+            key |= 1U << (3*SORT_GRID_BITS + axis);
+    }
+    return key;
+}
+
+///
+/// \brief Returns the key hits are sorted by before they are shaded: the type of their material then the material
+/// (misses last)
+///
+inline uint HitSortKey(const PathHit &hit, const Material *materials) {
+    const uint maxMaterialId = (1U << (HIT_SORT_BITS - 3)) - 1;
+    if (hit.intersection == Intersection::NO_INTERSECTION())
+        return (1U << HIT_SORT_BITS) - 1;
+    return static_cast<uint>(materials[hit.materialId].materialType) << (HIT_SORT_BITS - 3) | cl::sycl::min(hit.materialId, maxMaterialId);
+}
+
+///
+/// \brief Adds the light of what the path's ray hit to the path and picks the path's next ray (intended to be run on the SYCL device)
+/// \param shadowRay holds a ray toward one of the lights that adds light to the path if it isn't occluded
+/// \param hasShadowRay holds if there is a shadow ray
+/// \return false if the path is done
+///
+bool ShadePath(PathState *path, Intersection intersection, uint materialId, const Renderer::SphereLight *lights, uint lightCount,
+               const Material *materials, uint maxDepth, uint rouletteDepth, ShadowRay *shadowRay, bool *hasShadowRay) {
+    *hasShadowRay = false;
+    const Ray &r = path->ray;
+    Sampler *sampler = &path->sampler;
+    Color &accumulatedColor = path->color;
+    Color &accumulatedReflectance = path->reflectance;
+    float &bouncePdf = path->bouncePdf;
+
+    // if miss, we're done
+    if (intersection == Intersection::NO_INTERSECTION())
+        return false;
+    // only go so deep
+    if (++path->depth>maxDepth) return false;
+    sampler->StartBounce(path->depth);
+
+    // lookup the material of the hit object
+    Material material = materials[materialId];
+
+    Vector3f fixedNormal=intersection.Normal().Dot(r.direction)<0?intersection.Normal():intersection.Normal()*-1; // normal facing correct direction
+    Color BDRF=material.color; // object color for BRDF modulator
+
+    // accumulate color and reflectance
+    // a light hit by a diffuse bounce was also sampled directly at the bounce, so the two are weighted to add up to one
+    // (multiple importance sampling with the power heuristic)
+    float emissionWeight = 1;
+    if (bouncePdf > 0 && material.emission != Color(0,0,0)) {
+        const float lightPdf = SphereLightsPdf(r, intersection.Distance(), lights, lightCount);
+        emissionWeight = bouncePdf*bouncePdf / (bouncePdf*bouncePdf + lightPdf*lightPdf);
+    }
+    accumulatedColor += accumulatedReflectance.Multiply(material.emission) * emissionWeight;
+    bouncePdf = 0;
+
+    accumulatedReflectance = Color(accumulatedReflectance.Multiply(BDRF));
+
+    // russian roulette: past the roulette depth, paths that can't carry much light are stopped at random
+    // the paths that go on carry the light of the stopped ones so the image stays the same on average
+    if (path->depth>rouletteDepth) {
+        const float p = cl::sycl::fmin(1.F, cl::sycl::fmax(accumulatedReflectance.R(), cl::sycl::fmax(accumulatedReflectance.G(), accumulatedReflectance.B())));
+        if (!(sampler->Get(Sampler::ROULETTE)<p))
+            return false;
+        accumulatedReflectance = Color(accumulatedReflectance*(1/p));
+    }
+
+    // calculate the light based on the material type
+    if (material.materialType == Material::DIFFUSE) // Ideal DIFFUSE reflection
+    {
+        // sample one of the lights directly (next event estimation)
+        if (lightCount > 0) {
+            const uint lightIndex = cl::sycl::min(static_cast<uint>(sampler->Get(Sampler::LIGHT_CHOICE) * lightCount), lightCount - 1);
+            const Renderer::SphereLight &light = lights[lightIndex];
+            const float lr1 = sampler->Get(Sampler::LIGHT_U), lr2 = sampler->Get(Sampler::LIGHT_V);
+            Vector3f lightDirection;
+            float lightPdf;
+            if (SampleSphereLight(light.sphere, intersection.IntersectionPosition(), lr1, lr2, &lightDirection, &lightPdf)) {
+                const float cosine = lightDirection.Dot(fixedNormal);
+                const Ray toLight(intersection.IntersectionPosition(), lightDirection);
+                const Intersection lightIntersection = light.sphere.Intersect(toLight);
+                if (cosine > 0 && lightIntersection != Intersection::NO_INTERSECTION()) {
+                    // the light only counts if nothing is in the way (tested by whoever traces the shadow ray)
+                    lightPdf /= lightCount;
+                    const float bsdfPdf = cosine / static_cast<float>(M_PI);
+                    const float weight = lightPdf*lightPdf / (lightPdf*lightPdf + bsdfPdf*bsdfPdf);
+                    shadowRay->ray = toLight;
+                    shadowRay->maxDistance = lightIntersection.Distance() - 1e-3F;
+                    shadowRay->contribution = Color(accumulatedReflectance.Multiply(materials[light.materialId].emission) * (bsdfPdf / lightPdf * weight));
+                    *hasShadowRay = true;
+                }
+            }
+        }
+
+        float r1=2*static_cast<float>(M_PI)*sampler->Get(Sampler::BSDF_U); // random angle
+        float r2=sampler->Get(Sampler::BSDF_V), r2s=sqrt(r2); // random distance from center
+        Vector3f w = fixedNormal; // normal
+        Vector3f u = ( ((fabs(w.X())>.1F) ? Vector3f(0,1) : Vector3f(1) ).Cross(w)).Normalize(); // u is perpendicular to w
+        Vector3f v = w.Cross(u); // v is perpendicular to u and w
+        Vector3f d = Vector3f(u*cos(r1)*r2s + v*sin(r1)*r2s + w*sqrt(1-r2)).Normalize(); // d is a random reflection ray
+        path->ray = Ray(intersection.IntersectionPosition(),d);
+        bouncePdf = lightCount > 0 ? sqrt(1-r2) / static_cast<float>(M_PI) : 0;
+        return true;
+    }
+    else if (material.materialType == Material::SPECULAR) // Ideal SPECULAR reflection
+    {
+        path->ray = Ray(intersection.IntersectionPosition(),r.direction-intersection.Normal()*2*intersection.Normal().Dot(r.direction));
+        return true;
+    }
+    else // Ideal dielectric Material::REFRACTION
+    {
+        Ray reflRay(intersection.IntersectionPosition(), r.direction-intersection.Normal()*2*intersection.Normal().Dot(r.direction));
+        // Ray from outside going in?
+        bool into = intersection.Normal().Dot(fixedNormal) > 0;
+        float nc=1, nt=1.5, nnt=into?nc/nt:nt/nc, ddn=r.direction.Dot(fixedNormal), cos2t;
+        if ((cos2t=1-nnt*nnt*(1-ddn*ddn))<0) {    // Total internal reflection
+            path->ray = reflRay;
+            return true;
+        }
+        Vector3f tdir = Vector3f(r.direction*nnt - intersection.Normal()*((into?1:-1)*(ddn*nnt+sqrt(cos2t)))).Normalize();
+        float a=nt-nc, b=nt+nc, R0=a*a/(b*b), c = 1-(into?-ddn:tdir.Dot(intersection.Normal()));
+        float Re=R0+(1-R0)*c*c*c*c*c,Tr=1-Re,P=.25F+.5F*Re,RP=Re/P,TP=Tr/(1-P);
+        if (sampler->Get(Sampler::BSDF_LOBE)<P){
+          accumulatedReflectance = Color(accumulatedReflectance*RP);
+          path->ray = reflRay;
+        } else {
+          accumulatedReflectance = Color(accumulatedReflectance*TP);
+          path->ray = Ray(intersection.IntersectionPosition(),tdir);
+        }
+        return true;
+    }
 }
 
 } // namespace
@@ -108,6 +467,50 @@ Renderer::Renderer(bool forceHostCpu) {
     queue_ = cl::sycl::queue(*selector, redirectAsyncExceptionToErrorHander);
 
     delete selector;
+
+    // the host runs the kernel as compiled C++ which can use the widest SIMD nodes
+    // OpenCL CPUs vectorize the 4 wide loops themselves, GPUs do best with small binary nodes
+    if (GetDevice().is_host())
+        nodeWidth_ = PreferredHostNodeWidth();
+    else if (GetDevice().is_cpu())
+        nodeWidth_ = 4;
+    else
+        nodeWidth_ = 2;
+    // paths diverge the most on GPUs, where every work-item of a group waits on the slowest one
+    wavefront_ = !GetDevice().is_host() && !GetDevice().is_cpu();
+}
+
+void Renderer::SetMaxDepth(uint maxDepth) {
+    if (maxDepth == 0)
+        throw std::invalid_argument("Paths must be allowed at least one bounce");
+    maxDepth_ = maxDepth;
+}
+
+void Renderer::SetLaunchSeconds(double launchSeconds) {
+    if (!(launchSeconds > 0))
+        throw std::invalid_argument("Kernel launches must take some time");
+    // keep the throughput measured so far
+    launchSize_ = std::max<uint64>(64, static_cast<uint64>(launchSize_ * (launchSeconds / launchSeconds_)));
+    launchSeconds_ = launchSeconds;
+}
+
+void Renderer::SetAdaptiveSamples(uint adaptiveSamples) {
+    if (adaptiveSamples == 0)
+        throw std::invalid_argument("Pixels must get some samples between checks of their error");
+    adaptiveSamples_ = adaptiveSamples;
+}
+
+void Renderer::SetPixelFilter(PixelFilter::Type type, float radius) {
+    if (!(radius >= 0))
+        throw std::invalid_argument("The pixel filter's radius can't be negative");
+    pixelFilter_.type = type;
+    pixelFilter_.radius = radius;
+}
+
+void Renderer::SetNodeWidth(uint nodeWidth) {
+    if (nodeWidth != 2 && nodeWidth != 4 && nodeWidth != 8)
+        throw std::invalid_argument("BVH nodes must be 2, 4, or 8 wide");
+    nodeWidth_ = nodeWidth;
 }
 
 Image Renderer::RenderScene(const Scene &scene, const Camera &camera, uint samplesPerPixel, uint width, uint height) {
@@ -117,156 +520,669 @@ Image Renderer::RenderScene(const Scene &scene, const Camera &camera, uint sampl
 }
 
 void Renderer::RenderScene(const Scene &scene, const Camera &camera, uint samplesPerPixel, Image *image) {
-    const std::vector<ScenePrimative> &primativesVector = scene.GetPrimatives();
-    const std::vector<Material> &materialsVector = scene.GetMaterialManager().GetMaterials();
-
-    // Get raw arrays. SYCL needs them to transfer to the SYCL device
-    const ScenePrimative *primatives = primativesVector.data();
-    const Material *materials = materialsVector.data();
-    Pixel *pixels = image->GetData();
-
-    // Get sizes of each array so SYCL knows how big the arrays are
-    const uint64 primativesCount = primativesVector.size();
-    const uint64 materialsCount = materialsVector.size();
-    const uint pixelWidth = image->GetWidth();
-    const uint pixelHeight = image->GetHeight();
+    AccumulationBuffer accumulation(image->GetWidth(), image->GetHeight());
+    RenderPass(scene, camera, &accumulation, samplesPerPixel);
+    accumulation.Resolve(image);
+}
+
+uint Renderer::RenderPass(const Scene &scene, const Camera &camera, AccumulationBuffer *accumulation, uint samplesPerPixel) {
+    // the acceleration structure keeps every ray from being tested against every primative
+    // (it and the voxel DAG are only built or updated if the scene changed since the last render)
+    const auto buildStart = std::chrono::steady_clock::now();
+    const AccelerationStructure &accelerationStructure = scene.GetAccelerationStructure(&queue_, nodeWidth_);
+    scene.GetVoxelDAG();
+    const auto renderStart = std::chrono::steady_clock::now();
+    lastRenderStats_.buildSeconds = std::chrono::duration<double>(renderStart - buildStart).count();
+
+    // wide nodes are used where the device's vector units can test all of their children at once
+    // compressed nodes are used if the scene asked for them (so huge scenes fit on the device)
+    const uint wideTopLevelRoot = accelerationStructure.GetWideTopLevelRoot();
+    uint samplesDone;
+    if (accelerationStructure.GetCompressedNodes() && nodeWidth_ == 2)
+        samplesDone = RenderWithNodes(scene, accelerationStructure, accelerationStructure.GetQuantizedNodes2(), wideTopLevelRoot, camera, samplesPerPixel, accumulation);
+    else if (accelerationStructure.GetCompressedNodes() && nodeWidth_ == 4)
+        samplesDone = RenderWithNodes(scene, accelerationStructure, accelerationStructure.GetQuantizedNodes4(), wideTopLevelRoot, camera, samplesPerPixel, accumulation);
+    else if (accelerationStructure.GetCompressedNodes() && nodeWidth_ == 8)
+        samplesDone = RenderWithNodes(scene, accelerationStructure, accelerationStructure.GetQuantizedNodes8(), wideTopLevelRoot, camera, samplesPerPixel, accumulation);
+    else if (nodeWidth_ == 4)
+        samplesDone = RenderWithNodes(scene, accelerationStructure, accelerationStructure.GetNodes4(), wideTopLevelRoot, camera, samplesPerPixel, accumulation);
+    else if (nodeWidth_ == 8)
+        samplesDone = RenderWithNodes(scene, accelerationStructure, accelerationStructure.GetNodes8(), wideTopLevelRoot, camera, samplesPerPixel, accumulation);
+    else
+        samplesDone = RenderWithNodes(scene, accelerationStructure, accelerationStructure.GetNodes(), accelerationStructure.GetTopLevelRoot(), camera, samplesPerPixel, accumulation);
+    lastRenderStats_.renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+    return samplesDone;
+}
+
+void Renderer::UpdateLights(const std::vector<SphereLight> &lights) {
+    if (lights.size() != lights_.size()) {
+        lights_ = lights;
+        lightChanges_.AddAll(lights_.size());
+        return;
+    }
+    for (uint i=0; i<lights.size(); i++) {
+        const Sphere &a = lights[i].sphere, &b = lights_[i].sphere;
+        if (a.GetRadius() == b.GetRadius() && a.GetPosition() == b.GetPosition() && lights[i].materialId == lights_[i].materialId)
+            continue;
+        lights_[i] = lights[i];
+        lightChanges_.Add(i);
+    }
+}
+
+template<typename Node>
+uint Renderer::RenderWithNodes(const Scene &scene, const AccelerationStructure &accelerationStructure, const std::vector<Node> &nodes, uint topLevelRoot,
+                               const Camera &camera, uint samplesPerPixel, AccumulationBuffer *accumulation) {
+    // the lights sampled at every diffuse bounce (none if light sampling is off)
+    UpdateLights(lightSampling_ ? FindSphereLights(scene) : std::vector<SphereLight>());
+    const std::vector<SphereLight> &lights = lights_;
+
+    // what every work-item reads by index (the primatives, materials, and lights) is read from constant memory if it all
+    // fits, where it is cached and reading the same element from every work-item is fast.  Bigger scenes are read from
+    // global memory (read only, so it can be cached too)
+    const PrimativeArrays &primatives = accelerationStructure.GetPrimativeArrays();
+    const uint64 constantBytes = (primatives.GetReferences().size() + primatives.GetMaterialIds().size()) * sizeof(uint) +
+                                 primatives.GetData().size() * sizeof(float) +
+                                 scene.GetMaterialManager().GetMaterials().size() * sizeof(Material) +
+                                 scene.GetVoxelWorld().GetBlockMaterials().size() * sizeof(uint) +
+                                 lights.size() * sizeof(SphereLight) + sizeof(Camera);
+    lastRenderStats_.constantMemory = constantBytes <= GetDevice().get_info<cl::sycl::info::device::max_constant_buffer_size>();
+    if (lastRenderStats_.constantMemory)
+        return RenderWithMemory<Node, cl::sycl::access::target::constant_buffer>(scene, accelerationStructure, nodes, topLevelRoot, lights, camera,
+                                                                                 samplesPerPixel, accumulation);
+    return RenderWithMemory<Node, cl::sycl::access::target::global_buffer>(scene, accelerationStructure, nodes, topLevelRoot, lights, camera,
+                                                                           samplesPerPixel, accumulation);
+}
+
+template<typename Node, cl::sycl::access::target SceneMemory>
+uint Renderer::RenderWithMemory(const Scene &scene, const AccelerationStructure &accelerationStructure, const std::vector<Node> &nodes, uint topLevelRoot,
+                                const std::vector<SphereLight> &lights, const Camera &camera, uint samplesPerPixel, AccumulationBuffer *accumulation) {
+    // Get sizes of each array.  The device's buffers can be bigger (see DeviceArray)
+    const PrimativeArrays &primativeArrays = accelerationStructure.GetPrimativeArrays();
+    const PrimativeLayout primativeLayout = primativeArrays.GetLayout();
+    const uint primativeCount = static_cast<uint>(primativeArrays.GetReferences().size());
+    const uint primativeDataCount = static_cast<uint>(primativeArrays.GetData().size());
+    const uint materialsCount = static_cast<uint>(scene.GetMaterialManager().GetMaterials().size());
+    const uint blockMaterialCount = static_cast<uint>(scene.GetVoxelWorld().GetBlockMaterials().size());
+    const uint instanceCount = static_cast<uint>(accelerationStructure.GetInstances().size());
+    const uint pixelWidth = accumulation->GetWidth();
+    const uint pixelHeight = accumulation->GetHeight();
     const uint pixelCount = pixelWidth * pixelHeight;
+    const VoxelDAG &voxelDAG = scene.GetVoxelDAG();
+    // a world without blocks isn't walked at all
+    const VoxelGrid voxelGrid = voxelDAG.GetNodes().empty() ? VoxelDAG().GetGrid() : voxelDAG.GetGrid();
+    const uint lightCount = static_cast<uint>(lights.size());
+    const uint seed = seed_;
+    const Sampler::Type samplerType = sampler_;
+    const PixelFilter pixelFilter = pixelFilter_;
+    const uint maxDepth = maxDepth_;
+    const uint rouletteDepth = rouletteDepth_;
+    const float adaptiveThreshold = adaptiveThreshold_;
+    const uint adaptiveSamples = adaptiveSamples_;
+    const bool wavefront = wavefront_;
+    const bool sortRays = wavefront_ && sortRays_;
+    const bool persistentThreads = !wavefront_ && persistentThreads_;
+    const uint computeUnits = static_cast<uint>(GetDevice().get_info<cl::sycl::info::device::max_compute_units>());
+    const SortGrid sortGrid = sortRays ? CreateSortGrid(accelerationStructure, voxelDAG) : SortGrid();
+    double sortSeconds = 0;
+    uint64 uploadedBytes = 0;
+    // the pixels samples are rendered for (every pixel unless adaptive sampling leaves some out)
+    std::vector<uint> activePixels(pixelCount);
+    for (uint i=0; i<pixelCount; i++)
+        activePixels[i] = i;
+    uint activeCount = pixelCount;
 
     // this is where the magic starts
-    // begin invoking the SYCL kernel
+    // the render is split into many short launches of the SYCL kernel so no launch runs long enough for a display
+    // driver's watchdog to kill it, and the render can be cancelled between them
+    // a launch is either every active pixel for some samples, or (when one sample of every active pixel takes too long) a
+    // range of them for one sample.  Those go to a wave buffer first, which is added to the pixels once they all have the sample.
+    // with adaptive sampling the pixels whose error is still above the threshold are found again every adaptiveSamples samples
+    uint samplesDone = 0, nextPixel = 0;
+    uint launches = 0;
+    uint64 totalSamples = 0;
     try {
-        // setup SYCL buffers for transfering the arrays to/from the SYCL device
+        // bring the SYCL device's copy of the scene and the pixels up to date (only what changed since the last render is copied)
         // NOTE: scalars, unlike arrays "Just work" with no explicit copying needed
-        cl::sycl::buffer<ScenePrimative,1> primativeBuffer(primatives, cl::sycl::range<1>(primativesCount));
-        cl::sycl::buffer<Material,1> materialBuffer(materials, cl::sycl::range<1>(materialsCount));
-        cl::sycl::buffer<Pixel,1> pixelBuffer(pixels, cl::sycl::range<1>(pixelCount));
+        uploadedBytes = deviceScene_.Upload(queue_, scene, accelerationStructure, nodes);
+        uploadedBytes += deviceLights_.Upload(queue_, lights, lightChanges_);
+        const AccumulationBuffer &pixels = *accumulation;
+        uploadedBytes += devicePixels_.Upload(queue_, pixels.GetPixels(), pixels.GetChanges());
+        cl::sycl::buffer<uint,1> &primativeReferenceBuffer = deviceScene_.GetPrimativeReferences();
+        cl::sycl::buffer<float,1> &primativeDataBuffer = deviceScene_.GetPrimativeData();
+        cl::sycl::buffer<uint,1> &primativeMaterialBuffer = deviceScene_.GetPrimativeMaterialIds();
+        cl::sycl::buffer<Node,1> &nodeBuffer = deviceScene_.GetNodes<Node>();
+        cl::sycl::buffer<uint,1> &indexBuffer = deviceScene_.GetIndices();
+        cl::sycl::buffer<BVHInstance,1> &instanceBuffer = deviceScene_.GetInstances();
+        cl::sycl::buffer<Material,1> &materialBuffer = deviceScene_.GetMaterials();
+        cl::sycl::buffer<AccumulatedPixel,1> &accumulatedBuffer = devicePixels_.GetBuffer();
+        if (pixelCount > waveCapacity_) {
+            waveBuffer_ = cl::sycl::buffer<AccumulatedPixel,1>(cl::sycl::range<1>(pixelCount));
+            waveCapacity_ = pixelCount;
+        }
+        cl::sycl::buffer<AccumulatedPixel,1> &waveBuffer = waveBuffer_;
+        cl::sycl::buffer<uint,1> activeBuffer(activePixels.data(), cl::sycl::range<1>(pixelCount));
+        cl::sycl::buffer<uint,1> activeCountBuffer{cl::sycl::range<1>(1)};
+        // the active pixels are only ever read back to the host to count them
+        activeBuffer.set_final_data(nullptr);
         cl::sycl::buffer<Camera,1> cameraBuffer(&camera, cl::sycl::range<1>(1));
+        cl::sycl::buffer<uint,1> &chunkBuffer = deviceScene_.GetChunks();
+        cl::sycl::buffer<uint,1> &sectionRootBuffer = deviceScene_.GetSectionRoots();
+        cl::sycl::buffer<VoxelDAGNode,1> &voxelNodeBuffer = deviceScene_.GetVoxelNodes();
+        cl::sycl::buffer<VoxelDAGLeaf,1> &voxelLeafBuffer = deviceScene_.GetVoxelLeaves();
+        cl::sycl::buffer<uint,1> &blockMaterialBuffer = deviceScene_.GetBlockMaterials();
+        cl::sycl::buffer<SphereLight,1> &lightBuffer = deviceLights_.GetBuffer();
+        // for the wavefront: the paths of a launch, what their rays hit, the queues of rays to trace (this bounce's and the
+        // next one's), the shadow rays, and how long the next queues are (grown to fit the biggest launch)
+        uint pathCapacity = 0;
+        cl::sycl::buffer<PathState,1> pathBuffer{cl::sycl::range<1>(1)};
+        cl::sycl::buffer<PathHit,1> hitBuffer{cl::sycl::range<1>(1)};
+        cl::sycl::buffer<uint,1> rayQueueBuffers[2] = { cl::sycl::buffer<uint,1>{cl::sycl::range<1>(1)}, cl::sycl::buffer<uint,1>{cl::sycl::range<1>(1)} };
+        cl::sycl::buffer<ShadowRay,1> shadowRayBuffer{cl::sycl::range<1>(1)};
+        cl::sycl::buffer<uint,1> queueLengthBuffer{cl::sycl::range<1>(2)};
+        // the keys the queue of rays is sorted by (see SetSortRays())
+        cl::sycl::buffer<uint,1> sortKeyBuffer{cl::sycl::range<1>(1)};
+        RadixSort radixSort;
+        // for persistent threads: the samples of every chunk of a launch, and the next chunk to take
+        uint chunkCapacity = 0;
+        cl::sycl::buffer<AccumulatedPixel,1> chunkSampleBuffer{cl::sycl::range<1>(1)};
+        cl::sycl::buffer<uint,1> nextChunkBuffer{cl::sycl::range<1>(1)};
+
+        while (samplesDone < samplesPerPixel) {
+            const double progress = (samplesDone + static_cast<double>(nextPixel) / activeCount) / samplesPerPixel;
+            if (progressCallback_ && !progressCallback_(progress))
+                break;
+
+            if (adaptiveThreshold > 0 && samplesDone % adaptiveSamples == 0 && nextPixel == 0) {
+                // find the pixels that haven't converged (packed together on the device)
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto activeCountAccessor = activeCountBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+                    cgh.fill(activeCountAccessor, 0U);
+                });
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto accumulatedAccessor = accumulatedBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeAccessor = activeBuffer.get_access<cl::sycl::access::mode::discard_write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeCountAccessor = activeCountBuffer.get_access<cl::sycl::access::mode::atomic>(cgh);
+                    cgh.parallel_for<FindActivePixelsKernel>(cl::sycl::nd_range<1>((pixelCount + 63) / 64 * 64, 64), [=](cl::sycl::nd_item<1> item) {
+                        const uint pixel = static_cast<uint>(item.get_global_id(0));
+                        if (pixel >= pixelCount)
+                            return;
+                        const AccumulatedPixel &accumulated = accumulatedAccessor[pixel];
+                        if (accumulated.sampleCount < adaptiveSamples || accumulated.RelativeError() > adaptiveThreshold)
+                            activeAccessor[activeCountAccessor[0].fetch_add(1U)] = pixel;
+                    });
+                });
+                activeCount = activeCountBuffer.get_access<cl::sycl::access::mode::read>()[0];
+                if (activeCount == 0)
+                    break;
+            }
+
+            // size the launch to the throughput measured so far
+            // (with adaptive sampling, a launch doesn't go past the next time the active pixels are found)
+            const uint samplesLeft = adaptiveThreshold > 0 ? std::min(samplesPerPixel - samplesDone, adaptiveSamples - samplesDone % adaptiveSamples)
+                                                           : samplesPerPixel - samplesDone;
+            uint launchSamples = 1, launchPixels = activeCount;
+            if (nextPixel == 0 && launchSize_ >= activeCount)
+                launchSamples = static_cast<uint>(std::min<uint64>(samplesLeft, launchSize_ / activeCount));
+            else
+                launchPixels = static_cast<uint>(std::min<uint64>(activeCount - nextPixel, launchSize_));
+            const bool wave = launchPixels != activeCount;
+            const uint firstPixel = nextPixel;
+            // workgroups of 64, the threads past the last pixel of the launch do nothing
+            const uint threadCount = (launchPixels + 63) / 64 * 64;
+
+            const auto launchStart = std::chrono::steady_clock::now();
+            if (wavefront) {
+                const uint pathCount = launchPixels * launchSamples;
+                if (pathCount > pathCapacity) {
+                    pathBuffer = cl::sycl::buffer<PathState,1>(cl::sycl::range<1>(pathCount));
+                    hitBuffer = cl::sycl::buffer<PathHit,1>(cl::sycl::range<1>(pathCount));
+                    rayQueueBuffers[0] = cl::sycl::buffer<uint,1>(cl::sycl::range<1>(pathCount));
+                    rayQueueBuffers[1] = cl::sycl::buffer<uint,1>(cl::sycl::range<1>(pathCount));
+                    shadowRayBuffer = cl::sycl::buffer<ShadowRay,1>(cl::sycl::range<1>(pathCount));
+                    if (sortRays)
+                        sortKeyBuffer = cl::sycl::buffer<uint,1>(cl::sycl::range<1>(pathCount));
+                    pathCapacity = pathCount;
+                }
+
+                // start a path for every sample of the launch (the samples of a pixel next to each other)
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto accumulatedAccessor = accumulatedBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeAccessor = activeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto cameraAccessor = cameraBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::constant_buffer>(cgh);
+                    auto pathAccessor = pathBuffer.get_access<cl::sycl::access::mode::discard_write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto rayQueueAccessor = rayQueueBuffers[0].get_access<cl::sycl::access::mode::discard_write,cl::sycl::access::target::global_buffer>(cgh);
+                    cgh.parallel_for<GeneratePathsKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>((pathCount + 63) / 64 * 64, 64), [=](cl::sycl::nd_item<1> item) {
+                        const uint path = static_cast<uint>(item.get_global_id(0));
+                        if (path >= pathCount)
+                            return;
+                        const uint pixel = activeAccessor[firstPixel + path / launchSamples];
+                        const uint x = pixel % pixelWidth;
+                        const uint y = pixel / pixelWidth;
+                        // the same sample numbers, and so the same random numbers, as the megakernel
+                        PathState state;
+                        state.sampler = Sampler::Start(samplerType, seed, x, y, accumulatedAccessor[pixel].sampleCount + path % launchSamples);
+                        float offsetX, offsetY;
+                        pixelFilter.SampleOffset(state.sampler.Get(Sampler::CAMERA_U), state.sampler.Get(Sampler::CAMERA_V), &offsetX, &offsetY);
+                        state.ray = cameraAccessor[0].GenerateLookForPoint(x + offsetX, y + offsetY, pixelWidth, pixelHeight);
+                        pathAccessor[path] = state;
+                        rayQueueAccessor[path] = path;
+                    });
+                });
+
+                // trace the paths one bounce at a time until every one of them is done
+                uint rayCount = pathCount, current = 0;
+                for (uint bounce=0; rayCount > 0; bounce++) {
+                    cl::sycl::buffer<uint,1> &rayQueueBuffer = rayQueueBuffers[current];
+                    cl::sycl::buffer<uint,1> &nextRayQueueBuffer = rayQueueBuffers[1 - current];
+                    const uint rayThreads = (rayCount + 63) / 64 * 64;
+
+                    // sort the rays (the camera's are already in the order of their pixels)
+                    if (sortRays && bounce > 0) {
+                        queue_.wait_and_throw();
+                        const auto sortStart = std::chrono::steady_clock::now();
+                        queue_.submit([&](cl::sycl::handler& cgh) {
+                            auto pathAccessor = pathBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto rayQueueAccessor = rayQueueBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto sortKeyAccessor = sortKeyBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                            cgh.parallel_for<RaySortKeysKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(rayThreads, 64), [=](cl::sycl::nd_item<1> item) {
+                                const uint ray = static_cast<uint>(item.get_global_id(0));
+                                if (ray >= rayCount)
+                                    return;
+                                sortKeyAccessor[ray] = RaySortKey(pathAccessor[rayQueueAccessor[ray]].ray, sortGrid);
+                            });
+                        });
+                        radixSort.Sort(queue_, sortKeyBuffer, rayQueueBuffer, rayCount, RAY_SORT_BITS);
+                        queue_.wait_and_throw();
+                        sortSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - sortStart).count();
+                    }
+
+                    // find what the rays hit
+                    queue_.submit([&](cl::sycl::handler& cgh) {
+                        auto primativeReferenceAccessor = ReadAccessor<SceneMemory>(primativeReferenceBuffer, primativeCount, cgh);
+                        auto primativeDataAccessor = ReadAccessor<SceneMemory>(primativeDataBuffer, primativeDataCount, cgh);
+                        auto primativeMaterialAccessor = ReadAccessor<SceneMemory>(primativeMaterialBuffer, primativeCount, cgh);
+                        auto nodeAccessor = nodeBuffer.template get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto indexAccessor = indexBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto instanceAccessor = instanceBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto chunkAccessor = chunkBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto sectionRootAccessor = sectionRootBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto voxelNodeAccessor = voxelNodeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto voxelLeafAccessor = voxelLeafBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto blockMaterialAccessor = ReadAccessor<SceneMemory>(blockMaterialBuffer, blockMaterialCount, cgh);
+                        auto pathAccessor = pathBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto hitAccessor = hitBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                        auto rayQueueAccessor = rayQueueBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        cgh.parallel_for<ExtendPathsKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(rayThreads, 64), [=](cl::sycl::nd_item<1> item) {
+                            const PrimativePointers primatives = { primativeReferenceAccessor.get_pointer(), primativeDataAccessor.get_pointer(),
+                                                                   primativeMaterialAccessor.get_pointer(), primativeLayout };
+                            const uint ray = static_cast<uint>(item.get_global_id(0));
+                            if (ray >= rayCount)
+                                return;
+                            const uint path = rayQueueAccessor[ray];
+                            PathHit hit;
+                            hit.intersection = ClosestIntersection(pathAccessor[path].ray, nodeAccessor.get_pointer(), indexAccessor.get_pointer(),
+                                                                   primatives, instanceAccessor.get_pointer(), instanceCount, topLevelRoot,
+                                                                   voxelGrid, chunkAccessor.get_pointer(), sectionRootAccessor.get_pointer(),
+                                                                   voxelNodeAccessor.get_pointer(), voxelLeafAccessor.get_pointer(),
+                                                                   blockMaterialAccessor.get_pointer(), &hit.materialId);
+                            hitAccessor[path] = hit;
+                        });
+                    });
+
+                    // sort the hits by their material
+                    if (sortRays) {
+                        queue_.wait_and_throw();
+                        const auto sortStart = std::chrono::steady_clock::now();
+                        queue_.submit([&](cl::sycl::handler& cgh) {
+                            auto materialAccessor = ReadAccessor<SceneMemory>(materialBuffer, materialsCount, cgh);
+                            auto hitAccessor = hitBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto rayQueueAccessor = rayQueueBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto sortKeyAccessor = sortKeyBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                            cgh.parallel_for<HitSortKeysKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(rayThreads, 64), [=](cl::sycl::nd_item<1> item) {
+                                const uint ray = static_cast<uint>(item.get_global_id(0));
+                                if (ray >= rayCount)
+                                    return;
+                                sortKeyAccessor[ray] = HitSortKey(hitAccessor[rayQueueAccessor[ray]], materialAccessor.get_pointer());
+                            });
+                        });
+                        radixSort.Sort(queue_, sortKeyBuffer, rayQueueBuffer, rayCount, HIT_SORT_BITS);
+                        queue_.wait_and_throw();
+                        sortSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - sortStart).count();
+                    }
+
+                    // shade the hits, queueing the paths that go on and their shadow rays (packed together so paths that are
+                    // done take no work-items from the next bounce)
+                    queue_.submit([&](cl::sycl::handler& cgh) {
+                        auto queueLengthAccessor = queueLengthBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+                        cgh.fill(queueLengthAccessor, 0U);
+                    });
+                    queue_.submit([&](cl::sycl::handler& cgh) {
+                        auto materialAccessor = ReadAccessor<SceneMemory>(materialBuffer, materialsCount, cgh);
+                        auto lightAccessor = ReadAccessor<SceneMemory>(lightBuffer, lightCount, cgh);
+                        auto pathAccessor = pathBuffer.get_access<cl::sycl::access::mode::read_write,cl::sycl::access::target::global_buffer>(cgh);
+                        auto hitAccessor = hitBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto rayQueueAccessor = rayQueueBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                        auto nextRayQueueAccessor = nextRayQueueBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                        auto shadowRayAccessor = shadowRayBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                        auto queueLengthAccessor = queueLengthBuffer.get_access<cl::sycl::access::mode::atomic>(cgh);
+                        cgh.parallel_for<ShadePathsKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(rayThreads, 64), [=](cl::sycl::nd_item<1> item) {
+                            const uint ray = static_cast<uint>(item.get_global_id(0));
+                            if (ray >= rayCount)
+                                return;
+                            const uint path = rayQueueAccessor[ray];
+                            const PathHit &hit = hitAccessor[path];
+                            ShadowRay shadowRay;
+                            bool hasShadowRay;
+                            PathState *state = pathAccessor.get_pointer() + path;
+                            const bool alive = ShadePath(state, hit.intersection, hit.materialId, lightAccessor.get_pointer(), lightCount,
+                                                         materialAccessor.get_pointer(), maxDepth, rouletteDepth, &shadowRay, &hasShadowRay);
+                            if (hasShadowRay) {
+                                shadowRay.path = path;
+                                shadowRayAccessor[queueLengthAccessor[1].fetch_add(1U)] = shadowRay;
+                            }
+                            if (alive)
+                                nextRayQueueAccessor[queueLengthAccessor[0].fetch_add(1U)] = path;
+                        });
+                    });
+                    uint shadowRayCount;
+                    {
+                        auto queueLengthAccessor = queueLengthBuffer.get_access<cl::sycl::access::mode::read>();
+                        rayCount = queueLengthAccessor[0];
+                        shadowRayCount = queueLengthAccessor[1];
+                    }
+
+                    // add the light of the shadow rays that make it to their lights (a path has at most one per bounce)
+                    if (shadowRayCount > 0) {
+                        queue_.submit([&](cl::sycl::handler& cgh) {
+                            auto primativeReferenceAccessor = ReadAccessor<SceneMemory>(primativeReferenceBuffer, primativeCount, cgh);
+                            auto primativeDataAccessor = ReadAccessor<SceneMemory>(primativeDataBuffer, primativeDataCount, cgh);
+                            auto primativeMaterialAccessor = ReadAccessor<SceneMemory>(primativeMaterialBuffer, primativeCount, cgh);
+                            auto nodeAccessor = nodeBuffer.template get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto indexAccessor = indexBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto instanceAccessor = instanceBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto chunkAccessor = chunkBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto sectionRootAccessor = sectionRootBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto voxelNodeAccessor = voxelNodeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto voxelLeafAccessor = voxelLeafBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto blockMaterialAccessor = ReadAccessor<SceneMemory>(blockMaterialBuffer, blockMaterialCount, cgh);
+                            auto shadowRayAccessor = shadowRayBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                            auto pathAccessor = pathBuffer.get_access<cl::sycl::access::mode::read_write,cl::sycl::access::target::global_buffer>(cgh);
+                            cgh.parallel_for<ShadowRaysKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>((shadowRayCount + 63) / 64 * 64, 64), [=](cl::sycl::nd_item<1> item) {
+                                const PrimativePointers primatives = { primativeReferenceAccessor.get_pointer(), primativeDataAccessor.get_pointer(),
+                                                                       primativeMaterialAccessor.get_pointer(), primativeLayout };
+                                const uint i = static_cast<uint>(item.get_global_id(0));
+                                if (i >= shadowRayCount)
+                                    return;
+                                const ShadowRay &shadowRay = shadowRayAccessor[i];
+                                if (!Occluded(shadowRay.ray, nodeAccessor.get_pointer(), indexAccessor.get_pointer(), primatives,
+                                              instanceAccessor.get_pointer(), instanceCount, topLevelRoot, voxelGrid, chunkAccessor.get_pointer(),
+                                              sectionRootAccessor.get_pointer(), voxelNodeAccessor.get_pointer(), voxelLeafAccessor.get_pointer(),
+                                              blockMaterialAccessor.get_pointer(), shadowRay.maxDistance)) {
+                                    PathState *p = pathAccessor.get_pointer();
+                                    p[shadowRay.path].color += shadowRay.contribution;
+                                }
+                            });
+                        });
+                    }
+                    current = 1 - current;
+                }
+
+                // add the light of the paths to their pixels (in the order of their samples, like the megakernel)
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto pathAccessor = pathBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto accumulatedAccessor = accumulatedBuffer.get_access<cl::sycl::access::mode::read_write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto waveAccessor = waveBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeAccessor = activeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    cgh.parallel_for<AccumulatePathsKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(threadCount, 64), [=](cl::sycl::nd_item<1> item) {
+                        const uint threadId = static_cast<uint>(item.get_global_id(0));
+                        if (threadId >= launchPixels)
+                            return;
+                        const uint pixel = activeAccessor[firstPixel + threadId];
+                        AccumulatedPixel accumulated;
+                        for (uint i=0; i<launchSamples; i++)
+                            accumulated.Add(pathAccessor[threadId * launchSamples + i].color);
+                        if (wave) {
+                            AccumulatedPixel *p = waveAccessor.get_pointer();
+                            p[pixel] = accumulated;
+                        } else {
+                            AccumulatedPixel *p = accumulatedAccessor.get_pointer();
+                            p[pixel].Add(accumulated);
+                        }
+                    });
+                });
+            } else if (persistentThreads) {
+                // the launch is split into chunks of a pixel and up to PERSISTENT_CHUNK_SAMPLES of its samples
+                const uint chunksPerPixel = (launchSamples + PERSISTENT_CHUNK_SAMPLES - 1) / PERSISTENT_CHUNK_SAMPLES;
+                const uint chunkCount = launchPixels * chunksPerPixel;
+                if (chunkCount > chunkCapacity) {
+                    chunkSampleBuffer = cl::sycl::buffer<AccumulatedPixel,1>(cl::sycl::range<1>(chunkCount));
+                    chunkCapacity = chunkCount;
+                }
+                // just enough work-groups to fill the device (or one work-item per chunk if there are fewer chunks)
+                const uint persistentGroups = std::min(computeUnits * PERSISTENT_GROUPS_PER_COMPUTE_UNIT, (chunkCount + 63) / 64);
+
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto nextChunkAccessor = nextChunkBuffer.get_access<cl::sycl::access::mode::discard_write>(cgh);
+                    cgh.fill(nextChunkAccessor, 0U);
+                });
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto primativeReferenceAccessor = ReadAccessor<SceneMemory>(primativeReferenceBuffer, primativeCount, cgh);
+                    auto primativeDataAccessor = ReadAccessor<SceneMemory>(primativeDataBuffer, primativeDataCount, cgh);
+                    auto primativeMaterialAccessor = ReadAccessor<SceneMemory>(primativeMaterialBuffer, primativeCount, cgh);
+                    auto nodeAccessor = nodeBuffer.template get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto indexAccessor = indexBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto instanceAccessor = instanceBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto materialAccessor = ReadAccessor<SceneMemory>(materialBuffer, materialsCount, cgh);
+                    auto accumulatedAccessor = accumulatedBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeAccessor = activeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto cameraAccessor = cameraBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::constant_buffer>(cgh);
+                    auto chunkAccessor = chunkBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto sectionRootAccessor = sectionRootBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto voxelNodeAccessor = voxelNodeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto voxelLeafAccessor = voxelLeafBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto blockMaterialAccessor = ReadAccessor<SceneMemory>(blockMaterialBuffer, blockMaterialCount, cgh);
+                    auto lightAccessor = ReadAccessor<SceneMemory>(lightBuffer, lightCount, cgh);
+                    auto chunkSampleAccessor = chunkSampleBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto nextChunkAccessor = nextChunkBuffer.get_access<cl::sycl::access::mode::atomic>(cgh);
+                    cgh.parallel_for<PersistentRenderKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(persistentGroups * 64, 64), [=](cl::sycl::nd_item<1> item) {
+                        const PrimativePointers primatives = { primativeReferenceAccessor.get_pointer(), primativeDataAccessor.get_pointer(),
+                                                               primativeMaterialAccessor.get_pointer(), primativeLayout };
+                        const Camera &cam = cameraAccessor[0]; // the only camera
+                        // take chunks until there are none left
+                        while (1) {
+                            const uint chunk = nextChunkAccessor[0].fetch_add(1U);
+                            if (chunk >= chunkCount)
+                                return;
+                            const uint pixel = activeAccessor[firstPixel + chunk / chunksPerPixel];
+                            const uint x = pixel % pixelWidth;
+                            const uint y = pixel / pixelWidth;
+                            const uint firstSample = (chunk % chunksPerPixel) * PERSISTENT_CHUNK_SAMPLES;
+                            const uint lastSample = cl::sycl::min(launchSamples, firstSample + PERSISTENT_CHUNK_SAMPLES);
+                            // the same samples the megakernel takes
+                            AccumulatedPixel accumulated;
+                            for (uint i=firstSample; i<lastSample; i++) {
+                                Sampler sampler = Sampler::Start(samplerType, seed, x, y, accumulatedAccessor[pixel].sampleCount + i);
+                                float offsetX, offsetY;
+                                pixelFilter.SampleOffset(sampler.Get(Sampler::CAMERA_U), sampler.Get(Sampler::CAMERA_V), &offsetX, &offsetY);
+                                const Ray ray = cam.GenerateLookForPoint(x + offsetX, y + offsetY, pixelWidth, pixelHeight);
+                                accumulated.Add(SampleLight(ray, nodeAccessor.get_pointer(), indexAccessor.get_pointer(), primatives,
+                                                            instanceAccessor.get_pointer(), instanceCount, topLevelRoot,
+                                                            voxelGrid, chunkAccessor.get_pointer(), sectionRootAccessor.get_pointer(),
+                                                            voxelNodeAccessor.get_pointer(), voxelLeafAccessor.get_pointer(), blockMaterialAccessor.get_pointer(),
+                                                            lightAccessor.get_pointer(), lightCount,
+                                                            materialAccessor.get_pointer(), materialsCount, maxDepth, rouletteDepth, &sampler));
+                            }
+                            AccumulatedPixel *p = chunkSampleAccessor.get_pointer();
+                            p[chunk] = accumulated;
+                        }
+                    });
+                });
+
+                // add the chunks of every pixel to the pixel (in order, so the render doesn't depend on which work-item took what)
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto chunkSampleAccessor = chunkSampleBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto accumulatedAccessor = accumulatedBuffer.get_access<cl::sycl::access::mode::read_write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto waveAccessor = waveBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeAccessor = activeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    cgh.parallel_for<PersistentMergeKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(threadCount, 64), [=](cl::sycl::nd_item<1> item) {
+                        const uint threadId = static_cast<uint>(item.get_global_id(0));
+                        if (threadId >= launchPixels)
+                            return;
+                        const uint pixel = activeAccessor[firstPixel + threadId];
+                        AccumulatedPixel accumulated;
+                        for (uint i=0; i<chunksPerPixel; i++)
+                            accumulated.Add(chunkSampleAccessor[threadId * chunksPerPixel + i]);
+                        if (wave) {
+                            AccumulatedPixel *p = waveAccessor.get_pointer();
+                            p[pixel] = accumulated;
+                        } else {
+                            AccumulatedPixel *p = accumulatedAccessor.get_pointer();
+                            p[pixel].Add(accumulated);
+                        }
+                    });
+                });
+            } else {
+                // submit a new job to run on the SYCL device
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    // accessors make sure that the data is synced on the SYCL device when it's running (where appropriate)
+                    // when the accessor is destructed, the buffers are automatically synced back to the host (where appropriate)
+                    auto primativeReferenceAccessor = ReadAccessor<SceneMemory>(primativeReferenceBuffer, primativeCount, cgh);
+                    auto primativeDataAccessor = ReadAccessor<SceneMemory>(primativeDataBuffer, primativeDataCount, cgh);
+                    auto primativeMaterialAccessor = ReadAccessor<SceneMemory>(primativeMaterialBuffer, primativeCount, cgh);
+                    auto nodeAccessor = nodeBuffer.template get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto indexAccessor = indexBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto instanceAccessor = instanceBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto materialAccessor = ReadAccessor<SceneMemory>(materialBuffer, materialsCount, cgh);
+                    auto accumulatedAccessor = accumulatedBuffer.get_access<cl::sycl::access::mode::read_write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto waveAccessor = waveBuffer.get_access<cl::sycl::access::mode::write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeAccessor = activeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto cameraAccessor = cameraBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::constant_buffer>(cgh);
+                    auto chunkAccessor = chunkBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto sectionRootAccessor = sectionRootBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto voxelNodeAccessor = voxelNodeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto voxelLeafAccessor = voxelLeafBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto blockMaterialAccessor = ReadAccessor<SceneMemory>(blockMaterialBuffer, blockMaterialCount, cgh);
+                    auto lightAccessor = ReadAccessor<SceneMemory>(lightBuffer, lightCount, cgh);
+                    // start parallel workgroups and workitems
+                    // TODO: choose optimal workgroup size based on device capabilities instead of hardcoded to 64
+                    cgh.parallel_for<RenderKernel<Node,SceneMemory>>(cl::sycl::nd_range<1>(threadCount, 64), [=](cl::sycl::nd_item<1> item) {
+                        const PrimativePointers primatives = { primativeReferenceAccessor.get_pointer(), primativeDataAccessor.get_pointer(),
+                                                               primativeMaterialAccessor.get_pointer(), primativeLayout };
+                        // Note: We are now actually running on the SYCL device.
+
+                        // determine what pixel we are calculating in this thread
+                        const uint threadId = static_cast<uint>(item.get_global_id(0));
+                        if (threadId >= launchPixels)
+                            return;
+                        const uint pixel = activeAccessor[firstPixel + threadId];
+                        uint x = pixel % pixelWidth;
+                        uint y = pixel / pixelWidth;
+
+                        // now actually render the pixel this thread is supposed to render
+                        const Camera &cam = cameraAccessor[0]; // the only camera
+                        // collect the launch's samples for this pixel
+                        // they carry on from the samples already in the accumulation buffer
+                        const uint firstSample = accumulatedAccessor[pixel].sampleCount;
+                        AccumulatedPixel accumulated;
+                        for (uint i=0; i<launchSamples; i++) {
+                            // every sample has its own random numbers
+                            Sampler sampler = Sampler::Start(samplerType, seed, x, y, firstSample + i);
+                            // every sample looks through its own point around the pixel's center (picked by the filter)
+                            float offsetX, offsetY;
+                            pixelFilter.SampleOffset(sampler.Get(Sampler::CAMERA_U), sampler.Get(Sampler::CAMERA_V), &offsetX, &offsetY);
+                            const Ray ray = cam.GenerateLookForPoint(x + offsetX, y + offsetY, pixelWidth, pixelHeight);
+                            accumulated.Add(SampleLight(ray, nodeAccessor.get_pointer(), indexAccessor.get_pointer(), primatives,
+                                                            instanceAccessor.get_pointer(), instanceCount, topLevelRoot,
+                                                            voxelGrid, chunkAccessor.get_pointer(), sectionRootAccessor.get_pointer(),
+                                                            voxelNodeAccessor.get_pointer(), voxelLeafAccessor.get_pointer(), blockMaterialAccessor.get_pointer(),
+                                                            lightAccessor.get_pointer(), lightCount,
+                                                            materialAccessor.get_pointer(), materialsCount, maxDepth, rouletteDepth, &sampler));
+                        }
+
+                        // add the samples to the pixel (or hold them until the wave is done)
+                        if (wave) {
+                            AccumulatedPixel *p = waveAccessor.get_pointer();
+                            p[pixel] = accumulated;
+                        } else {
+                            AccumulatedPixel *p = accumulatedAccessor.get_pointer();
+                            p[pixel].Add(accumulated);
+                        }
+                    });
+                });
+            }
+            // wait for the SYCL device to finish
+            queue_.wait_and_throw();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - launchStart).count();
+            launches++;
+            totalSamples += static_cast<uint64>(launchSamples) * launchPixels;
 
-        // submit a new job to run on the SYCL device
-        queue_.submit([&](cl::sycl::handler& cgh) {
-            // accessors make sure that the data is synced on the SYCL device when it's running (where appropriate)
-            // when the accessor is destructed, the buffers are automatically synced back to the host (where appropriate)
-            auto primativeAccessor = primativeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::constant_buffer>(cgh);
-            auto materialAccessor = materialBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::constant_buffer>(cgh);
-            auto pixelAccessor = pixelBuffer.get_access<cl::sycl::access::mode::discard_write,cl::sycl::access::target::global_buffer>(cgh);
-            auto cameraAccessor = cameraBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::constant_buffer>(cgh);
-            // start parallel workgroups and workitems
-            // pixelCount total threads divided into workgroups of size 64
-            // TODO: choose optimal workgroup size based on device capabilities instead of hardcoded to 64
-            cgh.parallel_for<Tracer::Renderer>(cl::sycl::nd_range<1>(pixelCount, 64), [=](cl::sycl::nd_item<1> item) {
-                // Note: We are now actually running on the SYCL device.
-
-                // determine what pixel we are calculating in this thread
-                // threadId is unique and is [0,pixelCount]
-                uint threadId = static_cast<uint>(item.get_global_id(0));
-                // uint x = threadId % pixelWidth;
-                uint x = threadId % pixelWidth;
-                uint y = threadId / pixelWidth;
-
-                // create random seed (TODO: get a real random number from the host)
-                RenderRandomSeed seed = {x,y};
-
-                // now actually render the pixel this thread is supposed to render
-                const Camera &cam = cameraAccessor[0]; // the only camera
-                Ray ray = cam.GenerateLookForPixel(x, y, pixelWidth, pixelHeight);
-                // collect the requested number of samples for this pixel
-                Color accumulatedColor(0,0,0);
-                for (uint i=0; i<samplesPerPixel; i++)
-                    accumulatedColor += SampleLight(ray, primativeAccessor.get_pointer(), primativesCount, materialAccessor.get_pointer(), materialsCount, &seed) * (1.F/samplesPerPixel);
-
-                // write the color to the pixel
-                Pixel *p = pixelAccessor.get_pointer();
-                p[(y) * pixelWidth + (x)] = Pixel(accumulatedColor).GammaCorrect();
-            });
-        });
-
-        // wait for the SYCL device to finish
-        queue_.wait_and_throw();
+            if (!wave) {
+                samplesDone += launchSamples;
+            } else if ((nextPixel += launchPixels) == activeCount) {
+                // every active pixel has the wave's sample
+                queue_.submit([&](cl::sycl::handler& cgh) {
+                    auto accumulatedAccessor = accumulatedBuffer.get_access<cl::sycl::access::mode::read_write,cl::sycl::access::target::global_buffer>(cgh);
+                    auto waveAccessor = waveBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    auto activeAccessor = activeBuffer.get_access<cl::sycl::access::mode::read,cl::sycl::access::target::global_buffer>(cgh);
+                    cgh.parallel_for<AddWaveKernel>(cl::sycl::range<1>(activeCount), [=](cl::sycl::item<1> item) {
+                        const uint pixel = activeAccessor[item.get_id(0)];
+                        accumulatedAccessor[pixel].Add(waveAccessor[pixel]);
+                    });
+                });
+                queue_.wait_and_throw();
+                nextPixel = 0;
+                samplesDone++;
+            }
+
+            // size the next launch so it takes the target time (growing at most 8 times per launch since small launches
+            // are mostly overhead)
+            const double samplesPerSecond = static_cast<double>(launchSamples) * launchPixels / std::max(seconds, 1e-6);
+            launchSize_ = std::max<uint64>(64, std::min<uint64>(launchSize_ * 8, static_cast<uint64>(samplesPerSecond * launchSeconds_)));
+            lastRenderStats_.samplesPerSecond = samplesPerSecond;
+        }
+        // the device's copy is up to date with the pixels being marked as changed by writing to them
+        std::vector<AccumulatedPixel> &accumulated = accumulation->GetPixels();
+        devicePixels_.Download(&accumulated, accumulation->GetChanges());
     } catch (cl::sycl::exception const& e) {
         DefaultErrorHandler(e);
+        // what the device has is unknown
+        deviceScene_.Invalidate();
+        deviceLights_.Invalidate();
+        devicePixels_.Invalidate();
     }
+    // a cancelled wave isn't kept
+    lastRenderStats_.launches = launches;
+    lastRenderStats_.sortSeconds = sortSeconds;
+    lastRenderStats_.uploadedBytes = uploadedBytes;
+    lastRenderStats_.samplesPerPixel = samplesDone;
+    lastRenderStats_.totalSamples = totalSamples;
+    return samplesDone;
 }
 
-Color Renderer::SampleLight(Ray r, const ScenePrimative *primatives, uint64 primativesCount, const Material *materials, uint64 materialsCount, RenderRandomSeed *seed)
+template<typename Node>
+Color Renderer::SampleLight(Ray r, const Node *nodes, const uint *indices, const PrimativePointers &primatives,
+                            const BVHInstance *instances, uint instanceCount, uint topLevelRoot,
+                            const VoxelGrid &voxelGrid, const uint *chunks, const uint *sectionRoots, const VoxelDAGNode *voxelNodes,
+                            const VoxelDAGLeaf *voxelLeaves, const uint *blockMaterials, const SphereLight *lights, uint lightCount,
+                            const Material *materials, uint materialsCount, uint maxDepth, uint rouletteDepth, Sampler *sampler)
 {
-    uint depth=0;
-    Color accumulatedColor(0,0,0);
-    Color accumulatedReflectance(1,1,1);
+    PathState path;
+    path.ray = r;
+    path.sampler = *sampler;
+    ShadowRay shadowRay;
 
     while (1) {
-        uint64 primativeId = 0;
+        uint materialId = 0;
         // try to intersect
-        Intersection intersection = ClosestIntersection(r, primatives, primativesCount, &primativeId);
-        // if miss, we're done
-        if (intersection == Intersection::NO_INTERSECTION())
-            return accumulatedColor;
-        // only go so deep
-        if (++depth>7) return accumulatedColor;
-
-        // the hit object
-        const ScenePrimative &primative = primatives[primativeId];
-
-        // lookup the material
-        Material material = materials[primative.GetMaterialId()];
-
-        Vector3f fixedNormal=intersection.Normal().Dot(r.direction)<0?intersection.Normal():intersection.Normal()*-1; // normal facing correct direction
-        Color BDRF=material.color; // object color for BRDF modulator
-
-        // accumulate color and reflectance
-        accumulatedColor += accumulatedReflectance.Multiply(material.emission);
-
-        // TODO: get round russian roulette based ray bounce termination working (currently hangs OpenCL) I believe the RNG is the problem
-        // after depth of 5, stop the light traversal at random based on the surface reflectivity
-        /*float p = std::max({BDRF.x, BDRF.y, BDRF.z}); // find largest reflective value
-        if (++depth>5)
-        {
-            if (XorRandom(seed)<p)
-                BDRF=BDRF*(1/p);
-            else
-                return accumulatedColor;
-        }*/
-
-        accumulatedReflectance = Color(accumulatedReflectance.Multiply(BDRF));
-
-        // calculate the light based on the material type
-        if (material.materialType == Material::DIFFUSE) // Ideal DIFFUSE reflection
-        {
-            float r1=2*static_cast<float>(M_PI)*GetRandom(seed); // random angle
-            float r2=GetRandom(seed), r2s=sqrt(r2); // random distance from center
-            Vector3f w = fixedNormal; // normal
-            Vector3f u = ( ((fabs(w.X())>.1F) ? Vector3f(0,1) : Vector3f(1) ).Cross(w)).Normalize(); // u is perpendicular to w
-            Vector3f v = w.Cross(u); // v is perpendicular to u and w
-            Vector3f d = Vector3f(u*cos(r1)*r2s + v*sin(r1)*r2s + w*sqrt(1-r2)).Normalize(); // d is a random reflection ray
-            r = Ray(intersection.IntersectionPosition(),d);
-            continue;
-        }
-        else if (material.materialType == Material::SPECULAR) // Ideal SPECULAR reflection
-        {
-            r = Ray(intersection.IntersectionPosition(),r.direction-intersection.Normal()*2*intersection.Normal().Dot(r.direction));
-            continue;
-        }
-        else // Ideal dielectric Material::REFRACTION
-        {
-            Ray reflRay(intersection.IntersectionPosition(), r.direction-intersection.Normal()*2*intersection.Normal().Dot(r.direction));
-            // Ray from outside going in?
-            bool into = intersection.Normal().Dot(fixedNormal) > 0;
-            float nc=1, nt=1.5, nnt=into?nc/nt:nt/nc, ddn=r.direction.Dot(fixedNormal), cos2t;
-            if ((cos2t=1-nnt*nnt*(1-ddn*ddn))<0) {    // Total internal reflection
-                r = reflRay;
-                continue;
-            }
-            Vector3f tdir = Vector3f(r.direction*nnt - intersection.Normal()*((into?1:-1)*(ddn*nnt+sqrt(cos2t)))).Normalize();
-            float a=nt-nc, b=nt+nc, R0=a*a/(b*b), c = 1-(into?-ddn:tdir.Dot(intersection.Normal()));
-            float Re=R0+(1-R0)*c*c*c*c*c,Tr=1-Re,P=.25F+.5F*Re,RP=Re/P,TP=Tr/(1-P);
-            if (GetRandom(seed)<P){
-              accumulatedReflectance = Color(accumulatedReflectance*RP);
-              r = reflRay;
-            } else {
-              accumulatedReflectance = Color(accumulatedReflectance*TP);
-              r = Ray(intersection.IntersectionPosition(),tdir);
-            }
-            continue;
-        }
+        const Intersection intersection = ClosestIntersection(path.ray, nodes, indices, primatives, instances, instanceCount, topLevelRoot,
+                                                              voxelGrid, chunks, sectionRoots, voxelNodes, voxelLeaves, blockMaterials, &materialId);
+        bool hasShadowRay;
+        const bool alive = ShadePath(&path, intersection, materialId, lights, lightCount, materials, maxDepth, rouletteDepth, &shadowRay, &hasShadowRay);
+        if (hasShadowRay && !Occluded(shadowRay.ray, nodes, indices, primatives, instances, instanceCount, topLevelRoot, voxelGrid, chunks, sectionRoots,
+                                      voxelNodes, voxelLeaves, blockMaterials, shadowRay.maxDistance))
+            path.color += shadowRay.contribution;
+        if (!alive)
+            return path.color;
     }
 }
 
@@ -21,14 +21,23 @@
 #ifndef TRACER_RENDERER_H
 #define TRACER_RENDERER_H
 
+#include <functional>
 #include <string>
+#include <vector>
 
 #include <SYCL/sycl.hpp>
 #include "Scene.h"
 #include "Image.h"
+#include "AccumulationBuffer.h"
 #include "Vector.h"
+#include "AccelerationStructure.h"
 #include "Camera.h"
+#include "DeviceScene.h"
+#include "PixelFilter.h"
+#include "PrimativeArrays.h"
+#include "Sampler.h"
 #include "ScenePrimative.h"
+#include "VoxelDAG.h"
 
 namespace Tracer {
 
@@ -51,31 +60,285 @@ public:
     ///
     std::string GetDeviceName() { return GetDevice().get_info<cl::sycl::info::device::name>(); }
     ///
+    /// \brief Sets the width of the BVH nodes traversed while rendering (2, 4, or 8)
+    /// By default it is picked for the device: the widest the host's SIMD supports on the host, 4 on OpenCL CPUs, and 2 on GPUs.
+    ///
+    void SetNodeWidth(uint nodeWidth);
+    uint GetNodeWidth() const { return nodeWidth_; }
+    ///
+    /// \brief Sets if the scene's spherical lights are sampled directly at every diffuse bounce (on by default)
+    /// Paths then find small lights far more often instead of only when a random bounce happens to hit one.
+    ///
+    void SetLightSampling(bool lightSampling) { lightSampling_ = lightSampling; }
+    bool GetLightSampling() const { return lightSampling_; }
+    ///
+    /// \brief Sets if paths are traced as a wavefront instead of by one kernel running every path from start to end (the megakernel).
+    /// By default it is picked for the device: the megakernel on CPUs and the wavefront on GPUs.
+    ///
+    /// The wavefront keeps every path of a launch in device memory and traces all of them one bounce at a time, with separate
+    /// kernels to find what the rays hit, shade the hits, and trace the shadow rays toward the lights.  Neighbouring work-items
+    /// then run the same code even when their paths hit different materials, and paths that are done are dropped from the
+    /// queue of rays after every bounce.  Both give exactly the same image.
+    ///
+    void SetWavefront(bool wavefront) { wavefront_ = wavefront; }
+    bool GetWavefront() const { return wavefront_; }
+    ///
+    /// \brief Sets if the wavefront sorts its rays before finding what they hit, and what they hit before shading it (off by default).
+    /// Rays are sorted by the octant of their direction then where they start, and hits by their material, so neighbouring
+    /// work-items walk the same nodes and run the same shading code.  Sorting costs time of its own (see RenderStats::sortSeconds)
+    /// so it only pays off when paths scatter incoherently through scenes with many materials.  The image is the same either way.
+    /// The megakernel never sorts.
+    ///
+    void SetSortRays(bool sortRays) { sortRays_ = sortRays; }
+    bool GetSortRays() const { return sortRays_; }
+    ///
+    /// \brief Sets if the megakernel runs as persistent threads (off by default).
+    /// Instead of a work-item per pixel, just enough work-groups to fill the device are started and every work-item takes a
+    /// pixel and a few of its samples after another (from a counter shared by all of them) until there are none left.
+    /// Work-groups that get cheap pixels (ex: the sky) then take more of them instead of leaving the device idle while
+    /// the ones that got expensive pixels (ex: glass) finish.  The wavefront doesn't use persistent threads.
+    ///
+    void SetPersistentThreads(bool persistentThreads) { persistentThreads_ = persistentThreads; }
+    bool GetPersistentThreads() const { return persistentThreads_; }
+    ///
     /// \brief Renders a given scene and returns the image result (renders using the scene's primary camera)
     ///
     Image RenderScene(const Scene &scene, const Camera &camera, uint samplesPerPixel, uint width, uint height);
     ///
     /// \brief Renders a scene using a pre-existing image as the result
-    /// \param additive if true, the pre-existing pixels of the image are added to rather than overwritten
     ///
     void RenderScene(const Scene &scene, const Camera &camera, uint samplesPerPixel, Image *image);
     ///
-    /// \brief Contains the random seed passed around while rendering a pixel for a seed.
-    /// A random seed is essential for rendering a scene accurately.
-    /// \todo Generate random seed(s) on the host and pass to the device
+    /// \brief Adds more samples to every pixel of an accumulation buffer (progressive rendering)
+    /// The samples carry on from the ones already in the buffer, so N passes of S samples give exactly the same
+    /// image as one pass of N*S samples.  The buffer must be cleared if the scene or camera changes.
+    /// With adaptive sampling, pixels stop getting samples once they have converged (see SetAdaptiveThreshold()).
+    /// \return the most samples added to a pixel (less than asked for if the progress callback cancelled the render or
+    /// every pixel converged)
+    ///
+    uint RenderPass(const Scene &scene, const Camera &camera, AccumulationBuffer *accumulation, uint samplesPerPixel);
+    ///
+    /// \brief Sets the relative error (see AccumulatedPixel::RelativeError()) pixels stop getting samples at (0 by default,
+    /// which turns adaptive sampling off).  Pixels that converge quickly (ex: the background) then cost far fewer samples
+    /// than the ones that don't (ex: caustics).  A threshold around 0.02 is barely noticable.
+    ///
+    void SetAdaptiveThreshold(float adaptiveThreshold) { adaptiveThreshold_ = adaptiveThreshold; }
+    float GetAdaptiveThreshold() const { return adaptiveThreshold_; }
+    ///
+    /// \brief Sets how many samples pixels get between checks of their error, and before the first (16 by default,
+    /// throws std::invalid_argument if 0)
+    ///
+    void SetAdaptiveSamples(uint adaptiveSamples);
+    uint GetAdaptiveSamples() const { return adaptiveSamples_; }
+    ///
+    /// \brief Sets how long every launch of the SYCL kernel should take (50ms by default, throws std::invalid_argument if not positive)
+    /// Renders are split into many launches sized from the throughput of the last ones, so no launch runs long enough
+    /// to be killed by a display driver's watchdog and the render can be cancelled between them.
+    ///
+    void SetLaunchSeconds(double launchSeconds);
+    double GetLaunchSeconds() const { return launchSeconds_; }
+    ///
+    /// \brief Called between the launches of a render with how much of the render is done ([0,1]).
+    /// Returning false cancels the render (the samples already added to every pixel are kept).
+    ///
+    using ProgressCallback = std::function<bool(double progress)>;
+    void SetProgressCallback(const ProgressCallback &progressCallback) { progressCallback_ = progressCallback; }
     ///
-    struct RenderRandomSeed {
-        uint s1,s2;
+    /// \brief Sets the most surfaces a path can hit (16 by default, throws std::invalid_argument if 0)
+    ///
+    void SetMaxDepth(uint maxDepth);
+    uint GetMaxDepth() const { return maxDepth_; }
+    ///
+    /// \brief Sets how many surfaces a path hits before it can be stopped by russian roulette (3 by default).
+    /// After that, paths carrying little light (after bouncing off dark surfaces) are likely to be stopped early.
+    /// A roulette depth of at least the max depth turns russian roulette off.
+    ///
+    void SetRouletteDepth(uint rouletteDepth) { rouletteDepth_ = rouletteDepth; }
+    uint GetRouletteDepth() const { return rouletteDepth_; }
+    ///
+    /// \brief Sets the seed every random number of a render is made from (0 by default).
+    /// Rendering the same scene with the same seed gives exactly the same image.
+    ///
+    void SetSeed(uint seed) { seed_ = seed; }
+    uint GetSeed() const { return seed_; }
+    ///
+    /// \brief Sets how the numbers random decisions are made with are picked (Sampler::SOBOL by default)
+    ///
+    void SetSampler(Sampler::Type sampler) { sampler_ = sampler; }
+    Sampler::Type GetSampler() const { return sampler_; }
+    ///
+    /// \brief Sets how the samples of a pixel are spread around its center (a tent with a radius of one pixel by default,
+    /// throws std::invalid_argument if the radius is negative).  A radius of 0 takes every sample at the center (no anti-aliasing).
+    ///
+    void SetPixelFilter(PixelFilter::Type type, float radius);
+    const PixelFilter &GetPixelFilter() const { return pixelFilter_; }
+    ///
+    /// \brief A sphere of the scene whose material emits light.  This is what is copied to the SYCL device for sampling lights.
+    ///
+    struct SphereLight {
+        Sphere sphere;
+        uint materialId;
     };
+    ///
+    /// \brief Statistics about the last render
+    ///
+    struct RenderStats {
+        ///
+        /// \brief seconds spent building (or updating) the scene's acceleration structure
+        ///
+        double buildSeconds = 0;
+        ///
+        /// \brief seconds spent rendering the image
+        ///
+        double renderSeconds = 0;
+        ///
+        /// \brief seconds of the render spent sorting rays and hits (see SetSortRays())
+        ///
+        double sortSeconds = 0;
+        ///
+        /// \brief the bytes of the scene and pixels copied to the SYCL device (only what changed since the last render is copied)
+        ///
+        uint64 uploadedBytes = 0;
+        ///
+        /// \brief if the primatives, materials, and lights were read from constant memory.  They are when they fit in the
+        /// device's max_constant_buffer_size (small scenes), and are read from global memory otherwise.
+        ///
+        bool constantMemory = false;
+        ///
+        /// \brief the number of times the SYCL kernel was launched
+        ///
+        uint launches = 0;
+        ///
+        /// \brief the most samples added to a pixel
+        ///
+        uint samplesPerPixel = 0;
+        ///
+        /// \brief the samples added to every pixel added together
+        ///
+        uint64 totalSamples = 0;
+        ///
+        /// \brief the samples (of any pixel) rendered per second by the last launch
+        ///
+        double samplesPerSecond = 0;
+    };
+    ///
+    /// \brief Gets the statistics of the last call to RenderScene() or RenderPass()
+    ///
+    const RenderStats &GetLastRenderStats() const { return lastRenderStats_; }
 private:
     ///
     /// \brief Samples, once, the color of the scene in some direction (intended to be run on the SYCL device)
     ///
-    static Color SampleLight(Ray r, const ScenePrimative *primatives, uint64 primativesCount, const Material *materials, uint64 materialsCount, RenderRandomSeed *seed);
+    template<typename Node>
+    static Color SampleLight(Ray r, const Node *nodes, const uint *indices, const PrimativePointers &primatives,
+                             const BVHInstance *instances, uint instanceCount, uint topLevelRoot,
+                             const VoxelGrid &voxelGrid, const uint *chunks, const uint *sectionRoots, const VoxelDAGNode *voxelNodes,
+                             const VoxelDAGLeaf *voxelLeaves, const uint *blockMaterials, const SphereLight *lights, uint lightCount,
+                             const Material *materials, uint materialsCount, uint maxDepth, uint rouletteDepth, Sampler *sampler);
+    ///
+    /// \brief Adds samples to the accumulation buffer using the given node layout of the scene's acceleration structure
+    /// \return the number of samples added to every pixel
+    ///
+    template<typename Node>
+    uint RenderWithNodes(const Scene &scene, const AccelerationStructure &accelerationStructure, const std::vector<Node> &nodes, uint topLevelRoot,
+                         const Camera &camera, uint samplesPerPixel, AccumulationBuffer *accumulation);
+    ///
+    /// \brief Adds samples to the accumulation buffer, reading the primatives, materials, and lights from the given memory
+    /// (constant_buffer or global_buffer, see RenderStats::constantMemory)
+    /// \return the number of samples added to every pixel
+    ///
+    template<typename Node, cl::sycl::access::target SceneMemory>
+    uint RenderWithMemory(const Scene &scene, const AccelerationStructure &accelerationStructure, const std::vector<Node> &nodes, uint topLevelRoot,
+                          const std::vector<SphereLight> &lights, const Camera &camera, uint samplesPerPixel, AccumulationBuffer *accumulation);
+    ///
+    /// \brief Replaces the lights of the last render with the given ones, marking the ones that differ as changed
+    ///
+    void UpdateLights(const std::vector<SphereLight> &lights);
     ///
     /// \brief The SYCL work queue
     ///
     cl::sycl::queue queue_;
+    ///
+    /// \brief The scene, its lights, and the pixels kept on the SYCL device between renders
+    ///
+    DeviceScene deviceScene_;
+    DeviceArray<SphereLight> deviceLights_;
+    DeviceArray<AccumulatedPixel> devicePixels_;
+    ///
+    /// \brief The lights of the last render and which of them changed (see UpdateLights())
+    ///
+    std::vector<SphereLight> lights_;
+    DirtyRanges lightChanges_;
+    ///
+    /// \brief Where the samples of a wave go until every active pixel has one (only ever used on the SYCL device).
+    /// It is kept between renders and only replaced when an image with more pixels is rendered.
+    ///
+    cl::sycl::buffer<AccumulatedPixel,1> waveBuffer_{cl::sycl::range<1>(1)};
+    uint64 waveCapacity_ = 0;
+    ///
+    /// \brief See SetNodeWidth()
+    ///
+    uint nodeWidth_ = 2;
+    ///
+    /// \brief See SetLightSampling()
+    ///
+    bool lightSampling_ = true;
+    ///
+    /// \brief See SetWavefront()
+    ///
+    bool wavefront_ = false;
+    ///
+    /// \brief See SetSortRays()
+    ///
+    bool sortRays_ = false;
+    ///
+    /// \brief See SetPersistentThreads()
+    ///
+    bool persistentThreads_ = false;
+    ///
+    /// \brief See SetSeed()
+    ///
+    uint seed_ = 0;
+    ///
+    /// \brief See SetSampler()
+    ///
+    Sampler::Type sampler_ = Sampler::SOBOL;
+    ///
+    /// \brief See SetPixelFilter()
+    ///
+    PixelFilter pixelFilter_ = { PixelFilter::TENT, 1 };
+    ///
+    /// \brief See SetMaxDepth()
+    ///
+    uint maxDepth_ = 16;
+    ///
+    /// \brief See SetRouletteDepth()
+    ///
+    uint rouletteDepth_ = 3;
+    ///
+    /// \brief See SetAdaptiveThreshold()
+    ///
+    float adaptiveThreshold_ = 0;
+    ///
+    /// \brief See SetAdaptiveSamples()
+    ///
+    uint adaptiveSamples_ = 16;
+    ///
+    /// \brief See SetLaunchSeconds()
+    ///
+    double launchSeconds_ = .05;
+    ///
+    /// \brief How many samples (of any pixel) the next launch renders, kept between renders
+    ///
+    uint64 launchSize_ = 4096;
+    ///
+    /// \brief See SetProgressCallback()
+    ///
+    ProgressCallback progressCallback_;
+    ///
+    /// \brief See GetLastRenderStats()
+    ///
+    RenderStats lastRenderStats_;
 };
 
 }
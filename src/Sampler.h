@@ -0,0 +1,123 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_SAMPLER_H
+#define TRACER_SAMPLER_H
+
+#include "Common.h"
+
+namespace Tracer {
+
+///
+/// \brief Makes the numbers in [0,1) every random decision of a sample of a pixel is made with (intended to be run on the
+/// SYCL device).  This is what is passed around while rendering a sample.
+///
+/// Every decision has its own dimension (see the dimension constants) and every bounce of the path has its own set of
+/// dimensions, so a number only depends on the pixel, the sample, the bounce, and what it is used for.  Any sample of any
+/// pixel can then be regenerated on its own (on any device, in any launch) and samples can be spread evenly over the
+/// dimensions instead of only at random.
+///
+struct Sampler {
+    ///
+    /// \brief The ways of making the numbers
+    ///
+    enum Type {
+        ///
+        /// \brief every number is independently random
+        ///
+        INDEPENDENT,
+        ///
+        /// \brief every 16 samples of a pixel fall in different 16ths of every dimension (latin hypercube)
+        ///
+        STRATIFIED,
+        ///
+        /// \brief Owen scrambled Sobol points, every pair of dimensions is a (0,2) sequence of its own (converges the fastest)
+        ///
+        SOBOL,
+        ///
+        /// \brief the same Sobol points in every pixel, shifted by a blue noise mask so the error left at low sample counts
+        /// looks like fine grain instead of blotches
+        ///
+        BLUE_NOISE
+    };
+
+    ///
+    /// \brief The dimensions used at every bounce (and by the camera before the first bounce).  Dimensions are paired
+    /// (0 and 1, 2 and 3, ...) so the two numbers of a 2D decision are spread evenly over the square.
+    ///
+    static const uint CAMERA_U = 0, CAMERA_V = 1;
+    static const uint LIGHT_U = 0, LIGHT_V = 1;
+    static const uint BSDF_U = 2, BSDF_V = 3;
+    static const uint LIGHT_CHOICE = 4, ROULETTE = 5;
+    static const uint BSDF_LOBE = 6;
+
+    ///
+    /// \brief Starts a sample of a pixel (the camera's dimensions are used until the first bounce)
+    /// \param seed the seed of the render (see Renderer::SetSeed())
+    /// \param x,y the pixel
+    ///
+    static Sampler Start(Type type, uint seed, uint x, uint y, uint sample);
+    ///
+    /// \brief Moves on to the dimensions of a bounce (1 for the first surface the path hits)
+    ///
+    void StartBounce(uint bounce);
+    ///
+    /// \brief Returns the number of the dimension of the current bounce
+    ///
+    float Get(uint dimension) const;
+    ///
+    /// \brief Hashes a 32 bit number (the PCG hash of Jarzynski and Olano, every bit of the input changes about half of the output)
+    ///
+    static uint Hash(uint value);
+    ///
+    /// \brief Returns the point of an unscrambled 2D Sobol sequence (dimension 0 or 1) as a fixed point fraction
+    ///
+    static uint Sobol(uint index, uint dimension);
+    ///
+    /// \brief Owen scrambles the bits of a fixed point fraction (the hash based nested uniform scrambling of Burley)
+    ///
+    static uint OwenScramble(uint value, uint seed);
+    ///
+    /// \brief Returns the blue noise mask at the pixel for a dimension of a bounce in [0,1) (interleaved gradient noise of
+    /// Jimenez, moved for every dimension)
+    ///
+    static float BlueNoise(uint x, uint y, uint dimension);
+
+    Type type;
+    uint x, y;
+    uint sample;
+    ///
+    /// \brief the hash of the render's seed (and the pixel, unless every pixel uses the same points)
+    ///
+    uint pixelKey;
+    ///
+    /// \brief the hash of the pixel key and the bounce
+    ///
+    uint bounceKey;
+    ///
+    /// \brief the bounce the numbers are for (0 for the camera)
+    ///
+    uint bounce;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_SAMPLER_H
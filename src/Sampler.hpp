@@ -0,0 +1,127 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_SAMPLER_HPP
+#define TRACER_SAMPLER_HPP
+
+#include <SYCL/sycl.hpp>
+#include "Sampler.h"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+inline uint Sampler::Hash(uint value) {
+    const uint state = value * 747796405U + 2891336453U;
+    const uint word = ((state >> ((state >> 28U) + 4U)) ^ state) * 277803737U;
+    return (word >> 22U) ^ word;
+}
+
+inline uint Sampler::Sobol(uint index, uint dimension) {
+    // dimension 0 is the van der Corput sequence, dimension 1 has the primitive polynomial x+1 (direction v = v ^ v>>1)
+    uint result = 0;
+    uint direction = 1U << 31;
+    for (; index != 0; index >>= 1) {
+        if (index & 1)
+            result ^= direction;
+        direction = dimension == 0 ? direction >> 1 : direction ^ (direction >> 1);
+    }
+    return result;
+}
+
+inline uint Sampler::OwenScramble(uint value, uint seed) {
+    // a Laine-Karras permutation of the reversed bits: every bit is flipped by a hash of the bits above it
+    value = ((value >> 1) & 0x55555555U) | ((value & 0x55555555U) << 1);
+    value = ((value >> 2) & 0x33333333U) | ((value & 0x33333333U) << 2);
+    value = ((value >> 4) & 0x0F0F0F0FU) | ((value & 0x0F0F0F0FU) << 4);
+    value = ((value >> 8) & 0x00FF00FFU) | ((value & 0x00FF00FFU) << 8);
+    value = (value >> 16) | (value << 16);
+    value += seed;
+    value ^= value * 0x6c50b47cU;
+    value ^= value * 0xb82f1e52U;
+    value ^= value * 0xc7afe638U;
+    value ^= value * 0x8d22f6e6U;
+    value = ((value >> 1) & 0x55555555U) | ((value & 0x55555555U) << 1);
+    value = ((value >> 2) & 0x33333333U) | ((value & 0x33333333U) << 2);
+    value = ((value >> 4) & 0x0F0F0F0FU) | ((value & 0x0F0F0F0FU) << 4);
+    value = ((value >> 8) & 0x00FF00FFU) | ((value & 0x00FF00FFU) << 8);
+    return (value >> 16) | (value << 16);
+}
+
+inline float Sampler::BlueNoise(uint x, uint y, uint dimension) {
+    const float shift = 5.588238F * dimension;
+    const float gradient = 0.06711056F * (x + shift) + 0.00583715F * (y + shift);
+    const float noise = 52.9829189F * (gradient - cl::sycl::floor(gradient));
+    return noise - cl::sycl::floor(noise);
+}
+
+inline Sampler Sampler::Start(Type type, uint seed, uint x, uint y, uint sample) {
+    Sampler sampler;
+    sampler.type = type;
+    sampler.x = x;
+    sampler.y = y;
+    sampler.sample = sample;
+    // the blue noise mask is what differs between pixels, the points are the same
+    sampler.pixelKey = type == BLUE_NOISE ? Hash(seed) : Hash(y + Hash(x + Hash(seed)));
+    sampler.StartBounce(0);
+    return sampler;
+}
+
+inline void Sampler::StartBounce(uint bounce) {
+    this->bounce = bounce;
+    bounceKey = Hash(bounce + pixelKey);
+}
+
+inline float Sampler::Get(uint dimension) const {
+    uint bits;
+    if (type == INDEPENDENT) {
+        bits = Hash(dimension + Hash(sample + bounceKey));
+    } else if (type == STRATIFIED) {
+        // every 16 samples are a block, a random permutation of the block picks the 16th of the dimension a sample is in
+        // (multiplying by an odd number, adding, and xoring, all mod 16, only swaps the numbers 0-15 around)
+        const uint key = Hash(sample / 16 + Hash(dimension + bounceKey));
+        const uint stratum = (((sample % 16) * (key | 1) + (key >> 8)) ^ (key >> 16)) & 15;
+        bits = (stratum << 28) | (Hash(sample + Hash(dimension + bounceKey)) >> 4);
+    } else {
+        // every pair of dimensions is its own shuffled and scrambled 2D Sobol sequence (the padding of Burley)
+        const uint pairKey = Hash(dimension / 2 + bounceKey);
+        const uint index = OwenScramble(sample, pairKey);
+        bits = OwenScramble(Sobol(index, dimension % 2), Hash(dimension + bounceKey));
+        if (type == BLUE_NOISE) {
+            // shift the point by the mask (wrapping around), in float since devices may not have doubles and only the top 24 bits are used
+            bits += static_cast<uint>(BlueNoise(x, y, bounce * 8 + dimension) * 16777216.F) << 8;
+        }
+    }
+    // the top 24 bits fit exactly in a float
+    return static_cast<float>(bits >> 8) * (1.F / 16777216.F);
+}
+
+} // namespace Tracer
+
+#endif // TRACER_SAMPLER_HPP
@@ -27,9 +27,26 @@
 #include "Common.h"
 #include "Material.h"
 #include "Camera.h"
+#include "Mesh.h"
 
 namespace Tracer {
 
+const AccelerationStructure &Scene::GetAccelerationStructure(cl::sycl::queue *queue, uint nodeWidth) const {
+    if (needsRebuild_) {
+        accelerationStructure_.Build(*this, queue);
+        needsRebuild_ = false;
+    } else if (!dirtyPrimatives_.empty() || !dirtyInstances_.empty()) {
+        accelerationStructure_.Update(*this, dirtyPrimatives_, dirtyInstances_, rebuildThreshold_, queue);
+    }
+    dirtyPrimatives_.clear();
+    dirtyInstances_.clear();
+    if (accelerationStructure_.GetNodeWidth() != nodeWidth)
+        accelerationStructure_.SetNodeWidth(nodeWidth);
+    if (accelerationStructure_.GetCompressedNodes() != compressedBVH_)
+        accelerationStructure_.SetCompressedNodes(compressedBVH_);
+    return accelerationStructure_;
+}
+
 SceneFile SceneFile::Load(std::string filename) {
     std::fstream file(filename, std::fstream::in);
     if (!file) throw FileReadException(filename);
@@ -39,6 +56,14 @@ SceneFile SceneFile::Load(std::string filename) {
     float focalLength = 0;
     Vector<float,4> imagePlaneBounds({0,0,0,0});
     Vector<uint,2> imageResolution({0,0});
+    // vars for the depth of paths (0 keeps the renderer's)
+    uint maxDepth = 0, rouletteDepth = 0;
+    // vars for adaptive sampling (0 keeps the renderer's)
+    float adaptiveThreshold = 0;
+    uint adaptiveSamples = 0;
+    // vars for the pixel filter
+    PixelFilter pixelFilter = { PixelFilter::TENT, 1 };
+    bool hasPixelFilter = false;
     // vars to check the user enter all required values
     bool hasEye = false;
     bool hasLook = false;
@@ -49,6 +74,10 @@ SceneFile SceneFile::Load(std::string filename) {
 
     Scene scene;
 
+    // files referenced by the scene file are relative to the scene file
+    const uint64 sceneDirectoryEnd = filename.find_last_of("\\/");
+    const std::string sceneDirectory = std::string::npos == sceneDirectoryEnd ? "" : filename.substr(0, sceneDirectoryEnd + 1);
+
     std::string line;
     while (std::getline(file, line)) {
         std::istringstream lineParser(line);
@@ -92,6 +121,35 @@ SceneFile SceneFile::Load(std::string filename) {
                 throw ParseException("Could not parse resolution details in driver file");
             imageResolution = Vector<uint,2>({static_cast<uint>(x),static_cast<uint>(y)});
             hasImageResolution = true;
+        } else if (type == "depth") {
+            int roulette, max;
+            if (!(lineParser >> roulette >> max) || roulette < 0 || max < 1)
+                throw ParseException("Could not parse depth details in driver file");
+            rouletteDepth = static_cast<uint>(roulette);
+            maxDepth = static_cast<uint>(max);
+        } else if (type == "adaptive") {
+            float threshold;
+            int samples = 16;
+            if (!(lineParser >> threshold) || threshold <= 0)
+                throw ParseException("Could not parse adaptive sampling details in driver file");
+            // the samples between checks are optional
+            if (!(lineParser >> std::ws).eof() && (!(lineParser >> samples) || samples < 1))
+                throw ParseException("Could not parse adaptive sampling details in driver file");
+            adaptiveThreshold = threshold;
+            adaptiveSamples = static_cast<uint>(samples);
+        } else if (type == "filter") {
+            std::string filterType;
+            if (!(lineParser >> filterType >> pixelFilter.radius) || pixelFilter.radius < 0)
+                throw ParseException("Could not parse pixel filter details in driver file");
+            if (filterType == "box")
+                pixelFilter.type = PixelFilter::BOX;
+            else if (filterType == "tent")
+                pixelFilter.type = PixelFilter::TENT;
+            else if (filterType == "gaussian")
+                pixelFilter.type = PixelFilter::GAUSSIAN;
+            else
+                throw ParseException("Unknown pixel filter type in driver file");
+            hasPixelFilter = true;
         } else if (type == "sphere") {
             float x,y,z,r,  emission_r,emission_g,emission_b,   color_r,color_g,color_b;
             int materialType;
@@ -100,6 +158,52 @@ SceneFile SceneFile::Load(std::string filename) {
             scene.AddPrimative(
                         Sphere(r, Vector3f(x,y,z)),
                         Material(Vector3f(emission_r,emission_g,emission_b), Vector3f(color_r,color_g,color_b), (Material::MaterialType)materialType));
+        } else if (type == "plane") {
+            float x,y,z,nx,ny,nz,  emission_r,emission_g,emission_b,   color_r,color_g,color_b;
+            int materialType;
+            if (!(lineParser >> x >> y >> z >> nx >> ny >> nz >> emission_r >> emission_g >> emission_b >> color_r >> color_g >> color_b >> materialType))
+                throw ParseException("Could not parse plane details in driver file");
+            scene.AddPrimative(
+                        Plane(Vector3f(x,y,z), Vector3f(nx,ny,nz)),
+                        Material(Vector3f(emission_r,emission_g,emission_b), Vector3f(color_r,color_g,color_b), (Material::MaterialType)materialType));
+        } else if (type == "quad") {
+            float x,y,z,ux,uy,uz,vx,vy,vz,  emission_r,emission_g,emission_b,   color_r,color_g,color_b;
+            int materialType;
+            if (!(lineParser >> x >> y >> z >> ux >> uy >> uz >> vx >> vy >> vz >> emission_r >> emission_g >> emission_b >> color_r >> color_g >> color_b >> materialType))
+                throw ParseException("Could not parse quad details in driver file");
+            scene.AddPrimative(
+                        Quad(Vector3f(x,y,z), Vector3f(ux,uy,uz), Vector3f(vx,vy,vz)),
+                        Material(Vector3f(emission_r,emission_g,emission_b), Vector3f(color_r,color_g,color_b), (Material::MaterialType)materialType));
+        } else if (type == "box") {
+            float minX,minY,minZ,maxX,maxY,maxZ,  emission_r,emission_g,emission_b,   color_r,color_g,color_b;
+            int materialType;
+            if (!(lineParser >> minX >> minY >> minZ >> maxX >> maxY >> maxZ >> emission_r >> emission_g >> emission_b >> color_r >> color_g >> color_b >> materialType))
+                throw ParseException("Could not parse box details in driver file");
+            scene.AddPrimative(
+                        Box(Vector3f(minX,minY,minZ), Vector3f(maxX,maxY,maxZ)),
+                        Material(Vector3f(emission_r,emission_g,emission_b), Vector3f(color_r,color_g,color_b), (Material::MaterialType)materialType));
+        } else if (type == "mesh") {
+            std::string meshFile;
+            if (!(lineParser >> meshFile))
+                throw ParseException("Could not parse mesh details in driver file");
+            if (meshFile[0] != '/')
+                meshFile = sceneDirectory + meshFile;
+            scene.AddMesh(Mesh::LoadObj(meshFile, scene.GetMaterialManager()));
+        } else if (type == "bvh") {
+            // any of the build method and "compressed" (until a trailing comment)
+            std::string option;
+            bool parsed = false;
+            while (lineParser >> option && option[0] != '#') {
+                parsed = option == "sah" || option == "linear" || option == "compressed";
+                if (!parsed)
+                    break;
+                if (option == "compressed")
+                    scene.SetCompressedBVH(true);
+                else
+                    scene.SetBVHBuildMethod(option == "linear" ? BVH::LINEAR : BVH::SAH);
+            }
+            if (!parsed)
+                throw ParseException("Could not parse bvh details in driver file (expected \"sah\", \"linear\", and/or \"compressed\")");
         } else {
             throw ParseException("Unexpected scene item in driver file: \"" + line + "\"");
         }
@@ -122,7 +226,14 @@ SceneFile SceneFile::Load(std::string filename) {
     if (std::string::npos != period_idx)
         filename.erase(period_idx);
 
-    return SceneFile(std::move(scene), Camera(up, look, eye, focalLength, imagePlaneBounds), imageResolution, filename);
+    SceneFile sceneFile(std::move(scene), Camera(up, look, eye, focalLength, imagePlaneBounds), imageResolution, filename);
+    sceneFile.maxDepth_ = maxDepth;
+    sceneFile.rouletteDepth_ = rouletteDepth;
+    sceneFile.adaptiveThreshold_ = adaptiveThreshold;
+    sceneFile.adaptiveSamples_ = adaptiveSamples;
+    sceneFile.pixelFilter_ = pixelFilter;
+    sceneFile.hasPixelFilter_ = hasPixelFilter;
+    return sceneFile;
 }
 
 } // namespace Tracer
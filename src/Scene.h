@@ -25,10 +25,16 @@
 #include <vector>
 
 #include <CL/sycl.hpp>
+#include "AccelerationStructure.h"
 #include "Vector.h"
 #include "Material.h"
+#include "Mesh.h"
 #include "ScenePrimative.h"
 #include "Camera.h"
+#include "PixelFilter.h"
+#include "Transform.h"
+#include "VoxelDAG.h"
+#include "VoxelWorld.h"
 
 namespace Tracer {
 
@@ -37,37 +43,242 @@ public:
     Scene() = default;
     Scene(Scene &&s) {
         scenePrimatives_ = std::move(s.scenePrimatives_);
+        objects_ = std::move(s.objects_);
+        instances_ = std::move(s.instances_);
         materialManager_ = std::move(s.materialManager_);
+        accelerationStructure_ = std::move(s.accelerationStructure_);
+        needsRebuild_ = s.needsRebuild_;
+        dirtyPrimatives_ = std::move(s.dirtyPrimatives_);
+        dirtyInstances_ = std::move(s.dirtyInstances_);
+        rebuildThreshold_ = s.rebuildThreshold_;
+        bvhBuildMethod_ = s.bvhBuildMethod_;
+        compressedBVH_ = s.compressedBVH_;
+        voxelWorld_ = std::move(s.voxelWorld_);
+        voxelDAG_ = std::move(s.voxelDAG_);
+    }
+    ///
+    /// \brief Adds a primative to the scene
+    ///
+    void AddPrimative(const ScenePrimative &primative) {
+        scenePrimatives_.push_back(primative);
+        needsRebuild_ = true;
     }
     ///
     /// \brief Adds a sphere primative to the scene
     ///
-    void AddPrimative(const Sphere &sphere, uint materialId) { scenePrimatives_.push_back(ScenePrimative(sphere, materialId)); }
+    void AddPrimative(const Sphere &sphere, uint materialId) { AddPrimative(ScenePrimative(sphere, materialId)); }
     ///
     /// \brief Adds a sphere primative to the scene
     ///
     void AddPrimative(const Sphere &sphere, const Material &material) {
-        scenePrimatives_.push_back(ScenePrimative(sphere, materialManager_.AddMaterial(material)));
+        AddPrimative(sphere, materialManager_.AddMaterial(material));
+    }
+    ///
+    /// \brief Adds a triangle primative to the scene
+    ///
+    void AddPrimative(const Triangle &triangle, uint materialId) { AddPrimative(ScenePrimative(triangle, materialId)); }
+    ///
+    /// \brief Adds a triangle primative to the scene
+    ///
+    void AddPrimative(const Triangle &triangle, const Material &material) {
+        AddPrimative(triangle, materialManager_.AddMaterial(material));
+    }
+    ///
+    /// \brief Adds a plane primative to the scene
+    ///
+    void AddPrimative(const Plane &plane, uint materialId) { AddPrimative(ScenePrimative(plane, materialId)); }
+    ///
+    /// \brief Adds a plane primative to the scene
+    ///
+    void AddPrimative(const Plane &plane, const Material &material) {
+        AddPrimative(plane, materialManager_.AddMaterial(material));
+    }
+    ///
+    /// \brief Adds a parallelogram primative to the scene
+    ///
+    void AddPrimative(const Quad &quad, uint materialId) { AddPrimative(ScenePrimative(quad, materialId)); }
+    ///
+    /// \brief Adds a parallelogram primative to the scene
+    ///
+    void AddPrimative(const Quad &quad, const Material &material) {
+        AddPrimative(quad, materialManager_.AddMaterial(material));
+    }
+    ///
+    /// \brief Adds a axis aligned box primative to the scene
+    ///
+    void AddPrimative(const Box &box, uint materialId) { AddPrimative(ScenePrimative(box, materialId)); }
+    ///
+    /// \brief Adds a axis aligned box primative to the scene
+    ///
+    void AddPrimative(const Box &box, const Material &material) {
+        AddPrimative(box, materialManager_.AddMaterial(material));
+    }
+    ///
+    /// \brief Adds every triangle of a mesh to the scene
+    /// \note the mesh's material ids must come from this scene's material manager
+    ///
+    void AddMesh(const Mesh &mesh) {
+        scenePrimatives_.reserve(scenePrimatives_.size() + mesh.GetTriangleCount());
+        for (uint i=0; i<mesh.GetTriangleCount(); i++)
+            scenePrimatives_.push_back(ScenePrimative(mesh.GetTriangle(i), mesh.GetMaterialIds()[i]));
+        needsRebuild_ = true;
     }
     ///
     /// \brief Gets a list of all the primatives in the scene
+    /// \note Changing primatives through the non-const version rebuilds the whole acceleration structure,
+    /// use SetPrimative() to only update the parts that changed
     ///
-    std::vector<ScenePrimative>& GetPrimatives() { return scenePrimatives_; }
+    std::vector<ScenePrimative>& GetPrimatives() { needsRebuild_ = true; return scenePrimatives_; }
     const std::vector<ScenePrimative>& GetPrimatives() const { return scenePrimatives_; }
     ///
+    /// \brief Replaces a primative (ex: to move it) so only the affected part of the acceleration structure is updated
+    ///
+    void SetPrimative(uint primativeId, const ScenePrimative &primative) {
+        scenePrimatives_[primativeId] = primative;
+        dirtyPrimatives_.push_back(primativeId);
+    }
+    ///
+    /// \brief Adds an object (a group of primatives in their own coordinate space) that can be placed in the scene many times using instances
+    /// \return the id of the object
+    ///
+    uint AddObject(const std::vector<ScenePrimative> &primatives) {
+        objects_.push_back(primatives);
+        needsRebuild_ = true;
+        return static_cast<uint>(objects_.size() - 1);
+    }
+    ///
+    /// \brief Adds an object made of every triangle of a mesh
+    /// \return the id of the object
+    ///
+    uint AddObject(const Mesh &mesh) {
+        std::vector<ScenePrimative> primatives;
+        primatives.reserve(mesh.GetTriangleCount());
+        for (uint i=0; i<mesh.GetTriangleCount(); i++)
+            primatives.push_back(ScenePrimative(mesh.GetTriangle(i), mesh.GetMaterialIds()[i]));
+        return AddObject(primatives);
+    }
+    ///
+    /// \brief Places an object in the scene
+    /// \param transform moves the object from its own coordinate space into the scene
+    /// \param materialOverride if not Instance::NO_MATERIAL_OVERRIDE every primative of the instance uses this material
+    /// \return the id of the instance
+    ///
+    uint AddInstance(uint objectId, const Transform &transform, uint materialOverride = Instance::NO_MATERIAL_OVERRIDE) {
+        Instance instance;
+        instance.objectId = objectId;
+        instance.transform = transform;
+        instance.materialOverride = materialOverride;
+        instances_.push_back(instance);
+        needsRebuild_ = true;
+        return static_cast<uint>(instances_.size() - 1);
+    }
+    ///
+    /// \brief Moves an instance (only the top level of the acceleration structure is updated)
+    ///
+    void SetInstanceTransform(uint instanceId, const Transform &transform) {
+        instances_[instanceId].transform = transform;
+        dirtyInstances_.push_back(instanceId);
+    }
+    ///
+    /// \brief Gets the primatives of every object
+    ///
+    const std::vector<std::vector<ScenePrimative>>& GetObjects() const { return objects_; }
+    ///
+    /// \brief Gets every instance of an object in the scene
+    ///
+    const std::vector<Instance>& GetInstances() const { return instances_; }
+    ///
+    /// \brief Gets the world of blocks rendered with the scene's primatives (empty by default)
+    /// \note the block materials must come from this scene's material manager
+    ///
+    VoxelWorld& GetVoxelWorld() { return voxelWorld_; }
+    const VoxelWorld& GetVoxelWorld() const { return voxelWorld_; }
+    ///
+    /// \brief Gets the voxel world stored as a sparse voxel DAG (what is rendered), updating it first if the world changed
+    ///
+    const VoxelDAG& GetVoxelDAG() const {
+        voxelDAG_.Update(voxelWorld_);
+        return voxelDAG_;
+    }
+    ///
     /// \brief Gets the material manager for this scene
     ///
     MaterialManager& GetMaterialManager() { return materialManager_; }
     const MaterialManager& GetMaterialManager() const { return materialManager_; }
+    ///
+    /// \brief Sets how much slower (by SAH cost) refitting may make a BVH before it is rebuilt instead
+    ///
+    void SetRebuildThreshold(float rebuildThreshold) { rebuildThreshold_ = rebuildThreshold; }
+    ///
+    /// \brief Sets how the BVHs of the acceleration structure are built (fast to build or fast to render)
+    ///
+    void SetBVHBuildMethod(BVH::BuildMethod bvhBuildMethod) {
+        bvhBuildMethod_ = bvhBuildMethod;
+        needsRebuild_ = true;
+    }
+    BVH::BuildMethod GetBVHBuildMethod() const { return bvhBuildMethod_; }
+    ///
+    /// \brief Sets if the acceleration structure's nodes are compressed (see QuantizedBVHNode).
+    /// Compressed nodes let much bigger scenes fit on the SYCL device but are slightly slower to traverse.
+    ///
+    void SetCompressedBVH(bool compressedBVH) { compressedBVH_ = compressedBVH; }
+    bool GetCompressedBVH() const { return compressedBVH_; }
+    ///
+    /// \brief Gets the acceleration structure for the scene, building or updating it first if the scene changed
+    /// \param queue if not nullptr, linear BVHs are built on the queue's SYCL device
+    /// \param nodeWidth the width of the BVH nodes that will be traversed (see AccelerationStructure::SetNodeWidth)
+    ///
+    const AccelerationStructure& GetAccelerationStructure(cl::sycl::queue *queue = nullptr, uint nodeWidth = 2) const;
 private:
     ///
     /// \brief A list of the primatives of the scene
     ///
     std::vector<ScenePrimative> scenePrimatives_;
     ///
+    /// \brief The primatives of every object (in the object's own coordinate space)
+    ///
+    std::vector<std::vector<ScenePrimative>> objects_;
+    ///
+    /// \brief Every placement of an object in the scene
+    ///
+    std::vector<Instance> instances_;
+    ///
+    /// \brief See GetVoxelWorld()
+    ///
+    VoxelWorld voxelWorld_;
+    ///
+    /// \brief See GetVoxelDAG()
+    ///
+    mutable VoxelDAG voxelDAG_;
+    ///
     /// \brief The material manager for this scene
     ///
     MaterialManager materialManager_;
+    ///
+    /// \brief Built the first time it is needed and kept up to date as the scene changes
+    ///
+    mutable AccelerationStructure accelerationStructure_;
+    ///
+    /// \brief True if the acceleration structure must be built from scratch
+    ///
+    mutable bool needsRebuild_ = true;
+    ///
+    /// \brief Primatives and instances changed since the acceleration structure was last updated
+    ///
+    mutable std::vector<uint> dirtyPrimatives_;
+    mutable std::vector<uint> dirtyInstances_;
+    ///
+    /// \brief See SetRebuildThreshold()
+    ///
+    float rebuildThreshold_ = 1.5F;
+    ///
+    /// \brief See SetBVHBuildMethod()
+    ///
+    BVH::BuildMethod bvhBuildMethod_ = BVH::SAH;
+    ///
+    /// \brief See SetCompressedBVH()
+    ///
+    bool compressedBVH_ = false;
 };
 
 ///
@@ -85,6 +296,30 @@ public:
     Camera &GetCamera() { return camera_; }
     Vector<uint,2> &GetImageDimensions() { return imageDimensions_; }
     std::string &GetSceneName() { return sceneName_; }
+    ///
+    /// \brief Gets the max depth of paths from the scene file's depth line (0 if the scene file doesn't set it, see Renderer::SetMaxDepth)
+    ///
+    uint GetMaxDepth() const { return maxDepth_; }
+    ///
+    /// \brief Gets the russian roulette depth from the scene file's depth line (0 if the scene file doesn't set it, see Renderer::SetRouletteDepth)
+    ///
+    uint GetRouletteDepth() const { return rouletteDepth_; }
+    ///
+    /// \brief Gets the adaptive sampling threshold from the scene file's adaptive line (0 if the scene file doesn't set it, see Renderer::SetAdaptiveThreshold)
+    ///
+    float GetAdaptiveThreshold() const { return adaptiveThreshold_; }
+    ///
+    /// \brief Gets the samples between adaptive sampling checks from the scene file's adaptive line (0 if the scene file doesn't set it, see Renderer::SetAdaptiveSamples)
+    ///
+    uint GetAdaptiveSamples() const { return adaptiveSamples_; }
+    ///
+    /// \brief Returns if the scene file has a filter line
+    ///
+    bool HasPixelFilter() const { return hasPixelFilter_; }
+    ///
+    /// \brief Gets the pixel filter from the scene file's filter line (see Renderer::SetPixelFilter)
+    ///
+    const PixelFilter &GetPixelFilter() const { return pixelFilter_; }
 private:
     SceneFile(Scene &&scene, const Camera &camera, const Vector<uint,2> &imageDimensions, std::string sceneName)
         : scene_(std::move(scene)), camera_(camera), imageDimensions_(imageDimensions), sceneName_(sceneName) {}
@@ -104,6 +339,21 @@ private:
     /// \brief The filename of the scene file minus file path and extension
     ///
     std::string sceneName_;
+    ///
+    /// \brief See GetMaxDepth() and GetRouletteDepth()
+    ///
+    uint maxDepth_ = 0;
+    uint rouletteDepth_ = 0;
+    ///
+    /// \brief See GetAdaptiveThreshold() and GetAdaptiveSamples()
+    ///
+    float adaptiveThreshold_ = 0;
+    uint adaptiveSamples_ = 0;
+    ///
+    /// \brief See GetPixelFilter() and HasPixelFilter()
+    ///
+    PixelFilter pixelFilter_ = { PixelFilter::TENT, 1 };
+    bool hasPixelFilter_ = false;
 };
 
 } // namespace Tracer
@@ -22,6 +22,7 @@
 #define TRACER_SCENEOBJECT_H
 
 #include <SYCL/sycl.hpp>
+#include "AABB.h"
 #include "Vector.h"
 #include "Common.h"
 
@@ -110,15 +111,26 @@ public:
     /// \return IntersectionData with distance == INF if there is no intersection
     /// \note Sphere doesn't know what scene primative it is attached to, so Intersection.intersectedPrimative always == nullptr (See ScenePrimative.Intersect)
     ///
-    Intersection Intersect(const Ray &ray) const;
+    Intersection Intersect(const Ray &ray) const { return Intersect(ray, position_, radius_*radius_); }
+    ///
+    /// \brief Determines if the ray intersects the sphere at the position with the squared radius (see PrimativeArrays)
+    ///
+    static Intersection Intersect(const Ray &ray, const Vector3f &position, float radiusSquared);
+    ///
+    /// \brief Returns the smallest axis aligned box containing the sphere
+    ///
+    AABB GetBoundingBox() const {
+        const Vector3f r(radius_, radius_, radius_);
+        return AABB(position_ - r, position_ + r);
+    }
     ///
     /// \brief returns the radius of the sphere
     ///
-    float GetRadius() { return radius_; }
+    float GetRadius() const { return radius_; }
     ///
     /// \brief gets the position of the sphere
     ///
-    Vector3f GetPosition() { return position_; }
+    Vector3f GetPosition() const { return position_; }
 private:
     ///
     /// \brief the radius of the sphere
@@ -130,6 +142,176 @@ private:
     Vector3f position_;
 };
 
+///
+/// \brief Describes a triangle primative
+/// \note the three vertices are stored as-is (instead of a vertex and two edges) so that triangles sharing an edge
+/// compute that edge exactly the same way.  This is what keeps meshes watertight.
+///
+class Triangle {
+public:
+    Triangle(const Vector3f &v0, const Vector3f &v1, const Vector3f &v2):
+        v0_(v0), v1_(v1), v2_(v2) {}
+    ///
+    /// \brief Determines if the ray intersects the triangle and where that intersection is.
+    /// Uses the watertight ray/triangle intersection algorithm (Woop, Benthin, and Wald 2013) so rays never slip between
+    /// two triangles that share an edge.
+    /// \return IntersectionData with distance == INF if there is no intersection
+    /// \note The normal is the geometric normal, it faces the side the vertices wind counter clockwise around
+    ///
+    Intersection Intersect(const Ray &ray) const;
+    ///
+    /// \brief Returns the smallest axis aligned box containing the triangle
+    ///
+    AABB GetBoundingBox() const {
+        AABB bounds;
+        bounds.Grow(v0_);
+        bounds.Grow(v1_);
+        bounds.Grow(v2_);
+        return bounds;
+    }
+    ///
+    /// \brief Gets one of the three vertices of the triangle
+    ///
+    const Vector3f &GetVertex(uint i) const { return i == 0 ? v0_ : i == 1 ? v1_ : v2_; }
+private:
+    ///
+    /// \brief the vertices of the triangle
+    ///
+    Vector3f v0_, v1_, v2_;
+};
+
+///
+/// \brief Describes an infinite plane primative (ex: a floor that goes on forever)
+///
+class Plane {
+public:
+    ///
+    /// \param point any point on the plane
+    /// \param normal the direction the plane faces (does not need to be normalized)
+    ///
+    Plane(const Vector3f &point, const Vector3f &normal):
+        normal_(Vector3f(normal).Normalize()) { offset_ = normal_.Dot(point); }
+    ///
+    /// \brief Determines if the ray intersects the plane and where that intersection is.
+    /// \return IntersectionData with distance == INF if there is no intersection
+    /// \note The normal is the same from both sides (it is up to the renderer to flip it)
+    ///
+    Intersection Intersect(const Ray &ray) const { return Intersect(ray, normal_, offset_); }
+    ///
+    /// \brief Determines if the ray intersects the plane with the (normalized) normal and offset (see PrimativeArrays)
+    ///
+    static Intersection Intersect(const Ray &ray, const Vector3f &normal, float offset);
+    ///
+    /// \brief Returns an axis aligned box containing the plane within BOUNDS_EXTENT of the origin.
+    /// An infinite box would break building acceleration structures, so planes are only hit within this box.
+    /// The box is flat when the plane is perpendicular to an axis.
+    ///
+    AABB GetBoundingBox() const {
+        const float extent = BOUNDS_EXTENT();
+        Vector3f min(-extent, -extent, -extent), max(extent, extent, extent);
+        for (uint axis=0; axis<3; axis++) {
+            if (normal_[(axis+1)%3] == 0 && normal_[(axis+2)%3] == 0) {
+                min[axis] = offset_ / normal_[axis];
+                max[axis] = min[axis];
+            }
+        }
+        return AABB(min, max);
+    }
+    ///
+    /// \brief How far from the origin planes reach along the axes they aren't perpendicular to (see GetBoundingBox())
+    ///
+    static float BOUNDS_EXTENT() { return 1e5F; }
+    ///
+    /// \brief Gets the normalized direction the plane faces
+    ///
+    const Vector3f &GetNormal() const { return normal_; }
+    ///
+    /// \brief Gets the signed distance of the plane from the origin along its normal
+    ///
+    float GetOffset() const { return offset_; }
+private:
+    ///
+    /// \brief the normalized direction the plane faces
+    ///
+    Vector3f normal_;
+    ///
+    /// \brief the plane is every point p where normal_.Dot(p) == offset_
+    ///
+    float offset_;
+};
+
+///
+/// \brief Describes a parallelogram (a quad when the edges are perpendicular) primative
+///
+class Quad {
+public:
+    ///
+    /// \param corner one corner of the parallelogram
+    /// \param edgeU,edgeV the two edges leaving the corner (the other corners are corner+edgeU, corner+edgeV, corner+edgeU+edgeV)
+    ///
+    Quad(const Vector3f &corner, const Vector3f &edgeU, const Vector3f &edgeV):
+        corner_(corner), edgeU_(edgeU), edgeV_(edgeV) {}
+    ///
+    /// \brief Determines if the ray intersects the parallelogram and where that intersection is.
+    /// \return IntersectionData with distance == INF if there is no intersection
+    /// \note The normal is edgeU x edgeV from both sides (it is up to the renderer to flip it)
+    ///
+    Intersection Intersect(const Ray &ray) const;
+    ///
+    /// \brief Returns the smallest axis aligned box containing the parallelogram
+    ///
+    AABB GetBoundingBox() const {
+        AABB bounds;
+        bounds.Grow(corner_);
+        bounds.Grow(Vector3f(corner_ + edgeU_));
+        bounds.Grow(Vector3f(corner_ + edgeV_));
+        bounds.Grow(Vector3f(corner_ + edgeU_ + edgeV_));
+        return bounds;
+    }
+    const Vector3f &GetCorner() const { return corner_; }
+    const Vector3f &GetEdgeU() const { return edgeU_; }
+    const Vector3f &GetEdgeV() const { return edgeV_; }
+private:
+    ///
+    /// \brief one corner of the parallelogram
+    ///
+    Vector3f corner_;
+    ///
+    /// \brief the two edges leaving the corner
+    ///
+    Vector3f edgeU_, edgeV_;
+};
+
+///
+/// \brief Describes a solid axis aligned box primative
+///
+class Box {
+public:
+    Box(const Vector3f &min, const Vector3f &max):
+        min_(min), max_(max) {}
+    ///
+    /// \brief Determines if the ray intersects the box and where that intersection is (where the ray leaves the box if it starts inside).
+    /// \return IntersectionData with distance == INF if there is no intersection
+    /// \note The normal always faces out of the box
+    ///
+    Intersection Intersect(const Ray &ray) const;
+    ///
+    /// \brief Returns the box
+    ///
+    AABB GetBoundingBox() const { return AABB(min_, max_); }
+    const Vector3f &GetMin() const { return min_; }
+    const Vector3f &GetMax() const { return max_; }
+private:
+    ///
+    /// \brief the corner of the box with the smallest values
+    ///
+    Vector3f min_;
+    ///
+    /// \brief the corner of the box with the largest values
+    ///
+    Vector3f max_;
+};
+
 ///
 /// \brief Describes a primative that can be rendered in the scene
 ///
@@ -141,18 +323,73 @@ public:
     ScenePrimative(const Sphere &sphere, uint materialId) : sceneObjectType_(SCENE_OBJECT_SPHERE), materialId_(materialId) {
         sceneObjectData_.sphere = sphere;
     }
-//    ///
-//    /// \brief Creates a new scene object primative from a triangle
-//    ///
-//    SceneObject(Triangle triangle) : sceneObjectType(SCENE_OBJECT_TRIANGLE) {
-//        sceneObjectData.triangle = triangle;
-//    }
+    ///
+    /// \brief Creates a new scene object primative from a triangle
+    ///
+    ScenePrimative(const Triangle &triangle, uint materialId) : sceneObjectType_(SCENE_OBJECT_TRIANGLE), materialId_(materialId) {
+        sceneObjectData_.triangle = triangle;
+    }
+    ///
+    /// \brief Creates a new scene object primative from a plane
+    ///
+    ScenePrimative(const Plane &plane, uint materialId) : sceneObjectType_(SCENE_OBJECT_PLANE), materialId_(materialId) {
+        sceneObjectData_.plane = plane;
+    }
+    ///
+    /// \brief Creates a new scene object primative from a parallelogram
+    ///
+    ScenePrimative(const Quad &quad, uint materialId) : sceneObjectType_(SCENE_OBJECT_QUAD), materialId_(materialId) {
+        sceneObjectData_.quad = quad;
+    }
+    ///
+    /// \brief Creates a new scene object primative from an axis aligned box
+    ///
+    ScenePrimative(const Box &box, uint materialId) : sceneObjectType_(SCENE_OBJECT_BOX), materialId_(materialId) {
+        sceneObjectData_.box = box;
+    }
     ///
     /// \brief determines if the ray intersects the scene object
     /// \return information about the intersection
     ///
     Intersection Intersect(const Ray &ray) const;
     ///
+    /// \brief Returns the bounds of the primative (used when building acceleration structures on the host)
+    ///
+    AABB GetBoundingBox() const {
+        static_assert (ScenePrimative::SCENE_PRIMATIVES_COUNT -1 == ScenePrimative::SCENE_OBJECT_BOX, "You must add the new scene primative type to ScenePrimative::GetBoundingBox.");
+        if (sceneObjectType_ == SCENE_OBJECT_SPHERE)
+            return sceneObjectData_.sphere.GetBoundingBox();
+        else if (sceneObjectType_ == SCENE_OBJECT_TRIANGLE)
+            return sceneObjectData_.triangle.GetBoundingBox();
+        else if (sceneObjectType_ == SCENE_OBJECT_PLANE)
+            return sceneObjectData_.plane.GetBoundingBox();
+        else if (sceneObjectType_ == SCENE_OBJECT_QUAD)
+            return sceneObjectData_.quad.GetBoundingBox();
+        else if (sceneObjectType_ == SCENE_OBJECT_BOX)
+            return sceneObjectData_.box.GetBoundingBox();
+        return AABB();
+    }
+    ///
+    /// \brief Returns the sphere stored in the primative, or nullptr if it isn't a sphere
+    ///
+    const Sphere *GetSphere() const { return sceneObjectType_ == SCENE_OBJECT_SPHERE ? &sceneObjectData_.sphere : nullptr; }
+    ///
+    /// \brief Returns the triangle stored in the primative, or nullptr if it isn't a triangle
+    ///
+    const Triangle *GetTriangle() const { return sceneObjectType_ == SCENE_OBJECT_TRIANGLE ? &sceneObjectData_.triangle : nullptr; }
+    ///
+    /// \brief Returns the plane stored in the primative, or nullptr if it isn't a plane
+    ///
+    const Plane *GetPlane() const { return sceneObjectType_ == SCENE_OBJECT_PLANE ? &sceneObjectData_.plane : nullptr; }
+    ///
+    /// \brief Returns the parallelogram stored in the primative, or nullptr if it isn't a parallelogram
+    ///
+    const Quad *GetQuad() const { return sceneObjectType_ == SCENE_OBJECT_QUAD ? &sceneObjectData_.quad : nullptr; }
+    ///
+    /// \brief Returns the box stored in the primative, or nullptr if it isn't a box
+    ///
+    const Box *GetBox() const { return sceneObjectType_ == SCENE_OBJECT_BOX ? &sceneObjectData_.box : nullptr; }
+    ///
     /// \brief Gets the id of the material associated with this primative
     ///
     uint GetMaterialId() const { return materialId_; }
@@ -162,7 +399,10 @@ private:
     ///
     enum SceneObjectType {
         SCENE_OBJECT_SPHERE = 0,
-        // SCENE_OBJECT_TRIANGLE // TODO
+        SCENE_OBJECT_TRIANGLE,
+        SCENE_OBJECT_PLANE,
+        SCENE_OBJECT_QUAD,
+        SCENE_OBJECT_BOX,
         SCENE_PRIMATIVES_COUNT
     };
     ///
@@ -182,7 +422,10 @@ private:
         SceneObjectData() {}
         // the objects that can be represented
         Sphere sphere;
-        // Triangle triangle;
+        Triangle triangle;
+        Plane plane;
+        Quad quad;
+        Box box;
     } sceneObjectData_;
     ///
     /// \brief the id of the material of the primative
@@ -18,6 +18,11 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#ifndef TRACER_SCENEPRIMATIVE_HPP
+#define TRACER_SCENEPRIMATIVE_HPP
+
+#include <limits>
+
 #include "ScenePrimative.h"
 
 ///
@@ -35,13 +40,13 @@
 
 namespace Tracer {
 
-inline Intersection Sphere::Intersect(const Ray &ray) const {
+inline Intersection Sphere::Intersect(const Ray &ray, const Vector3f &position, float radiusSquared) {
     // Solve t^2*d.d + 2*t*(o-p).d + (o-p).(o-p)-R^2 = 0
     float t;
-    const Vector3f op = position_-ray.origin;
-    const float epsilon=1.5e-2F;
+    const Vector3f op = position-ray.origin;
+    const float epsilon=1e-3F;
     const float b=op.Dot(ray.direction);
-    const float det_squared=b*b-op.Dot(op)+radius_*radius_;
+    const float det_squared=b*b-op.Dot(op)+radiusSquared;
     if (det_squared<0) return Intersection::NO_INTERSECTION(); // ray missed
     const float det = cl::sycl::sqrt(det_squared);
     // try both possible solutions and pick the one that is closer and in front of the ray
@@ -49,18 +54,141 @@ inline Intersection Sphere::Intersect(const Ray &ray) const {
         return Intersection::NO_INTERSECTION(); // ray missed
     // ray hit calculate relavent values
     Vector3f intersection=ray.origin+ray.direction*t; // ray intersection point
-    Vector3f normal=Vector3f(intersection-position_).Normalize(); // normal at intersection
+    Vector3f normal=Vector3f(intersection-position).Normalize(); // normal at intersection
+    return Intersection(t, normal, intersection);
+}
+
+inline Intersection Triangle::Intersect(const Ray &ray) const {
+    const float epsilon=1e-3F;
+    const Vector3f &direction = ray.direction;
+
+    // pick the dimension where the ray direction is largest (z), the other two (x,y) are picked to preserve the winding
+    const float absX = cl::sycl::fabs(direction.X());
+    const float absY = cl::sycl::fabs(direction.Y());
+    const float absZ = cl::sycl::fabs(direction.Z());
+    const uint kz = absX > absY ? (absX > absZ ? 0 : 2) : (absY > absZ ? 1 : 2);
+    uint kx = kz == 2 ? 0 : kz+1;
+    uint ky = kx == 2 ? 0 : kx+1;
+    if (direction[kz] < 0) {
+        const uint tmp = kx; kx = ky; ky = tmp;
+    }
+
+    // shear and scale the vertices so that the ray points straight down the z axis
+    const float sx = direction[kx]/direction[kz];
+    const float sy = direction[ky]/direction[kz];
+    const float sz = 1.F/direction[kz];
+    const Vector3f a = Vector3f(v0_ - ray.origin);
+    const Vector3f b = Vector3f(v1_ - ray.origin);
+    const Vector3f c = Vector3f(v2_ - ray.origin);
+    const float ax = a[kx] - sx*a[kz], ay = a[ky] - sy*a[kz];
+    const float bx = b[kx] - sx*b[kz], by = b[ky] - sy*b[kz];
+    const float cx = c[kx] - sx*c[kz], cy = c[ky] - sy*c[kz];
+
+    // scaled barycentric coordinates (an edge exactly hit gives exactly 0)
+    const float u = cx*by - cy*bx;
+    const float v = ax*cy - ay*cx;
+    const float w = bx*ay - by*ax;
+    if ((u<0 || v<0 || w<0) && (u>0 || v>0 || w>0))
+        return Intersection::NO_INTERSECTION(); // ray missed
+    const float det = u + v + w;
+    if (det == 0)
+        return Intersection::NO_INTERSECTION(); // ray is parallel to the triangle
+
+    // scaled hit distance, then the real one
+    const float t = (u*sz*a[kz] + v*sz*b[kz] + w*sz*c[kz]) / det;
+    if (!(t > epsilon))
+        return Intersection::NO_INTERSECTION(); // triangle is behind the ray
+
+    // ray hit calculate relavent values
+    Vector3f intersection=ray.origin+ray.direction*t; // ray intersection point
+    Vector3f normal=Vector3f(v1_-v0_).Cross(Vector3f(v2_-v0_)).Normalize(); // geometric normal
     return Intersection(t, normal, intersection);
 }
 
+inline Intersection Plane::Intersect(const Ray &ray, const Vector3f &normal, float offset) {
+    const float epsilon=1e-3F;
+    const float denominator = normal.Dot(ray.direction);
+    if (denominator == 0)
+        return Intersection::NO_INTERSECTION(); // ray is parallel to the plane
+    const float t = (offset - normal.Dot(ray.origin)) / denominator;
+    if (!(t > epsilon))
+        return Intersection::NO_INTERSECTION(); // plane is behind the ray
+    return Intersection(t, normal, ray.origin+ray.direction*t);
+}
+
+inline Intersection Quad::Intersect(const Ray &ray) const {
+    const float epsilon=1e-3F;
+    const Vector3f normal = edgeU_.Cross(edgeV_);
+    const float denominator = normal.Dot(ray.direction);
+    if (denominator == 0)
+        return Intersection::NO_INTERSECTION(); // ray is parallel to the parallelogram
+    const float t = normal.Dot(Vector3f(corner_ - ray.origin)) / denominator;
+    if (!(t > epsilon))
+        return Intersection::NO_INTERSECTION(); // parallelogram is behind the ray
+
+    // the coordinates of the hit along the edges (both in [0,1] inside the parallelogram)
+    const Vector3f intersection = ray.origin+ray.direction*t;
+    const Vector3f p = Vector3f(intersection - corner_);
+    const float inverseArea = 1 / normal.Dot(normal);
+    const float u = normal.Dot(p.Cross(edgeV_)) * inverseArea;
+    const float v = normal.Dot(edgeU_.Cross(p)) * inverseArea;
+    if (u < 0 || u > 1 || v < 0 || v > 1)
+        return Intersection::NO_INTERSECTION(); // ray missed
+    return Intersection(t, Vector3f(normal).Normalize(), intersection);
+}
+
+inline Intersection Box::Intersect(const Ray &ray) const {
+    const float epsilon=1e-3F;
+    // slab test keeping the axis the ray enters and leaves the box through
+    float tNear = -std::numeric_limits<float>::infinity(), tFar = std::numeric_limits<float>::infinity();
+    uint nearAxis = 0, farAxis = 0;
+    for (uint axis=0; axis<3; axis++) {
+        if (ray.direction[axis] == 0) {
+            if (ray.origin[axis] < min_[axis] || ray.origin[axis] > max_[axis])
+                return Intersection::NO_INTERSECTION(); // ray is parallel to and outside of the slab
+            continue;
+        }
+        const float inverse = 1 / ray.direction[axis];
+        float t0 = (min_[axis] - ray.origin[axis]) * inverse;
+        float t1 = (max_[axis] - ray.origin[axis]) * inverse;
+        if (t0 > t1) {
+            const float tmp = t0; t0 = t1; t1 = tmp;
+        }
+        if (t0 > tNear) { tNear = t0; nearAxis = axis; }
+        if (t1 < tFar) { tFar = t1; farAxis = axis; }
+    }
+    if (tNear > tFar)
+        return Intersection::NO_INTERSECTION(); // ray missed
+
+    // the closest of entering and leaving the box that is in front of the ray
+    Vector3f normal;
+    float t;
+    if (tNear > epsilon) {
+        t = tNear;
+        normal[nearAxis] = ray.direction[nearAxis] < 0 ? 1.F : -1.F;
+    } else if (tFar > epsilon) {
+        t = tFar;
+        normal[farAxis] = ray.direction[farAxis] < 0 ? -1.F : 1.F;
+    } else {
+        return Intersection::NO_INTERSECTION(); // box is behind the ray
+    }
+    return Intersection(t, normal, ray.origin+ray.direction*t);
+}
+
 inline Intersection ScenePrimative::Intersect(const Ray &ray) const {
     // forgeting to add a new primative to Intersect could make your life suck, now it cannot happen
-    static_assert (ScenePrimative::SCENE_PRIMATIVES_COUNT -1 == ScenePrimative::SCENE_OBJECT_SPHERE, "You must add the new scene primative type to ScenePrimative::Intersect.");
+    static_assert (ScenePrimative::SCENE_PRIMATIVES_COUNT -1 == ScenePrimative::SCENE_OBJECT_BOX, "You must add the new scene primative type to ScenePrimative::Intersect.");
 
     if (sceneObjectType_ == SCENE_OBJECT_SPHERE)
         return sceneObjectData_.sphere.Intersect(ray);
-    // else if (sceneObjectType == SCENE_OBJECT_TRIANGLE)
-    //     return sceneObjectData.triangle.Intersect(ray);
+    else if (sceneObjectType_ == SCENE_OBJECT_TRIANGLE)
+        return sceneObjectData_.triangle.Intersect(ray);
+    else if (sceneObjectType_ == SCENE_OBJECT_PLANE)
+        return sceneObjectData_.plane.Intersect(ray);
+    else if (sceneObjectType_ == SCENE_OBJECT_QUAD)
+        return sceneObjectData_.quad.Intersect(ray);
+    else if (sceneObjectType_ == SCENE_OBJECT_BOX)
+        return sceneObjectData_.box.Intersect(ray);
 
     // this line should never be reached... (see above assertion)
     // and no execptions on GPU unfortunately...
@@ -68,3 +196,5 @@ inline Intersection ScenePrimative::Intersect(const Ray &ray) const {
 }
 
 } // namespace Tracer
+
+#endif // TRACER_SCENEPRIMATIVE_HPP
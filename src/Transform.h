@@ -0,0 +1,160 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_TRANSFORM_H
+#define TRACER_TRANSFORM_H
+
+#include <SYCL/sycl.hpp>
+#include "AABB.h"
+#include "Common.h"
+#include "Vector.h"
+
+namespace Tracer {
+
+///
+/// \brief An affine transform stored as a row major 3x4 matrix (the last row of a 4x4 matrix is always 0 0 0 1)
+/// \note plain floats are used so that the transform can be copied to the SYCL device as-is
+///
+class Transform {
+public:
+    ///
+    /// \brief Creates the identity transform
+    ///
+    Transform() : m_{1,0,0,0, 0,1,0,0, 0,0,1,0} {}
+    Transform(float m00, float m01, float m02, float m03,
+              float m10, float m11, float m12, float m13,
+              float m20, float m21, float m22, float m23)
+        : m_{m00,m01,m02,m03, m10,m11,m12,m13, m20,m21,m22,m23} {}
+    ///
+    /// \brief Creates a transform that moves things by offset
+    ///
+    static Transform Translate(const Vector3f &offset) {
+        return Transform(1,0,0,offset.X(), 0,1,0,offset.Y(), 0,0,1,offset.Z());
+    }
+    ///
+    /// \brief Creates a transform that scales things along each axis
+    ///
+    static Transform Scale(const Vector3f &scale) {
+        return Transform(scale.X(),0,0,0, 0,scale.Y(),0,0, 0,0,scale.Z(),0);
+    }
+    ///
+    /// \brief Creates a transform that rotates things around an axis (right handed)
+    /// \param radians the angle to rotate
+    ///
+    static Transform Rotate(const Vector3f &axis, float radians) {
+        const Vector3f a = Vector3f(axis).Normalize();
+        const float c = cl::sycl::cos(radians), s = cl::sycl::sin(radians), t = 1 - c;
+        return Transform(t*a.X()*a.X() + c,         t*a.X()*a.Y() - s*a.Z(), t*a.X()*a.Z() + s*a.Y(), 0,
+                         t*a.X()*a.Y() + s*a.Z(), t*a.Y()*a.Y() + c,         t*a.Y()*a.Z() - s*a.X(), 0,
+                         t*a.X()*a.Z() - s*a.Y(), t*a.Y()*a.Z() + s*a.X(), t*a.Z()*a.Z() + c,         0);
+    }
+    ///
+    /// \brief Gets an element of the matrix
+    ///
+    float operator()(uint row, uint column) const { return m_[row*4+column]; }
+    ///
+    /// \brief Combines two transforms (the rhs is applied first)
+    ///
+    Transform operator*(const Transform &b) const {
+        Transform result;
+        for (uint row=0; row<3; row++) {
+            for (uint column=0; column<4; column++) {
+                float value = column == 3 ? m_[row*4+3] : 0;
+                for (uint i=0; i<3; i++)
+                    value += m_[row*4+i] * b.m_[i*4+column];
+                result.m_[row*4+column] = value;
+            }
+        }
+        return result;
+    }
+    ///
+    /// \brief Returns the inverse of the transform (the transform must be invertible)
+    ///
+    Transform Inverse() const {
+        // invert the 3x3 part using the adjugate, then the translation is just -inverse*translation
+        const float a = m_[0], b = m_[1], c = m_[2];
+        const float d = m_[4], e = m_[5], f = m_[6];
+        const float g = m_[8], h = m_[9], i = m_[10];
+        const float invDet = 1 / (a*(e*i - f*h) - b*(d*i - f*g) + c*(d*h - e*g));
+        Transform result((e*i - f*h)*invDet, (c*h - b*i)*invDet, (b*f - c*e)*invDet, 0,
+                         (f*g - d*i)*invDet, (a*i - c*g)*invDet, (c*d - a*f)*invDet, 0,
+                         (d*h - e*g)*invDet, (b*g - a*h)*invDet, (a*e - b*d)*invDet, 0);
+        const Vector3f translation = result.TransformVector(Vector3f(m_[3], m_[7], m_[11]));
+        result.m_[3] = -translation.X();
+        result.m_[7] = -translation.Y();
+        result.m_[11] = -translation.Z();
+        return result;
+    }
+    ///
+    /// \brief Transforms a position
+    ///
+    Vector3f TransformPoint(const Vector3f &p) const {
+        return Vector3f(m_[0]*p.X() + m_[1]*p.Y() + m_[2]*p.Z() + m_[3],
+                        m_[4]*p.X() + m_[5]*p.Y() + m_[6]*p.Z() + m_[7],
+                        m_[8]*p.X() + m_[9]*p.Y() + m_[10]*p.Z() + m_[11]);
+    }
+    ///
+    /// \brief Transforms a direction (translation is ignored)
+    ///
+    Vector3f TransformVector(const Vector3f &v) const {
+        return Vector3f(m_[0]*v.X() + m_[1]*v.Y() + m_[2]*v.Z(),
+                        m_[4]*v.X() + m_[5]*v.Y() + m_[6]*v.Z(),
+                        m_[8]*v.X() + m_[9]*v.Y() + m_[10]*v.Z());
+    }
+    ///
+    /// \brief Transforms a direction by the transpose of the matrix.
+    /// Normals must be transformed by the inverse transpose, so calling this on the inverse transform transforms a normal.
+    ///
+    Vector3f TransformVectorTransposed(const Vector3f &v) const {
+        return Vector3f(m_[0]*v.X() + m_[4]*v.Y() + m_[8]*v.Z(),
+                        m_[1]*v.X() + m_[5]*v.Y() + m_[9]*v.Z(),
+                        m_[2]*v.X() + m_[6]*v.Y() + m_[10]*v.Z());
+    }
+    ///
+    /// \brief Returns the box that contains the transformed box
+    ///
+    AABB TransformBoundingBox(const AABB &box) const {
+        AABB result;
+        if (box.IsEmpty()) return result;
+        for (uint corner=0; corner<8; corner++) {
+            result.Grow(TransformPoint(Vector3f(corner & 1 ? box.Max().X() : box.Min().X(),
+                                                corner & 2 ? box.Max().Y() : box.Min().Y(),
+                                                corner & 4 ? box.Max().Z() : box.Min().Z())));
+        }
+        return result;
+    }
+    bool operator==(const Transform &b) const {
+        for (uint i=0; i<12; i++)
+            if (!FLOAT_EQ(m_[i], b.m_[i]))
+                return false;
+        return true;
+    }
+    bool operator!=(const Transform &b) const { return !((*this) == b); }
+private:
+    ///
+    /// \brief the rows of the matrix
+    ///
+    float m_[12];
+};
+
+} // namespace Tracer
+
+#endif // TRACER_TRANSFORM_H
@@ -0,0 +1,126 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "VoxelDAG.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Tracer {
+
+const uint VoxelDAG::EMPTY_NODE;
+const uint VoxelDAG::LEAF_SIZE;
+
+void VoxelDAG::Update(const VoxelWorld &world) {
+    grid_ = world.GetGrid();
+    // only copy the columns whose chunk changed
+    std::vector<DirtyRanges::Range> changedColumns;
+    const std::vector<uint> &columns = world.GetChunks();
+    if (chunks_.size() != columns.size() || !world.GetChunkChanges().GetSince(worldChunkStamp_, &changedColumns)) {
+        chunks_ = columns;
+        chunkChanges_.AddAll(chunks_.size());
+    } else {
+        for (const DirtyRanges::Range &range : changedColumns) {
+            std::copy(columns.begin() + range.begin, columns.begin() + range.end, chunks_.begin() + range.begin);
+            chunkChanges_.Add(range.begin, range.end);
+        }
+    }
+    worldChunkStamp_ = world.GetChunkChanges().GetStamp();
+
+    // rebuild from scratch once the nodes of changed chunks outnumber the nodes in use
+    const uint64 size = nodes_.size() + leaves_.size();
+    const std::vector<uint64> &revisions = world.GetChunkRevisions();
+    if (size > 2 * builtSize_ + 1024 || revisions.size() < chunkRevisions_.size()) {
+        Clear();
+        chunkRevisions_.clear();
+        nodeChanges_.AddAll(0);
+        leafChanges_.AddAll(0);
+    }
+
+    sectionRoots_.resize(revisions.size() * VoxelWorld::SECTIONS_PER_CHUNK, EMPTY_NODE);
+    chunkRevisions_.resize(revisions.size(), 0);
+    const bool rebuilt = nodes_.empty() && leaves_.empty();
+    for (uint chunk=0; chunk<revisions.size(); chunk++) {
+        if (chunkRevisions_[chunk] == revisions[chunk]) continue;
+        BuildChunk(world, chunk);
+        chunkRevisions_[chunk] = revisions[chunk];
+    }
+    if (rebuilt)
+        builtSize_ = nodes_.size() + leaves_.size();
+}
+
+void VoxelDAG::BuildChunk(const VoxelWorld &world, uint chunk) {
+    const uint8 *chunkBlocks = world.GetBlocks().data() + static_cast<uint64>(chunk) * VoxelWorld::CHUNK_BLOCKS;
+    const uint sectionMask = world.GetSectionMasks()[chunk];
+    for (uint section=0; section<VoxelWorld::SECTIONS_PER_CHUNK; section++) {
+        sectionRoots_[chunk * VoxelWorld::SECTIONS_PER_CHUNK + section] =
+                sectionMask >> section & 1 ? BuildNode(chunkBlocks, 0, section * VoxelWorld::SECTION_SIZE, 0, VoxelWorld::SECTION_SIZE) : EMPTY_NODE;
+    }
+    sectionRootChanges_.Add(chunk * VoxelWorld::SECTIONS_PER_CHUNK, (chunk + 1) * VoxelWorld::SECTIONS_PER_CHUNK);
+}
+
+uint VoxelDAG::BuildNode(const uint8 *chunkBlocks, uint x, uint y, uint z, uint size) {
+    const uint half = size / 2;
+    VoxelDAGNode node;
+    bool empty = true;
+    for (uint i=0; i<8; i++) {
+        const uint childX = x + (i & 1) * half;
+        const uint childY = y + (i >> 1 & 1) * half;
+        const uint childZ = z + (i >> 2 & 1) * half;
+        node.child[i] = half == LEAF_SIZE ? BuildLeaf(chunkBlocks, childX, childY, childZ) : BuildNode(chunkBlocks, childX, childY, childZ, half);
+        empty = empty && node.child[i] == EMPTY_NODE;
+    }
+    if (empty)
+        return EMPTY_NODE;
+
+    // 16 wide nodes use the first map, 8 wide the second, and 4 wide the third
+    std::unordered_map<VoxelDAGNode,uint,NodeHash> &ids = nodeIds_[size == 16 ? 0 : size == 8 ? 1 : 2];
+    const auto found = ids.emplace(node, static_cast<uint>(nodes_.size()));
+    if (found.second)
+        nodes_.push_back(node);
+    return found.first->second;
+}
+
+uint VoxelDAG::BuildLeaf(const uint8 *chunkBlocks, uint x, uint y, uint z) {
+    VoxelDAGLeaf leaf;
+    for (uint i=0; i<8; i++)
+        leaf.block[i] = chunkBlocks[VoxelWorld::BlockIndex(x + (i & 1), y + (i >> 1 & 1), z + (i >> 2 & 1))];
+    uint64 key;
+    static_assert(sizeof(key) == sizeof(leaf), "A leaf must fit in its 64 bit key");
+    std::memcpy(&key, &leaf, sizeof(key));
+    if (key == 0)
+        return EMPTY_NODE;
+
+    const auto found = leafIds_.emplace(key, static_cast<uint>(leaves_.size()));
+    if (found.second)
+        leaves_.push_back(leaf);
+    return found.first->second;
+}
+
+void VoxelDAG::Clear() {
+    nodes_.clear();
+    leaves_.clear();
+    for (std::unordered_map<VoxelDAGNode,uint,NodeHash> &ids : nodeIds_)
+        ids.clear();
+    leafIds_.clear();
+}
+
+} // namespace Tracer
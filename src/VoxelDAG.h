@@ -0,0 +1,199 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_VOXELDAG_H
+#define TRACER_VOXELDAG_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "Common.h"
+#include "DirtyRanges.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+#include "VoxelWorld.h"
+
+namespace Tracer {
+
+///
+/// \brief An interior node of a VoxelDAG (a cube of blocks split in eight).  This is what is copied to the SYCL device.
+/// Child i is the octant at x = i&1, y = (i>>1)&1, z = (i>>2)&1.  Children of the smallest nodes are leaves.
+///
+struct VoxelDAGNode {
+    uint child[8];
+
+    bool operator==(const VoxelDAGNode &b) const {
+        for (uint i=0; i<8; i++)
+            if (child[i] != b.child[i]) return false;
+        return true;
+    }
+};
+
+///
+/// \brief The 2x2x2 blocks at the bottom of a VoxelDAG (in the same order as the children of a VoxelDAGNode)
+///
+struct VoxelDAGLeaf {
+    uint8 block[8];
+};
+
+///
+/// \brief The blocks of a VoxelWorld stored as a sparse voxel DAG (a sparse octree where identical subtrees are stored once).
+///
+/// Every 16x16x16 section of the world's stored chunks is an octree (16, 8, then 4 blocks wide nodes, then 2x2x2 leaves).
+/// Empty subtrees aren't stored and identical subtrees anywhere in the world are stored once, so solid ground, identical
+/// buildings, and repeated terrain cost almost nothing.  Only the DAG is copied to the SYCL device, not the blocks.
+///
+/// Rays walk the world's sections the same way as VoxelWorld::Intersect, but inside a section they skip the biggest
+/// empty node around them instead of stepping block by block.
+///
+class VoxelDAG {
+public:
+    ///
+    /// \brief Marks an empty child, or a section with no blocks
+    ///
+    static const uint EMPTY_NODE = 0xFFFFFFFF;
+    ///
+    /// \brief The size of the leaves in blocks along every axis
+    ///
+    static const uint LEAF_SIZE = 2;
+    ///
+    /// \brief Brings the DAG up to date with the world, only rebuilding the chunks that changed since the last update.
+    /// Nodes of changed chunks are left behind until they outnumber the nodes in use, then the whole DAG is rebuilt.
+    ///
+    void Update(const VoxelWorld &world);
+    ///
+    /// \brief Gets the position and size of the world (see VoxelWorld::GetGrid())
+    ///
+    const VoxelGrid &GetGrid() const { return grid_; }
+    ///
+    /// \brief Gets the chunk of every column of the world (see VoxelWorld::GetChunks())
+    ///
+    const std::vector<uint> &GetChunks() const { return chunks_; }
+    ///
+    /// \brief Gets the root node of every section of every stored chunk (SECTIONS_PER_CHUNK per chunk, EMPTY_NODE if it is empty)
+    ///
+    const std::vector<uint> &GetSectionRoots() const { return sectionRoots_; }
+    ///
+    /// \brief Gets the interior nodes
+    ///
+    const std::vector<VoxelDAGNode> &GetNodes() const { return nodes_; }
+    ///
+    /// \brief Gets the leaves
+    ///
+    const std::vector<VoxelDAGLeaf> &GetLeaves() const { return leaves_; }
+    ///
+    /// \brief Gets the ranges of the chunks, section roots, nodes, and leaves that changed (see DirtyRanges)
+    ///
+    const DirtyRanges &GetChunkChanges() const { return chunkChanges_; }
+    const DirtyRanges &GetSectionRootChanges() const { return sectionRootChanges_; }
+    const DirtyRanges &GetNodeChanges() const { return nodeChanges_; }
+    const DirtyRanges &GetLeafChanges() const { return leafChanges_; }
+    ///
+    /// \brief Returns how many bytes of the DAG are copied to the SYCL device
+    ///
+    uint64 GetDeviceSize() const {
+        return chunks_.size() * sizeof(uint) + sectionRoots_.size() * sizeof(uint) +
+                nodes_.size() * sizeof(VoxelDAGNode) + leaves_.size() * sizeof(VoxelDAGLeaf);
+    }
+    ///
+    /// \brief Finds the closest block the ray hits, see VoxelWorld::Intersect (intended to be run on the SYCL device)
+    ///
+    static Intersection Intersect(const Ray &ray, const VoxelGrid &grid, const uint *chunks, const uint *sectionRoots, const VoxelDAGNode *nodes,
+                                  const VoxelDAGLeaf *leaves, const uint *blockMaterials, float maxDistance, uint *materialId);
+private:
+    ///
+    /// \brief Hashes the children of a node
+    ///
+    struct NodeHash {
+        uint64 operator()(const VoxelDAGNode &node) const {
+            uint64 hash = 14695981039346656037UL;
+            for (uint i=0; i<8; i++)
+                hash = (hash ^ node.child[i]) * 1099511628211UL;
+            return hash;
+        }
+    };
+    ///
+    /// \brief Builds the sections of a stored chunk of the world
+    ///
+    void BuildChunk(const VoxelWorld &world, uint chunk);
+    ///
+    /// \brief Builds (or finds the identical) node of the given size whose smallest corner is the block (x,y,z) of the chunk
+    ///
+    uint BuildNode(const uint8 *chunkBlocks, uint x, uint y, uint z, uint size);
+    ///
+    /// \brief Builds (or finds the identical) leaf whose smallest corner is the block (x,y,z) of the chunk
+    ///
+    uint BuildLeaf(const uint8 *chunkBlocks, uint x, uint y, uint z);
+    ///
+    /// \brief Removes every node and leaf
+    ///
+    void Clear();
+    ///
+    /// \brief See GetGrid()
+    ///
+    VoxelGrid grid_ = { Vector3f(), 1, 0, 0 };
+    ///
+    /// \brief See GetChunks()
+    ///
+    std::vector<uint> chunks_;
+    ///
+    /// \brief See GetSectionRoots()
+    ///
+    std::vector<uint> sectionRoots_;
+    ///
+    /// \brief See GetNodes()
+    ///
+    std::vector<VoxelDAGNode> nodes_;
+    ///
+    /// \brief See GetLeaves()
+    ///
+    std::vector<VoxelDAGLeaf> leaves_;
+    ///
+    /// \brief See GetChunkChanges(), GetSectionRootChanges(), GetNodeChanges(), and GetLeafChanges().  Nodes and leaves are
+    /// only ever added (the device's copy grows to them) until the DAG is rebuilt.
+    ///
+    DirtyRanges chunkChanges_;
+    DirtyRanges sectionRootChanges_;
+    DirtyRanges nodeChanges_;
+    DirtyRanges leafChanges_;
+    ///
+    /// \brief The changes of the world's chunks that chunks_ is up to date with
+    ///
+    DirtyRanges::Stamp worldChunkStamp_;
+    ///
+    /// \brief Finds identical nodes (one map for each node size since their children mean different things) and leaves
+    ///
+    std::unordered_map<VoxelDAGNode,uint,NodeHash> nodeIds_[3];
+    std::unordered_map<uint64,uint> leafIds_;
+    ///
+    /// \brief The revision of every stored chunk the DAG was built from (see VoxelWorld::GetChunkRevisions())
+    ///
+    std::vector<uint64> chunkRevisions_;
+    ///
+    /// \brief The number of nodes and leaves right after the DAG was last built from scratch
+    ///
+    uint64 builtSize_ = 0;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_VOXELDAG_H
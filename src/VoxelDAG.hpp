@@ -0,0 +1,142 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_VOXELDAG_HPP
+#define TRACER_VOXELDAG_HPP
+
+#include <limits>
+
+#include "VoxelDAG.h"
+#include "VoxelWorld.hpp"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+///
+/// \brief Finds the closest block in the sections of a VoxelDAG, see VoxelWorld::Traverse
+///
+struct ClosestDAGBlockIntersector {
+    ClosestDAGBlockIntersector(const Ray &ray, const uint *sectionRoots, const VoxelDAGNode *nodes, const VoxelDAGLeaf *leaves, const uint *blockMaterials)
+        : ray(ray), sectionRoots(sectionRoots), nodes(nodes), leaves(leaves), blockMaterials(blockMaterials),
+          bestIntersection(Intersection::NO_INTERSECTION()), materialId(0) {}
+    bool Intersect(uint chunk, const int *section, float tStart, float tEnd, int enteredAxis, const Vector3f &origin, const Vector3f &direction) {
+        const uint root = sectionRoots[chunk * VoxelWorld::SECTIONS_PER_CHUNK + static_cast<uint>(section[1])];
+        if (root == VoxelDAG::EMPTY_NODE)
+            return false;
+
+        const int sectionSize = static_cast<int>(VoxelWorld::SECTION_SIZE);
+        const int sectionMin[3] = { section[0] * sectionSize, section[1] * sectionSize, section[2] * sectionSize };
+        // the block the ray is in (within the section)
+        int cell[3];
+        for (uint axis=0; axis<3; axis++) {
+            cell[axis] = static_cast<int>(cl::sycl::floor(origin[axis] + direction[axis] * tStart)) - sectionMin[axis];
+            cell[axis] = cell[axis] < 0 ? 0 : cell[axis] >= sectionSize ? sectionSize - 1 : cell[axis];
+        }
+        float t = tStart;
+        int axis = enteredAxis;
+        while (true) {
+            // go down to the block, or to the biggest empty node the block is in
+            uint node = root;
+            int size = sectionSize;
+            uint8 block = VoxelWorld::AIR;
+            while (true) {
+                size /= 2;
+                const uint octant = (cell[0] / size & 1) | (cell[1] / size & 1) << 1 | (cell[2] / size & 1) << 2;
+                const uint child = nodes[node].child[octant];
+                if (child == VoxelDAG::EMPTY_NODE)
+                    break;
+                if (size == static_cast<int>(VoxelDAG::LEAF_SIZE)) {
+                    block = leaves[child].block[(cell[0] & 1) | (cell[1] & 1) << 1 | (cell[2] & 1) << 2];
+                    size = 1;
+                    break;
+                }
+                node = child;
+            }
+            if (block != VoxelWorld::AIR && axis != -1) {
+                // the face the ray entered the block through
+                Vector3f normal;
+                normal[axis] = direction[axis] < 0 ? 1.F : -1.F;
+                bestIntersection = Intersection(t, normal, ray.origin + ray.direction * t);
+                materialId = blockMaterials[block];
+                return true;
+            }
+
+            // leave the empty node (or block) through the face the ray reaches first
+            int nodeMin[3];
+            float tExit = std::numeric_limits<float>::infinity();
+            uint exitAxis = 0;
+            for (uint a=0; a<3; a++) {
+                nodeMin[a] = cell[a] / size * size;
+                if (direction[a] == 0) continue;
+                const int boundary = sectionMin[a] + (direction[a] < 0 ? nodeMin[a] : nodeMin[a] + size);
+                const float tBoundary = (boundary - origin[a]) / direction[a];
+                if (tBoundary < tExit) {
+                    tExit = tBoundary;
+                    exitAxis = a;
+                }
+            }
+            if (tExit > tEnd)
+                return false;
+            for (uint a=0; a<3; a++) {
+                if (a == exitAxis) {
+                    cell[a] = direction[a] < 0 ? nodeMin[a] - 1 : nodeMin[a] + size;
+                } else {
+                    // the exit point is on the node's face, keep rounding from moving the ray off of it
+                    const int c = static_cast<int>(cl::sycl::floor(origin[a] + direction[a] * tExit)) - sectionMin[a];
+                    cell[a] = c < nodeMin[a] ? nodeMin[a] : c >= nodeMin[a] + size ? nodeMin[a] + size - 1 : c;
+                }
+            }
+            if (cell[exitAxis] < 0 || cell[exitAxis] >= sectionSize)
+                return false;
+            t = tExit;
+            axis = static_cast<int>(exitAxis);
+        }
+    }
+    const Ray &ray;
+    const uint *sectionRoots;
+    const VoxelDAGNode *nodes;
+    const VoxelDAGLeaf *leaves;
+    const uint *blockMaterials;
+    Intersection bestIntersection;
+    uint materialId;
+};
+
+inline Intersection VoxelDAG::Intersect(const Ray &ray, const VoxelGrid &grid, const uint *chunks, const uint *sectionRoots, const VoxelDAGNode *nodes,
+                                        const VoxelDAGLeaf *leaves, const uint *blockMaterials, float maxDistance, uint *materialId) {
+    ClosestDAGBlockIntersector intersector(ray, sectionRoots, nodes, leaves, blockMaterials);
+    VoxelWorld::Traverse(ray, grid, chunks, maxDistance, &intersector);
+    if (intersector.bestIntersection != Intersection::NO_INTERSECTION())
+        *materialId = intersector.materialId;
+    return intersector.bestIntersection;
+}
+
+} // namespace Tracer
+
+#endif // TRACER_VOXELDAG_HPP
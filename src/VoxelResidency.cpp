@@ -0,0 +1,111 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "VoxelResidency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace Tracer {
+
+VoxelResidency::VoxelResidency(const ChunkLoader &loader, uint radius, const Vector3f &origin, float blockSize, uint maxLoadsPerUpdate)
+    : loader_(loader), radius_(radius), origin_(origin), blockSize_(blockSize), maxLoadsPerUpdate_(maxLoadsPerUpdate),
+      blocks_(VoxelWorld::CHUNK_BLOCKS) {}
+
+uint VoxelResidency::Update(const Vector3f &eye, VoxelWorld *world) {
+    const int width = static_cast<int>(2 * radius_ + 1);
+    const float chunkSize = VoxelWorld::CHUNK_WIDTH * blockSize_;
+    const int windowX = static_cast<int>(std::floor((eye.X() - origin_.X()) / chunkSize)) - static_cast<int>(radius_);
+    const int windowZ = static_cast<int>(std::floor((eye.Z() - origin_.Z()) / chunkSize)) - static_cast<int>(radius_);
+
+    if (!placed_ || world->GetGrid().chunkCountX != static_cast<uint>(width) || world->GetGrid().chunkCountZ != static_cast<uint>(width)) {
+        // start over with an empty window (keeping the block materials)
+        const std::vector<uint> blockMaterials = world->GetBlockMaterials();
+        *world = VoxelWorld(static_cast<uint>(width), static_cast<uint>(width), origin_ + Vector3f(windowX * chunkSize, 0, windowZ * chunkSize), blockSize_);
+        for (uint block=0; block<blockMaterials.size(); block++)
+            world->SetBlockMaterial(static_cast<uint8>(block), blockMaterials[block]);
+        resident_.assign(static_cast<uint64>(width * width), 0);
+        placed_ = true;
+    } else if (windowX != windowX_ || windowZ != windowZ_) {
+        // keep the chunks the old and new windows share
+        const int shiftX = windowX - windowX_;
+        const int shiftZ = windowZ - windowZ_;
+        world->ShiftChunks(shiftX, shiftZ);
+        std::vector<uint8> resident(resident_.size(), 0);
+        for (int z=0; z<width; z++) {
+            for (int x=0; x<width; x++) {
+                const int oldX = x + shiftX;
+                const int oldZ = z + shiftZ;
+                if (oldX >= 0 && oldZ >= 0 && oldX < width && oldZ < width)
+                    resident[static_cast<uint>(z * width + x)] = resident_[static_cast<uint>(oldZ * width + oldX)];
+            }
+        }
+        resident_ = std::move(resident);
+    }
+    windowX_ = windowX;
+    windowZ_ = windowZ;
+
+    // remove the chunks in the corners of the window (outside of the radius) and find the chunks to load
+    const int radius = static_cast<int>(radius_);
+    std::vector<std::pair<int,uint>> toLoad;
+    for (int z=0; z<width; z++) {
+        for (int x=0; x<width; x++) {
+            const uint i = static_cast<uint>(z * width + x);
+            const int distance = (x - radius) * (x - radius) + (z - radius) * (z - radius);
+            if (distance > radius * radius) {
+                if (resident_[i])
+                    world->SetChunk(static_cast<uint>(x), static_cast<uint>(z), nullptr);
+                resident_[i] = 0;
+            } else if (!resident_[i]) {
+                toLoad.push_back(std::make_pair(distance, i));
+            }
+        }
+    }
+
+    // closest first
+    std::sort(toLoad.begin(), toLoad.end());
+    if (maxLoadsPerUpdate_ != 0 && toLoad.size() > maxLoadsPerUpdate_)
+        toLoad.resize(maxLoadsPerUpdate_);
+    for (const std::pair<int,uint> &chunk : toLoad) {
+        const uint x = chunk.second % static_cast<uint>(width);
+        const uint z = chunk.second / static_cast<uint>(width);
+        const bool hasBlocks = loader_(windowX_ + static_cast<int>(x), windowZ_ + static_cast<int>(z), blocks_.data());
+        world->SetChunk(x, z, hasBlocks ? blocks_.data() : nullptr);
+        resident_[chunk.second] = 1;
+    }
+    return static_cast<uint>(toLoad.size());
+}
+
+bool VoxelResidency::IsResident(int chunkX, int chunkZ) const {
+    const int width = static_cast<int>(2 * radius_ + 1);
+    const int x = chunkX - windowX_;
+    const int z = chunkZ - windowZ_;
+    if (!placed_ || x < 0 || z < 0 || x >= width || z >= width)
+        return false;
+    return resident_[static_cast<uint>(z * width + x)] != 0;
+}
+
+uint VoxelResidency::GetResidentCount() const {
+    return static_cast<uint>(std::count(resident_.begin(), resident_.end(), 1));
+}
+
+} // namespace Tracer
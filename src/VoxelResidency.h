@@ -0,0 +1,99 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_VOXELRESIDENCY_H
+#define TRACER_VOXELRESIDENCY_H
+
+#include <functional>
+#include <vector>
+
+#include "Common.h"
+#include "Vector.h"
+#include "VoxelWorld.h"
+
+namespace Tracer {
+
+///
+/// \brief Streams the chunks of a world too big to keep in memory into a VoxelWorld around the camera.
+///
+/// The VoxelWorld is a window of (2*radius+1)^2 chunks that follows the eye of the camera a whole chunk at a time.
+/// Chunks within radius chunks of the eye's chunk are loaded (closest first) and the rest are removed, so the memory used
+/// on the host and (through the scene's VoxelDAG) on the SYCL device is bounded by the radius however big the world is.
+///
+class VoxelResidency {
+public:
+    ///
+    /// \brief Loads the blocks of a chunk of the world (its x and z in the grid of every chunk of the world)
+    /// \return false if the chunk has no blocks (blocks is left untouched) otherwise fills the VoxelWorld::CHUNK_BLOCKS blocks
+    ///
+    typedef std::function<bool(int chunkX, int chunkZ, uint8 *blocks)> ChunkLoader;
+    ///
+    /// \param loader loads chunks as they come within the radius
+    /// \param radius how far (in chunks) from the eye's chunk chunks are kept
+    /// \param origin where the corner of block (0,0,0) of chunk (0,0) with the smallest values is in the scene
+    /// \param blockSize the length of the edge of a block in the scene
+    /// \param maxLoadsPerUpdate the most chunks loaded by an Update() (0 for no limit), spreads loading across frames
+    ///
+    VoxelResidency(const ChunkLoader &loader, uint radius, const Vector3f &origin = Vector3f(), float blockSize = 1, uint maxLoadsPerUpdate = 0);
+    ///
+    /// \brief Moves the window of the world to the eye and loads and removes chunks to match
+    /// The block materials of the world are kept.
+    /// \return the number of chunks loaded
+    ///
+    uint Update(const Vector3f &eye, VoxelWorld *world);
+    ///
+    /// \brief Returns true if the chunk (in the grid of every chunk of the world) is loaded
+    ///
+    bool IsResident(int chunkX, int chunkZ) const;
+    ///
+    /// \brief Returns the number of loaded chunks
+    ///
+    uint GetResidentCount() const;
+private:
+    ///
+    /// \brief See VoxelResidency()
+    ///
+    ChunkLoader loader_;
+    uint radius_;
+    Vector3f origin_;
+    float blockSize_;
+    uint maxLoadsPerUpdate_;
+    ///
+    /// \brief The chunk (in the grid of every chunk of the world) at the corner of the window with the smallest values
+    ///
+    int windowX_ = 0, windowZ_ = 0;
+    ///
+    /// \brief True once the window has been placed
+    ///
+    bool placed_ = false;
+    ///
+    /// \brief If every chunk of the window is loaded (x + z * window width)
+    ///
+    std::vector<uint8> resident_;
+    ///
+    /// \brief Where chunks are loaded to before they are copied into the world
+    ///
+    std::vector<uint8> blocks_;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_VOXELRESIDENCY_H
@@ -0,0 +1,156 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "VoxelWorld.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Tracer {
+
+const uint VoxelWorld::CHUNK_WIDTH;
+const uint VoxelWorld::CHUNK_HEIGHT;
+const uint VoxelWorld::CHUNK_BLOCKS;
+const uint VoxelWorld::SECTION_SIZE;
+const uint VoxelWorld::SECTIONS_PER_CHUNK;
+const uint8 VoxelWorld::AIR;
+const uint VoxelWorld::EMPTY_CHUNK;
+
+VoxelWorld::VoxelWorld(uint chunkCountX, uint chunkCountZ, const Vector3f &origin, float blockSize)
+    : chunks_(chunkCountX * chunkCountZ, EMPTY_CHUNK), blockMaterials_(256, 0) {
+    grid_.origin = origin;
+    grid_.blockSize = blockSize;
+    grid_.chunkCountX = chunkCountX;
+    grid_.chunkCountZ = chunkCountZ;
+}
+
+void VoxelWorld::SetBlock(uint x, uint y, uint z, uint8 block) {
+    if (x >= grid_.chunkCountX * CHUNK_WIDTH || y >= CHUNK_HEIGHT || z >= grid_.chunkCountZ * CHUNK_WIDTH)
+        throw std::out_of_range("Block is outside of the voxel world");
+    if (block == AIR && chunks_[z / CHUNK_WIDTH * grid_.chunkCountX + x / CHUNK_WIDTH] == EMPTY_CHUNK)
+        return;
+    const uint chunk = StoreChunk(x / CHUNK_WIDTH, z / CHUNK_WIDTH);
+
+    uint8 &stored = blocks_[static_cast<uint64>(chunk) * CHUNK_BLOCKS + BlockIndex(x % CHUNK_WIDTH, y, z % CHUNK_WIDTH)];
+    const uint section = y / SECTION_SIZE;
+    uint &sectionBlockCount = sectionBlockCounts_[chunk * SECTIONS_PER_CHUNK + section];
+    if (stored == AIR && block != AIR)
+        sectionBlockCount++;
+    else if (stored != AIR && block == AIR)
+        sectionBlockCount--;
+    stored = block;
+    chunkRevisions_[chunk] = ++revision_;
+
+    if (sectionBlockCount == 0)
+        sectionMasks_[chunk] &= ~(1U << section);
+    else
+        sectionMasks_[chunk] |= 1U << section;
+}
+
+void VoxelWorld::SetChunk(uint chunkX, uint chunkZ, const uint8 *blocks) {
+    if (chunkX >= grid_.chunkCountX || chunkZ >= grid_.chunkCountZ)
+        throw std::out_of_range("Chunk is outside of the voxel world");
+    uint &column = chunks_[chunkZ * grid_.chunkCountX + chunkX];
+    if (blocks == nullptr) {
+        if (column != EMPTY_CHUNK) {
+            RemoveChunk(column);
+            chunkChanges_.Add(chunkZ * grid_.chunkCountX + chunkX);
+        }
+        column = EMPTY_CHUNK;
+        return;
+    }
+
+    const uint chunk = StoreChunk(chunkX, chunkZ);
+    std::copy(blocks, blocks + CHUNK_BLOCKS, blocks_.begin() + static_cast<uint64>(chunk) * CHUNK_BLOCKS);
+    sectionMasks_[chunk] = 0;
+    for (uint section=0; section<SECTIONS_PER_CHUNK; section++) {
+        const uint8 *sectionBlocks = blocks + section * SECTION_SIZE * CHUNK_WIDTH * CHUNK_WIDTH;
+        const uint airCount = static_cast<uint>(std::count(sectionBlocks, sectionBlocks + SECTION_SIZE * CHUNK_WIDTH * CHUNK_WIDTH, AIR));
+        sectionBlockCounts_[chunk * SECTIONS_PER_CHUNK + section] = SECTION_SIZE * CHUNK_WIDTH * CHUNK_WIDTH - airCount;
+        if (airCount != SECTION_SIZE * CHUNK_WIDTH * CHUNK_WIDTH)
+            sectionMasks_[chunk] |= 1U << section;
+    }
+    chunkRevisions_[chunk] = ++revision_;
+    // a chunk of air isn't kept
+    if (sectionMasks_[chunk] == 0) {
+        RemoveChunk(chunk);
+        column = EMPTY_CHUNK;
+        chunkChanges_.Add(chunkZ * grid_.chunkCountX + chunkX);
+    }
+}
+
+void VoxelWorld::ShiftChunks(int chunkX, int chunkZ) {
+    std::vector<uint> chunks(chunks_.size(), EMPTY_CHUNK);
+    for (uint z=0; z<grid_.chunkCountZ; z++) {
+        for (uint x=0; x<grid_.chunkCountX; x++) {
+            const uint chunk = chunks_[z * grid_.chunkCountX + x];
+            if (chunk == EMPTY_CHUNK) continue;
+            const int newX = static_cast<int>(x) - chunkX;
+            const int newZ = static_cast<int>(z) - chunkZ;
+            if (newX < 0 || newZ < 0 || newX >= static_cast<int>(grid_.chunkCountX) || newZ >= static_cast<int>(grid_.chunkCountZ))
+                RemoveChunk(chunk);
+            else
+                chunks[static_cast<uint>(newZ) * grid_.chunkCountX + static_cast<uint>(newX)] = chunk;
+        }
+    }
+    chunks_ = std::move(chunks);
+    chunkChanges_.AddAll(chunks_.size());
+    const float chunkSize = CHUNK_WIDTH * grid_.blockSize;
+    grid_.origin = grid_.origin + Vector3f(chunkX * chunkSize, 0, chunkZ * chunkSize);
+}
+
+uint &VoxelWorld::StoreChunk(uint chunkX, uint chunkZ) {
+    uint &chunk = chunks_[chunkZ * grid_.chunkCountX + chunkX];
+    if (chunk != EMPTY_CHUNK)
+        return chunk;
+    chunkChanges_.Add(chunkZ * grid_.chunkCountX + chunkX);
+    // reuse a removed chunk before growing the storage
+    if (!freeChunks_.empty()) {
+        chunk = freeChunks_.back();
+        freeChunks_.pop_back();
+        std::fill(blocks_.begin() + static_cast<uint64>(chunk) * CHUNK_BLOCKS, blocks_.begin() + static_cast<uint64>(chunk + 1) * CHUNK_BLOCKS, AIR);
+        return chunk;
+    }
+    chunk = static_cast<uint>(sectionMasks_.size());
+    sectionMasks_.push_back(0);
+    chunkRevisions_.push_back(++revision_);
+    sectionBlockCounts_.resize(sectionBlockCounts_.size() + SECTIONS_PER_CHUNK, 0);
+    blocks_.resize(blocks_.size() + CHUNK_BLOCKS, AIR);
+    return chunk;
+}
+
+void VoxelWorld::RemoveChunk(uint chunk) {
+    sectionMasks_[chunk] = 0;
+    std::fill(sectionBlockCounts_.begin() + chunk * SECTIONS_PER_CHUNK, sectionBlockCounts_.begin() + (chunk + 1) * SECTIONS_PER_CHUNK, 0);
+    chunkRevisions_[chunk] = ++revision_;
+    freeChunks_.push_back(chunk);
+}
+
+uint8 VoxelWorld::GetBlock(uint x, uint y, uint z) const {
+    if (x >= grid_.chunkCountX * CHUNK_WIDTH || y >= CHUNK_HEIGHT || z >= grid_.chunkCountZ * CHUNK_WIDTH)
+        throw std::out_of_range("Block is outside of the voxel world");
+    const uint chunk = chunks_[z / CHUNK_WIDTH * grid_.chunkCountX + x / CHUNK_WIDTH];
+    if (chunk == EMPTY_CHUNK)
+        return AIR;
+    return blocks_[static_cast<uint64>(chunk) * CHUNK_BLOCKS + BlockIndex(x % CHUNK_WIDTH, y, z % CHUNK_WIDTH)];
+}
+
+} // namespace Tracer
@@ -0,0 +1,239 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_VOXELWORLD_H
+#define TRACER_VOXELWORLD_H
+
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "Common.h"
+#include "DirtyRanges.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+
+namespace Tracer {
+
+///
+/// \brief Where a voxel world is and how many chunks it has.  This is what is copied to the SYCL device (along with
+/// the chunk, section, block, and block material arrays of VoxelWorld).
+///
+struct VoxelGrid {
+    ///
+    /// \brief the corner of block (0,0,0) with the smallest values
+    ///
+    Vector3f origin;
+    ///
+    /// \brief the length of the edge of a block
+    ///
+    float blockSize;
+    ///
+    /// \brief the number of chunks along the x and z axes
+    ///
+    uint chunkCountX, chunkCountZ;
+};
+
+///
+/// \brief A world of blocks (ex: a Minecraft world) that is ray traced directly instead of as primatives.
+///
+/// The world is a grid of chunks, each 16x256x16 (x,y,z) blocks.  A block is a one byte id (AIR is empty) which maps to
+/// a material of the scene's MaterialManager (see SetBlockMaterial).  Only chunks with a block in them are stored.
+/// Every chunk is split into 16 sections of 16x16x16 blocks, and a bit per section marks the sections with blocks in them.
+///
+/// Rays are traced with the 3D-DDA of Amanatides and Woo on two levels: first through the coarse grid of sections,
+/// skipping missing chunks and empty sections, then block by block through the sections with blocks in them.
+///
+class VoxelWorld {
+public:
+    ///
+    /// \brief The size of a chunk in blocks (x and z are CHUNK_WIDTH and y is CHUNK_HEIGHT)
+    ///
+    static const uint CHUNK_WIDTH = 16;
+    static const uint CHUNK_HEIGHT = 256;
+    static const uint CHUNK_BLOCKS = CHUNK_WIDTH * CHUNK_WIDTH * CHUNK_HEIGHT;
+    ///
+    /// \brief The size of a section (the cells of the coarse grid) in blocks along every axis
+    ///
+    static const uint SECTION_SIZE = 16;
+    static const uint SECTIONS_PER_CHUNK = CHUNK_HEIGHT / SECTION_SIZE;
+    ///
+    /// \brief The id of an empty block
+    ///
+    static const uint8 AIR = 0;
+    ///
+    /// \brief Marks a chunk of the grid that has no blocks stored
+    ///
+    static const uint EMPTY_CHUNK = 0xFFFFFFFF;
+
+    ///
+    /// \brief Creates an empty world with no chunks
+    ///
+    VoxelWorld() : VoxelWorld(0, 0) {}
+    ///
+    /// \brief Creates a world of air
+    /// \param chunkCountX the number of chunks along the x axis
+    /// \param chunkCountZ the number of chunks along the z axis
+    /// \param origin where the corner of block (0,0,0) with the smallest values is in the scene
+    /// \param blockSize the length of the edge of a block in the scene
+    ///
+    VoxelWorld(uint chunkCountX, uint chunkCountZ, const Vector3f &origin = Vector3f(), float blockSize = 1);
+    ///
+    /// \brief Sets the block at the block coordinates (throws std::out_of_range if they are outside the world)
+    ///
+    void SetBlock(uint x, uint y, uint z, uint8 block);
+    ///
+    /// \brief Gets the block at the block coordinates (throws std::out_of_range if they are outside the world)
+    ///
+    uint8 GetBlock(uint x, uint y, uint z) const;
+    ///
+    /// \brief Replaces every block of a chunk
+    /// \param blocks CHUNK_BLOCKS blocks (see BlockIndex()), or nullptr to remove the chunk (all air)
+    ///
+    void SetChunk(uint chunkX, uint chunkZ, const uint8 *blocks);
+    ///
+    /// \brief Moves the world by whole chunks keeping the chunks that stay in it (the rest are removed and new chunks are air)
+    /// Chunk (x,z) becomes what was chunk (x+chunkX, z+chunkZ).  Used to keep a window of a much bigger world around the camera.
+    ///
+    void ShiftChunks(int chunkX, int chunkZ);
+    ///
+    /// \brief Sets the material (from the scene's MaterialManager) blocks with the id are rendered with
+    ///
+    void SetBlockMaterial(uint8 block, uint materialId) {
+        blockMaterials_[block] = materialId;
+        blockMaterialChanges_.Add(block);
+    }
+    ///
+    /// \brief Gets the material id of every block id
+    ///
+    const std::vector<uint> &GetBlockMaterials() const { return blockMaterials_; }
+    ///
+    /// \brief Gets the ranges of the block materials that changed (see DirtyRanges)
+    ///
+    const DirtyRanges &GetBlockMaterialChanges() const { return blockMaterialChanges_; }
+    ///
+    /// \brief Gets the position and size of the world
+    ///
+    const VoxelGrid &GetGrid() const { return grid_; }
+    ///
+    /// \brief Gets the chunk of every column of the world (x + z * chunkCountX), EMPTY_CHUNK if it has no blocks
+    ///
+    const std::vector<uint> &GetChunks() const { return chunks_; }
+    ///
+    /// \brief Gets the ranges of the columns whose chunk changed (see DirtyRanges)
+    ///
+    const DirtyRanges &GetChunkChanges() const { return chunkChanges_; }
+    ///
+    /// \brief Gets a mask of the sections with blocks in them for every stored chunk (bit i is the i'th section from the bottom)
+    /// \note removed chunks leave a chunk with no sections behind which is reused by the next chunk stored
+    ///
+    const std::vector<uint> &GetSectionMasks() const { return sectionMasks_; }
+    ///
+    /// \brief Gets the blocks of every stored chunk (CHUNK_BLOCKS per chunk, see BlockIndex())
+    ///
+    const std::vector<uint8> &GetBlocks() const { return blocks_; }
+    ///
+    /// \brief Gets a number for every stored chunk that changes whenever the chunk's blocks change (or it is removed)
+    ///
+    const std::vector<uint64> &GetChunkRevisions() const { return chunkRevisions_; }
+    ///
+    /// \brief Returns the number of chunks with blocks stored
+    ///
+    uint GetChunkCount() const { return static_cast<uint>(sectionMasks_.size() - freeChunks_.size()); }
+    ///
+    /// \brief Returns true if the world has no blocks
+    ///
+    bool IsEmpty() const { return GetChunkCount() == 0; }
+    ///
+    /// \brief Returns where a block is in the blocks of its chunk (the coordinates are within the chunk)
+    ///
+    static uint BlockIndex(uint x, uint y, uint z) { return (y * CHUNK_WIDTH + z) * CHUNK_WIDTH + x; }
+    ///
+    /// \brief Finds the closest block the ray hits (intended to be run on the SYCL device)
+    /// The block the ray starts in is ignored, so rays leaving the face of a block don't hit it again.
+    /// \param maxDistance blocks further than this are ignored (ex: the distance to the closest primative)
+    /// \param materialId holds the id of the material of the block (if there was an intersection)
+    ///
+    static Intersection Intersect(const Ray &ray, const VoxelGrid &grid, const uint *chunks, const uint *sectionMasks,
+                                  const uint8 *blocks, const uint *blockMaterials, float maxDistance, uint *materialId);
+    ///
+    /// \brief Walks the sections of the stored chunks the ray passes through front to back (intended to be run on the SYCL device)
+    /// \tparam SectionIntersector has bool Intersect(chunk, section, tStart, tEnd, enteredAxis, origin, direction) which looks for a
+    /// block in the section (its x,y,z in the grid of sections) between the distances tStart and tEnd and returns true to stop at it.
+    /// enteredAxis is the axis of the face the ray entered the section through (-1 if the ray starts in the section), origin and
+    /// direction are the ray in blocks (see VoxelDDA).
+    ///
+    template<typename SectionIntersector>
+    static void Traverse(const Ray &ray, const VoxelGrid &grid, const uint *chunks, float maxDistance, SectionIntersector *intersector);
+private:
+    ///
+    /// \brief Returns the chunk of the column, storing a new chunk of air there first if it has none
+    ///
+    uint &StoreChunk(uint chunkX, uint chunkZ);
+    ///
+    /// \brief Removes a stored chunk so it can be reused
+    ///
+    void RemoveChunk(uint chunk);
+    ///
+    /// \brief See GetGrid()
+    ///
+    VoxelGrid grid_;
+    ///
+    /// \brief See GetChunks()
+    ///
+    std::vector<uint> chunks_;
+    ///
+    /// \brief See GetSectionMasks()
+    ///
+    std::vector<uint> sectionMasks_;
+    ///
+    /// \brief The number of blocks that aren't air in every section of every stored chunk (keeps the section masks up to date)
+    ///
+    std::vector<uint> sectionBlockCounts_;
+    ///
+    /// \brief See GetBlocks()
+    ///
+    std::vector<uint8> blocks_;
+    ///
+    /// \brief See GetBlockMaterials()
+    ///
+    std::vector<uint> blockMaterials_;
+    ///
+    /// \brief See GetChunkChanges() and GetBlockMaterialChanges()
+    ///
+    DirtyRanges chunkChanges_;
+    DirtyRanges blockMaterialChanges_;
+    ///
+    /// \brief Removed chunks that can be reused
+    ///
+    std::vector<uint> freeChunks_;
+    ///
+    /// \brief See GetChunkRevisions()
+    ///
+    std::vector<uint64> chunkRevisions_;
+    ///
+    /// \brief The last revision given to a chunk
+    ///
+    uint64 revision_ = 0;
+};
+
+} // namespace Tracer
+
+#endif // TRACER_VOXELWORLD_H
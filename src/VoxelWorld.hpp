@@ -0,0 +1,213 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_VOXELWORLD_HPP
+#define TRACER_VOXELWORLD_HPP
+
+#include <limits>
+
+#include "VoxelWorld.h"
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+///
+/// \brief Steps a ray cell by cell through a grid (the 3D-DDA of Amanatides and Woo)
+/// Positions are in blocks so the distances along the ray are the same as in the scene.
+///
+struct VoxelDDA {
+    ///
+    /// \brief Starts in the cell (of cellSize blocks) the ray is in at distance t, kept within the cells [min,max)
+    ///
+    VoxelDDA(const Vector3f &origin, const Vector3f &direction, float t, float cellSize, const int *min, const int *max) {
+        const float inf = std::numeric_limits<float>::infinity();
+        for (uint axis=0; axis<3; axis++) {
+            const float position = origin[axis] + direction[axis] * t;
+            cell[axis] = static_cast<int>(cl::sycl::floor(position / cellSize));
+            cell[axis] = cell[axis] < min[axis] ? min[axis] : cell[axis] >= max[axis] ? max[axis] - 1 : cell[axis];
+            step[axis] = direction[axis] < 0 ? -1 : 1;
+            if (direction[axis] == 0) {
+                tMax[axis] = inf;
+                tDelta[axis] = inf;
+            } else {
+                const int boundary = direction[axis] < 0 ? cell[axis] : cell[axis] + 1;
+                tMax[axis] = (boundary * cellSize - origin[axis]) / direction[axis];
+                tDelta[axis] = cellSize / cl::sycl::fabs(direction[axis]);
+            }
+        }
+    }
+    ///
+    /// \brief Returns the axis of the next cell boundary the ray crosses
+    ///
+    uint NextAxis() const {
+        return tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+    }
+    ///
+    /// \brief Moves into the next cell along the axis
+    ///
+    void Step(uint axis) {
+        cell[axis] += step[axis];
+        tMax[axis] += tDelta[axis];
+    }
+    ///
+    /// \brief the cell the ray is in
+    ///
+    int cell[3];
+    ///
+    /// \brief which way the ray moves through the cells along each axis
+    ///
+    int step[3];
+    ///
+    /// \brief the distance along the ray to the next cell boundary along each axis
+    ///
+    float tMax[3];
+    ///
+    /// \brief the distance along the ray between cell boundaries along each axis
+    ///
+    float tDelta[3];
+};
+
+///
+/// \brief Finds the closest block in the sections of the flat chunks of a VoxelWorld, see VoxelWorld::Traverse
+///
+struct ClosestBlockIntersector {
+    ClosestBlockIntersector(const Ray &ray, const uint *sectionMasks, const uint8 *blocks, const uint *blockMaterials)
+        : ray(ray), sectionMasks(sectionMasks), blocks(blocks), blockMaterials(blockMaterials),
+          bestIntersection(Intersection::NO_INTERSECTION()), materialId(0) {}
+    bool Intersect(uint chunk, const int *section, float tStart, float tEnd, int enteredAxis, const Vector3f &origin, const Vector3f &direction) {
+        if (!(sectionMasks[chunk] >> section[1] & 1))
+            return false;
+        // walk the blocks of the section
+        const int size = static_cast<int>(VoxelWorld::SECTION_SIZE);
+        const int blockMin[3] = { section[0] * size, section[1] * size, section[2] * size };
+        const int blockMax[3] = { blockMin[0] + size, blockMin[1] + size, blockMin[2] + size };
+        const uint8 *chunkBlocks = blocks + static_cast<uint64>(chunk) * VoxelWorld::CHUNK_BLOCKS;
+        VoxelDDA cells(origin, direction, tStart, 1, blockMin, blockMax);
+        float tBlock = tStart;
+        int blockAxis = enteredAxis;
+        while (true) {
+            const uint8 block = chunkBlocks[VoxelWorld::BlockIndex(static_cast<uint>(cells.cell[0]) % VoxelWorld::CHUNK_WIDTH, static_cast<uint>(cells.cell[1]),
+                                                                   static_cast<uint>(cells.cell[2]) % VoxelWorld::CHUNK_WIDTH)];
+            if (block != VoxelWorld::AIR && blockAxis != -1) {
+                // the face the ray entered the block through
+                Vector3f normal;
+                normal[blockAxis] = static_cast<float>(-cells.step[blockAxis]);
+                bestIntersection = Intersection(tBlock, normal, ray.origin + ray.direction * tBlock);
+                materialId = blockMaterials[block];
+                return true;
+            }
+            const uint axis = cells.NextAxis();
+            if (cells.tMax[axis] > tEnd)
+                return false;
+            tBlock = cells.tMax[axis];
+            blockAxis = static_cast<int>(axis);
+            cells.Step(axis);
+            if (cells.cell[axis] < blockMin[axis] || cells.cell[axis] >= blockMax[axis])
+                return false;
+        }
+    }
+    const Ray &ray;
+    const uint *sectionMasks;
+    const uint8 *blocks;
+    const uint *blockMaterials;
+    Intersection bestIntersection;
+    uint materialId;
+};
+
+template<typename SectionIntersector>
+inline void VoxelWorld::Traverse(const Ray &ray, const VoxelGrid &grid, const uint *chunks, float maxDistance, SectionIntersector *intersector) {
+    if (grid.chunkCountX == 0 || grid.chunkCountZ == 0)
+        return;
+
+    // the ray in blocks
+    const Vector3f origin = (ray.origin - grid.origin) * (1 / grid.blockSize);
+    const Vector3f direction = ray.direction * (1 / grid.blockSize);
+    const int worldMin[3] = { 0, 0, 0 };
+    const int worldMax[3] = { static_cast<int>(grid.chunkCountX * CHUNK_WIDTH), static_cast<int>(CHUNK_HEIGHT), static_cast<int>(grid.chunkCountZ * CHUNK_WIDTH) };
+
+    // clip the ray to the world's box
+    // enteredAxis is the axis of the face the ray entered the current cell through (-1 if the ray starts in it)
+    float tStart = 0, tEnd = maxDistance;
+    int enteredAxis = -1;
+    for (uint axis=0; axis<3; axis++) {
+        if (direction[axis] == 0) {
+            if (origin[axis] < worldMin[axis] || origin[axis] > worldMax[axis])
+                return;
+            continue;
+        }
+        float tNear = (worldMin[axis] - origin[axis]) / direction[axis];
+        float tFar = (worldMax[axis] - origin[axis]) / direction[axis];
+        if (tNear > tFar) {
+            const float swap = tNear;
+            tNear = tFar;
+            tFar = swap;
+        }
+        if (tNear > tStart) {
+            tStart = tNear;
+            enteredAxis = static_cast<int>(axis);
+        }
+        tEnd = cl::sycl::fmin(tEnd, tFar);
+    }
+    if (tStart > tEnd)
+        return;
+
+    // walk the coarse grid of sections, skipping missing chunks
+    const int sectionMax[3] = { static_cast<int>(grid.chunkCountX), static_cast<int>(SECTIONS_PER_CHUNK), static_cast<int>(grid.chunkCountZ) };
+    VoxelDDA sections(origin, direction, tStart, SECTION_SIZE, worldMin, sectionMax);
+    float tSection = tStart;
+    while (true) {
+        const uint chunk = chunks[sections.cell[2] * grid.chunkCountX + sections.cell[0]];
+        const uint axis = sections.NextAxis();
+        if (chunk != EMPTY_CHUNK &&
+                intersector->Intersect(chunk, sections.cell, tSection, cl::sycl::fmin(tEnd, sections.tMax[axis]), enteredAxis, origin, direction))
+            return;
+
+        if (sections.tMax[axis] > tEnd)
+            return;
+        tSection = sections.tMax[axis];
+        enteredAxis = static_cast<int>(axis);
+        sections.Step(axis);
+        if (sections.cell[axis] < worldMin[axis] || sections.cell[axis] >= sectionMax[axis])
+            return;
+    }
+}
+
+inline Intersection VoxelWorld::Intersect(const Ray &ray, const VoxelGrid &grid, const uint *chunks, const uint *sectionMasks,
+                                          const uint8 *blocks, const uint *blockMaterials, float maxDistance, uint *materialId) {
+    ClosestBlockIntersector intersector(ray, sectionMasks, blocks, blockMaterials);
+    Traverse(ray, grid, chunks, maxDistance, &intersector);
+    if (intersector.bestIntersection != Intersection::NO_INTERSECTION())
+        *materialId = intersector.materialId;
+    return intersector.bestIntersection;
+}
+
+} // namespace Tracer
+
+#endif // TRACER_VOXELWORLD_HPP
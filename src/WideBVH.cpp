@@ -0,0 +1,153 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "WideBVH.h"
+#include "WideBVH.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "AABB.h"
+
+namespace Tracer {
+
+namespace {
+
+///
+/// \brief Returns the surface area of a binary node's bounds
+///
+float SurfaceArea(const BVHNode &node) {
+    return AABB(Vector3f(node.boundsMin[0], node.boundsMin[1], node.boundsMin[2]),
+                Vector3f(node.boundsMax[0], node.boundsMax[1], node.boundsMax[2])).SurfaceArea();
+}
+
+///
+/// \brief Returns true if the node bounds nothing (an empty BVH's root, which isn't really a leaf or an interior node)
+///
+bool IsEmpty(const BVHNode &node) {
+    return node.boundsMin[0] == std::numeric_limits<float>::infinity() || (node.IsLeaf() && node.count == 0);
+}
+
+} // namespace
+
+template<uint Width>
+uint WideBVH<Width>::Collapse(const std::vector<BVHNode> &nodes, uint root, std::vector<WideBVHNode<Width>> *wideNodes,
+                              std::vector<uint> *childSources) {
+    const float inf = std::numeric_limits<float>::infinity();
+    const uint wideRoot = static_cast<uint>(wideNodes->size());
+    wideNodes->push_back(WideBVHNode<Width>());
+
+    // (binary node, the wide node made from it)
+    std::vector<std::pair<uint,uint>> toCollapse;
+    toCollapse.push_back(std::make_pair(root, wideRoot));
+    while (!toCollapse.empty()) {
+        const uint nodeId = toCollapse.back().first;
+        const uint wideNodeId = toCollapse.back().second;
+        toCollapse.pop_back();
+
+        // pull grandchildren up into the wide node, always opening the biggest interior child first
+        uint children[Width];
+        uint childCount = 0;
+        if (IsEmpty(nodes[nodeId])) {
+            // nothing to add
+        } else if (nodes[nodeId].IsLeaf()) {
+            children[childCount++] = nodeId;
+        } else {
+            children[childCount++] = nodes[nodeId].leftFirst;
+            children[childCount++] = nodes[nodeId].leftFirst + 1;
+        }
+        while (childCount < Width) {
+            uint biggest = Width;
+            float biggestArea = -1;
+            for (uint i=0; i<childCount; i++) {
+                const BVHNode &child = nodes[children[i]];
+                if (!child.IsLeaf() && !IsEmpty(child) && SurfaceArea(child) > biggestArea) {
+                    biggest = i;
+                    biggestArea = SurfaceArea(child);
+                }
+            }
+            if (biggest == Width) break; // only leaves left
+            const uint opened = children[biggest];
+            children[biggest] = nodes[opened].leftFirst;
+            children[childCount++] = nodes[opened].leftFirst + 1;
+        }
+
+        // fill in the wide node (not by reference, new nodes are pushed while doing this)
+        WideBVHNode<Width> wideNode;
+        uint sources[Width];
+        for (uint i=0; i<Width; i++) {
+            const bool used = i < childCount && !IsEmpty(nodes[children[i]]);
+            sources[i] = used ? children[i] : WideBVHNode<Width>::EMPTY_CHILD;
+            if (!used) {
+                wideNode.boundsMinX[i] = wideNode.boundsMinY[i] = wideNode.boundsMinZ[i] = inf;
+                wideNode.boundsMaxX[i] = wideNode.boundsMaxY[i] = wideNode.boundsMaxZ[i] = inf;
+                wideNode.child[i] = WideBVHNode<Width>::EMPTY_CHILD;
+                wideNode.count[i] = 0;
+                continue;
+            }
+            const BVHNode &child = nodes[children[i]];
+            SetChildBounds(child, i, &wideNode);
+            if (child.IsLeaf()) {
+                wideNode.child[i] = child.leftFirst;
+                wideNode.count[i] = child.count;
+            } else {
+                wideNode.child[i] = static_cast<uint>(wideNodes->size());
+                wideNode.count[i] = 0;
+                wideNodes->push_back(WideBVHNode<Width>());
+                toCollapse.push_back(std::make_pair(children[i], wideNode.child[i]));
+            }
+        }
+        (*wideNodes)[wideNodeId] = wideNode;
+        if (childSources) {
+            const uint emptyChild = WideBVHNode<Width>::EMPTY_CHILD; // a copy, resize() takes a reference
+            childSources->resize(wideNodes->size() * Width, emptyChild);
+            std::copy(sources, sources + Width, childSources->begin() + wideNodeId * Width);
+        }
+    }
+    return wideRoot;
+}
+
+template<uint Width>
+void WideBVH<Width>::SetChildBounds(const BVHNode &child, uint i, WideBVHNode<Width> *wideNode) {
+    wideNode->boundsMinX[i] = child.boundsMin[0];
+    wideNode->boundsMinY[i] = child.boundsMin[1];
+    wideNode->boundsMinZ[i] = child.boundsMin[2];
+    wideNode->boundsMaxX[i] = child.boundsMax[0];
+    wideNode->boundsMaxY[i] = child.boundsMax[1];
+    wideNode->boundsMaxZ[i] = child.boundsMax[2];
+}
+
+template class WideBVH<2>;
+template class WideBVH<4>;
+template class WideBVH<8>;
+
+uint PreferredHostNodeWidth() {
+#if defined(TRACER_WIDEBVH_AVX)
+    return HostHasAVX() ? 8 : 4;
+#elif defined(TRACER_WIDEBVH_SSE)
+    return 4;
+#else
+    return 2;
+#endif
+}
+
+} // namespace Tracer
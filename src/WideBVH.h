@@ -0,0 +1,108 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_WIDEBVH_H
+#define TRACER_WIDEBVH_H
+
+#include <vector>
+
+#include <SYCL/sycl.hpp>
+#include "BVH.h"
+#include "Common.h"
+#include "Vector.h"
+
+namespace Tracer {
+
+///
+/// \brief A node of a wide BVH (Width children per node).  This is what is copied to the SYCL device.
+///
+/// The bounds of the children are stored as structure of arrays so every child's slab test can be done at once
+/// with SIMD instructions.  Child i is a leaf if count[i] > 0 (it references the primative indices [child[i], child[i]+count[i])),
+/// an interior node if count[i] == 0 (child[i] is the node id), or unused if child[i] == EMPTY_CHILD.
+///
+template<uint Width>
+struct WideBVHNode {
+    ///
+    /// \brief Marks an unused child
+    ///
+    static const uint EMPTY_CHILD = 0xFFFFFFFF;
+
+    float boundsMinX[Width];
+    float boundsMinY[Width];
+    float boundsMinZ[Width];
+    float boundsMaxX[Width];
+    float boundsMaxY[Width];
+    float boundsMaxZ[Width];
+    uint child[Width];
+    uint count[Width];
+
+    ///
+    /// \brief Tests the ray against the bounds of every child at once
+    /// \param invDirection 1/ray.direction (precomputed once per ray)
+    /// \param distances holds the distance the ray enters each child or INF if the ray misses it (or it is further than maxDistance)
+    ///
+    void Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) const;
+};
+
+typedef WideBVHNode<4> BVH4Node;
+typedef WideBVHNode<8> BVH8Node;
+
+///
+/// \brief Builds and traverses wide BVHs (4 or 8 children per node) made by collapsing binary BVHs.
+/// Wide nodes suit CPUs: one SIMD slab test checks every child and there are far fewer nodes to visit.
+///
+template<uint Width>
+class WideBVH {
+public:
+    ///
+    /// \brief The max number of entries on the traversal stack (every level of the tree can leave Width-1 children for later)
+    ///
+    static const uint STACK_SIZE = BVH::MAX_DEPTH * (Width - 1) + 1;
+    ///
+    /// \brief Collapses the binary BVH starting at root into wide nodes that are appended to wideNodes.
+    /// The leaves keep referencing the same indices as the binary BVH.
+    /// \param childSources if not nullptr, holds the binary node stored in every child of every wide node (Width per wide node,
+    /// EMPTY_CHILD for unused children) so the wide nodes can be refit later without collapsing again (see SetChildBounds)
+    /// \return the id of the wide root node
+    ///
+    static uint Collapse(const std::vector<BVHNode> &nodes, uint root, std::vector<WideBVHNode<Width>> *wideNodes,
+                         std::vector<uint> *childSources = nullptr);
+    ///
+    /// \brief Sets the bounds of one child of a wide node to the bounds of the binary node stored there
+    ///
+    static void SetChildBounds(const BVHNode &child, uint i, WideBVHNode<Width> *wideNode);
+    ///
+    /// \brief Walks the tree starting at root front to back, see BVH::Traverse (intended to be run on the SYCL device)
+    /// \tparam Node WideBVHNode<Width> or any node with the same child, count and Intersect() members (ex: QuantizedBVHNode<Width>)
+    ///
+    template<typename Node, typename Intersector>
+    static void Traverse(const Ray &ray, const Node *nodes, const uint *indices, uint root, Intersector *intersector);
+};
+
+///
+/// \brief Returns the widest node the host's vector units can test at once (8 if the CPU has AVX, 4 with SSE, otherwise 2 which is a binary BVH).
+/// AVX is checked for when the program runs, so it is used without building for it.
+///
+uint PreferredHostNodeWidth();
+
+} // namespace Tracer
+
+#endif // TRACER_WIDEBVH_H
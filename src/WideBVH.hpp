@@ -0,0 +1,248 @@
+// Copyright (c) 2019 Matthew J. Runyan
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TRACER_WIDEBVH_HPP
+#define TRACER_WIDEBVH_HPP
+
+#include "WideBVH.h"
+#include "BVH.hpp"
+
+// SIMD is only used when the kernel is compiled for the host (SYCL devices get the plain loop)
+#if !defined(__SYCL_DEVICE_ONLY__) && (defined(__SSE2__) || defined(_M_X64))
+#include <immintrin.h>
+#define TRACER_WIDEBVH_SSE
+// the AVX slab test is compiled for AVX on its own and picked at runtime (see HostHasAVX()) so the build doesn't need -mavx
+#if defined(__AVX__)
+#define TRACER_WIDEBVH_AVX
+#define TRACER_TARGET_AVX
+#elif defined(__GNUC__)
+#define TRACER_WIDEBVH_AVX
+#define TRACER_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+///
+/// Why is this a '.hpp' and not a '.cpp' file?
+/// Any code that is run in a kernel in SYCL must appear in the same file.
+/// By including this '.hpp' file it allows for the SYCL kernel to compile
+/// at the cost of increased compile time in the single file where the
+/// SYCL kernel is defined.
+///
+/// See Renderer.cpp for kernel definition.
+///
+
+namespace Tracer {
+
+template<uint Width>
+inline void WideBVHNode<Width>::Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) const {
+    for (uint i=0; i<Width; i++) {
+        const float tx1 = (boundsMinX[i] - ray.origin.X()) * invDirection.X();
+        const float tx2 = (boundsMaxX[i] - ray.origin.X()) * invDirection.X();
+        const float ty1 = (boundsMinY[i] - ray.origin.Y()) * invDirection.Y();
+        const float ty2 = (boundsMaxY[i] - ray.origin.Y()) * invDirection.Y();
+        const float tz1 = (boundsMinZ[i] - ray.origin.Z()) * invDirection.Z();
+        const float tz2 = (boundsMaxZ[i] - ray.origin.Z()) * invDirection.Z();
+        float tNear = cl::sycl::fmax(0.F, cl::sycl::fmin(tx1, tx2));
+        tNear = cl::sycl::fmax(tNear, cl::sycl::fmin(ty1, ty2));
+        tNear = cl::sycl::fmax(tNear, cl::sycl::fmin(tz1, tz2));
+        float tFar = cl::sycl::fmin(maxDistance, cl::sycl::fmax(tx1, tx2));
+        tFar = cl::sycl::fmin(tFar, cl::sycl::fmax(ty1, ty2));
+        tFar = cl::sycl::fmin(tFar, cl::sycl::fmax(tz1, tz2));
+        distances[i] = tNear <= tFar ? tNear : std::numeric_limits<float>::infinity();
+    }
+}
+
+#ifdef TRACER_WIDEBVH_SSE
+// NOTE: a slab is NaN (0*INF) when the ray starts on it and runs parallel to it.  fmin/fmax ignore a NaN, but the min/max
+// instructions return their second operand if either is NaN.  So every axis is taken twice, once with each slab second:
+// one of them gives the slab that isn't NaN (if either isn't) and the NaN from the other is dropped by having the running
+// value second.  That is exactly what the scalar test does, including skipping an axis where both slabs are NaN.
+
+///
+/// \brief Tests the ray against 4 children starting at child first of the given node (the SSE slab test)
+///
+template<uint Width>
+inline void IntersectSSE(const WideBVHNode<Width> &node, uint first, const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) {
+    const __m128 originX = _mm_set1_ps(ray.origin.X());
+    const __m128 originY = _mm_set1_ps(ray.origin.Y());
+    const __m128 originZ = _mm_set1_ps(ray.origin.Z());
+    const __m128 invX = _mm_set1_ps(invDirection.X());
+    const __m128 invY = _mm_set1_ps(invDirection.Y());
+    const __m128 invZ = _mm_set1_ps(invDirection.Z());
+    const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMinX + first), originX), invX);
+    const __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMaxX + first), originX), invX);
+    const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMinY + first), originY), invY);
+    const __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMaxY + first), originY), invY);
+    const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMinZ + first), originZ), invZ);
+    const __m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMaxZ + first), originZ), invZ);
+    __m128 tNear = _mm_max_ps(_mm_min_ps(tx1, tx2), _mm_setzero_ps());
+    tNear = _mm_max_ps(_mm_min_ps(tx2, tx1), tNear);
+    tNear = _mm_max_ps(_mm_min_ps(ty1, ty2), tNear);
+    tNear = _mm_max_ps(_mm_min_ps(ty2, ty1), tNear);
+    tNear = _mm_max_ps(_mm_min_ps(tz1, tz2), tNear);
+    tNear = _mm_max_ps(_mm_min_ps(tz2, tz1), tNear);
+    __m128 tFar = _mm_min_ps(_mm_max_ps(tx1, tx2), _mm_set1_ps(maxDistance));
+    tFar = _mm_min_ps(_mm_max_ps(tx2, tx1), tFar);
+    tFar = _mm_min_ps(_mm_max_ps(ty1, ty2), tFar);
+    tFar = _mm_min_ps(_mm_max_ps(ty2, ty1), tFar);
+    tFar = _mm_min_ps(_mm_max_ps(tz1, tz2), tFar);
+    tFar = _mm_min_ps(_mm_max_ps(tz2, tz1), tFar);
+    const __m128 hit = _mm_cmple_ps(tNear, tFar);
+    const __m128 miss = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    _mm_storeu_ps(distances + first, _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, miss)));
+}
+
+template<>
+inline void WideBVHNode<4>::Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) const {
+    IntersectSSE(*this, 0, ray, invDirection, maxDistance, distances);
+}
+#endif
+
+#ifdef TRACER_WIDEBVH_AVX
+///
+/// \brief Returns true if the host's CPU has AVX (checked once)
+///
+inline bool HostHasAVX() {
+#if defined(__AVX__)
+    return true;
+#else
+    static const bool hasAVX = __builtin_cpu_supports("avx");
+    return hasAVX;
+#endif
+}
+
+///
+/// \brief Tests the ray against all 8 children of the node at once (the AVX slab test, see the note on IntersectSSE() about NaN)
+///
+TRACER_TARGET_AVX
+inline void IntersectAVX(const WideBVHNode<8> &node, const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) {
+    const __m256 originX = _mm256_set1_ps(ray.origin.X());
+    const __m256 originY = _mm256_set1_ps(ray.origin.Y());
+    const __m256 originZ = _mm256_set1_ps(ray.origin.Z());
+    const __m256 invX = _mm256_set1_ps(invDirection.X());
+    const __m256 invY = _mm256_set1_ps(invDirection.Y());
+    const __m256 invZ = _mm256_set1_ps(invDirection.Z());
+    const __m256 tx1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMinX), originX), invX);
+    const __m256 tx2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMaxX), originX), invX);
+    const __m256 ty1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMinY), originY), invY);
+    const __m256 ty2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMaxY), originY), invY);
+    const __m256 tz1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMinZ), originZ), invZ);
+    const __m256 tz2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMaxZ), originZ), invZ);
+    __m256 tNear = _mm256_max_ps(_mm256_min_ps(tx1, tx2), _mm256_setzero_ps());
+    tNear = _mm256_max_ps(_mm256_min_ps(tx2, tx1), tNear);
+    tNear = _mm256_max_ps(_mm256_min_ps(ty1, ty2), tNear);
+    tNear = _mm256_max_ps(_mm256_min_ps(ty2, ty1), tNear);
+    tNear = _mm256_max_ps(_mm256_min_ps(tz1, tz2), tNear);
+    tNear = _mm256_max_ps(_mm256_min_ps(tz2, tz1), tNear);
+    __m256 tFar = _mm256_min_ps(_mm256_max_ps(tx1, tx2), _mm256_set1_ps(maxDistance));
+    tFar = _mm256_min_ps(_mm256_max_ps(tx2, tx1), tFar);
+    tFar = _mm256_min_ps(_mm256_max_ps(ty1, ty2), tFar);
+    tFar = _mm256_min_ps(_mm256_max_ps(ty2, ty1), tFar);
+    tFar = _mm256_min_ps(_mm256_max_ps(tz1, tz2), tFar);
+    tFar = _mm256_min_ps(_mm256_max_ps(tz2, tz1), tFar);
+    const __m256 hit = _mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ);
+    _mm256_storeu_ps(distances, _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits<float>::infinity()), tNear, hit));
+}
+#endif
+
+#ifdef TRACER_WIDEBVH_SSE
+template<>
+inline void WideBVHNode<8>::Intersect(const Ray &ray, const Vector3f &invDirection, float maxDistance, float *distances) const {
+#ifdef TRACER_WIDEBVH_AVX
+    if (HostHasAVX()) {
+        IntersectAVX(*this, ray, invDirection, maxDistance, distances);
+        return;
+    }
+#endif
+    // without AVX the children are tested 4 at a time
+    IntersectSSE(*this, 0, ray, invDirection, maxDistance, distances);
+    IntersectSSE(*this, 4, ray, invDirection, maxDistance, distances);
+}
+#endif
+
+template<uint Width>
+template<typename Node, typename Intersector>
+inline void WideBVH<Width>::Traverse(const Ray &ray, const Node *nodes, const uint *indices, uint root, Intersector *intersector) {
+    const float inf = std::numeric_limits<float>::infinity();
+    const Vector3f invDirection(1/ray.direction.X(), 1/ray.direction.Y(), 1/ray.direction.Z());
+
+    // stack of children still to visit (a leaf's primative range or an interior node) and how far away they were when pushed
+    uint stackChild[STACK_SIZE];
+    uint stackCount[STACK_SIZE];
+    float stackDistance[STACK_SIZE];
+    uint stackSize = 0;
+
+    // the root is a wide node whose children all still need testing
+    stackChild[0] = root;
+    stackCount[0] = 0;
+    stackDistance[0] = 0;
+    stackSize = 1;
+
+    while (stackSize > 0) {
+        stackSize--;
+        if (stackDistance[stackSize] >= intersector->Distance())
+            continue;
+        const uint child = stackChild[stackSize];
+        const uint count = stackCount[stackSize];
+        if (count > 0) {
+            for (uint i=child; i<child+count; i++)
+                intersector->Intersect(indices[i]);
+            continue;
+        }
+
+        // push the children that were hit furthest first so the closest is visited next
+        const Node &node = nodes[child];
+        float distances[Width];
+        node.Intersect(ray, invDirection, intersector->Distance(), distances);
+        const uint stackStart = stackSize;
+        for (uint i=0; i<Width; i++) {
+            if (distances[i] == inf || node.child[i] == Node::EMPTY_CHILD) continue;
+            // insertion sort (furthest at the bottom)
+            uint j = stackSize;
+            while (j > stackStart && stackDistance[j-1] < distances[i]) {
+                stackChild[j] = stackChild[j-1];
+                stackCount[j] = stackCount[j-1];
+                stackDistance[j] = stackDistance[j-1];
+                j--;
+            }
+            stackChild[j] = node.child[i];
+            stackCount[j] = node.count[i];
+            stackDistance[j] = distances[i];
+            stackSize++;
+        }
+    }
+}
+
+///
+/// \brief Walks a binary or wide BVH, see BVH::Traverse (lets the same code use every node layout)
+///
+template<typename Intersector>
+inline void TraverseBVH(const Ray &ray, const BVHNode *nodes, const uint *indices, uint root, Intersector *intersector) {
+    BVH::Traverse(ray, nodes, indices, root, intersector);
+}
+template<uint Width, typename Intersector>
+inline void TraverseBVH(const Ray &ray, const WideBVHNode<Width> *nodes, const uint *indices, uint root, Intersector *intersector) {
+    WideBVH<Width>::Traverse(ray, nodes, indices, root, intersector);
+}
+
+} // namespace Tracer
+
+#endif // TRACER_WIDEBVH_HPP
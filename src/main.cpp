@@ -43,12 +43,31 @@ int main(int argc, char *argv[]) {
     }
 
     Tracer::Renderer renderer(forceHostCpu);
+    if (loadedScene.GetMaxDepth() != 0) {
+        renderer.SetMaxDepth(loadedScene.GetMaxDepth());
+        renderer.SetRouletteDepth(loadedScene.GetRouletteDepth());
+    }
+    if (loadedScene.GetAdaptiveSamples() != 0) {
+        renderer.SetAdaptiveThreshold(loadedScene.GetAdaptiveThreshold());
+        renderer.SetAdaptiveSamples(loadedScene.GetAdaptiveSamples());
+    }
+    if (loadedScene.HasPixelFilter())
+        renderer.SetPixelFilter(loadedScene.GetPixelFilter().type, loadedScene.GetPixelFilter().radius);
 
     std::cout << "Samples Per Pixel: " << samplesPerPixel << std::endl;
     std::cout << "Rendering using " << renderer.GetDeviceName() << std::endl;
 
+    // renders are split into many short kernel launches, report the progress between them
+    renderer.SetProgressCallback([](double progress) {
+        std::cout << "\rRendering " << static_cast<int>(progress * 100) << "%" << std::flush;
+        return true;
+    });
+
     // now render
     Tracer::Image img = renderer.RenderScene(loadedScene.GetScene(), loadedScene.GetCamera(), samplesPerPixel, imageSize[0], imageSize[1]);
+    std::cout << "\rRendering 100%" << std::endl;
+    std::cout << "Acceleration structure built in " << renderer.GetLastRenderStats().buildSeconds << "s" << std::endl;
+    std::cout << "Rendered in " << renderer.GetLastRenderStats().renderSeconds << "s (" << renderer.GetLastRenderStats().launches << " kernel launches, " << renderer.GetLastRenderStats().totalSamples << " samples)" << std::endl;
 
     img.WritePNG(loadedScene.GetSceneName() + ".png");
 }
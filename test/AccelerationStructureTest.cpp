@@ -0,0 +1,293 @@
+#include "AccelerationStructure.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AccelerationStructure.hpp"
+#include "Scene.h"
+#include "Transform.h"
+#include "Vector.h"
+
+using Tracer::AccelerationStructure;
+using Tracer::DirtyRanges;
+using Tracer::Instance;
+using Tracer::Intersection;
+using Tracer::Material;
+using Tracer::Ray;
+using Tracer::Scene;
+using Tracer::ScenePrimative;
+using Tracer::Sphere;
+using Tracer::Transform;
+using Tracer::Triangle;
+using Tracer::Vector3f;
+using Tracer::uint;
+using Tracer::uint64;
+
+///
+/// \brief Test that instanced objects are hit exactly the same as the same primatives placed directly in the scene
+///
+class AccelerationStructureTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        // an object of a sphere sitting on a triangle
+        std::vector<ScenePrimative> object;
+        object.push_back(ScenePrimative(Sphere(1, Vector3f(0,1,0)), 0));
+        object.push_back(ScenePrimative(Triangle(Vector3f(-2,0,-2), Vector3f(0,0,2), Vector3f(2,0,-2)), 1));
+        const uint objectId = instanced.AddObject(object);
+
+        // place it many times, with the same primatives moved by hand into the flat scene
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> position(-50, 50);
+        std::uniform_real_distribution<float> angle(0, 6.28F);
+        std::uniform_real_distribution<float> scale(.5F, 2);
+        for (uint i=0; i<200; i++) {
+            const float s = scale(rng);
+            const Transform transform = Transform::Translate(Vector3f(position(rng), position(rng), position(rng)))
+                    * Transform::Rotate(Vector3f(position(rng), position(rng), position(rng)), angle(rng))
+                    * Transform::Scale(Vector3f(s,s,s));
+            const uint materialOverride = i % 2 ? Instance::NO_MATERIAL_OVERRIDE : 2;
+            instanced.AddInstance(objectId, transform, materialOverride);
+
+            flat.AddPrimative(Sphere(s, transform.TransformPoint(Vector3f(0,1,0))), materialOverride == 2 ? 2 : 0);
+            flat.AddPrimative(Triangle(transform.TransformPoint(Vector3f(-2,0,-2)), transform.TransformPoint(Vector3f(0,0,2)), transform.TransformPoint(Vector3f(2,0,-2))), materialOverride == 2 ? 2 : 1);
+        }
+        // plain primatives and instances can be mixed
+        instanced.AddPrimative(Sphere(3, Vector3f(0,0,0)), 3);
+        flat.AddPrimative(Sphere(3, Vector3f(0,0,0)), 3);
+
+        instancedStructure.Build(instanced);
+        flatStructure.Build(flat);
+    }
+    Intersection Intersect(const AccelerationStructure &s, const Ray &ray, uint *materialId) {
+        return AccelerationStructure::Intersect(ray, s.GetNodes().data(), s.GetIndices().data(), s.GetPrimatives().data(),
+                                                s.GetInstances().data(), static_cast<uint>(s.GetInstances().size()), s.GetTopLevelRoot(), materialId);
+    }
+    ///
+    /// \brief Expects both structures to find the same intersections for random rays
+    ///
+    void ExpectSameIntersections(const AccelerationStructure &expectedStructure, const AccelerationStructure &actualStructure, uint seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-80, 80);
+        uint hits = 0;
+        for (uint i=0; i<2000; i++) {
+            const Ray ray(Vector3f(position(rng), position(rng), position(rng)), Vector3f(Vector3f(position(rng), position(rng), position(rng))).Normalize());
+            uint expectedMaterial = 0, actualMaterial = 0;
+            const Intersection expected = Intersect(expectedStructure, ray, &expectedMaterial);
+            const Intersection actual = Intersect(actualStructure, ray, &actualMaterial);
+            if (expected == Intersection::NO_INTERSECTION()) {
+                EXPECT_EQ(actual, Intersection::NO_INTERSECTION());
+                continue;
+            }
+            hits++;
+            // transforming the ray isn't exact so allow some floating point error
+            EXPECT_NEAR(actual.Distance(), expected.Distance(), 1e-2F);
+            EXPECT_NEAR(actual.Normal().Dot(expected.Normal()), 1, 1e-3F);
+            EXPECT_EQ(actualMaterial, expectedMaterial);
+        }
+        EXPECT_GT(hits, 50);
+    }
+    ///
+    /// \brief Expects the wide (or compressed) nodes of a structure to find exactly what its binary nodes find
+    ///
+    template<typename Node>
+    void ExpectSameAsBinary(const AccelerationStructure &s, const std::vector<Node> &wideNodes, uint seed) {
+        ASSERT_FALSE(wideNodes.empty());
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-80, 80);
+        for (uint i=0; i<2000; i++) {
+            const Ray ray(Vector3f(position(rng), position(rng), position(rng)), Vector3f(Vector3f(position(rng), position(rng), position(rng))).Normalize());
+            uint expectedMaterial = 0, actualMaterial = 0;
+            const Intersection expected = Intersect(s, ray, &expectedMaterial);
+            const Intersection actual = AccelerationStructure::Intersect(ray, wideNodes.data(), s.GetIndices().data(), s.GetPrimatives().data(), s.GetInstances().data(),
+                                                                         static_cast<uint>(s.GetInstances().size()), s.GetWideTopLevelRoot(), &actualMaterial);
+            EXPECT_EQ(actual, expected);
+            EXPECT_EQ(actualMaterial, expectedMaterial);
+        }
+    }
+    Scene instanced;
+    Scene flat;
+    AccelerationStructure instancedStructure;
+    AccelerationStructure flatStructure;
+};
+
+TEST_F(AccelerationStructureTest, Build) {
+    // the object is only stored once
+    EXPECT_EQ(instancedStructure.GetPrimatives().size(), 3);
+    EXPECT_EQ(instancedStructure.GetInstances().size(), 200);
+    EXPECT_EQ(flatStructure.GetPrimatives().size(), 401);
+    EXPECT_EQ(flatStructure.GetInstances().size(), 0);
+}
+
+TEST_F(AccelerationStructureTest, Intersection) {
+    ExpectSameIntersections(flatStructure, instancedStructure, 2);
+}
+
+TEST_F(AccelerationStructureTest, Update) {
+    // build the scenes' structures so the moves below are updates
+    flat.GetAccelerationStructure();
+    instanced.GetAccelerationStructure();
+
+    // move some of the instances and the matching primatives of the flat scene
+    const Scene &constFlat = flat;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> offset(-5, 5);
+    for (uint i=0; i<200; i+=7) {
+        const Transform transform = Transform::Translate(Vector3f(offset(rng), offset(rng), offset(rng))) * instanced.GetInstances()[i].transform;
+        instanced.SetInstanceTransform(i, transform);
+
+        const ScenePrimative &sphere = constFlat.GetPrimatives()[2*i];
+        const float radius = sphere.GetBoundingBox().Extent()[0] / 2;
+        flat.SetPrimative(2*i, ScenePrimative(Sphere(radius, transform.TransformPoint(Vector3f(0,1,0))), sphere.GetMaterialId()));
+        flat.SetPrimative(2*i+1, ScenePrimative(Triangle(transform.TransformPoint(Vector3f(-2,0,-2)), transform.TransformPoint(Vector3f(0,0,2)),
+                                                         transform.TransformPoint(Vector3f(2,0,-2))), constFlat.GetPrimatives()[2*i+1].GetMaterialId()));
+    }
+
+    // the updated structures must match each other and a structure built from scratch
+    AccelerationStructure rebuilt;
+    rebuilt.Build(flat);
+    ExpectSameIntersections(rebuilt, flat.GetAccelerationStructure(), 4);
+    ExpectSameIntersections(flat.GetAccelerationStructure(), instanced.GetAccelerationStructure(), 5);
+    EXPECT_EQ(flat.GetAccelerationStructure().GetNodes().size(), flatStructure.GetNodes().size());
+}
+
+TEST_F(AccelerationStructureTest, UpdateWideNodes) {
+    Scene &scene = instanced;
+    for (uint width : {2U, 4U, 8U}) {
+        for (bool compressed : {false, true}) {
+            if (width == 2 && !compressed) continue; // there are no wide nodes
+            AccelerationStructure s;
+            s.SetNodeWidth(width);
+            s.SetCompressedNodes(compressed);
+            s.Build(scene);
+            const size_t nodeCount = s.GetNodes4().size() + s.GetNodes8().size() + s.GetQuantizedNodes2().size()
+                    + s.GetQuantizedNodes4().size() + s.GetQuantizedNodes8().size();
+
+            // move a primative and some instances a little so the BVHs are only refit
+            scene.SetPrimative(0, ScenePrimative(Sphere(3, Vector3f(1.F * width, 2, compressed ? 3.F : -3.F)), 3));
+            std::vector<uint> changedInstances;
+            for (uint i=width; i<200; i+=19) {
+                scene.SetInstanceTransform(i, Transform::Translate(Vector3f(2, -2, 1)) * instanced.GetInstances()[i].transform);
+                changedInstances.push_back(i);
+            }
+            EXPECT_FALSE(s.Update(scene, std::vector<uint>(1, 0), changedInstances, 100));
+
+            // the refit children are updated in place (nothing is collapsed again) and still find what the binary nodes find
+            EXPECT_EQ(s.GetNodes4().size() + s.GetNodes8().size() + s.GetQuantizedNodes2().size()
+                      + s.GetQuantizedNodes4().size() + s.GetQuantizedNodes8().size(), nodeCount);
+            if (compressed && width == 2)
+                ExpectSameAsBinary(s, s.GetQuantizedNodes2(), width);
+            else if (compressed && width == 4)
+                ExpectSameAsBinary(s, s.GetQuantizedNodes4(), width);
+            else if (compressed)
+                ExpectSameAsBinary(s, s.GetQuantizedNodes8(), width);
+            else if (width == 4)
+                ExpectSameAsBinary(s, s.GetNodes4(), width);
+            else
+                ExpectSameAsBinary(s, s.GetNodes8(), width);
+        }
+    }
+}
+
+///
+/// \brief A copy of an array kept up to date by copying only the ranges marked as changed (like DeviceArray)
+///
+template<typename T>
+struct FollowedArray {
+    void Follow(const std::vector<T> &array, const DirtyRanges &changes) {
+        std::vector<DirtyRanges::Range> ranges;
+        const uint64 oldSize = std::min<uint64>(copy.size(), array.size());
+        copy.resize(array.size());
+        if (!changes.GetSince(stamp, &ranges))
+            ranges.assign(1, { 0, array.size() });
+        ranges.push_back({ oldSize, array.size() });
+        for (const DirtyRanges::Range &range : ranges)
+            for (uint64 i=range.begin; i<std::min<uint64>(range.end, array.size()); i++)
+                copy[i] = array[i];
+        stamp = changes.GetStamp();
+        EXPECT_EQ(std::memcmp(copy.data(), array.data(), array.size() * sizeof(T)), 0);
+    }
+    std::vector<T> copy;
+    DirtyRanges::Stamp stamp;
+};
+
+TEST_F(AccelerationStructureTest, Changes) {
+    // copies updated with only the changed ranges stay the same as the arrays through refits and rebuilds
+    Scene &scene = instanced;
+    for (uint width : {2U, 4U, 8U}) {
+        for (bool compressed : {false, true}) {
+            AccelerationStructure s;
+            s.SetNodeWidth(width);
+            s.SetCompressedNodes(compressed);
+            s.Build(scene);
+            FollowedArray<Tracer::BVHNode> nodes;
+            FollowedArray<Tracer::BVH4Node> nodes4;
+            FollowedArray<Tracer::BVH8Node> nodes8;
+            FollowedArray<Tracer::QuantizedBVHNode<2>> quantizedNodes2;
+            FollowedArray<Tracer::QuantizedBVHNode<4>> quantizedNodes4;
+            FollowedArray<Tracer::QuantizedBVHNode<8>> quantizedNodes8;
+            FollowedArray<uint> indices, references, materialIds;
+            FollowedArray<float> data;
+            FollowedArray<Tracer::BVHInstance> instances;
+            const auto follow = [&]() {
+                const Tracer::PrimativeArrays &primatives = s.GetPrimativeArrays();
+                nodes.Follow(s.GetNodes(), s.GetNodeChanges());
+                nodes4.Follow(s.GetNodes4(), s.GetWideNodeChanges());
+                nodes8.Follow(s.GetNodes8(), s.GetWideNodeChanges());
+                quantizedNodes2.Follow(s.GetQuantizedNodes2(), s.GetWideNodeChanges());
+                quantizedNodes4.Follow(s.GetQuantizedNodes4(), s.GetWideNodeChanges());
+                quantizedNodes8.Follow(s.GetQuantizedNodes8(), s.GetWideNodeChanges());
+                indices.Follow(s.GetIndices(), s.GetIndexChanges());
+                instances.Follow(s.GetInstances(), s.GetInstanceChanges());
+                references.Follow(primatives.GetReferences(), primatives.GetReferenceChanges());
+                data.Follow(primatives.GetData(), primatives.GetDataChanges());
+                materialIds.Follow(primatives.GetMaterialIds(), primatives.GetMaterialIdChanges());
+            };
+            follow();
+
+            // refit
+            scene.SetPrimative(0, ScenePrimative(Sphere(2, Vector3f(1.F * width, 2, 3)), 2));
+            std::vector<uint> changedInstances;
+            for (uint i=width; i<200; i+=23) {
+                scene.SetInstanceTransform(i, Transform::Translate(Vector3f(1, -1, 1)) * scene.GetInstances()[i].transform);
+                changedInstances.push_back(i);
+            }
+            EXPECT_FALSE(s.Update(scene, std::vector<uint>(1, 0), changedInstances, 100));
+            follow();
+            // nothing changed
+            EXPECT_FALSE(s.Update(scene, std::vector<uint>(), std::vector<uint>(), 100));
+            follow();
+            // rebuild
+            s.Build(scene);
+            follow();
+        }
+    }
+}
+
+TEST_F(AccelerationStructureTest, UpdateRebuildThreshold) {
+    // a small move is only refit
+    Scene &scene = flat;
+    const uint primativeCount = static_cast<uint>(flatStructure.GetPrimatives().size());
+    std::vector<uint> changed = {0};
+    scene.SetPrimative(0, ScenePrimative(Sphere(1, Vector3f(1,1,1)), 0));
+    EXPECT_FALSE(flatStructure.Update(scene, changed, std::vector<uint>(), 1.5F));
+
+    // scattering primatives makes the refit tree much worse so it is rebuilt
+    changed.clear();
+    for (uint i=0; i<primativeCount; i+=2) {
+        scene.SetPrimative(i, ScenePrimative(Sphere(1, Vector3f(i % 3 ? -500.F : 500.F, i, 0)), 0));
+        changed.push_back(i);
+    }
+    EXPECT_TRUE(flatStructure.Update(scene, changed, std::vector<uint>(), 1.5F));
+
+    AccelerationStructure rebuilt;
+    rebuilt.Build(scene);
+    ExpectSameIntersections(rebuilt, flatStructure, 6);
+
+    // adding primatives always rebuilds
+    scene.AddPrimative(Sphere(1, Vector3f(0,0,0)), 0);
+    EXPECT_TRUE(flatStructure.Update(scene, std::vector<uint>(), std::vector<uint>(), 1.5F));
+    EXPECT_EQ(flatStructure.GetPrimatives().size(), 402);
+}
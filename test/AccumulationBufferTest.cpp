@@ -0,0 +1,93 @@
+#include "AccumulationBuffer.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "Image.h"
+
+using Tracer::AccumulatedPixel;
+using Tracer::AccumulationBuffer;
+using Tracer::Color;
+using Tracer::Image;
+using Tracer::Pixel;
+using Tracer::uint;
+
+///
+/// \brief Test adding up samples and resolving them to images
+///
+class AccumulationBufferTest : public ::testing::Test {
+protected:
+    AccumulationBufferTest() {
+        accumulation.AddSample(0, 0, Color(1, 2, 0));
+        accumulation.AddSample(0, 0, Color(0, 0, 0));
+        accumulation.AddSample(3, 1, Color(.25F, .25F, .25F));
+    }
+    AccumulationBuffer accumulation = AccumulationBuffer(4, 2);
+};
+
+TEST_F(AccumulationBufferTest, Accessors) {
+    EXPECT_EQ(accumulation.GetWidth(), 4U);
+    EXPECT_EQ(accumulation.GetHeight(), 2U);
+    EXPECT_EQ(accumulation.GetPixels().size(), 8U);
+    EXPECT_EQ(accumulation.GetSampleCount(0, 0), 2U);
+    EXPECT_EQ(accumulation.GetSampleCount(3, 1), 1U);
+    EXPECT_EQ(accumulation.GetSampleCount(1, 0), 0U);
+    EXPECT_EQ(accumulation.GetTotalSampleCount(), 3U);
+    // colors aren't clamped
+    EXPECT_EQ(accumulation.GetColor(0, 0), Color(.5F, 1, 0));
+    EXPECT_EQ(accumulation.GetColor(3, 1), Color(.25F, .25F, .25F));
+    EXPECT_EQ(accumulation.GetPixels()[7].mean, Color(.25F, .25F, .25F));
+    EXPECT_EQ(accumulation.GetColor(1, 0), Color(0, 0, 0));
+
+    // more samples are averaged with the ones already there
+    accumulation.AddSample(0, 0, Color(1, 0, 2));
+    accumulation.AddSample(0, 0, Color(0, 0, 0));
+    EXPECT_EQ(accumulation.GetColor(0, 0), Color(.5F, .5F, .5F));
+
+    accumulation.Clear();
+    EXPECT_EQ(accumulation.GetTotalSampleCount(), 0U);
+    EXPECT_EQ(accumulation.GetColor(0, 0), Color(0, 0, 0));
+    EXPECT_EQ(accumulation.GetPixels()[7].mean, Color(0, 0, 0));
+}
+
+TEST_F(AccumulationBufferTest, Variance) {
+    const float samples[] = { .1F, .7F, .3F, 2.5F, 0, .4F, 1.1F, .2F };
+    AccumulatedPixel pixel, first, second;
+    float mean = 0;
+    for (uint i=0; i<8; i++) {
+        pixel.Add(Color(samples[i], samples[i], samples[i]));
+        (i < 3 ? first : second).Add(Color(samples[i], samples[i], samples[i]));
+        mean += samples[i] / 8;
+    }
+    float variance = 0;
+    for (float sample : samples)
+        variance += (sample - mean) * (sample - mean) / 7;
+    EXPECT_NEAR(AccumulatedPixel::Brightness(pixel.mean), mean, 1e-5F);
+    EXPECT_NEAR(pixel.Variance(), variance, 1e-5F);
+    EXPECT_NEAR(pixel.RelativeError(), std::sqrt(variance / 8) / mean, 1e-5F);
+
+    // adding the samples of two pixels together gives the same mean and variance
+    first.Add(second);
+    EXPECT_EQ(first.sampleCount, 8U);
+    EXPECT_NEAR(AccumulatedPixel::Brightness(first.mean), mean, 1e-5F);
+    EXPECT_NEAR(first.Variance(), variance, 1e-5F);
+
+    // a single sample says nothing about the error, samples that are all the same have none
+    EXPECT_GT(accumulation.GetPixel(3, 1).RelativeError(), 1e30F);
+    accumulation.AddSample(3, 1, Color(.25F, .25F, .25F));
+    EXPECT_EQ(accumulation.GetPixel(3, 1).RelativeError(), 0);
+}
+
+TEST_F(AccumulationBufferTest, Resolve) {
+    Image image = accumulation.Resolve();
+    EXPECT_EQ(image.GetWidth(), 4U);
+    EXPECT_EQ(image.GetHeight(), 2U);
+    EXPECT_EQ(image.GetPixel(0, 0), Pixel(Color(.5F, 1, 0)).GammaCorrect());
+    EXPECT_EQ(image.GetPixel(3, 1), Pixel(Color(.25F, .25F, .25F)).GammaCorrect());
+    EXPECT_EQ(image.GetPixel(1, 1), Pixel(0, 0, 0));
+
+    Image wrongSize(4, 3);
+    EXPECT_THROW(accumulation.Resolve(&wrongSize), std::invalid_argument);
+}
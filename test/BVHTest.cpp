@@ -0,0 +1,161 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BVH.hpp"
+#include "RandomSpheres.h"
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+
+using Tracer::AABB;
+using Tracer::BVH;
+using Tracer::BVHNode;
+using Tracer::Intersection;
+using Tracer::Ray;
+using Tracer::ScenePrimative;
+using Tracer::Sphere;
+using Tracer::Vector3f;
+using Tracer::uint;
+
+///
+/// \brief Test building and traversing a BVH of random spheres
+///
+class BVHTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        primatives = RandomSpheres(1000);
+        bvh.Build(primatives);
+    }
+    ///
+    /// \brief Expects the BVH to find exactly what testing every primative finds for random rays
+    ///
+    void ExpectMatchesBruteForce(uint seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-150, 150);
+        for (uint i=0; i<1000; i++) {
+            Ray ray(Vector3f(position(rng), position(rng), position(rng)), Vector3f(Vector3f(position(rng), position(rng), position(rng))).Normalize());
+
+            Intersection expected = Intersection::NO_INTERSECTION();
+            uint expectedId = 0;
+            for (uint j=0; j<primatives.size(); j++) {
+                Intersection intersection = primatives[j].Intersect(ray);
+                if (intersection < expected) {
+                    expected = intersection;
+                    expectedId = j;
+                }
+            }
+
+            uint id = 0;
+            Intersection actual = BVH::Intersect(ray, bvh.GetNodes().data(), bvh.GetIndices().data(), primatives.data(), &id);
+            EXPECT_EQ(actual, expected);
+            if (expected != Intersection::NO_INTERSECTION()) {
+                EXPECT_EQ(id, expectedId);
+            }
+        }
+    }
+    ///
+    /// \brief Returns the SAH cost of the BVH by walking every node
+    ///
+    float GetCostOfEveryNode() const {
+        auto area = [](const BVHNode &node) {
+            return AABB(Vector3f(node.boundsMin[0], node.boundsMin[1], node.boundsMin[2]),
+                        Vector3f(node.boundsMax[0], node.boundsMax[1], node.boundsMax[2])).SurfaceArea();
+        };
+        const float rootArea = area(bvh.GetNodes()[0]);
+        double cost = 0;
+        for (const BVHNode &node : bvh.GetNodes())
+            cost += (node.IsLeaf() ? node.count : 1) * area(node) / rootArea;
+        return static_cast<float>(cost);
+    }
+    std::vector<ScenePrimative> primatives;
+    BVH bvh;
+};
+
+TEST_F(BVHTest, Structure) {
+    const std::vector<BVHNode> &nodes = bvh.GetNodes();
+    const std::vector<uint> &indices = bvh.GetIndices();
+    EXPECT_LE(nodes.size(), 2*primatives.size() - 1);
+
+    // every primative is referenced by exactly one leaf
+    std::vector<uint> referenced(primatives.size(), 0);
+    for (const BVHNode &node : nodes)
+        if (node.IsLeaf())
+            for (uint i=node.leftFirst; i<node.leftFirst+node.count; i++)
+                referenced[indices[i]]++;
+    for (uint count : referenced)
+        EXPECT_EQ(count, 1);
+
+    // the root contains every primative
+    for (const ScenePrimative &primative : primatives) {
+        AABB bounds = primative.GetBoundingBox();
+        for (uint i=0; i<3; i++) {
+            EXPECT_LE(nodes[0].boundsMin[i], bounds.Min()[i]);
+            EXPECT_GE(nodes[0].boundsMax[i], bounds.Max()[i]);
+        }
+    }
+
+    // a SAH tree is much cheaper than testing every primative
+    EXPECT_LT(bvh.GetCost(), primatives.size() / 10.F);
+    EXPECT_FLOAT_EQ(bvh.GetCost(), GetCostOfEveryNode());
+}
+
+TEST_F(BVHTest, Intersection) {
+    ExpectMatchesBruteForce(7);
+}
+
+TEST_F(BVHTest, Refit) {
+    const float builtCost = bvh.GetCost();
+    // move some of the spheres (a few far away) and refit
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<uint> primativeId(0, static_cast<uint>(primatives.size() - 1));
+    std::uniform_real_distribution<float> offset(-20, 20);
+    std::vector<uint> moved;
+    for (uint i=0; i<50; i++) {
+        const uint id = primativeId(rng);
+        const float distance = i % 10 ? 1 : 10;
+        const AABB bounds = primatives[id].GetBoundingBox();
+        const Vector3f position = bounds.Centroid() + Vector3f(offset(rng), offset(rng), offset(rng)) * distance;
+        primatives[id] = ScenePrimative(Sphere(bounds.Extent()[0] / 2, position), id);
+        moved.push_back(id);
+    }
+    std::vector<uint> changedNodes;
+    bvh.Refit([this](uint id) { return primatives[id].GetBoundingBox(); }, moved, &changedNodes);
+
+    // only the moved leaves and their ancestors were touched (each only once)
+    EXPECT_FALSE(changedNodes.empty());
+    EXPECT_LT(changedNodes.size(), bvh.GetNodes().size());
+    std::sort(changedNodes.begin(), changedNodes.end());
+    EXPECT_EQ(std::unique(changedNodes.begin(), changedNodes.end()), changedNodes.end());
+    EXPECT_EQ(changedNodes[0], 0);
+
+    // every node still contains its children
+    const std::vector<BVHNode> &nodes = bvh.GetNodes();
+    for (const BVHNode &node : nodes) {
+        if (node.IsLeaf()) continue;
+        for (uint child=node.leftFirst; child<node.leftFirst+2; child++) {
+            for (uint i=0; i<3; i++) {
+                EXPECT_LE(node.boundsMin[i], nodes[child].boundsMin[i]);
+                EXPECT_GE(node.boundsMax[i], nodes[child].boundsMax[i]);
+            }
+        }
+    }
+
+    // the cost is updated from only the refit nodes but matches walking every node
+    EXPECT_NE(bvh.GetCost(), builtCost);
+    EXPECT_NEAR(bvh.GetCost(), GetCostOfEveryNode(), bvh.GetCost() * 1e-5F);
+
+    ExpectMatchesBruteForce(8);
+}
+
+TEST_F(BVHTest, Empty) {
+    BVH empty;
+    empty.Build(std::vector<ScenePrimative>());
+    EXPECT_EQ(empty.GetNodes().size(), 1);
+    uint id = 0;
+    uint dummyIndex = 0;
+    EXPECT_EQ(BVH::Intersect(Ray(Vector3f(0,0,0), Vector3f(0,0,1)), empty.GetNodes().data(), &dummyIndex, primatives.data(), &id), Intersection::NO_INTERSECTION());
+}
@@ -0,0 +1,40 @@
+#include "ScenePrimative.h"
+
+#include <gtest/gtest.h>
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+
+using Tracer::Box;
+using Tracer::Intersection;
+using Tracer::Vector3f;
+using Tracer::Ray;
+
+///
+/// \brief Test the axis aligned box primative
+///
+class BoxTest : public ::testing::Test {
+protected:
+    Box b1 = Box(Vector3f(-1,0,2), Vector3f(1,4,3));
+};
+
+TEST_F(BoxTest, Accessors) {
+    EXPECT_EQ(b1.GetMin(), Vector3f(-1,0,2));
+    EXPECT_EQ(b1.GetMax(), Vector3f(1,4,3));
+    EXPECT_EQ(b1.GetBoundingBox().Min(), Vector3f(-1,0,2));
+    EXPECT_EQ(b1.GetBoundingBox().Max(), Vector3f(1,4,3));
+}
+
+TEST_F(BoxTest, Intersection) {
+    // the normal is the face the ray enters through
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(0,1,0),Vector3f(0,0,1))), (Intersection { 2, Vector3f(0,0,-1), Vector3f(0,1,2) }) );
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(0,10,2.5F),Vector3f(0,-1,0))), (Intersection { 6, Vector3f(0,1,0), Vector3f(0,4,2.5F) }) );
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(-3,-1,2.5F),Vector3f(2,1,0).Normalize())), (Intersection { 2.236068F, Vector3f(-1,0,0), Vector3f(-1,0,2.5F) }) );
+    // from inside the box it is where the ray leaves, still facing out
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(0,1,2.5F),Vector3f(1,0,0))), (Intersection { 1, Vector3f(1,0,0), Vector3f(1,1,2.5F) }) );
+    // misses
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(0,1,0),Vector3f(0,0,-1))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(2,1,0),Vector3f(0,0,1))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(-3,5,2.5F),Vector3f(1,0,0))), Intersection::NO_INTERSECTION());
+    // a ray leaving the box doesn't hit it again
+    EXPECT_EQ(b1.Intersect(Ray(Vector3f(1,1,2.5F),Vector3f(1,0,0))), Intersection::NO_INTERSECTION());
+}
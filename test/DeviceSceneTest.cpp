@@ -0,0 +1,130 @@
+#include "DeviceScene.h"
+
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <SYCL/sycl.hpp>
+#include "DirtyRanges.h"
+#include "Material.h"
+#include "Scene.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+
+using Tracer::BVHNode;
+using Tracer::Color;
+using Tracer::DeviceArray;
+using Tracer::DeviceScene;
+using Tracer::DirtyRanges;
+using Tracer::Material;
+using Tracer::Scene;
+using Tracer::Sphere;
+using Tracer::Vector3f;
+using Tracer::uint;
+using Tracer::uint64;
+
+///
+/// \brief Test keeping arrays on the host SYCL device and copying only what changed to it
+///
+class DeviceSceneTest : public ::testing::Test {
+protected:
+    DeviceSceneTest() : queue(cl::sycl::host_selector()) {}
+    ///
+    /// \brief Returns what the device has of the array
+    ///
+    template<typename T>
+    static std::vector<T> Contents(DeviceArray<T> *array) {
+        auto accessor = array->GetBuffer().template get_access<cl::sycl::access::mode::read>();
+        return std::vector<T>(accessor.get_pointer(), accessor.get_pointer() + array->GetSize());
+    }
+    cl::sycl::queue queue;
+};
+
+TEST_F(DeviceSceneTest, Upload) {
+    DeviceArray<uint> array;
+    DirtyRanges changes;
+    std::vector<uint> values(1000);
+    for (uint i=0; i<values.size(); i++)
+        values[i] = i;
+    changes.AddAll(values.size());
+    EXPECT_EQ(array.Upload(queue, values, changes), 1000U * sizeof(uint));
+    queue.wait();
+    EXPECT_EQ(Contents(&array), values);
+    // nothing changed
+    EXPECT_EQ(array.Upload(queue, values, changes), 0U);
+
+    // only the changed elements are copied, along with short unchanged runs between them
+    values[10] = values[900] = 0;
+    changes.Add(10);
+    changes.Add(900);
+    EXPECT_EQ(array.Upload(queue, values, changes), 2U * sizeof(uint));
+    values[100] = values[100 + DeviceArray<uint>::MERGE_GAP - 1] = 0;
+    changes.Add(100 + DeviceArray<uint>::MERGE_GAP - 1);
+    changes.Add(100);
+    EXPECT_EQ(array.Upload(queue, values, changes), DeviceArray<uint>::MERGE_GAP * sizeof(uint));
+    queue.wait();
+    EXPECT_EQ(Contents(&array), values);
+    // elements that changed without being marked aren't copied
+    values[0] = 5;
+    EXPECT_EQ(array.Upload(queue, values, changes), 0U);
+    values[0] = 0;
+
+    // growing within the buffer's room only copies the new elements, and shrinking copies nothing
+    values.resize(1200, 7);
+    EXPECT_EQ(array.Upload(queue, values, changes), 200U * sizeof(uint));
+    queue.wait();
+    EXPECT_EQ(Contents(&array), values);
+    values.resize(500);
+    EXPECT_EQ(array.Upload(queue, values, changes), 0U);
+    EXPECT_EQ(Contents(&array), values);
+    // past the room the array is copied whole to a new buffer
+    values.resize(3000, 9);
+    EXPECT_EQ(array.Upload(queue, values, changes), 3000U * sizeof(uint));
+    queue.wait();
+    EXPECT_EQ(Contents(&array), values);
+
+    array.Invalidate();
+    EXPECT_EQ(array.Upload(queue, values, changes), 3000U * sizeof(uint));
+    queue.wait();
+    // the changes of another array are never trusted
+    EXPECT_EQ(array.Upload(queue, values, DirtyRanges()), 3000U * sizeof(uint));
+    queue.wait();
+    EXPECT_EQ(array.Upload(queue, std::vector<uint>(), changes), 0U);
+    EXPECT_EQ(array.GetSize(), 0U);
+}
+
+TEST_F(DeviceSceneTest, Download) {
+    DeviceArray<uint> array;
+    DirtyRanges changes;
+    std::vector<uint> values(100, 1);
+    array.Upload(queue, values, changes);
+    queue.wait();
+    {
+        auto accessor = array.GetBuffer().get_access<cl::sycl::access::mode::write>();
+        accessor[5] = 2;
+    }
+    changes.AddAll(values.size());
+    array.Download(&values, changes);
+    EXPECT_EQ(values[5], 2U);
+    // what was downloaded is what the device has
+    EXPECT_EQ(array.Upload(queue, values, changes), 0U);
+}
+
+TEST_F(DeviceSceneTest, Scene) {
+    Scene scene;
+    for (uint i=0; i<100; i++)
+        scene.AddPrimative(Sphere(.5F, Vector3f(static_cast<float>(i), 0, 0)), Material(Color(0,0,0), Color(.5F,.5F,.5F), Material::DIFFUSE));
+    DeviceScene deviceScene;
+    const Tracer::AccelerationStructure &accelerationStructure = scene.GetAccelerationStructure();
+    EXPECT_GT(deviceScene.Upload(queue, scene, accelerationStructure, accelerationStructure.GetNodes()), 0U);
+    EXPECT_EQ(deviceScene.Upload(queue, scene, accelerationStructure, accelerationStructure.GetNodes()), 0U);
+
+    // changing a material only copies it
+    scene.GetMaterialManager().SetMaterial(Material(Color(1,1,1), Color(0,0,0), Material::DIFFUSE), 50);
+    EXPECT_EQ(deviceScene.Upload(queue, scene, accelerationStructure, accelerationStructure.GetNodes()), sizeof(Material));
+    auto materials = deviceScene.GetMaterials().get_access<cl::sycl::access::mode::read>();
+    EXPECT_EQ(materials[50].emission, Color(1,1,1));
+    auto nodes = deviceScene.GetNodes<BVHNode>().get_access<cl::sycl::access::mode::read>();
+    EXPECT_EQ(std::memcmp(nodes.get_pointer(), accelerationStructure.GetNodes().data(), accelerationStructure.GetNodes().size() * sizeof(BVHNode)), 0);
+}
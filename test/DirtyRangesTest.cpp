@@ -0,0 +1,83 @@
+#include "DirtyRanges.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Tracer::DirtyRanges;
+using Tracer::uint64;
+
+///
+/// \brief Test keeping track of the changed ranges of an array for copies that follow it
+///
+class DirtyRangesTest : public ::testing::Test {
+protected:
+    ///
+    /// \brief Returns the ranges changed since the stamp (expecting them to be known) as begin,end pairs
+    ///
+    std::vector<uint64> Since(const DirtyRanges::Stamp &stamp) const {
+        std::vector<DirtyRanges::Range> ranges;
+        EXPECT_TRUE(changes.GetSince(stamp, &ranges));
+        std::vector<uint64> pairs;
+        for (const DirtyRanges::Range &range : ranges) {
+            pairs.push_back(range.begin);
+            pairs.push_back(range.end);
+        }
+        return pairs;
+    }
+    DirtyRanges changes;
+};
+
+TEST_F(DirtyRangesTest, Since) {
+    const DirtyRanges::Stamp start = changes.GetStamp();
+    EXPECT_EQ(Since(start), std::vector<uint64>());
+    changes.Add(5);
+    changes.Add(20, 30);
+    const DirtyRanges::Stamp middle = changes.GetStamp();
+    EXPECT_NE(middle, start);
+    changes.Add(100);
+    EXPECT_EQ(Since(start), std::vector<uint64>({ 5, 6, 20, 30, 100, 101 }));
+    EXPECT_EQ(Since(middle), std::vector<uint64>({ 100, 101 }));
+    EXPECT_EQ(Since(changes.GetStamp()), std::vector<uint64>());
+    // empty ranges aren't changes
+    changes.Add(7, 7);
+    EXPECT_EQ(Since(middle), std::vector<uint64>({ 100, 101 }));
+}
+
+TEST_F(DirtyRangesTest, Merge) {
+    // ranges touching the last one grow it, unless a copy could already be up to date with it
+    const DirtyRanges::Stamp start = changes.GetStamp();
+    for (uint64 i=0; i<10; i++)
+        changes.Add(i);
+    changes.Add(5, 15);
+    const DirtyRanges::Stamp middle = changes.GetStamp();
+    changes.Add(15, 20);
+    changes.Add(20);
+    EXPECT_EQ(Since(start), std::vector<uint64>({ 0, 15, 15, 21 }));
+    EXPECT_EQ(Since(middle), std::vector<uint64>({ 15, 21 }));
+}
+
+TEST_F(DirtyRangesTest, Forget) {
+    std::vector<DirtyRanges::Range> ranges;
+    const DirtyRanges::Stamp start = changes.GetStamp();
+    changes.AddAll(10);
+    EXPECT_FALSE(changes.GetSince(start, &ranges));
+    const DirtyRanges::Stamp all = changes.GetStamp();
+    EXPECT_EQ(Since(all), std::vector<uint64>());
+
+    // past the limit the ranges are forgotten
+    for (uint64 i=0; i<=DirtyRanges::MIN_LIMIT; i++)
+        changes.Add(i * 2);
+    EXPECT_FALSE(changes.GetSince(all, &ranges));
+    EXPECT_EQ(Since(changes.GetStamp()), std::vector<uint64>());
+}
+
+TEST_F(DirtyRangesTest, Copy) {
+    // a copy is of another array so the stamps of one mean nothing to the other
+    changes.Add(3);
+    const DirtyRanges copy = changes;
+    std::vector<DirtyRanges::Range> ranges;
+    EXPECT_FALSE(copy.GetSince(changes.GetStamp(), &ranges));
+    EXPECT_FALSE(changes.GetSince(copy.GetStamp(), &ranges));
+    EXPECT_FALSE(changes.GetSince(DirtyRanges::Stamp(), &ranges));
+}
@@ -0,0 +1,167 @@
+#include "LinearBVHBuilder.h"
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BVH.hpp"
+#include "RandomSpheres.h"
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+
+using Tracer::AABB;
+using Tracer::BVH;
+using Tracer::BVHNode;
+using Tracer::Intersection;
+using Tracer::LinearBVHBuilder;
+using Tracer::Ray;
+using Tracer::ScenePrimative;
+using Tracer::Sphere;
+using Tracer::Vector3f;
+using Tracer::uint;
+
+///
+/// \brief Test building linear BVHs on the host and on a SYCL device
+///
+class LinearBVHBuilderTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        primatives = RandomSpheres(5000);
+        for (const ScenePrimative &primative : primatives)
+            bounds.push_back(primative.GetBoundingBox());
+    }
+    ///
+    /// \brief Expects the nodes and indices to be a valid tree over every primative
+    ///
+    void ExpectValidTree(const std::vector<BVHNode> &nodes, const std::vector<uint> &indices, const std::vector<AABB> &primativeBounds) {
+        ASSERT_EQ(nodes.size(), 2*primativeBounds.size() - 1);
+        ASSERT_EQ(indices.size(), primativeBounds.size());
+
+        // every node is reached exactly once and every primative is in exactly one leaf
+        std::vector<uint> reached(nodes.size(), 0);
+        std::vector<uint> referenced(primativeBounds.size(), 0);
+        std::vector<std::pair<uint,uint>> toVisit = {{0, 1}}; // (node id, depth)
+        while (!toVisit.empty()) {
+            const uint nodeId = toVisit.back().first;
+            const uint depth = toVisit.back().second;
+            toVisit.pop_back();
+            reached[nodeId]++;
+            EXPECT_LE(depth, static_cast<uint>(BVH::MAX_DEPTH));
+            const BVHNode &node = nodes[nodeId];
+            if (node.IsLeaf()) {
+                for (uint i=node.leftFirst; i<node.leftFirst+node.count; i++) {
+                    referenced[indices[i]]++;
+                    for (uint axis=0; axis<3; axis++) {
+                        EXPECT_EQ(node.boundsMin[axis], primativeBounds[indices[i]].Min()[axis]);
+                        EXPECT_EQ(node.boundsMax[axis], primativeBounds[indices[i]].Max()[axis]);
+                    }
+                }
+                continue;
+            }
+            for (uint child=node.leftFirst; child<node.leftFirst+2; child++) {
+                for (uint axis=0; axis<3; axis++) {
+                    EXPECT_LE(node.boundsMin[axis], nodes[child].boundsMin[axis]);
+                    EXPECT_GE(node.boundsMax[axis], nodes[child].boundsMax[axis]);
+                }
+                toVisit.push_back(std::make_pair(child, depth+1));
+            }
+        }
+        for (uint count : reached)
+            EXPECT_EQ(count, 1);
+        for (uint count : referenced)
+            EXPECT_EQ(count, 1);
+    }
+    ///
+    /// \brief Expects the BVH to find exactly what testing every primative finds for random rays
+    ///
+    void ExpectMatchesBruteForce(const BVH &bvh) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-150, 150);
+        for (uint i=0; i<500; i++) {
+            Ray ray(Vector3f(position(rng), position(rng), position(rng)), Vector3f(Vector3f(position(rng), position(rng), position(rng))).Normalize());
+
+            Intersection expected = Intersection::NO_INTERSECTION();
+            for (const ScenePrimative &primative : primatives) {
+                Intersection intersection = primative.Intersect(ray);
+                if (intersection < expected)
+                    expected = intersection;
+            }
+
+            uint id = 0;
+            EXPECT_EQ(BVH::Intersect(ray, bvh.GetNodes().data(), bvh.GetIndices().data(), primatives.data(), &id), expected);
+        }
+    }
+    std::vector<ScenePrimative> primatives;
+    std::vector<AABB> bounds;
+};
+
+TEST_F(LinearBVHBuilderTest, Host) {
+    std::vector<BVHNode> nodes;
+    std::vector<uint> indices;
+    LinearBVHBuilder::Build(bounds, nullptr, &nodes, &indices);
+    ExpectValidTree(nodes, indices, bounds);
+}
+
+TEST_F(LinearBVHBuilderTest, Device) {
+    cl::sycl::queue queue((cl::sycl::host_selector()));
+    std::vector<BVHNode> nodes, hostNodes;
+    std::vector<uint> indices, hostIndices;
+    LinearBVHBuilder::Build(bounds, &queue, &nodes, &indices);
+    ExpectValidTree(nodes, indices, bounds);
+
+    // the device builds exactly the same tree as the host
+    LinearBVHBuilder::Build(bounds, nullptr, &hostNodes, &hostIndices);
+    EXPECT_EQ(indices, hostIndices);
+    for (uint i=0; i<nodes.size(); i++) {
+        EXPECT_EQ(nodes[i].leftFirst, hostNodes[i].leftFirst);
+        EXPECT_EQ(nodes[i].count, hostNodes[i].count);
+    }
+}
+
+TEST_F(LinearBVHBuilderTest, DuplicateCodes) {
+    // primatives at the same spot get the same morton code, the tree must still be valid (and not too deep)
+    std::vector<AABB> duplicates(3000, AABB(Vector3f(0,0,0), Vector3f(1,1,1)));
+    for (uint i=0; i<1000; i++)
+        duplicates[i] = AABB(Vector3f(i,0,0), Vector3f(i+1,1,1));
+    std::vector<BVHNode> nodes;
+    std::vector<uint> indices;
+    LinearBVHBuilder::Build(duplicates, nullptr, &nodes, &indices);
+    ExpectValidTree(nodes, indices, duplicates);
+}
+
+TEST_F(LinearBVHBuilderTest, Small) {
+    std::vector<BVHNode> nodes;
+    std::vector<uint> indices;
+    LinearBVHBuilder::Build(std::vector<AABB>(), nullptr, &nodes, &indices);
+    EXPECT_EQ(nodes.size(), 1);
+    EXPECT_EQ(indices.size(), 0);
+
+    LinearBVHBuilder::Build(std::vector<AABB>(1, bounds[0]), nullptr, &nodes, &indices);
+    ASSERT_EQ(nodes.size(), 1);
+    EXPECT_EQ(nodes[0].count, 1);
+
+    std::vector<AABB> two(bounds.begin(), bounds.begin() + 2);
+    LinearBVHBuilder::Build(two, nullptr, &nodes, &indices);
+    ExpectValidTree(nodes, indices, two);
+}
+
+TEST_F(LinearBVHBuilderTest, TraverseAndRefit) {
+    BVH bvh;
+    bvh.BuildLinear(primatives);
+    ExpectMatchesBruteForce(bvh);
+
+    // a linear BVH is worse than a SAH one but not by much
+    BVH sahBVH;
+    sahBVH.Build(primatives);
+    EXPECT_LT(bvh.GetCost(), sahBVH.GetCost() * 2);
+
+    // refitting doesn't depend on how the tree was built
+    std::vector<uint> moved;
+    for (uint i=0; i<primatives.size(); i+=50) {
+        primatives[i] = ScenePrimative(Sphere(2, Vector3f(0, i / 50.F, 0)), i);
+        moved.push_back(i);
+    }
+    bvh.Refit([this](uint id) { return primatives[id].GetBoundingBox(); }, moved);
+    ExpectMatchesBruteForce(bvh);
+}
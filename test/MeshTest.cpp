@@ -0,0 +1,137 @@
+#include "Mesh.h"
+
+#include <fstream>
+#include <string>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include "Common.h"
+#include "Material.h"
+#include "Vector.h"
+
+using Tracer::Mesh;
+using Tracer::Material;
+using Tracer::MaterialManager;
+using Tracer::ParseException;
+using Tracer::Vector3f;
+using Tracer::uint;
+
+const std::string testMeshMaterialContents = R""(
+newmtl Red
+Kd 0.900000 0.100000 0.100000
+illum 2
+
+newmtl Mirror
+Ks 0.900000 0.900000 0.900000
+illum 3
+)"";
+
+///
+/// \brief A unit cube made of quads where some of the vertices are repeated (and are merged on load)
+///
+const std::string testMeshContents = R""(# cube
+v 0 0 0
+v 1 0 0
+v 1 1 0
+v 0 1 0
+v 0 0 1
+v 1 0 1
+v 1 1 1
+v 0 1 1
+v 0 0 0
+vn 0 0 -1
+f 9//1 4//1 3//1 2//1
+f 5 6 7 8
+usemtl Red
+f 1/1/1 2/2/1 6/3/1 5/4/1
+f 4 8 7 3
+usemtl Mirror
+f 1 5 8 4
+f -8 -7 -3 -4
+)"";
+
+///
+/// \brief Test loading meshes from obj files
+///
+class MeshTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        // the mtl file must be next to the obj file
+        meshFilename = tmpnam(nullptr);
+        materialFilename = meshFilename + ".mtl";
+        file.open(materialFilename);
+        file << testMeshMaterialContents;
+        file.close();
+        file.open(meshFilename);
+        file << "mtllib " << materialFilename.substr(materialFilename.find_last_of('/') + 1) << "\n" << testMeshContents;
+        file.close();
+
+        badFilename = tmpnam(nullptr);
+        file.open(badFilename);
+        file << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n";
+        file.close();
+    }
+    virtual void TearDown() {
+        remove(meshFilename.c_str());
+        remove(materialFilename.c_str());
+        remove(badFilename.c_str());
+    }
+    std::string meshFilename;
+    std::string materialFilename;
+    std::string badFilename;
+    std::ofstream file;
+    MaterialManager mm;
+};
+
+TEST_F(MeshTest, LoadObj) {
+    Mesh mesh = Mesh::LoadObj(meshFilename, mm, 1);
+
+    // the repeated vertex is merged
+    EXPECT_EQ(mesh.GetVertices().size(), 8);
+    // six quads are twelve triangles
+    EXPECT_EQ(mesh.GetTriangleCount(), 12);
+    EXPECT_EQ(mesh.GetIndices().size(), 36);
+
+    // the first face references the repeated vertex (9) which is the same as vertex 1
+    EXPECT_EQ(mesh.GetIndices()[0], 0);
+    EXPECT_EQ(mesh.GetTriangle(0).GetVertex(0), Vector3f(0,0,0));
+    EXPECT_EQ(mesh.GetTriangle(0).GetVertex(1), Vector3f(0,1,0));
+    EXPECT_EQ(mesh.GetTriangle(0).GetVertex(2), Vector3f(1,1,0));
+    // relative indices
+    EXPECT_EQ(mesh.GetTriangle(10).GetVertex(0), Vector3f(1,0,0));
+    EXPECT_EQ(mesh.GetTriangle(10).GetVertex(1), Vector3f(1,1,0));
+    EXPECT_EQ(mesh.GetTriangle(10).GetVertex(2), Vector3f(1,1,1));
+
+    // materials (the first faces have no material so the default material is used)
+    const std::vector<uint> &materialIds = mesh.GetMaterialIds();
+    const uint defaultMaterial = materialIds[0];
+    const uint red = mm.GetMaterial(materialFilename, "Red");
+    const uint mirror = mm.GetMaterial(materialFilename, "Mirror");
+    for (uint i=0; i<4; i++)
+        EXPECT_EQ(materialIds[i], defaultMaterial);
+    for (uint i=4; i<8; i++)
+        EXPECT_EQ(materialIds[i], red);
+    for (uint i=8; i<12; i++)
+        EXPECT_EQ(materialIds[i], mirror);
+    EXPECT_EQ(mm.GetMaterial(red).color, Vector3f(.9F,.1F,.1F));
+    EXPECT_EQ(mm.GetMaterial(mirror).materialType, Material::SPECULAR);
+}
+
+TEST_F(MeshTest, LoadObjInParallel) {
+    // splitting the file into many chunks gives exactly the same mesh
+    Mesh expected = Mesh::LoadObj(meshFilename, mm, 1);
+    for (uint threads=2; threads<=16; threads++) {
+        Mesh mesh = Mesh::LoadObj(meshFilename, mm, threads);
+        EXPECT_EQ(mesh.GetVertices().size(), expected.GetVertices().size());
+        EXPECT_EQ(mesh.GetIndices(), expected.GetIndices());
+        EXPECT_EQ(mesh.GetMaterialIds().size(), expected.GetMaterialIds().size());
+        for (uint i=0; i<expected.GetTriangleCount(); i++)
+            EXPECT_EQ(mm.GetMaterial(mesh.GetMaterialIds()[i]), mm.GetMaterial(expected.GetMaterialIds()[i]));
+    }
+}
+
+TEST_F(MeshTest, BadObj) {
+    EXPECT_THROW(Mesh::LoadObj(badFilename, mm), ParseException);
+    EXPECT_THROW(Mesh::LoadObj(badFilename + "doesnotexist", mm), Tracer::FileReadException);
+}
@@ -0,0 +1,71 @@
+#include "PixelFilter.h"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "PixelFilter.hpp"
+
+using Tracer::PixelFilter;
+using Tracer::uint;
+
+///
+/// \brief Test where the filters take the samples of a pixel
+///
+class PixelFilterTest : public ::testing::Test {
+protected:
+    ///
+    /// \brief Returns how many of a grid of offsets are within the given distance of the center along x, and checks
+    /// every offset is within the filter's radius
+    ///
+    static float FractionWithin(const PixelFilter &filter, float distance) {
+        const uint size = 200;
+        uint within = 0;
+        for (uint i=0; i<size; i++) {
+            for (uint j=0; j<size; j++) {
+                float x, y;
+                filter.SampleOffset((i + .5F) / size, (j + .5F) / size, &x, &y);
+                EXPECT_LE(std::sqrt(x*x + y*y), filter.radius * (filter.type == PixelFilter::GAUSSIAN ? 1 : std::sqrt(2.F)) + 1e-5F);
+                if (std::abs(x) < distance) within++;
+            }
+        }
+        return static_cast<float>(within) / (size * size);
+    }
+};
+
+TEST_F(PixelFilterTest, Box) {
+    const PixelFilter box = { PixelFilter::BOX, 2 };
+    EXPECT_NEAR(FractionWithin(box, 1), .5F, .01F);
+    EXPECT_NEAR(FractionWithin(box, 1.5F), .75F, .01F);
+    float x, y;
+    box.SampleOffset(0, .5F, &x, &y);
+    EXPECT_FLOAT_EQ(x, -2);
+    EXPECT_FLOAT_EQ(y, 0);
+}
+
+TEST_F(PixelFilterTest, Tent) {
+    const PixelFilter tent = { PixelFilter::TENT, 1 };
+    EXPECT_NEAR(FractionWithin(tent, .5F), .75F, .01F);
+    EXPECT_NEAR(FractionWithin(tent, .25F), 1 - .75F*.75F, .01F);
+    float x, y;
+    tent.SampleOffset(.5F, .125F, &x, &y);
+    EXPECT_NEAR(x, 0, 1e-6F);
+    EXPECT_FLOAT_EQ(y, -.5F);
+}
+
+TEST_F(PixelFilterTest, Gaussian) {
+    // the standard deviation is a third of the radius, so about 68% of samples are within one of the center along x
+    const PixelFilter gaussian = { PixelFilter::GAUSSIAN, 3 };
+    EXPECT_NEAR(FractionWithin(gaussian, 1), .68F, .02F);
+    EXPECT_NEAR(FractionWithin(gaussian, 2), .96F, .02F);
+}
+
+TEST_F(PixelFilterTest, NoRadius) {
+    for (PixelFilter::Type type : { PixelFilter::BOX, PixelFilter::TENT, PixelFilter::GAUSSIAN }) {
+        const PixelFilter filter = { type, 0 };
+        float x, y;
+        filter.SampleOffset(.3F, .9F, &x, &y);
+        EXPECT_EQ(x, 0);
+        EXPECT_EQ(y, 0);
+    }
+}
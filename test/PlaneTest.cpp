@@ -0,0 +1,40 @@
+#include "ScenePrimative.h"
+
+#include <gtest/gtest.h>
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+
+using Tracer::Intersection;
+using Tracer::Plane;
+using Tracer::Vector3f;
+using Tracer::Ray;
+
+///
+/// \brief Test the infinite plane primative
+///
+class PlaneTest : public ::testing::Test {
+protected:
+    Plane floor = Plane(Vector3f(5,2,-7), Vector3f(0,3,0));
+    Plane tilted = Plane(Vector3f(1,0,0), Vector3f(1,1,0));
+};
+
+TEST_F(PlaneTest, Accessors) {
+    EXPECT_EQ(floor.GetNormal(), Vector3f(0,1,0));
+    EXPECT_FLOAT_EQ(floor.GetOffset(), 2);
+    // flat along the normal when perpendicular to an axis, otherwise as big as planes get
+    EXPECT_EQ(floor.GetBoundingBox().Min(), Vector3f(-Plane::BOUNDS_EXTENT(), 2, -Plane::BOUNDS_EXTENT()));
+    EXPECT_EQ(floor.GetBoundingBox().Max(), Vector3f(Plane::BOUNDS_EXTENT(), 2, Plane::BOUNDS_EXTENT()));
+    EXPECT_EQ(tilted.GetBoundingBox().Min(), Vector3f(-Plane::BOUNDS_EXTENT(), -Plane::BOUNDS_EXTENT(), -Plane::BOUNDS_EXTENT()));
+}
+
+TEST_F(PlaneTest, Intersection) {
+    EXPECT_EQ(floor.Intersect(Ray(Vector3f(100,10,-300),Vector3f(0,-1,0))), (Intersection { 8, Vector3f(0,1,0), Vector3f(100,2,-300) }) );
+    // from behind the normal is the same (it is up to the renderer to flip it)
+    EXPECT_EQ(floor.Intersect(Ray(Vector3f(0,0,0),Vector3f(0,1,0))), (Intersection { 2, Vector3f(0,1,0), Vector3f(0,2,0) }) );
+    EXPECT_EQ(tilted.Intersect(Ray(Vector3f(0,0,3),Vector3f(1,0,0))), (Intersection { 1, Vector3f(0.707107F,0.707107F,0), Vector3f(1,0,3) }) );
+    // misses
+    EXPECT_EQ(floor.Intersect(Ray(Vector3f(0,10,0),Vector3f(0,1,0))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(floor.Intersect(Ray(Vector3f(0,10,0),Vector3f(1,0,0))), Intersection::NO_INTERSECTION());
+    // a ray leaving the plane doesn't hit it again
+    EXPECT_EQ(floor.Intersect(Ray(Vector3f(0,2,0),Vector3f(0,1,0))), Intersection::NO_INTERSECTION());
+}
@@ -0,0 +1,110 @@
+#include "PrimativeArrays.h"
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "PrimativeArrays.hpp"
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+
+using Tracer::Box;
+using Tracer::Intersection;
+using Tracer::Plane;
+using Tracer::PrimativeArrays;
+using Tracer::PrimativeLayout;
+using Tracer::PrimativePointers;
+using Tracer::Quad;
+using Tracer::Ray;
+using Tracer::ScenePrimative;
+using Tracer::Sphere;
+using Tracer::Triangle;
+using Tracer::Vector3f;
+using Tracer::uint;
+
+///
+/// \brief Test storing primatives of every type as a structure of arrays
+///
+class PrimativeArraysTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-20, 20);
+        std::uniform_real_distribution<float> size(.5F, 4);
+        auto point = [&]() { return Vector3f(position(rng), position(rng), position(rng)); };
+        for (uint i=0; i<200; i++) {
+            const Vector3f p = point();
+            if (i % 5 == 0)
+                primatives.push_back(ScenePrimative(Sphere(size(rng), p), i));
+            else if (i % 5 == 1)
+                primatives.push_back(ScenePrimative(Triangle(p, p + Vector3f(size(rng), 0, 0), p + Vector3f(0, size(rng), size(rng))), i));
+            else if (i % 5 == 2 && i < 20)
+                primatives.push_back(ScenePrimative(Plane(p, point()), i));
+            else if (i % 5 == 3)
+                primatives.push_back(ScenePrimative(Quad(p, Vector3f(size(rng), 0, 0), Vector3f(0, 0, size(rng))), i));
+            else
+                primatives.push_back(ScenePrimative(Box(p, p + Vector3f(size(rng), size(rng), size(rng))), i));
+        }
+        arrays.Build(primatives);
+    }
+    ///
+    /// \brief Expects the arrays to be hit exactly where the primatives are for random rays
+    ///
+    void ExpectMatchesPrimatives(uint seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-30, 30);
+        const PrimativePointers pointers = arrays.GetPointers();
+        uint hits = 0;
+        for (uint i=0; i<200; i++) {
+            const Ray ray(Vector3f(position(rng), position(rng), position(rng)), Vector3f(position(rng), position(rng), position(rng)).Normalize());
+            for (uint id=0; id<primatives.size(); id++) {
+                const Intersection expected = primatives[id].Intersect(ray);
+                const Intersection actual = pointers.Intersect(id, ray);
+                EXPECT_EQ(actual.Distance(), expected.Distance());
+                if (expected == Intersection::NO_INTERSECTION()) continue;
+                hits++;
+                EXPECT_EQ(actual.Normal(), expected.Normal());
+            }
+        }
+        EXPECT_GT(hits, 300U);
+        for (uint id=0; id<primatives.size(); id++)
+            EXPECT_EQ(pointers.GetMaterialId(id), primatives[id].GetMaterialId());
+    }
+    std::vector<ScenePrimative> primatives;
+    PrimativeArrays arrays;
+};
+
+TEST_F(PrimativeArraysTest, Layout) {
+    const PrimativeLayout &layout = arrays.GetLayout();
+    EXPECT_EQ(layout.counts[PrimativeLayout::SPHERE], 40U);
+    EXPECT_EQ(layout.counts[PrimativeLayout::PLANE], 4U);
+    EXPECT_EQ(layout.counts[PrimativeLayout::BOX], 76U);
+    // every type's fields are one after the other, one array per float
+    EXPECT_EQ(layout.offsets[PrimativeLayout::TRIANGLE], 40U * 4);
+    EXPECT_EQ(arrays.GetData().size(), 40U*4 + 40U*9 + 4U*4 + 40U*9 + 76U*6);
+    EXPECT_EQ(arrays.GetMaterialIds().size(), primatives.size());
+    EXPECT_EQ(arrays.GetReferences()[5], PrimativeLayout::SPHERE << PrimativeArrays::TYPE_SHIFT | 1U);
+    EXPECT_EQ(arrays.GetData()[2*40 + 1], primatives[5].GetSphere()->GetPosition().Z());
+    EXPECT_FLOAT_EQ(arrays.GetData()[3*40 + 1], primatives[5].GetSphere()->GetRadius() * primatives[5].GetSphere()->GetRadius());
+}
+
+TEST_F(PrimativeArraysTest, Intersect) {
+    ExpectMatchesPrimatives(3);
+}
+
+TEST_F(PrimativeArraysTest, Update) {
+    // primatives that keep their type are stored in place
+    primatives[10] = ScenePrimative(Sphere(2, Vector3f(1, 2, 3)), 77);
+    primatives[11] = ScenePrimative(Triangle(Vector3f(0,0,0), Vector3f(5,0,0), Vector3f(0,5,0)), 78);
+    const std::vector<uint> references = arrays.GetReferences();
+    arrays.Update(primatives, { 10, 11 });
+    EXPECT_EQ(arrays.GetReferences(), references);
+    ExpectMatchesPrimatives(5);
+
+    // a primative that changes type lays out everything again
+    primatives[10] = ScenePrimative(Box(Vector3f(0,0,0), Vector3f(1,1,1)), 79);
+    arrays.Update(primatives, { 10 });
+    EXPECT_EQ(arrays.GetLayout().counts[PrimativeLayout::SPHERE], 39U);
+    ExpectMatchesPrimatives(9);
+}
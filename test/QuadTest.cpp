@@ -0,0 +1,56 @@
+#include "ScenePrimative.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+
+using Tracer::Intersection;
+using Tracer::Quad;
+using Tracer::Vector3f;
+using Tracer::Ray;
+using Tracer::uint;
+
+///
+/// \brief Test the parallelogram primative
+///
+class QuadTest : public ::testing::Test {
+protected:
+    Quad wall = Quad(Vector3f(1,0,0), Vector3f(0,2,0), Vector3f(0,0,3));
+    Quad slanted = Quad(Vector3f(0,0,0), Vector3f(2,0,0), Vector3f(1,1,0));
+};
+
+TEST_F(QuadTest, Accessors) {
+    EXPECT_EQ(wall.GetCorner(), Vector3f(1,0,0));
+    EXPECT_EQ(wall.GetEdgeU(), Vector3f(0,2,0));
+    EXPECT_EQ(wall.GetEdgeV(), Vector3f(0,0,3));
+    EXPECT_EQ(wall.GetBoundingBox().Min(), Vector3f(1,0,0));
+    EXPECT_EQ(wall.GetBoundingBox().Max(), Vector3f(1,2,3));
+    EXPECT_EQ(slanted.GetBoundingBox().Max(), Vector3f(3,1,0));
+}
+
+TEST_F(QuadTest, Intersection) {
+    EXPECT_EQ(wall.Intersect(Ray(Vector3f(5,1,2),Vector3f(-1,0,0))), (Intersection { 4, Vector3f(1,0,0), Vector3f(1,1,2) }) );
+    // from behind the normal is the same (it is up to the renderer to flip it)
+    EXPECT_EQ(wall.Intersect(Ray(Vector3f(-1,1,2),Vector3f(1,0,0))), (Intersection { 2, Vector3f(1,0,0), Vector3f(1,1,2) }) );
+    // inside the parallelogram but outside of the rectangle with the same bounds
+    EXPECT_EQ(slanted.Intersect(Ray(Vector3f(2.5F,.9F,1),Vector3f(0,0,-1))), (Intersection { 1, Vector3f(0,0,1), Vector3f(2.5F,.9F,0) }) );
+    // misses
+    EXPECT_EQ(slanted.Intersect(Ray(Vector3f(.5F,.9F,1),Vector3f(0,0,-1))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(wall.Intersect(Ray(Vector3f(5,2.5F,2),Vector3f(-1,0,0))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(wall.Intersect(Ray(Vector3f(5,1,2),Vector3f(1,0,0))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(wall.Intersect(Ray(Vector3f(5,1,2),Vector3f(0,1,0))), Intersection::NO_INTERSECTION());
+}
+
+TEST_F(QuadTest, Triangles) {
+    // a parallelogram is hit exactly where the two triangles it is made of are
+    const Tracer::Triangle t1(Vector3f(0,0,0), Vector3f(2,0,0), Vector3f(3,1,0));
+    const Tracer::Triangle t2(Vector3f(0,0,0), Vector3f(3,1,0), Vector3f(1,1,0));
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-1, 4);
+    for (uint i=0; i<1000; i++) {
+        const Ray ray(Vector3f(position(rng), position(rng), 2), Vector3f(0,0,-1));
+        const bool hitTriangles = t1.Intersect(ray) != Intersection::NO_INTERSECTION() || t2.Intersect(ray) != Intersection::NO_INTERSECTION();
+        EXPECT_EQ(slanted.Intersect(ray) != Intersection::NO_INTERSECTION(), hitTriangles);
+    }
+}
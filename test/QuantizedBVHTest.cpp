@@ -0,0 +1,192 @@
+#include "QuantizedBVH.h"
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AccelerationStructure.hpp"
+#include "BVH.hpp"
+#include "QuantizedBVH.hpp"
+#include "RandomSpheres.h"
+#include "Scene.h"
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+#include "WideBVH.hpp"
+
+using Tracer::AABB;
+using Tracer::AccelerationStructure;
+using Tracer::BVH;
+using Tracer::BVHNode;
+using Tracer::ClosestPrimativeIntersector;
+using Tracer::Intersection;
+using Tracer::QuantizedBVH;
+using Tracer::QuantizedBVHNode;
+using Tracer::Ray;
+using Tracer::Scene;
+using Tracer::ScenePrimative;
+using Tracer::Sphere;
+using Tracer::Transform;
+using Tracer::TraverseBVH;
+using Tracer::Triangle;
+using Tracer::Vector3f;
+using Tracer::WideBVH;
+using Tracer::WideBVHNode;
+using Tracer::uint;
+
+///
+/// \brief Test compressing wide BVHs into quantized nodes and traversing them
+///
+class QuantizedBVHTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        primatives = RandomSpheres(2000);
+        // a tiny cluster far from the origin and a flat triangle need very fine steps
+        for (uint i=0; i<20; i++)
+            primatives.push_back(ScenePrimative(Sphere(.001F, Vector3f(5000 + i * .003F, 5000, 5000)), i));
+        primatives.push_back(ScenePrimative(Triangle(Vector3f(-50,7,-50), Vector3f(0,7,50), Vector3f(50,7,-50)), 0));
+        bvh.Build(primatives);
+    }
+    ///
+    /// \brief Expects every compressed child's bounds to contain the uncompressed bounds, and to stay close to them
+    ///
+    template<uint Width>
+    void ExpectConservative() {
+        std::vector<WideBVHNode<Width>> wideNodes;
+        WideBVH<Width>::Collapse(bvh.GetNodes(), 0, &wideNodes);
+        std::vector<QuantizedBVHNode<Width>> quantizedNodes;
+        QuantizedBVH<Width>::Compress(wideNodes, &quantizedNodes);
+        ASSERT_EQ(quantizedNodes.size(), wideNodes.size());
+        for (uint n=0; n<wideNodes.size(); n++) {
+            const WideBVHNode<Width> &node = wideNodes[n];
+            const QuantizedBVHNode<Width> &quantizedNode = quantizedNodes[n];
+            AABB nodeBounds;
+            for (uint i=0; i<Width; i++)
+                if (node.child[i] != WideBVHNode<Width>::EMPTY_CHILD)
+                    nodeBounds.Grow(AABB(Vector3f(node.boundsMinX[i], node.boundsMinY[i], node.boundsMinZ[i]),
+                                         Vector3f(node.boundsMaxX[i], node.boundsMaxY[i], node.boundsMaxZ[i])));
+            for (uint i=0; i<Width; i++) {
+                EXPECT_EQ(quantizedNode.child[i], node.child[i]);
+                EXPECT_EQ(quantizedNode.count[i], node.count[i]);
+                if (node.child[i] == WideBVHNode<Width>::EMPTY_CHILD) {
+                    EXPECT_TRUE(quantizedNode.GetChildBounds(i).IsEmpty());
+                    continue;
+                }
+                const AABB bounds = quantizedNode.GetChildBounds(i);
+                const float childMin[3] = { node.boundsMinX[i], node.boundsMinY[i], node.boundsMinZ[i] };
+                const float childMax[3] = { node.boundsMaxX[i], node.boundsMaxY[i], node.boundsMaxZ[i] };
+                for (uint axis=0; axis<3; axis++) {
+                    EXPECT_LE(bounds.Min()[axis], childMin[axis]);
+                    EXPECT_GE(bounds.Max()[axis], childMax[axis]);
+                    // no more than a couple of the 255 steps looser than the real bounds
+                    const float step = 2 * nodeBounds.Extent()[axis] / 255;
+                    EXPECT_LE(childMin[axis] - bounds.Min()[axis], step + 1e-3F);
+                    EXPECT_LE(bounds.Max()[axis] - childMax[axis], step + 1e-3F);
+                }
+            }
+        }
+    }
+    ///
+    /// \brief Expects the compressed nodes to find exactly what the binary nodes find
+    ///
+    template<uint Width>
+    void ExpectSameAsBinary() {
+        std::vector<WideBVHNode<Width>> wideNodes;
+        const uint root = WideBVH<Width>::Collapse(bvh.GetNodes(), 0, &wideNodes);
+        std::vector<QuantizedBVHNode<Width>> quantizedNodes;
+        QuantizedBVH<Width>::Compress(wideNodes, &quantizedNodes);
+
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-150, 150);
+        for (uint i=0; i<2000; i++) {
+            // some rays are axis aligned (infinite inverse directions)
+            Vector3f direction(position(rng), position(rng), position(rng));
+            if (i % 10 == 0) direction = Vector3f(0, i % 20 ? 1.F : -1.F, 0);
+            const Ray ray(Vector3f(position(rng), position(rng), position(rng)), direction.Normalize());
+
+            ClosestPrimativeIntersector<const ScenePrimative*> expected(ray, primatives.data());
+            TraverseBVH(ray, bvh.GetNodes().data(), bvh.GetIndices().data(), 0, &expected);
+            ClosestPrimativeIntersector<const ScenePrimative*> actual(ray, primatives.data());
+            TraverseBVH(ray, quantizedNodes.data(), bvh.GetIndices().data(), root, &actual);
+            EXPECT_EQ(actual.bestIntersection, expected.bestIntersection);
+            EXPECT_EQ(actual.primativeId, expected.primativeId);
+        }
+    }
+    std::vector<ScenePrimative> primatives;
+    BVH bvh;
+};
+
+TEST_F(QuantizedBVHTest, Size) {
+    // smaller than the uncompressed nodes they replace
+    EXPECT_LE(sizeof(QuantizedBVHNode<2>), 48);
+    EXPECT_LT(sizeof(QuantizedBVHNode<2>), 2 * sizeof(BVHNode));
+    EXPECT_LT(sizeof(QuantizedBVHNode<4>), sizeof(WideBVHNode<4>));
+    EXPECT_LT(sizeof(QuantizedBVHNode<8>), sizeof(WideBVHNode<8>));
+}
+
+TEST_F(QuantizedBVHTest, Conservative) {
+    ExpectConservative<2>();
+    ExpectConservative<4>();
+    ExpectConservative<8>();
+}
+
+TEST_F(QuantizedBVHTest, Traverse) {
+    ExpectSameAsBinary<2>();
+    ExpectSameAsBinary<4>();
+    ExpectSameAsBinary<8>();
+}
+
+TEST_F(QuantizedBVHTest, AccelerationStructure) {
+    // instances and scene primatives are found the same way with compressed nodes of every width
+    Scene scene;
+    std::vector<ScenePrimative> object;
+    object.push_back(ScenePrimative(Sphere(1, Vector3f(0,1,0)), 0));
+    object.push_back(ScenePrimative(Triangle(Vector3f(-2,0,-2), Vector3f(0,0,2), Vector3f(2,0,-2)), 1));
+    const uint objectId = scene.AddObject(object);
+    for (uint i=0; i<100; i++)
+        scene.AddInstance(objectId, Transform::Translate(Vector3f(i % 10 * 5.F, i / 10 * 5.F, 0)), i % 3 ? 2 : Tracer::Instance::NO_MATERIAL_OVERRIDE);
+    for (uint i=0; i<500; i++)
+        scene.AddPrimative(primatives[i]);
+
+    AccelerationStructure structure;
+    structure.Build(scene);
+    AccelerationStructure compressedStructure;
+    compressedStructure.Build(scene);
+    compressedStructure.SetCompressedNodes(true);
+    EXPECT_TRUE(compressedStructure.GetCompressedNodes());
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> position(-100, 100);
+    for (uint width : {2U, 4U, 8U}) {
+        compressedStructure.SetNodeWidth(width);
+        // only the nodes of the current width are kept
+        EXPECT_EQ(compressedStructure.GetQuantizedNodes2().empty(), width != 2);
+        EXPECT_EQ(compressedStructure.GetQuantizedNodes4().empty(), width != 4);
+        EXPECT_EQ(compressedStructure.GetQuantizedNodes8().empty(), width != 8);
+        EXPECT_TRUE(compressedStructure.GetNodes4().empty());
+        EXPECT_TRUE(compressedStructure.GetNodes8().empty());
+        for (uint i=0; i<1000; i++) {
+            const Ray ray(Vector3f(position(rng), position(rng), -100), Vector3f(position(rng) / 4, position(rng) / 4, 100).Normalize());
+            const auto &s = structure;
+            const auto &c = compressedStructure;
+            uint expectedMaterial = 0, actualMaterial = 0;
+            const Intersection expected = AccelerationStructure::Intersect(ray, s.GetNodes().data(), s.GetIndices().data(), s.GetPrimatives().data(),
+                                                                           s.GetInstances().data(), 100, s.GetTopLevelRoot(), &expectedMaterial);
+            const Intersection actual = width == 2 ?
+                        AccelerationStructure::Intersect(ray, c.GetQuantizedNodes2().data(), c.GetIndices().data(), c.GetPrimatives().data(),
+                                                         c.GetInstances().data(), 100, c.GetWideTopLevelRoot(), &actualMaterial)
+                      : width == 4 ?
+                        AccelerationStructure::Intersect(ray, c.GetQuantizedNodes4().data(), c.GetIndices().data(), c.GetPrimatives().data(),
+                                                         c.GetInstances().data(), 100, c.GetWideTopLevelRoot(), &actualMaterial)
+                      : AccelerationStructure::Intersect(ray, c.GetQuantizedNodes8().data(), c.GetIndices().data(), c.GetPrimatives().data(),
+                                                         c.GetInstances().data(), 100, c.GetWideTopLevelRoot(), &actualMaterial);
+            EXPECT_EQ(actual, expected);
+            EXPECT_EQ(actualMaterial, expectedMaterial);
+        }
+    }
+
+    // turning compression off goes back to the uncompressed wide nodes
+    compressedStructure.SetCompressedNodes(false);
+    EXPECT_TRUE(compressedStructure.GetQuantizedNodes8().empty());
+    EXPECT_FALSE(compressedStructure.GetNodes8().empty());
+}
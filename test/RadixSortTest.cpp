@@ -0,0 +1,84 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Tracer::RadixSort;
+using Tracer::uint;
+
+///
+/// \brief Test sorting keys and values with SYCL kernels on the host device
+///
+class RadixSortTest : public ::testing::Test {
+protected:
+    RadixSortTest() : queue(cl::sycl::host_selector()) {}
+    ///
+    /// \brief Sorts the first count keys by their lowest bits and returns the keys and values (values start as the position of their key)
+    ///
+    std::vector<std::pair<uint,uint>> Sort(const std::vector<uint> &keys, uint count, uint bits) {
+        std::vector<uint> sortedKeys = keys, values(keys.size());
+        for (uint i=0; i<values.size(); i++)
+            values[i] = i;
+        {
+            cl::sycl::buffer<uint,1> keyBuffer(sortedKeys.data(), cl::sycl::range<1>(sortedKeys.size()));
+            cl::sycl::buffer<uint,1> valueBuffer(values.data(), cl::sycl::range<1>(values.size()));
+            radixSort.Sort(queue, keyBuffer, valueBuffer, count, bits);
+            queue.wait_and_throw();
+        }
+        std::vector<std::pair<uint,uint>> sorted;
+        for (uint i=0; i<keys.size(); i++)
+            sorted.push_back(std::make_pair(sortedKeys[i], values[i]));
+        return sorted;
+    }
+    cl::sycl::queue queue;
+    RadixSort radixSort;
+};
+
+TEST_F(RadixSortTest, Sort) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<uint> key(0, 0xFFFFFFFF);
+    std::vector<uint> keys(3000);
+    for (uint &k : keys)
+        k = key(rng);
+    const std::vector<std::pair<uint,uint>> sorted = Sort(keys, 3000, 32);
+    for (uint i=0; i<3000; i++) {
+        EXPECT_EQ(keys[sorted[i].second], sorted[i].first);
+        if (i > 0) {
+            EXPECT_LE(sorted[i-1].first, sorted[i].first);
+        }
+    }
+}
+
+TEST_F(RadixSortTest, Stable) {
+    // small keys need fewer passes, equal keys keep their order
+    std::mt19937 rng(6);
+    std::uniform_int_distribution<uint> key(0, 31);
+    std::vector<uint> keys(1000);
+    for (uint &k : keys)
+        k = key(rng);
+    const std::vector<std::pair<uint,uint>> sorted = Sort(keys, 1000, 5);
+    for (uint i=1; i<1000; i++) {
+        EXPECT_LE(sorted[i-1].first, sorted[i].first);
+        if (sorted[i-1].first == sorted[i].first) {
+            EXPECT_LT(sorted[i-1].second, sorted[i].second);
+        }
+    }
+}
+
+TEST_F(RadixSortTest, Partial) {
+    // the keys past the count are left alone, and sorting more keys later grows the buffers
+    const std::vector<uint> keys = { 9, 3, 7, 1, 0, 2 };
+    std::vector<std::pair<uint,uint>> sorted = Sort(keys, 4, 8);
+    EXPECT_EQ(sorted, (std::vector<std::pair<uint,uint>>{ {1,3}, {3,1}, {7,2}, {9,0}, {0,4}, {2,5} }));
+    std::vector<uint> more(600);
+    for (uint i=0; i<600; i++)
+        more[i] = 599 - i;
+    sorted = Sort(more, 600, 10);
+    for (uint i=0; i<600; i++)
+        EXPECT_EQ(sorted[i], std::make_pair(i, 599 - i));
+    EXPECT_EQ(RadixSort::PassCount(5), 2U);
+    EXPECT_EQ(RadixSort::PassCount(30), 4U);
+}
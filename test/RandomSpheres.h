@@ -0,0 +1,26 @@
+#ifndef TRACER_TEST_RANDOMSPHERES_H
+#define TRACER_TEST_RANDOMSPHERES_H
+
+#include <random>
+#include <vector>
+
+#include "Common.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+
+///
+/// \brief Returns spheres scattered randomly through a 200 unit cube around the origin, the same ones every time.
+/// The material id of every sphere is its index.  Used by the tests that build BVHs over a large scene.
+///
+inline std::vector<Tracer::ScenePrimative> RandomSpheres(Tracer::uint count) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-100, 100);
+    std::uniform_real_distribution<float> radius(.5F, 5);
+    std::vector<Tracer::ScenePrimative> spheres;
+    spheres.reserve(count);
+    for (Tracer::uint i=0; i<count; i++)
+        spheres.push_back(Tracer::ScenePrimative(Tracer::Sphere(radius(rng), Tracer::Vector3f(position(rng), position(rng), position(rng))), i));
+    return spheres;
+}
+
+#endif // TRACER_TEST_RANDOMSPHERES_H
@@ -0,0 +1,378 @@
+#include "Renderer.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AccumulationBuffer.h"
+#include "Camera.h"
+#include "Image.h"
+#include "Material.h"
+#include "Scene.h"
+#include "ScenePrimative.h"
+#include "Vector.h"
+
+using Tracer::AccumulatedPixel;
+using Tracer::AccumulationBuffer;
+using Tracer::Camera;
+using Tracer::Color;
+using Tracer::Image;
+using Tracer::Material;
+using Tracer::PixelFilter;
+using Tracer::Quad;
+using Tracer::Renderer;
+using Tracer::Scene;
+using Tracer::Sphere;
+using Tracer::Vector;
+using Tracer::Vector3f;
+using Tracer::uint;
+
+///
+/// \brief Test rendering scenes on the host
+///
+class RendererTest : public ::testing::Test {
+protected:
+    RendererTest() : renderer(true), camera(Vector3f(0,0,1), Vector3f(0,0,0), Vector3f(0,8,0), 1, Vector<float,4>({-1,-1,1,1})) {
+        // a floor lit by a small light, seen from above
+        scene.AddPrimative(Quad(Vector3f(-10,0,-10), Vector3f(0,0,20), Vector3f(20,0,0)), Material(Color(0,0,0), Color(.75F,.75F,.75F), Material::DIFFUSE));
+        scene.AddPrimative(Sphere(.5F, Vector3f(2,4,1)), Material(Color(40,40,40), Color(0,0,0), Material::DIFFUSE));
+    }
+    ///
+    /// \brief Renders the scene at 8x8 and returns the brightness of every pixel (before gamma correction)
+    ///
+    std::vector<float> Render(uint samplesPerPixel) {
+        Image image(8, 8);
+        renderer.RenderScene(scene, camera, samplesPerPixel, &image);
+        std::vector<float> brightness;
+        for (uint y=0; y<8; y++)
+            for (uint x=0; x<8; x++)
+                brightness.push_back(std::pow(image.GetPixel(x,y).R() / 255.F, 2.2F));
+        return brightness;
+    }
+    ///
+    /// \brief Returns the average difference between the pixels of two renders
+    ///
+    static float Error(const std::vector<float> &a, const std::vector<float> &b) {
+        float error = 0;
+        for (uint i=0; i<a.size(); i++)
+            error += std::fabs(a[i] - b[i]);
+        return error / a.size();
+    }
+    static float Mean(const std::vector<float> &a) {
+        float sum = 0;
+        for (float v : a)
+            sum += v;
+        return sum / a.size();
+    }
+    Renderer renderer;
+    Scene scene;
+    Camera camera;
+};
+
+TEST_F(RendererTest, LightSampling) {
+    // sampling the light directly converges to the same image far faster than waiting for bounces to hit it
+    EXPECT_TRUE(renderer.GetLightSampling());
+    renderer.SetLightSampling(false);
+    const std::vector<float> reference = Render(4096);
+    const std::vector<float> bouncesOnly = Render(32);
+    renderer.SetLightSampling(true);
+    const std::vector<float> lightSampled = Render(32);
+
+    EXPECT_GT(Mean(reference), .05F);
+    EXPECT_NEAR(Mean(lightSampled), Mean(reference), Mean(reference) * .05F);
+    EXPECT_LT(Error(lightSampled, reference) * 3, Error(bouncesOnly, reference));
+}
+
+TEST_F(RendererTest, Seed) {
+    // the same seed renders exactly the same image, another seed renders another image (of the same scene)
+    EXPECT_EQ(renderer.GetSeed(), 0U);
+    const std::vector<float> first = Render(4);
+    EXPECT_EQ(Render(4), first);
+    renderer.SetSeed(12345);
+    const std::vector<float> reseeded = Render(4);
+    EXPECT_NE(reseeded, first);
+    EXPECT_NEAR(Mean(reseeded), Mean(first), Mean(first) * .15F);
+    EXPECT_EQ(Render(4), reseeded);
+}
+
+TEST_F(RendererTest, RussianRoulette) {
+    // walls around the floor so light bounces around
+    scene.AddPrimative(Quad(Vector3f(-3,0,-3), Vector3f(0,6,0), Vector3f(6,0,0)), Material(Color(0,0,0), Color(.8F,.2F,.2F), Material::DIFFUSE));
+    scene.AddPrimative(Quad(Vector3f(-3,0,-3), Vector3f(0,6,0), Vector3f(0,0,6)), Material(Color(0,0,0), Color(.2F,.8F,.2F), Material::DIFFUSE));
+    EXPECT_EQ(renderer.GetMaxDepth(), 16U);
+    EXPECT_EQ(renderer.GetRouletteDepth(), 3U);
+    EXPECT_THROW(renderer.SetMaxDepth(0), std::invalid_argument);
+
+    // stopping paths at random doesn't change the image on average
+    const std::vector<float> roulette = Render(1024);
+    renderer.SetRouletteDepth(16);
+    const std::vector<float> everyBounce = Render(1024);
+    EXPECT_NEAR(Mean(roulette), Mean(everyBounce), Mean(everyBounce) * .03F);
+    EXPECT_LT(Error(roulette, everyBounce), .01F);
+
+    // only lit directly
+    renderer.SetMaxDepth(1);
+    EXPECT_LT(Mean(Render(1024)), Mean(everyBounce) * .95F);
+}
+
+TEST_F(RendererTest, RenderPass) {
+    // passes carry on from the samples already accumulated, so two passes render exactly what one bigger pass does
+    AccumulationBuffer passes(8, 8), single(8, 8);
+    renderer.RenderPass(scene, camera, &passes, 2);
+    renderer.RenderPass(scene, camera, &passes, 3);
+    renderer.RenderPass(scene, camera, &single, 5);
+    EXPECT_EQ(passes.GetTotalSampleCount(), 5U * 64);
+    float brightest = 0;
+    for (uint y=0; y<8; y++) {
+        for (uint x=0; x<8; x++) {
+            for (uint c=0; c<3; c++)
+                EXPECT_NEAR(passes.GetColor(x,y)[c], single.GetColor(x,y)[c], 1e-4F);
+            brightest = std::fmax(brightest, passes.GetColor(x,y).R());
+        }
+    }
+    EXPECT_GT(brightest, 0);
+
+    // rendering an image is resolving a single pass
+    Image image(8, 8);
+    renderer.RenderScene(scene, camera, 5, &image);
+    Image resolved = single.Resolve();
+    for (uint y=0; y<8; y++)
+        for (uint x=0; x<8; x++)
+            EXPECT_EQ(image.GetPixel(x,y), resolved.GetPixel(x,y));
+}
+
+TEST_F(RendererTest, TimeSlicing) {
+    EXPECT_EQ(renderer.GetLaunchSeconds(), .05);
+    EXPECT_THROW(renderer.SetLaunchSeconds(0), std::invalid_argument);
+    // a size that isn't a multiple of the workgroup size
+    AccumulationBuffer single(30, 30), sliced(30, 30);
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &single, 6), 6U);
+
+    // tiny launches split every sample into waves of pixels but render the same samples
+    renderer.SetLaunchSeconds(1e-9);
+    std::vector<double> progress;
+    renderer.SetProgressCallback([&](double p) { progress.push_back(p); return true; });
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &sliced, 6), 6U);
+    EXPECT_GT(renderer.GetLastRenderStats().launches, 6U * 900 / 64);
+    EXPECT_EQ(renderer.GetLastRenderStats().samplesPerPixel, 6U);
+    EXPECT_GT(renderer.GetLastRenderStats().samplesPerSecond, 0);
+    for (uint y=0; y<30; y++)
+        for (uint x=0; x<30; x++)
+            for (uint c=0; c<3; c++)
+                EXPECT_NEAR(sliced.GetColor(x,y)[c], single.GetColor(x,y)[c], 1e-4F);
+    ASSERT_EQ(progress.size(), renderer.GetLastRenderStats().launches);
+    EXPECT_EQ(progress[0], 0);
+    for (uint i=1; i<progress.size(); i++)
+        EXPECT_GT(progress[i], progress[i-1]);
+    EXPECT_LT(progress.back(), 1);
+
+    // cancelling in the middle of a sample keeps only the samples every pixel has
+    AccumulationBuffer cancelled(30, 30);
+    renderer.SetProgressCallback([](double p) { return p < .4; });
+    const uint samples = renderer.RenderPass(scene, camera, &cancelled, 6);
+    EXPECT_EQ(samples, 2U);
+    EXPECT_EQ(cancelled.GetTotalSampleCount(), 2U * 900);
+    AccumulationBuffer two(30, 30);
+    renderer.SetProgressCallback(nullptr);
+    renderer.RenderPass(scene, camera, &two, 2);
+    for (uint c=0; c<3; c++)
+        EXPECT_NEAR(cancelled.GetColor(15,15)[c], two.GetColor(15,15)[c], 1e-4F);
+}
+
+TEST_F(RendererTest, AdaptiveSampling) {
+    EXPECT_EQ(renderer.GetAdaptiveThreshold(), 0);
+    EXPECT_EQ(renderer.GetAdaptiveSamples(), 16U);
+    EXPECT_THROW(renderer.SetAdaptiveSamples(0), std::invalid_argument);
+    // the sky above the floor is black and converges right away, the lit floor needs many more samples
+    camera = Camera(Vector3f(0,1,0), Vector3f(0,1,0), Vector3f(0,3,-8), 1, Vector<float,4>({-1,-1,1,1}));
+    renderer.SetPixelFilter(PixelFilter::BOX, 0);
+    AccumulationBuffer uniform(16, 16), adaptive(16, 16);
+    renderer.RenderPass(scene, camera, &uniform, 256);
+    EXPECT_EQ(renderer.GetLastRenderStats().totalSamples, 256U * 256);
+
+    renderer.SetAdaptiveThreshold(.003F);
+    renderer.SetAdaptiveSamples(8);
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &adaptive, 256), 256U);
+    // about half of the pixels are sky
+    EXPECT_EQ(renderer.GetLastRenderStats().totalSamples, adaptive.GetTotalSampleCount());
+    EXPECT_LT(adaptive.GetTotalSampleCount() * 3, uniform.GetTotalSampleCount() * 2);
+    uint converged = 0;
+    float error = 0;
+    for (uint y=0; y<16; y++) {
+        for (uint x=0; x<16; x++) {
+            const uint samples = adaptive.GetSampleCount(x,y);
+            EXPECT_GE(samples, 8U);
+            EXPECT_EQ(samples % 8, 0U);
+            // pixels stop once their error is below the threshold
+            EXPECT_TRUE(samples == 256 || adaptive.GetPixel(x,y).RelativeError() <= .003F);
+            if (adaptive.GetPixel(x,y).RelativeError() <= .003F) converged++;
+            error += std::fabs(Tracer::AccumulatedPixel::Brightness(adaptive.GetColor(x,y)) - Tracer::AccumulatedPixel::Brightness(uniform.GetColor(x,y)));
+        }
+    }
+    EXPECT_GT(converged, 64U);
+    EXPECT_LT(error / 256, .01F);
+
+    // another pass only renders the pixels that haven't converged
+    const Tracer::uint64 before = adaptive.GetTotalSampleCount();
+    renderer.RenderPass(scene, camera, &adaptive, 8);
+    EXPECT_EQ(adaptive.GetTotalSampleCount() - before, 8U * (256 - converged));
+}
+
+TEST_F(RendererTest, Samplers) {
+    // every sampler renders the same image on average, spreading the samples evenly gets there faster
+    EXPECT_EQ(renderer.GetSampler(), Tracer::Sampler::SOBOL);
+    // (samples at the center of the pixels, a sample catching the edge of the bright light would outweigh the rest)
+    renderer.SetPixelFilter(PixelFilter::BOX, 0);
+    const std::vector<float> reference = Render(4096);
+    float errors[4];
+    for (Tracer::Sampler::Type type : { Tracer::Sampler::INDEPENDENT, Tracer::Sampler::STRATIFIED, Tracer::Sampler::SOBOL, Tracer::Sampler::BLUE_NOISE }) {
+        renderer.SetSampler(type);
+        const std::vector<float> image = Render(16);
+        EXPECT_NEAR(Mean(image), Mean(reference), Mean(reference) * .05F);
+        errors[type] = Error(image, reference);
+    }
+    EXPECT_LT(errors[Tracer::Sampler::STRATIFIED], errors[Tracer::Sampler::INDEPENDENT]);
+    EXPECT_LT(errors[Tracer::Sampler::SOBOL] * 1.5F, errors[Tracer::Sampler::INDEPENDENT]);
+}
+
+TEST_F(RendererTest, PixelFilter) {
+    EXPECT_EQ(renderer.GetPixelFilter().type, PixelFilter::TENT);
+    EXPECT_EQ(renderer.GetPixelFilter().radius, 1);
+    EXPECT_THROW(renderer.SetPixelFilter(PixelFilter::BOX, -1), std::invalid_argument);
+    // a glowing floor whose edge is between the centers of two columns of pixels (column 4 is .157 pixels from the edge)
+    Scene edge;
+    edge.AddPrimative(Quad(Vector3f(-10,.01F,-10), Vector3f(8.5F,0,0), Vector3f(0,0,20)), Material(Color(1,1,1), Color(0,0,0), Material::DIFFUSE));
+    auto render = [&](PixelFilter::Type type, float radius) {
+        renderer.SetPixelFilter(type, radius);
+        AccumulationBuffer accumulation(8, 8);
+        renderer.RenderPass(edge, camera, &accumulation, 256);
+        std::vector<float> row;
+        for (uint x=0; x<8; x++)
+            row.push_back(accumulation.GetColor(x, 3).R());
+        return row;
+    };
+
+    // without a filter the edge is sharp
+    EXPECT_EQ(render(PixelFilter::BOX, 0), std::vector<float>({0, 0, 0, 0, 0, 1, 1, 1}));
+    // with one the pixels next to it are covered as much as the filter covers the floor
+    const std::vector<float> box = render(PixelFilter::BOX, .5F);
+    EXPECT_EQ(box[3], 0);
+    EXPECT_NEAR(box[4], .343F, .01F);
+    EXPECT_EQ(box[5], 1);
+    const std::vector<float> tent = render(PixelFilter::TENT, 1);
+    EXPECT_EQ(tent[3], 0);
+    EXPECT_NEAR(tent[4], .355F, .01F);
+    EXPECT_NEAR(tent[5], .987F, .01F);
+    const std::vector<float> gaussian = render(PixelFilter::GAUSSIAN, 1.5F);
+    EXPECT_NEAR(gaussian[4], .376F, .02F);
+    EXPECT_GT(gaussian[3], 0);
+}
+
+TEST_F(RendererTest, Wavefront) {
+    // the host runs the megakernel by default
+    EXPECT_FALSE(renderer.GetWavefront());
+    // paths hitting every kind of material
+    scene.AddPrimative(Sphere(1, Vector3f(-2,1,0)), Material(Color(0,0,0), Color(.9F,.9F,.9F), Material::SPECULAR));
+    scene.AddPrimative(Sphere(1, Vector3f(1,1,-2)), Material(Color(0,0,0), Color(.9F,.9F,.9F), Material::REFRACTION));
+    AccumulationBuffer megakernel(20, 20), wavefront(20, 20), waves(20, 20);
+    renderer.RenderPass(scene, camera, &megakernel, 8);
+
+    // the wavefront renders exactly the same paths, whether launches cover every pixel or waves of them
+    renderer.SetWavefront(true);
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &wavefront, 8), 8U);
+    renderer.SetLaunchSeconds(1e-9);
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &waves, 8), 8U);
+    EXPECT_GT(renderer.GetLastRenderStats().launches, 8U);
+    for (uint y=0; y<20; y++) {
+        for (uint x=0; x<20; x++) {
+            for (uint c=0; c<3; c++) {
+                EXPECT_FLOAT_EQ(wavefront.GetColor(x,y)[c], megakernel.GetColor(x,y)[c]);
+                EXPECT_FLOAT_EQ(waves.GetColor(x,y)[c], megakernel.GetColor(x,y)[c]);
+            }
+            EXPECT_NEAR(wavefront.GetPixel(x,y).m2, megakernel.GetPixel(x,y).m2, 1e-5F * (1 + megakernel.GetPixel(x,y).m2));
+        }
+    }
+    EXPECT_EQ(renderer.GetLastRenderStats().sortSeconds, 0);
+
+    // sorting the rays and hits only changes the order paths are traced in
+    EXPECT_FALSE(renderer.GetSortRays());
+    renderer.SetSortRays(true);
+    renderer.SetLaunchSeconds(1);
+    AccumulationBuffer sorted(20, 20);
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &sorted, 8), 8U);
+    EXPECT_GT(renderer.GetLastRenderStats().sortSeconds, 0);
+    for (uint y=0; y<20; y++)
+        for (uint x=0; x<20; x++)
+            for (uint c=0; c<3; c++)
+                EXPECT_FLOAT_EQ(sorted.GetColor(x,y)[c], megakernel.GetColor(x,y)[c]);
+}
+
+TEST_F(RendererTest, PersistentThreads) {
+    EXPECT_FALSE(renderer.GetPersistentThreads());
+    scene.AddPrimative(Sphere(1, Vector3f(1,1,-2)), Material(Color(0,0,0), Color(.9F,.9F,.9F), Material::REFRACTION));
+    AccumulationBuffer megakernel(20, 20), persistent(20, 20), waves(20, 20);
+    renderer.RenderPass(scene, camera, &megakernel, 10);
+
+    // work-items take the same samples in chunks, whether launches cover every pixel or waves of them
+    renderer.SetPersistentThreads(true);
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &persistent, 10), 10U);
+    renderer.SetLaunchSeconds(1e-9);
+    EXPECT_EQ(renderer.RenderPass(scene, camera, &waves, 10), 10U);
+    EXPECT_EQ(waves.GetTotalSampleCount(), 10U * 400);
+    for (uint y=0; y<20; y++) {
+        for (uint x=0; x<20; x++) {
+            EXPECT_EQ(persistent.GetSampleCount(x,y), 10U);
+            for (uint c=0; c<3; c++) {
+                EXPECT_NEAR(persistent.GetColor(x,y)[c], megakernel.GetColor(x,y)[c], 1e-4F * (1 + megakernel.GetColor(x,y)[c]));
+                EXPECT_NEAR(waves.GetColor(x,y)[c], megakernel.GetColor(x,y)[c], 1e-4F * (1 + megakernel.GetColor(x,y)[c]));
+            }
+            EXPECT_NEAR(persistent.GetPixel(x,y).m2, megakernel.GetPixel(x,y).m2, 1e-4F * (1 + megakernel.GetPixel(x,y).m2));
+        }
+    }
+}
+
+TEST_F(RendererTest, DeviceScene) {
+    AccumulationBuffer accumulation(20, 20), fresh(20, 20);
+    renderer.RenderPass(scene, camera, &accumulation, 2);
+    EXPECT_GT(renderer.GetLastRenderStats().uploadedBytes, 0U);
+    // the scene and pixels are still on the device
+    renderer.RenderPass(scene, camera, &accumulation, 2);
+    EXPECT_EQ(renderer.GetLastRenderStats().uploadedBytes, 0U);
+
+    // only what changed is copied, and renders the same as copying everything
+    scene.GetMaterialManager().SetMaterial(Material(Color(0,0,0), Color(.25F,.5F,.75F), Material::DIFFUSE), 0);
+    accumulation.Clear();
+    renderer.RenderPass(scene, camera, &accumulation, 4);
+    EXPECT_LT(renderer.GetLastRenderStats().uploadedBytes, sizeof(Material) + 400 * sizeof(AccumulatedPixel) + 1);
+    Renderer other(true);
+    other.RenderPass(scene, camera, &fresh, 4);
+    for (uint y=0; y<20; y++)
+        for (uint x=0; x<20; x++)
+            EXPECT_EQ(accumulation.GetColor(x,y), fresh.GetColor(x,y));
+}
+
+TEST_F(RendererTest, LargeScene) {
+    // the small scene fits in constant memory
+    AccumulationBuffer small(8, 8);
+    renderer.RenderPass(scene, camera, &small, 1);
+    EXPECT_TRUE(renderer.GetLastRenderStats().constantMemory);
+
+    // a million spheres covering the floor don't, and are read from global memory
+    Scene large;
+    large.AddPrimative(Sphere(.5F, Vector3f(2,4,1)), Material(Color(40,40,40), Color(0,0,0), Material::DIFFUSE));
+    const uint floor = large.GetMaterialManager().AddMaterial(Material(Color(0,0,0), Color(.75F,.75F,.75F), Material::DIFFUSE));
+    for (uint x=0; x<1000; x++)
+        for (uint z=0; z<1000; z++)
+            large.AddPrimative(Sphere(.01F, Vector3f(-10 + .02F*x + .01F, 0, -10 + .02F*z + .01F)), floor);
+    AccumulationBuffer accumulation(8, 8);
+    EXPECT_EQ(renderer.RenderPass(large, camera, &accumulation, 4), 4U);
+    EXPECT_FALSE(renderer.GetLastRenderStats().constantMemory);
+    // lit like the floor of the small scene
+    uint lit = 0;
+    for (uint y=0; y<8; y++)
+        for (uint x=0; x<8; x++)
+            if (AccumulatedPixel::Brightness(accumulation.GetColor(x,y)) > 0) lit++;
+    EXPECT_GT(lit, 48U);
+}
@@ -0,0 +1,118 @@
+#include "Sampler.h"
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Sampler.hpp"
+
+using Tracer::Sampler;
+using Tracer::uint;
+
+///
+/// \brief Test the numbers of every sampler
+///
+class SamplerTest : public ::testing::Test {
+protected:
+    ///
+    /// \brief Returns the numbers of two dimensions of a bounce of the first samples of a pixel
+    ///
+    static std::vector<std::pair<float,float>> Points(Sampler::Type type, uint count, uint dimension, uint x = 3, uint y = 5) {
+        std::vector<std::pair<float,float>> points;
+        for (uint i=0; i<count; i++) {
+            Sampler sampler = Sampler::Start(type, 7, x, y, i);
+            sampler.StartBounce(2);
+            points.push_back(std::make_pair(sampler.Get(dimension), sampler.Get(dimension + 1)));
+        }
+        return points;
+    }
+    ///
+    /// \brief Returns true if every cell of a grid of the points' square has the same number of points
+    ///
+    static bool Stratified(const std::vector<std::pair<float,float>> &points, uint cellsX, uint cellsY) {
+        std::vector<uint> counts(cellsX * cellsY, 0);
+        for (const auto &point : points)
+            counts[static_cast<uint>(point.second * cellsY) * cellsX + static_cast<uint>(point.first * cellsX)]++;
+        for (uint count : counts)
+            if (count != points.size() / counts.size()) return false;
+        return true;
+    }
+};
+
+TEST_F(SamplerTest, Sobol) {
+    // the start of the Sobol sequence
+    const float expected[8][2] = { {0,0}, {.5F,.5F}, {.25F,.75F}, {.75F,.25F}, {.125F,.625F}, {.625F,.125F}, {.375F,.375F}, {.875F,.875F} };
+    for (uint i=0; i<8; i++) {
+        EXPECT_EQ(Sampler::Sobol(i, 0) * (1 / 4294967296.0), expected[i][0]);
+        EXPECT_EQ(Sampler::Sobol(i, 1) * (1 / 4294967296.0), expected[i][1]);
+    }
+
+    // scrambling keeps every power of two of points in every elementary interval of the square (a (0,2) sequence)
+    for (uint dimension : { Sampler::LIGHT_U, Sampler::BSDF_U }) {
+        const auto points = Points(Sampler::SOBOL, 256, dimension);
+        for (uint count=4; count<=256; count*=4) {
+            const std::vector<std::pair<float,float>> first(points.begin(), points.begin() + count);
+            for (uint cellsX=1; cellsX<=count; cellsX*=2)
+                EXPECT_TRUE(Stratified(first, cellsX, count / cellsX)) << count << " " << cellsX;
+        }
+    }
+
+    // but differently in every pixel, bounce, and pair of dimensions
+    EXPECT_NE(Points(Sampler::SOBOL, 4, 0), Points(Sampler::SOBOL, 4, 0, 4, 5));
+    EXPECT_NE(Points(Sampler::SOBOL, 4, 0), Points(Sampler::SOBOL, 4, 2));
+    Sampler sampler = Sampler::Start(Sampler::SOBOL, 7, 3, 5, 1);
+    const float camera = sampler.Get(Sampler::CAMERA_U);
+    sampler.StartBounce(1);
+    EXPECT_NE(sampler.Get(0), camera);
+}
+
+TEST_F(SamplerTest, Stratified) {
+    // every 16 samples are in different 16ths of every dimension
+    const auto points = Points(Sampler::STRATIFIED, 64, Sampler::BSDF_U);
+    for (uint block=0; block<4; block++) {
+        const std::vector<std::pair<float,float>> samples(points.begin() + block * 16, points.begin() + block * 16 + 16);
+        EXPECT_TRUE(Stratified(samples, 16, 1));
+        EXPECT_TRUE(Stratified(samples, 1, 16));
+    }
+}
+
+TEST_F(SamplerTest, Independent) {
+    const auto points = Points(Sampler::INDEPENDENT, 4096, Sampler::LIGHT_U);
+    float mean = 0;
+    for (const auto &point : points) {
+        EXPECT_GE(point.first, 0);
+        EXPECT_LT(point.first, 1);
+        mean += (point.first + point.second) / (2 * points.size());
+    }
+    EXPECT_NEAR(mean, .5F, .01F);
+    // the same sample gives the same numbers
+    EXPECT_EQ(Points(Sampler::INDEPENDENT, 8, 2), Points(Sampler::INDEPENDENT, 8, 2));
+}
+
+TEST_F(SamplerTest, BlueNoise) {
+    // the first sample of neighboring pixels differ far more than at random (the error has no low frequencies)
+    // but over a block of pixels they are still spread evenly
+    float neighborDifference = 0;
+    std::vector<uint> histogram(8, 0);
+    for (uint y=0; y<64; y++) {
+        for (uint x=0; x<64; x++) {
+            const float value = Points(Sampler::BLUE_NOISE, 1, Sampler::BSDF_U, x, y)[0].first;
+            neighborDifference += std::fabs(value - Points(Sampler::BLUE_NOISE, 1, Sampler::BSDF_U, x + 1, y)[0].first) / 4096;
+            histogram[static_cast<uint>(value * 8)]++;
+        }
+    }
+    // the difference of independent numbers is 1/3 on average
+    EXPECT_GT(neighborDifference, .4F);
+    for (uint count : histogram)
+        EXPECT_NEAR(count, 512, 64);
+
+    // every pixel walks the same sequence, only shifted (wrapping around)
+    const auto a = Points(Sampler::BLUE_NOISE, 64, Sampler::LIGHT_U, 3, 5);
+    const auto b = Points(Sampler::BLUE_NOISE, 64, Sampler::LIGHT_U, 10, 2);
+    const float shift = a[0].first - b[0].first;
+    for (uint i=0; i<64; i++) {
+        const float difference = a[i].first - b[i].first - shift;
+        EXPECT_NEAR(difference - std::round(difference), 0, 1e-6F);
+    }
+}
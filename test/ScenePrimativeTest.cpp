@@ -2,11 +2,16 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include "ScenePrimative.hpp"
 #include "Vector.h"
 
 using Tracer::ScenePrimative;
 using Tracer::Intersection;
+using Tracer::Box;
+using Tracer::Plane;
+using Tracer::Quad;
 using Tracer::Sphere;
+using Tracer::Triangle;
 using Tracer::Vector3f;
 using Tracer::Ray;
 
@@ -17,11 +22,19 @@ class ScenePrimativeTest : public ::testing::Test {
 protected:
     ScenePrimative p1 = ScenePrimative(Sphere(1, Vector3f(1,2,3)),0);
     ScenePrimative p2 = ScenePrimative(Sphere(2, Vector3f(3,3,3)),1);
+    ScenePrimative p3 = ScenePrimative(Triangle(Vector3f(0,0,0), Vector3f(1,0,0), Vector3f(0,1,0)),2);
+    ScenePrimative p4 = ScenePrimative(Plane(Vector3f(0,-1,0), Vector3f(0,1,0)),3);
+    ScenePrimative p5 = ScenePrimative(Quad(Vector3f(0,0,0), Vector3f(1,0,0), Vector3f(0,1,0)),4);
+    ScenePrimative p6 = ScenePrimative(Box(Vector3f(0,0,0), Vector3f(1,1,1)),5);
 };
 
 TEST_F(ScenePrimativeTest, Accessors) {
     EXPECT_EQ(p1.GetMaterialId(), 0);
     EXPECT_EQ(p2.GetMaterialId(), 1);
+    EXPECT_EQ(p3.GetMaterialId(), 2);
+    EXPECT_EQ(p6.GetMaterialId(), 5);
+    EXPECT_EQ(p5.GetBoundingBox().Max(), Vector3f(1,1,0));
+    EXPECT_EQ(p6.GetBoundingBox().Max(), Vector3f(1,1,1));
     // you cannot actually get the sphere inside of the ScenePrimative since there is no need to do so yet
 }
 
@@ -29,4 +42,8 @@ TEST_F(ScenePrimativeTest, Intersection) {
     // no matter what primative is stored inside, they have to be able to intersect with a ray
     EXPECT_EQ(p1.Intersect(Ray(Vector3f(0,0,0),Vector3f(1,2,3))), (Intersection { 0.472251F, Vector3f(-0.267261F,-0.534522F,-0.801784F), Vector3f(0.472251F,0.944502F,1.41675F) }) );
     EXPECT_EQ(p2.Intersect(Ray(Vector3f(0,0,0),Vector3f(1,2,-3))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(p3.Intersect(Ray(Vector3f(.25F,.25F,5),Vector3f(0,0,-1))), (Intersection { 5, Vector3f(0,0,1), Vector3f(.25F,.25F,0) }) );
+    EXPECT_EQ(p4.Intersect(Ray(Vector3f(.25F,.25F,5),Vector3f(0,-1,0))), (Intersection { 1.25F, Vector3f(0,1,0), Vector3f(.25F,-1,5) }) );
+    EXPECT_EQ(p5.Intersect(Ray(Vector3f(.25F,.25F,5),Vector3f(0,0,-1))), (Intersection { 5, Vector3f(0,0,1), Vector3f(.25F,.25F,0) }) );
+    EXPECT_EQ(p6.Intersect(Ray(Vector3f(.25F,.25F,5),Vector3f(0,0,-1))), (Intersection { 4, Vector3f(0,0,1), Vector3f(.25F,.25F,1) }) );
 }
@@ -0,0 +1,44 @@
+#include "Transform.h"
+
+#include <gtest/gtest.h>
+
+#include "AABB.h"
+#include "Vector.h"
+
+using Tracer::AABB;
+using Tracer::Transform;
+using Tracer::Vector3f;
+
+///
+/// \brief Test affine transforms
+///
+class TransformTest : public ::testing::Test {
+protected:
+    Transform t = Transform::Translate(Vector3f(1,2,3)) * Transform::Rotate(Vector3f(0,0,1), 3.14159265F/2) * Transform::Scale(Vector3f(2,2,2));
+};
+
+TEST_F(TransformTest, Identity) {
+    EXPECT_EQ(Transform().TransformPoint(Vector3f(1,2,3)), Vector3f(1,2,3));
+    EXPECT_EQ(Transform().Inverse(), Transform());
+}
+
+TEST_F(TransformTest, TransformPoint) {
+    // scaled to (2,0,0), rotated to (0,2,0), moved to (1,4,3)
+    EXPECT_EQ(t.TransformPoint(Vector3f(1,0,0)), Vector3f(1,4,3));
+    // directions aren't moved
+    EXPECT_EQ(t.TransformVector(Vector3f(1,0,0)), Vector3f(0,2,0));
+}
+
+TEST_F(TransformTest, Inverse) {
+    const Transform inverse = t.Inverse();
+    EXPECT_EQ(inverse.TransformPoint(Vector3f(1,4,3)), Vector3f(1,0,0));
+    EXPECT_EQ(inverse * t, Transform());
+    EXPECT_EQ(t * inverse, Transform());
+}
+
+TEST_F(TransformTest, TransformBoundingBox) {
+    AABB box = t.TransformBoundingBox(AABB(Vector3f(0,0,0), Vector3f(1,1,1)));
+    EXPECT_EQ(box.Min(), Vector3f(-1,2,3));
+    EXPECT_EQ(box.Max(), Vector3f(1,4,5));
+    EXPECT_TRUE(t.TransformBoundingBox(AABB()).IsEmpty());
+}
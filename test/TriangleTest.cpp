@@ -0,0 +1,55 @@
+#include "ScenePrimative.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+
+using Tracer::Intersection;
+using Tracer::Triangle;
+using Tracer::Vector3f;
+using Tracer::Ray;
+using Tracer::uint;
+
+///
+/// \brief Test the triangle primative
+///
+class TriangleTest : public ::testing::Test {
+protected:
+    Triangle t1 = Triangle(Vector3f(0,0,0), Vector3f(1,0,0), Vector3f(0,1,0));
+    Triangle t2 = Triangle(Vector3f(1,0,0), Vector3f(1,1,0), Vector3f(0,1,0));
+};
+
+TEST_F(TriangleTest, Accessors) {
+    EXPECT_EQ(t1.GetVertex(0), Vector3f(0,0,0));
+    EXPECT_EQ(t1.GetVertex(1), Vector3f(1,0,0));
+    EXPECT_EQ(t1.GetVertex(2), Vector3f(0,1,0));
+    EXPECT_EQ(t1.GetBoundingBox().Min(), Vector3f(0,0,0));
+    EXPECT_EQ(t1.GetBoundingBox().Max(), Vector3f(1,1,0));
+}
+
+TEST_F(TriangleTest, Intersection) {
+    EXPECT_EQ(t1.Intersect(Ray(Vector3f(.25F,.25F,5),Vector3f(0,0,-1))), (Intersection { 5, Vector3f(0,0,1), Vector3f(.25F,.25F,0) }) );
+    // from behind the normal is the same (it is up to the renderer to flip it)
+    EXPECT_EQ(t1.Intersect(Ray(Vector3f(.25F,.25F,-5),Vector3f(0,0,1))), (Intersection { 5, Vector3f(0,0,1), Vector3f(.25F,.25F,0) }) );
+    // misses
+    EXPECT_EQ(t1.Intersect(Ray(Vector3f(.75F,.75F,5),Vector3f(0,0,-1))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(t1.Intersect(Ray(Vector3f(.25F,.25F,5),Vector3f(0,0,1))), Intersection::NO_INTERSECTION());
+    EXPECT_EQ(t1.Intersect(Ray(Vector3f(.25F,.25F,5),Vector3f(1,0,0))), Intersection::NO_INTERSECTION());
+}
+
+TEST_F(TriangleTest, Watertight) {
+    // rays aimed at the edge shared by both triangles must never slip through the crack
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> along(0, 1);
+    std::uniform_real_distribution<float> jitter(-1, 1);
+    for (uint i=0; i<10000; i++) {
+        const float s = along(rng);
+        const Vector3f onEdge(1-s, s, 0);
+        const Vector3f origin(onEdge.X() + jitter(rng), onEdge.Y() + jitter(rng), 3);
+        const Ray ray(origin, Vector3f(onEdge - origin).Normalize());
+        const bool hit1 = t1.Intersect(ray) != Intersection::NO_INTERSECTION();
+        const bool hit2 = t2.Intersect(ray) != Intersection::NO_INTERSECTION();
+        EXPECT_TRUE(hit1 || hit2);
+    }
+}
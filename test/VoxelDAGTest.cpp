@@ -0,0 +1,151 @@
+#include "VoxelDAG.h"
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ScenePrimative.h"
+#include "Vector.h"
+#include "VoxelDAG.hpp"
+#include "VoxelWorld.hpp"
+
+using Tracer::Intersection;
+using Tracer::Ray;
+using Tracer::Vector3f;
+using Tracer::VoxelDAG;
+using Tracer::VoxelDAGLeaf;
+using Tracer::VoxelDAGNode;
+using Tracer::VoxelWorld;
+using Tracer::uint;
+using Tracer::uint64;
+using Tracer::uint8;
+
+///
+/// \brief Test building sparse voxel DAGs from voxel worlds and tracing rays through them
+///
+class VoxelDAGTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        // scattered blocks, a solid floor, and a big hollow room
+        world = VoxelWorld(3, 2, Vector3f(5, -10, -3), .25F);
+        std::mt19937 rng(5);
+        std::uniform_int_distribution<uint> x(0, 3 * VoxelWorld::CHUNK_WIDTH - 1);
+        std::uniform_int_distribution<uint> y(0, 100);
+        std::uniform_int_distribution<uint> z(0, 2 * VoxelWorld::CHUNK_WIDTH - 1);
+        std::uniform_int_distribution<uint> block(1, 3);
+        for (uint i=0; i<2000; i++)
+            world.SetBlock(x(rng), y(rng), z(rng), static_cast<uint8>(block(rng)));
+        for (uint x=0; x<3*VoxelWorld::CHUNK_WIDTH; x++)
+            for (uint z=0; z<2*VoxelWorld::CHUNK_WIDTH; z++)
+                for (uint y=0; y<5; y++)
+                    world.SetBlock(x, y, z, 4);
+        for (uint x=2; x<40; x++)
+            for (uint z=2; z<30; z++)
+                for (uint y=120; y<160; y++)
+                    if (x == 2 || x == 39 || z == 2 || z == 29 || y == 120 || y == 159)
+                        world.SetBlock(x, y, z, 5);
+        for (uint i=1; i<=5; i++)
+            world.SetBlockMaterial(static_cast<uint8>(i), 20 + i);
+        dag.Update(world);
+    }
+    ///
+    /// \brief Expects the DAG to find the same blocks as the flat world for rays from everywhere (including inside the room)
+    ///
+    void ExpectSameAsWorld() {
+        std::mt19937 rng(9);
+        std::uniform_real_distribution<float> position(-5, 20);
+        std::uniform_real_distribution<float> height(-15, 60);
+        std::uniform_real_distribution<float> direction(-1, 1);
+        for (uint i=0; i<3000; i++) {
+            Vector3f d(direction(rng), direction(rng), direction(rng));
+            if (i % 10 == 0) d = Vector3f(0, i % 20 ? -1.F : 1.F, 0);
+            if (i % 10 == 1) d = Vector3f(0, 0, 1);
+            const Ray ray(Vector3f(position(rng), height(rng), position(rng) - 5), d.Normalize());
+            uint expectedMaterial = 0, actualMaterial = 0;
+            const Intersection expected = VoxelWorld::Intersect(ray, world.GetGrid(), world.GetChunks().data(), world.GetSectionMasks().data(),
+                                                                world.GetBlocks().data(), world.GetBlockMaterials().data(),
+                                                                std::numeric_limits<float>::infinity(), &expectedMaterial);
+            const Intersection actual = VoxelDAG::Intersect(ray, dag.GetGrid(), dag.GetChunks().data(), dag.GetSectionRoots().data(),
+                                                            dag.GetNodes().data(), dag.GetLeaves().data(), world.GetBlockMaterials().data(),
+                                                            std::numeric_limits<float>::infinity(), &actualMaterial);
+            ASSERT_EQ(actual == Intersection::NO_INTERSECTION(), expected == Intersection::NO_INTERSECTION());
+            if (expected == Intersection::NO_INTERSECTION()) continue;
+            EXPECT_NEAR(actual.Distance(), expected.Distance(), 1e-3F);
+            EXPECT_EQ(actual.Normal(), expected.Normal());
+            EXPECT_EQ(actualMaterial, expectedMaterial);
+        }
+    }
+    VoxelWorld world;
+    VoxelDAG dag;
+};
+
+TEST_F(VoxelDAGTest, Intersect) {
+    ExpectSameAsWorld();
+}
+
+TEST_F(VoxelDAGTest, Deduplicated) {
+    // much smaller than the blocks, and identical subtrees (the floor and the room's walls) are stored once
+    EXPECT_LT(dag.GetDeviceSize(), world.GetBlocks().size() / 10);
+    VoxelWorld floor(8, 8);
+    std::vector<uint8> blocks(VoxelWorld::CHUNK_BLOCKS, VoxelWorld::AIR);
+    std::fill(blocks.begin(), blocks.begin() + 64 * VoxelWorld::CHUNK_WIDTH * VoxelWorld::CHUNK_WIDTH, 1);
+    for (uint x=0; x<8; x++)
+        for (uint z=0; z<8; z++)
+            floor.SetChunk(x, z, blocks.data());
+    VoxelDAG floorDAG;
+    floorDAG.Update(floor);
+    // one node for each size and one leaf no matter how many chunks
+    EXPECT_EQ(floorDAG.GetNodes().size(), 3U);
+    EXPECT_EQ(floorDAG.GetLeaves().size(), 1U);
+    for (uint section=0; section<VoxelWorld::SECTIONS_PER_CHUNK; section++)
+        EXPECT_EQ(floorDAG.GetSectionRoots()[section] == VoxelDAG::EMPTY_NODE, section >= 4);
+}
+
+TEST_F(VoxelDAGTest, Update) {
+    // only changed chunks are rebuilt and the DAG keeps matching the world
+    const uint64 size = dag.GetNodes().size();
+    dag.Update(world);
+    EXPECT_EQ(dag.GetNodes().size(), size);
+    world.SetBlock(20, 60, 20, 2);
+    world.SetBlock(3, 4, 3, VoxelWorld::AIR);
+    world.SetChunk(2, 1, nullptr);
+    dag.Update(world);
+    ExpectSameAsWorld();
+
+    // nodes left behind by changes don't pile up
+    for (uint i=0; i<200; i++) {
+        world.SetBlock(i % 48, 50 + i % 7, i % 32, static_cast<uint8>(1 + i % 3));
+        dag.Update(world);
+    }
+    EXPECT_LT(dag.GetNodes().size(), 3 * size + 1024);
+    ExpectSameAsWorld();
+}
+
+TEST_F(VoxelDAGTest, Changes) {
+    // only the section roots of rebuilt chunks and the columns whose chunk changed are marked as changed
+    const Tracer::DirtyRanges::Stamp sectionRoots = dag.GetSectionRootChanges().GetStamp();
+    const Tracer::DirtyRanges::Stamp chunks = dag.GetChunkChanges().GetStamp();
+    const uint changedChunk = world.GetChunks()[1 * 3 + 1];
+    const uint removedChunk = world.GetChunks()[1 * 3 + 2];
+    world.SetBlock(20, 60, 20, 2);
+    world.SetChunk(2, 1, nullptr);
+    dag.Update(world);
+    std::vector<Tracer::DirtyRanges::Range> ranges;
+    ASSERT_TRUE(dag.GetSectionRootChanges().GetSince(sectionRoots, &ranges));
+    ASSERT_EQ(ranges.size(), 2U);
+    for (const Tracer::DirtyRanges::Range &range : ranges) {
+        const uint64 chunk = range.begin / VoxelWorld::SECTIONS_PER_CHUNK;
+        EXPECT_TRUE(chunk == changedChunk || chunk == removedChunk);
+        EXPECT_EQ(range.begin, chunk * VoxelWorld::SECTIONS_PER_CHUNK);
+        EXPECT_EQ(range.end, (chunk + 1) * VoxelWorld::SECTIONS_PER_CHUNK);
+    }
+    ranges.clear();
+    ASSERT_TRUE(dag.GetChunkChanges().GetSince(chunks, &ranges));
+    ASSERT_EQ(ranges.size(), 1U);
+    EXPECT_EQ(ranges[0].begin, 1U * 3 + 2);
+    EXPECT_EQ(ranges[0].end, 1U * 3 + 3);
+    EXPECT_EQ(dag.GetChunks(), world.GetChunks());
+    ExpectSameAsWorld();
+}
@@ -0,0 +1,92 @@
+#include "VoxelResidency.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Vector.h"
+#include "VoxelWorld.h"
+
+using Tracer::Vector3f;
+using Tracer::VoxelResidency;
+using Tracer::VoxelWorld;
+using Tracer::uint;
+using Tracer::uint8;
+
+///
+/// \brief Test streaming the chunks of an endless world around the camera
+///
+class VoxelResidencyTest : public ::testing::Test {
+protected:
+    ///
+    /// \brief An endless world where every chunk has a pillar as tall as (the chunk's x + 1000) % 200 and odd rows of chunks are empty
+    ///
+    static bool LoadChunk(int chunkX, int chunkZ, uint8 *blocks) {
+        if (chunkZ % 2 != 0) return false;
+        std::fill(blocks, blocks + VoxelWorld::CHUNK_BLOCKS, VoxelWorld::AIR);
+        for (uint y=0; y<static_cast<uint>((chunkX + 1000) % 200); y++)
+            blocks[VoxelWorld::BlockIndex(0, y, 0)] = 1;
+        return true;
+    }
+    ///
+    /// \brief Expects the window of the world to have the chunks of the endless world within the radius of the chunk (x,z)
+    ///
+    void ExpectWindow(const VoxelResidency &residency, const VoxelWorld &world, int centerX, int centerZ, int radius) {
+        for (int z=-radius-2; z<=radius+2; z++) {
+            for (int x=-radius-2; x<=radius+2; x++) {
+                const bool inside = x*x + z*z <= radius*radius;
+                EXPECT_EQ(residency.IsResident(centerX + x, centerZ + z), inside);
+                if (!inside || x < -radius || x > radius || z < -radius || z > radius) continue;
+                const uint worldX = static_cast<uint>(x + radius) * VoxelWorld::CHUNK_WIDTH;
+                const uint worldZ = static_cast<uint>(z + radius) * VoxelWorld::CHUNK_WIDTH;
+                const uint height = (centerZ + z) % 2 != 0 ? 0 : static_cast<uint>((centerX + x + 1000) % 200);
+                EXPECT_EQ(world.GetBlock(worldX, height, worldZ), VoxelWorld::AIR);
+                if (height > 0) {
+                    EXPECT_EQ(world.GetBlock(worldX, height - 1, worldZ), 1);
+                }
+            }
+        }
+    }
+};
+
+TEST_F(VoxelResidencyTest, FollowsEye) {
+    VoxelResidency residency(LoadChunk, 3, Vector3f(0, -64, 0), 2);
+    VoxelWorld world;
+    world.SetBlockMaterial(1, 4);
+    // the eye is in chunk (1,-2)
+    EXPECT_EQ(residency.Update(Vector3f(40, 0, -40), &world), 29U);
+    EXPECT_EQ(residency.GetResidentCount(), 29U);
+    EXPECT_EQ(world.GetGrid().chunkCountX, 7U);
+    EXPECT_EQ(world.GetGrid().origin, Vector3f(-64, -64, -160));
+    EXPECT_EQ(world.GetBlockMaterials()[1], 4U);
+    ExpectWindow(residency, world, 1, -2, 3);
+
+    // moving within the chunk loads nothing
+    EXPECT_EQ(residency.Update(Vector3f(50, 100, -35), &world), 0U);
+
+    // moving a chunk only loads the chunks that came within the radius and keeps the rest
+    EXPECT_EQ(residency.Update(Vector3f(70, 0, -40), &world), 7U);
+    ExpectWindow(residency, world, 2, -2, 3);
+    EXPECT_EQ(world.GetGrid().origin, Vector3f(-32, -64, -160));
+
+    // memory stays bounded however far the eye goes
+    for (uint i=0; i<50; i++)
+        residency.Update(Vector3f(70 + i * 100.F, 0, -40 - i * 37.F), &world);
+    EXPECT_EQ(residency.GetResidentCount(), 29U);
+    EXPECT_LE(world.GetBlocks().size(), 29U * VoxelWorld::CHUNK_BLOCKS);
+}
+
+TEST_F(VoxelResidencyTest, MaxLoadsPerUpdate) {
+    // the closest chunks are loaded first
+    VoxelResidency residency(LoadChunk, 2, Vector3f(), 1, 5);
+    VoxelWorld world;
+    EXPECT_EQ(residency.Update(Vector3f(8, 0, 8), &world), 5U);
+    EXPECT_TRUE(residency.IsResident(0, 0));
+    EXPECT_TRUE(residency.IsResident(1, 0));
+    EXPECT_TRUE(residency.IsResident(0, -1));
+    EXPECT_FALSE(residency.IsResident(2, 0));
+    EXPECT_EQ(residency.Update(Vector3f(8, 0, 8), &world), 5U);
+    EXPECT_EQ(residency.Update(Vector3f(8, 0, 8), &world), 3U);
+    EXPECT_EQ(residency.Update(Vector3f(8, 0, 8), &world), 0U);
+    ExpectWindow(residency, world, 0, 0, 2);
+}
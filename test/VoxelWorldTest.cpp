@@ -0,0 +1,187 @@
+#include "VoxelWorld.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ScenePrimative.h"
+#include "Vector.h"
+#include "VoxelWorld.hpp"
+
+using Tracer::Intersection;
+using Tracer::Ray;
+using Tracer::Vector3f;
+using Tracer::VoxelWorld;
+using Tracer::uint;
+using Tracer::uint8;
+
+///
+/// \brief Test storing blocks in chunks and tracing rays through them
+///
+class VoxelWorldTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        // a 3x2 chunk world with one column of chunks left empty, scaled and moved away from the origin
+        world = VoxelWorld(3, 2, Vector3f(-20, 5, 10), .5F);
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<uint> x(0, 2 * VoxelWorld::CHUNK_WIDTH - 1);
+        std::uniform_int_distribution<uint> y(0, 80);
+        std::uniform_int_distribution<uint> z(0, 2 * VoxelWorld::CHUNK_WIDTH - 1);
+        std::uniform_int_distribution<uint> block(1, 4);
+        for (uint i=0; i<3000; i++)
+            world.SetBlock(x(rng), y(rng), z(rng), static_cast<uint8>(block(rng)));
+        // a lone block high up in the last column
+        world.SetBlock(40, 200, 20, 5);
+        for (uint i=1; i<=5; i++)
+            world.SetBlockMaterial(static_cast<uint8>(i), 10 + i);
+    }
+    ///
+    /// \brief Finds the closest block by testing the ray against every block
+    ///
+    Intersection BruteForce(const Ray &ray, uint *materialId) {
+        const Vector3f origin = (ray.origin - world.GetGrid().origin) * (1 / world.GetGrid().blockSize);
+        const Vector3f direction = ray.direction * (1 / world.GetGrid().blockSize);
+        Intersection best = Intersection::NO_INTERSECTION();
+        for (uint x=0; x<3*VoxelWorld::CHUNK_WIDTH; x++) {
+            for (uint y=0; y<VoxelWorld::CHUNK_HEIGHT; y++) {
+                for (uint z=0; z<2*VoxelWorld::CHUNK_WIDTH; z++) {
+                    const uint8 block = world.GetBlock(x, y, z);
+                    if (block == VoxelWorld::AIR) continue;
+                    const float min[3] = { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) };
+                    float tNear = 0, tFar = std::numeric_limits<float>::infinity();
+                    int axis = -1;
+                    for (uint a=0; a<3; a++) {
+                        float t0 = (min[a] - origin[a]) / direction[a];
+                        float t1 = (min[a] + 1 - origin[a]) / direction[a];
+                        if (t0 > t1) std::swap(t0, t1);
+                        if (t0 > tNear) { tNear = t0; axis = static_cast<int>(a); }
+                        tFar = std::min(tFar, t1);
+                    }
+                    if (axis == -1 || tNear > tFar || tNear >= best.Distance()) continue;
+                    Vector3f normal;
+                    normal[axis] = direction[axis] < 0 ? 1.F : -1.F;
+                    best = Intersection(tNear, normal, ray.origin + ray.direction * tNear);
+                    *materialId = world.GetBlockMaterials()[block];
+                }
+            }
+        }
+        return best;
+    }
+    ///
+    /// \brief Traces the ray through the world
+    ///
+    Intersection Trace(const Ray &ray, float maxDistance, uint *materialId) {
+        return VoxelWorld::Intersect(ray, world.GetGrid(), world.GetChunks().data(), world.GetSectionMasks().data(),
+                                     world.GetBlocks().data(), world.GetBlockMaterials().data(), maxDistance, materialId);
+    }
+    VoxelWorld world;
+};
+
+TEST_F(VoxelWorldTest, Blocks) {
+    EXPECT_EQ(world.GetBlock(40, 200, 20), 5);
+    EXPECT_EQ(world.GetBlock(40, 199, 20), VoxelWorld::AIR);
+    EXPECT_EQ(world.GetBlockMaterials()[5], 15U);
+    // only chunks with blocks are stored
+    EXPECT_EQ(world.GetChunks().size(), 6U);
+    EXPECT_EQ(world.GetChunks()[2], VoxelWorld::EMPTY_CHUNK);
+    EXPECT_EQ(world.GetSectionMasks().size(), 5U);
+    EXPECT_EQ(world.GetBlocks().size(), 5U * VoxelWorld::CHUNK_BLOCKS);
+    EXPECT_THROW(world.SetBlock(48, 0, 0, 1), std::out_of_range);
+    EXPECT_THROW(world.GetBlock(0, 256, 0), std::out_of_range);
+
+    // sections are marked while they have blocks in them
+    const uint chunk = world.GetChunks()[5];
+    EXPECT_EQ(world.GetSectionMasks()[chunk], 1U << 12);
+    world.SetBlock(40, 201, 20, 1);
+    world.SetBlock(40, 200, 20, VoxelWorld::AIR);
+    EXPECT_EQ(world.GetSectionMasks()[chunk], 1U << 12);
+    world.SetBlock(40, 201, 20, VoxelWorld::AIR);
+    EXPECT_EQ(world.GetSectionMasks()[chunk], 0U);
+
+    // air doesn't create chunks
+    VoxelWorld empty(1, 1);
+    empty.SetBlock(0, 0, 0, VoxelWorld::AIR);
+    EXPECT_TRUE(empty.IsEmpty());
+    EXPECT_TRUE(VoxelWorld().IsEmpty());
+}
+
+TEST_F(VoxelWorldTest, Intersect) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> position(-30, 15);
+    std::uniform_real_distribution<float> height(0, 140);
+    std::uniform_real_distribution<float> target(0, 1);
+    uint hits = 0;
+    for (uint i=0; i<400; i++) {
+        // rays aim at the blocks (some start inside the world, in air) and some are axis aligned
+        Vector3f origin(position(rng), height(rng), position(rng) + 15);
+        Vector3f d = Vector3f(-20 + 16 * target(rng), 5 + 40 * target(rng), 10 + 16 * target(rng)) - origin;
+        if (i % 8 == 0) d = Vector3f(0, i % 16 ? -1.F : 1.F, 0);
+        if (i % 8 == 1) d = Vector3f(1, 0, 0);
+        const Vector3f inWorld = (origin - world.GetGrid().origin) * (1 / world.GetGrid().blockSize);
+        if (inWorld.X() >= 0 && inWorld.X() < 48 && inWorld.Y() >= 0 && inWorld.Y() < 256 && inWorld.Z() >= 0 && inWorld.Z() < 32 &&
+                world.GetBlock(static_cast<uint>(inWorld.X()), static_cast<uint>(inWorld.Y()), static_cast<uint>(inWorld.Z())) != VoxelWorld::AIR)
+            continue;
+        const Ray ray(origin, d.Normalize());
+
+        uint expectedMaterial = 0, actualMaterial = 0;
+        const Intersection expected = BruteForce(ray, &expectedMaterial);
+        const Intersection actual = Trace(ray, std::numeric_limits<float>::infinity(), &actualMaterial);
+        ASSERT_EQ(actual == Intersection::NO_INTERSECTION(), expected == Intersection::NO_INTERSECTION());
+        if (expected == Intersection::NO_INTERSECTION()) continue;
+        hits++;
+        EXPECT_NEAR(actual.Distance(), expected.Distance(), 1e-3F);
+        EXPECT_EQ(actual.Normal(), expected.Normal());
+        EXPECT_EQ(actualMaterial, expectedMaterial);
+
+        // nothing is found past the max distance
+        EXPECT_EQ(Trace(ray, expected.Distance() * .99F, &actualMaterial), Intersection::NO_INTERSECTION());
+    }
+    EXPECT_GT(hits, 100U);
+}
+
+TEST_F(VoxelWorldTest, LeavingBlock) {
+    // a ray leaving the top face of a block doesn't hit it again but finds the block above it
+    VoxelWorld tower(1, 1);
+    tower.SetBlock(3, 10, 3, 1);
+    tower.SetBlock(3, 20, 3, 2);
+    tower.SetBlockMaterial(2, 7);
+    uint materialId = 0;
+    const Intersection intersection = VoxelWorld::Intersect(Ray(Vector3f(3.5F, 11, 3.5F), Vector3f(0, 1, 0)), tower.GetGrid(), tower.GetChunks().data(),
+                                                            tower.GetSectionMasks().data(), tower.GetBlocks().data(), tower.GetBlockMaterials().data(),
+                                                            std::numeric_limits<float>::infinity(), &materialId);
+    EXPECT_EQ(intersection, Intersection(9, Vector3f(0, -1, 0), Vector3f(3.5F, 20, 3.5F)));
+    EXPECT_EQ(materialId, 7U);
+}
+
+TEST_F(VoxelWorldTest, Chunks) {
+    // whole chunks can be replaced and removed
+    std::vector<uint8> blocks(VoxelWorld::CHUNK_BLOCKS, VoxelWorld::AIR);
+    blocks[VoxelWorld::BlockIndex(1, 2, 3)] = 9;
+    blocks[VoxelWorld::BlockIndex(4, 100, 5)] = 8;
+    world.SetChunk(2, 0, blocks.data());
+    EXPECT_EQ(world.GetBlock(33, 2, 3), 9);
+    EXPECT_EQ(world.GetSectionMasks()[world.GetChunks()[2]], 1U | 1U << 6);
+    EXPECT_EQ(world.GetChunkCount(), 6U);
+    world.SetChunk(0, 0, nullptr);
+    EXPECT_EQ(world.GetChunkCount(), 5U);
+    EXPECT_EQ(world.GetBlock(0, 0, 0), VoxelWorld::AIR);
+    // removed chunks are reused
+    world.SetBlock(3, 3, 3, 1);
+    EXPECT_EQ(world.GetChunkCount(), 6U);
+    EXPECT_EQ(world.GetBlocks().size(), 6U * VoxelWorld::CHUNK_BLOCKS);
+    EXPECT_EQ(world.GetBlock(3, 3, 3), 1);
+    EXPECT_EQ(world.GetBlock(1, 2, 3), VoxelWorld::AIR);
+
+    // shifting keeps the chunks that stay in the world
+    const Vector3f origin = world.GetGrid().origin;
+    world.ShiftChunks(2, 1);
+    EXPECT_EQ(world.GetGrid().origin, origin + Vector3f(16, 0, 8));
+    EXPECT_EQ(world.GetChunkCount(), 1U);
+    EXPECT_EQ(world.GetBlock(1, 2, 3), VoxelWorld::AIR);
+    EXPECT_EQ(world.GetBlock(8, 200, 4), 5);
+    EXPECT_THROW(world.SetChunk(3, 0, nullptr), std::out_of_range);
+}
@@ -0,0 +1,219 @@
+#include "WideBVH.h"
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "AccelerationStructure.hpp"
+#include "BVH.hpp"
+#include "RandomSpheres.h"
+#include "Scene.h"
+#include "ScenePrimative.hpp"
+#include "Vector.h"
+#include "WideBVH.hpp"
+
+using Tracer::AccelerationStructure;
+using Tracer::BVH;
+using Tracer::BVH4Node;
+using Tracer::BVH8Node;
+using Tracer::BVHNode;
+using Tracer::ClosestPrimativeIntersector;
+using Tracer::Intersection;
+using Tracer::Ray;
+using Tracer::Scene;
+using Tracer::ScenePrimative;
+using Tracer::Sphere;
+using Tracer::Transform;
+using Tracer::TraverseBVH;
+using Tracer::Triangle;
+using Tracer::Vector3f;
+using Tracer::WideBVH;
+using Tracer::WideBVHNode;
+using Tracer::uint;
+
+///
+/// \brief Test collapsing binary BVHs into wide BVHs and traversing them
+///
+class WideBVHTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        primatives = RandomSpheres(2000);
+        bvh.Build(primatives);
+    }
+    ///
+    /// \brief Expects the wide nodes to find exactly what the binary nodes find
+    ///
+    template<uint Width>
+    void ExpectSameAsBinary(const std::vector<WideBVHNode<Width>> &wideNodes, uint wideRoot) {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-150, 150);
+        for (uint i=0; i<2000; i++) {
+            // some rays are axis aligned (infinite inverse directions)
+            Vector3f direction(position(rng), position(rng), position(rng));
+            if (i % 10 == 0) direction = Vector3f(0, i % 20 ? 1.F : -1.F, 0);
+            const Ray ray(Vector3f(position(rng), position(rng), position(rng)), direction.Normalize());
+
+            ClosestPrimativeIntersector<const ScenePrimative*> expected(ray, primatives.data());
+            TraverseBVH(ray, bvh.GetNodes().data(), bvh.GetIndices().data(), 0, &expected);
+            ClosestPrimativeIntersector<const ScenePrimative*> actual(ray, primatives.data());
+            TraverseBVH(ray, wideNodes.data(), bvh.GetIndices().data(), wideRoot, &actual);
+            EXPECT_EQ(actual.bestIntersection, expected.bestIntersection);
+            EXPECT_EQ(actual.primativeId, expected.primativeId);
+        }
+    }
+    std::vector<ScenePrimative> primatives;
+    BVH bvh;
+};
+
+TEST_F(WideBVHTest, Collapse4) {
+    std::vector<BVH4Node> nodes;
+    EXPECT_EQ(WideBVH<4>::Collapse(bvh.GetNodes(), 0, &nodes), 0);
+    // far fewer nodes than the binary tree
+    EXPECT_LT(nodes.size(), bvh.GetNodes().size() / 2);
+
+    // every primative is still referenced exactly once
+    std::vector<uint> referenced(primatives.size(), 0);
+    for (const BVH4Node &node : nodes)
+        for (uint i=0; i<4; i++)
+            for (uint j=node.child[i]; node.count[i] > 0 && j<node.child[i]+node.count[i]; j++)
+                referenced[bvh.GetIndices()[j]]++;
+    for (uint count : referenced)
+        EXPECT_EQ(count, 1);
+
+    ExpectSameAsBinary(nodes, 0);
+}
+
+TEST_F(WideBVHTest, Collapse8) {
+    std::vector<BVH8Node> nodes;
+    // collapsing appends to what is already there
+    nodes.push_back(BVH8Node());
+    const uint root = WideBVH<8>::Collapse(bvh.GetNodes(), 0, &nodes);
+    EXPECT_EQ(root, 1);
+    ExpectSameAsBinary(nodes, root);
+}
+
+TEST_F(WideBVHTest, FewerPrimativesThanChildren) {
+    // tiny (and empty) trees can't fill a wide node so the rest of its children are unused
+    const std::vector<ScenePrimative> spheres = primatives;
+    for (uint count=0; count<10; count++) {
+        primatives.assign(spheres.begin(), spheres.begin() + count);
+        bvh.Build(primatives);
+        std::vector<BVH4Node> nodes4;
+        std::vector<BVH8Node> nodes8;
+        WideBVH<4>::Collapse(bvh.GetNodes(), 0, &nodes4);
+        WideBVH<8>::Collapse(bvh.GetNodes(), 0, &nodes8);
+        if (count <= BVH::MIN_LEAF_SIZE) {
+            // a single leaf, or nothing at all
+            const uint emptyChild = BVH4Node::EMPTY_CHILD;
+            ASSERT_EQ(nodes4.size(), 1);
+            EXPECT_EQ(nodes4[0].count[0], count);
+            for (uint i=count > 0 ? 1 : 0; i<4; i++)
+                EXPECT_EQ(nodes4[0].child[i], emptyChild);
+        }
+        // every primative is still referenced exactly once
+        uint referenced = 0;
+        for (const BVH8Node &node : nodes8)
+            for (uint i=0; i<8; i++)
+                referenced += node.count[i];
+        EXPECT_EQ(referenced, count);
+        ExpectSameAsBinary(nodes4, 0);
+        ExpectSameAsBinary(nodes8, 0);
+    }
+}
+
+TEST_F(WideBVHTest, SlabTest) {
+    // the (possibly SIMD) 4 wide test must match testing each child's box alone
+    std::vector<BVH4Node> nodes;
+    WideBVH<4>::Collapse(bvh.GetNodes(), 0, &nodes);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> position(-150, 150);
+    for (uint i=0; i<200; i++) {
+        const Ray ray(Vector3f(position(rng), position(rng), position(rng)), Vector3f(position(rng), position(rng), position(rng)).Normalize());
+        const Vector3f invDirection(1/ray.direction.X(), 1/ray.direction.Y(), 1/ray.direction.Z());
+        for (const BVH4Node &node : nodes) {
+            float distances[4];
+            node.Intersect(ray, invDirection, 200, distances);
+            for (uint c=0; c<4; c++) {
+                BVHNode box;
+                box.boundsMin[0] = node.boundsMinX[c]; box.boundsMin[1] = node.boundsMinY[c]; box.boundsMin[2] = node.boundsMinZ[c];
+                box.boundsMax[0] = node.boundsMaxX[c]; box.boundsMax[1] = node.boundsMaxY[c]; box.boundsMax[2] = node.boundsMaxZ[c];
+                EXPECT_EQ(distances[c], box.Intersect(ray, invDirection, 200));
+            }
+        }
+    }
+}
+
+template<uint Width>
+static void ExpectSlabsOnFaces() {
+    // rays starting on a face of a child and parallel to it (0*INF is NaN) must be tested exactly like the scalar test
+    // children: the unit box, and boxes flat along some axes
+    WideBVHNode<Width> node;
+    for (uint c=0; c<Width; c++) {
+        node.boundsMinX[c] = node.boundsMinY[c] = node.boundsMinZ[c] = 0;
+        node.boundsMaxX[c] = c & 1 ? 0.F : 1.F;
+        node.boundsMaxY[c] = c & 2 ? 0.F : 1.F;
+        node.boundsMaxZ[c] = c & 4 ? 0.F : 1.F;
+    }
+    const float positions[] = { -1, 0, .5F, 1 };
+    const float directions[] = { 0.F, -0.F, 1, -1, .5F };
+    for (float x : positions) for (float y : positions) for (float z : positions)
+    for (float dx : directions) for (float dy : directions) for (float dz : directions) {
+        if (dx == 0 && dy == 0 && dz == 0) continue;
+        const Ray ray(Vector3f(x, y, z), Vector3f(dx, dy, dz));
+        const Vector3f invDirection(1/dx, 1/dy, 1/dz);
+        float distances[Width];
+        node.Intersect(ray, invDirection, 100, distances);
+        for (uint c=0; c<Width; c++) {
+            BVHNode box;
+            box.boundsMin[0] = node.boundsMinX[c]; box.boundsMin[1] = node.boundsMinY[c]; box.boundsMin[2] = node.boundsMinZ[c];
+            box.boundsMax[0] = node.boundsMaxX[c]; box.boundsMax[1] = node.boundsMaxY[c]; box.boundsMax[2] = node.boundsMaxZ[c];
+            EXPECT_EQ(distances[c], box.Intersect(ray, invDirection, 100));
+        }
+    }
+}
+
+TEST_F(WideBVHTest, SlabTestOnFaces) {
+    ExpectSlabsOnFaces<4>();
+    ExpectSlabsOnFaces<8>();
+}
+
+TEST_F(WideBVHTest, AccelerationStructure) {
+    // instances and scene primatives are found the same way with every node width
+    Scene scene;
+    std::vector<ScenePrimative> object;
+    object.push_back(ScenePrimative(Sphere(1, Vector3f(0,1,0)), 0));
+    object.push_back(ScenePrimative(Triangle(Vector3f(-2,0,-2), Vector3f(0,0,2), Vector3f(2,0,-2)), 1));
+    const uint objectId = scene.AddObject(object);
+    for (uint i=0; i<100; i++)
+        scene.AddInstance(objectId, Transform::Translate(Vector3f(i % 10 * 5.F, i / 10 * 5.F, 0)), i % 3 ? 2 : Tracer::Instance::NO_MATERIAL_OVERRIDE);
+    for (uint i=0; i<500; i++)
+        scene.AddPrimative(primatives[i]);
+
+    AccelerationStructure structure;
+    structure.Build(scene);
+    AccelerationStructure wideStructure;
+    wideStructure.Build(scene);
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> position(-100, 100);
+    for (uint width : {4U, 8U}) {
+        wideStructure.SetNodeWidth(width);
+        for (uint i=0; i<1000; i++) {
+            const Ray ray(Vector3f(position(rng), position(rng), -100), Vector3f(position(rng) / 4, position(rng) / 4, 100).Normalize());
+            const auto &s = structure;
+            const auto &w = wideStructure;
+            uint expectedMaterial = 0, actualMaterial = 0;
+            const Intersection expected = AccelerationStructure::Intersect(ray, s.GetNodes().data(), s.GetIndices().data(), s.GetPrimatives().data(),
+                                                                           s.GetInstances().data(), 100, s.GetTopLevelRoot(), &expectedMaterial);
+            const Intersection actual = width == 4 ?
+                        AccelerationStructure::Intersect(ray, w.GetNodes4().data(), w.GetIndices().data(), w.GetPrimatives().data(),
+                                                         w.GetInstances().data(), 100, w.GetWideTopLevelRoot(), &actualMaterial)
+                      : AccelerationStructure::Intersect(ray, w.GetNodes8().data(), w.GetIndices().data(), w.GetPrimatives().data(),
+                                                         w.GetInstances().data(), 100, w.GetWideTopLevelRoot(), &actualMaterial);
+            EXPECT_EQ(actual, expected);
+            EXPECT_EQ(actualMaterial, expectedMaterial);
+        }
+    }
+    EXPECT_THROW(wideStructure.SetNodeWidth(3), std::invalid_argument);
+}